@@ -59,6 +59,8 @@ String config_database =
 "set rs_mysqlUser \"racesow\" \n" +
 "set rs_mysqlDb \"racesow\" \n" +
 "set rs_mysqlPass \"secret\" \n" +
+"// Number of database workers, each one holds its own connection\n" +
+"set rs_mysqlWorkers \"4\" \n" +
 "// Enable ingame registration\n" +
 "set rs_registrationDisabled \"1\" \n" +
 "// Registration instructions for the player\n" +
@@ -30,6 +30,24 @@ class Racesow_Player_Race : Racesow_Player_Implemented
 	 */
     uint stopTime;
 
+	/**
+	 * Time when the start trigger was touched, with sub-millisecond precision
+	 * @var double
+	 */
+    double preciseStartTime;
+
+	/**
+	 * Time when the finish trigger was touched, with sub-millisecond precision
+	 * @var double
+	 */
+    double preciseStopTime;
+
+	/**
+	 * Checkpoints of the race with sub-millisecond precision
+	 * @var double
+	 */
+    double[] preciseCheckPoints;
+
 	/**
 	 * Distance when started race
 	 * @var uint64
@@ -74,13 +92,17 @@ class Racesow_Player_Race : Racesow_Player_Implemented
 		this.delta = 0;
 		this.stopTime = 0;
 		this.checkPoints.resize( numCheckpoints );
+		this.preciseCheckPoints.resize( numCheckpoints );
 		this.lastCheckPoint = 0;
 		this.startTime = 0;
+		this.preciseStartTime = 0;
+		this.preciseStopTime = 0;
 		this.prejumped = false;
 
 		for ( int i = 0; i < numCheckpoints; i++ )
 		{
             this.checkPoints[i] = 0;
+            this.preciseCheckPoints[i] = 0;
 		}
     }
 
@@ -111,7 +133,32 @@ class Racesow_Player_Race : Racesow_Player_Implemented
 	 */
 	uint getTime()
 	{
-		return this.stopTime - this.startTime;
+		return this.preciseToTime( this.getPreciseTime(), this.stopTime - this.startTime );
+	}
+
+	/**
+	 * Get the race time with sub-millisecond precision, measured from
+	 * the moments the start and finish triggers were touched
+	 * @return double
+	 */
+	double getPreciseTime()
+	{
+		return this.preciseStopTime - this.preciseStartTime;
+	}
+
+	/**
+	 * Round a precise time to milliseconds, the frame time is used
+	 * when the precise one isn't valid
+	 * @param double preciseTime
+	 * @param uint time
+	 * @return uint
+	 */
+	uint preciseToTime( double preciseTime, uint time )
+	{
+		if ( preciseTime < 0 )
+			return time;
+
+		return uint( preciseTime + 0.5 );
 	}
 
 	/**
@@ -190,7 +237,8 @@ class Racesow_Player_Race : Racesow_Player_Implemented
 		if ( this.checkPoints[id] != 0 ) // already past this checkPoint
             return;
 
-		this.checkPoints[id] = serverTime - this.startTime;
+		this.preciseCheckPoints[id] = this.player.getClient().getTouchTime() - this.preciseStartTime;
+		this.checkPoints[id] = this.preciseToTime( this.preciseCheckPoints[id], serverTime - this.startTime );
 
 		uint newTime = this.checkPoints[id];
 		uint serverBestTime = map.getHighScore().getCheckPoint(id);
@@ -243,6 +291,7 @@ class Racesow_Player_Race : Racesow_Player_Implemented
 	{
 		clearCheckpoints();
 		this.startTime = serverTime;
+		this.preciseStartTime = this.player.getClient().getTouchTime();
 		this.startDistance = this.player.distance;
 	}
 
@@ -256,6 +305,7 @@ class Racesow_Player_Race : Racesow_Player_Implemented
             return false;
 
         this.stopTime = serverTime;
+		this.preciseStopTime = this.player.getClient().getTouchTime();
 		this.stopDistance = this.player.distance;
 		this.timeStamp = localTime;
 
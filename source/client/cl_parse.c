@@ -568,8 +568,9 @@ static size_t CL_WebDownloadReadCb( const void *buf, size_t numb, float percenta
 	// have to use Sys_Milliseconds because cls.realtime might be old from Web_Get
 	cls.download.timeout = Sys_Milliseconds() + 3000;
 	cls.download.retries = 0;
+	cls.download.lost = qfalse;
 
-	CL_AddReliableCommand( va( "nextdl \"%s\" %i", cls.download.name, cls.download.offset ) );
+	CL_AddReliableCommand( va( "nextdl \"%s\" %i 1", cls.download.name, cls.download.offset ) );
 }
 
 /*
@@ -597,6 +598,7 @@ void CL_StopServerDownload( void )
 	cls.download.percent = 0;
 	cls.download.timeout = 0;
 	cls.download.retries = 0;
+	cls.download.lost = qfalse;
 	cls.download.web = qfalse;
 
 	Cvar_ForceSet( "cl_download_name", "" );
@@ -622,7 +624,7 @@ static void CL_RetryDownload( void )
 	else
 	{
 		cls.download.timeout = Sys_Milliseconds() + 3000;
-		CL_AddReliableCommand( va( "nextdl \"%s\" %i", cls.download.name, cls.download.offset ) );
+		CL_AddReliableCommand( va( "nextdl \"%s\" %i 1", cls.download.name, cls.download.offset ) );
 	}
 }
 
@@ -749,9 +751,14 @@ static void CL_ParseDownload( msg_t *msg )
 
 	if( cls.download.offset != offset )
 	{
-		Com_Printf( "Error: Download message for wrong position\n" );
+		// the server keeps several blocks in flight, so skip the ones following a lost
+		// block until it resends from where we are
 		msg->readcount += size;
-		CL_RetryDownload();
+		if( offset > cls.download.offset && !cls.download.lost )
+		{
+			cls.download.lost = qtrue;
+			CL_AddReliableCommand( va( "nextdl \"%s\" %i 1", cls.download.name, cls.download.offset ) );
+		}
 		return;
 	}
 
@@ -767,8 +774,9 @@ static void CL_ParseDownload( msg_t *msg )
 	{
 		cls.download.timeout = Sys_Milliseconds() + 3000;
 		cls.download.retries = 0;
+		cls.download.lost = qfalse;
 
-		CL_AddReliableCommand( va( "nextdl \"%s\" %i", cls.download.name, cls.download.offset ) );
+		CL_AddReliableCommand( va( "nextdl \"%s\" %i 1", cls.download.name, cls.download.offset ) );
 	}
 	else
 	{
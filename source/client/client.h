@@ -152,6 +152,7 @@ typedef struct
 	int filenum;
 	size_t offset;
 	int retries;
+	qboolean lost;                  // told the server about a lost block, until the download is in order again
 	size_t baseoffset;				// for download speed calculation when resuming downloads
 
 	// web download
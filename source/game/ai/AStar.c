@@ -30,6 +30,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 static short int alist[MAX_NODES];  //list contains all studied nodes, Open and Closed together
 static int alist_numNodes;
 
+static short int aheap[MAX_NODES];  //binary heap of the open nodes, by F and then by their order in alist
+static int aheap_numNodes;
+
 enum
 {
 	NOLIST,
@@ -44,6 +47,8 @@ typedef struct
 	int H;
 
 	short int list;
+	short int order;	//position in alist
+	short int heapIndex;
 
 } astarnode_t;
 
@@ -59,7 +64,28 @@ static short int goalNode;
 static short int currentNode;
 
 static int ValidLinksMask;
-#define DEFAULT_MOVETYPES_MASK ( LINK_MOVE|LINK_STAIRS|LINK_FALL|LINK_WATER|LINK_WATERJUMP|LINK_JUMPPAD|LINK_PLATFORM|LINK_TELEPORT );
+#define DEFAULT_MOVETYPES_MASK ( LINK_MOVE|LINK_STAIRS|LINK_FALL|LINK_WATER|LINK_WATERJUMP|LINK_JUMPPAD|LINK_PLATFORM|LINK_TELEPORT )
+
+//==========================================
+// next hop tables: the first node of the shortest path between any two nodes,
+// for the movetypes bots use, so paths are read instead of searched
+//==========================================
+#define	HOP_FILE_VERSION 1
+#define HOP_FILE_EXTENSION "hop"
+#define ASTAR_MAX_HOPTABLES 4
+
+typedef struct
+{
+	int movetypes;
+	int numNodes;
+	unsigned int checksum;	// of the nodes and links the table was made from
+	int linksVersion;		// nav.linksVersion when the checksum was last compared
+	short int *next;	//[from * numNodes + to], NODE_INVALID if unreachable
+	int *dist;
+} astarhops_t;
+
+static astarhops_t astarhops[ASTAR_MAX_HOPTABLES];
+static int astarhops_num;
 //==========================================
 //
 //
@@ -84,9 +110,92 @@ int AStar_nodeIsInOpen( int node )
 
 static void AStar_InitLists( void )
 {
-	memset( astarnodes, 0, sizeof( astarnodes ) ); //jabot092
+	int i;
+
+	//only the studied nodes were touched
+	for( i = 0; i < alist_numNodes; i++ )
+		memset( &astarnodes[alist[i]], 0, sizeof( astarnode_t ) );
 	if( Apath ) Apath->numNodes = 0;
 	alist_numNodes = 0;
+	aheap_numNodes = 0;
+}
+
+static void AStar_AddToList( int node )
+{
+	astarnodes[node].order = alist_numNodes;
+	alist[alist_numNodes] = node;
+	alist_numNodes++;
+}
+
+//==========================================
+// open list heap
+//==========================================
+
+static qboolean AStar_HeapLess( int n1, int n2 )
+{
+	int F1 = astarnodes[n1].G + astarnodes[n1].H;
+	int F2 = astarnodes[n2].G + astarnodes[n2].H;
+
+	if( F1 != F2 )
+		return ( F1 < F2 );
+
+	return ( astarnodes[n1].order < astarnodes[n2].order );
+}
+
+static void AStar_HeapSet( int index, int node )
+{
+	aheap[index] = node;
+	astarnodes[node].heapIndex = index;
+}
+
+static void AStar_HeapUp( int node )
+{
+	int index = astarnodes[node].heapIndex;
+	int parent;
+
+	while( index > 0 )
+	{
+		parent = ( index - 1 ) >> 1;
+		if( !AStar_HeapLess( node, aheap[parent] ) )
+			break;
+		AStar_HeapSet( index, aheap[parent] );
+		index = parent;
+	}
+
+	AStar_HeapSet( index, node );
+}
+
+static void AStar_HeapPush( int node )
+{
+	astarnodes[node].heapIndex = aheap_numNodes++;
+	AStar_HeapUp( node );
+}
+
+static int AStar_HeapPop( void )
+{
+	int best, node, index, child;
+
+	if( !aheap_numNodes )
+		return -1;
+
+	best = aheap[0];
+	node = aheap[--aheap_numNodes];
+
+	index = 0;
+	while( ( child = ( index << 1 ) + 1 ) < aheap_numNodes )
+	{
+		if( child + 1 < aheap_numNodes && AStar_HeapLess( aheap[child + 1], aheap[child] ) )
+			child++;
+		if( !AStar_HeapLess( aheap[child], node ) )
+			break;
+		AStar_HeapSet( index, aheap[child] );
+		index = child;
+	}
+
+	if( aheap_numNodes )
+		AStar_HeapSet( index, node );
+
+	return best;
 }
 
 static int AStar_PLinkDistance( int n1, int n2 )
@@ -134,10 +243,7 @@ static int  Astar_HDist_ManhatanGuess( int node )
 static void AStar_PutInClosed( int node )
 {
 	if( !astarnodes[node].list )
-	{
-		alist[alist_numNodes] = node;
-		alist_numNodes++;
-	}
+		AStar_AddToList( node );
 
 	astarnodes[node].list = CLOSEDLIST;
 }
@@ -177,6 +283,7 @@ static void AStar_PutAdjacentsInOpen( int node )
 				{
 					astarnodes[addnode].parent = node;
 					astarnodes[addnode].G = astarnodes[node].G + plinkDist;
+					AStar_HeapUp( addnode );
 				}
 			}
 		}
@@ -199,40 +306,21 @@ static void AStar_PutAdjacentsInOpen( int node )
 
 			//put in global list
 			if( !astarnodes[addnode].list )
-			{
-				alist[alist_numNodes] = addnode;
-				alist_numNodes++;
-			}
+				AStar_AddToList( addnode );
 
 			astarnodes[addnode].parent = node;
 			astarnodes[addnode].G = astarnodes[node].G + plinkDist;
 			astarnodes[addnode].H = Astar_HDist_ManhatanGuess( addnode );
 			astarnodes[addnode].list = OPENLIST;
+			AStar_HeapPush( addnode );
 		}
 	}
 }
 
 static int AStar_FindInOpen_BestF( void )
 {
-	int i;
-	int bestF = -1;
-	int best = -1;
-
-	for( i = 0; i < alist_numNodes; i++ )
-	{
-		int node = alist[i];
-
-		if( astarnodes[node].list != OPENLIST )
-			continue;
-
-		if( bestF == -1 || bestF > ( astarnodes[node].G + astarnodes[node].H ) )
-		{
-			bestF = astarnodes[node].G + astarnodes[node].H;
-			best = node;
-		}
-	}
-	//printf("BEST:%i\n", best);
-	return best;
+	//the first one with the lowest F, it's closed right after
+	return AStar_HeapPop();
 }
 
 static void AStar_ListsToPath( void )
@@ -292,13 +380,340 @@ int AStar_ResolvePath( int n1, int n2, int movetypes )
 	return 1;
 }
 
+//==========================================
+// AStar_FillNextHops
+// shortest paths from a node to all the others, by Dijkstra
+// on the open list heap. parent keeps the first hop instead
+//==========================================
+static void AStar_FillNextHops( astarhops_t *hops, int origin )
+{
+	int i, node, addnode, plinkDist;
+	short int *next = hops->next + origin * hops->numNodes;
+	int *dist = hops->dist + origin * hops->numNodes;
+
+	AStar_InitLists();
+
+	AStar_AddToList( origin );
+	astarnodes[origin].parent = origin;
+	astarnodes[origin].list = OPENLIST;
+	AStar_HeapPush( origin );
+
+	while( ( node = AStar_HeapPop() ) != -1 )
+	{
+		astarnodes[node].list = CLOSEDLIST;
+		next[node] = astarnodes[node].parent;
+		dist[node] = astarnodes[node].G;
+
+		for( i = 0; i < pLinks[node].numLinks; i++ )
+		{
+			if( !( ValidLinksMask & pLinks[node].moveType[i] ) )
+				continue;
+
+			addnode = pLinks[node].nodes[i];
+			if( addnode == node || addnode >= hops->numNodes || AStar_nodeIsInClosed( addnode ) )
+				continue;
+
+			plinkDist = AStar_PLinkDistance( node, addnode );
+			if( plinkDist == -1 )
+			{
+				//like AStar_PutAdjacentsInOpen, try the reverse link first
+				plinkDist = AStar_PLinkDistance( addnode, node );
+				if( plinkDist == -1 )
+					plinkDist = 999;
+			}
+
+			if( AStar_nodeIsInOpen( addnode ) )
+			{
+				if( astarnodes[addnode].G > astarnodes[node].G + plinkDist )
+				{
+					astarnodes[addnode].G = astarnodes[node].G + plinkDist;
+					astarnodes[addnode].parent = ( node == origin ) ? addnode : astarnodes[node].parent;
+					AStar_HeapUp( addnode );
+				}
+			}
+			else
+			{
+				AStar_AddToList( addnode );
+				astarnodes[addnode].G = astarnodes[node].G + plinkDist;
+				astarnodes[addnode].parent = ( node == origin ) ? addnode : astarnodes[node].parent;
+				astarnodes[addnode].list = OPENLIST;
+				AStar_HeapPush( addnode );
+			}
+		}
+	}
+}
+
+//==========================================
+// AStar_NextHopsChecksum
+// the tables are only valid for the nodes and links they were made from
+//==========================================
+static unsigned int AStar_NextHopsChecksum( int numNodes )
+{
+	unsigned int checksum = 2166136261u;
+	int i, j;
+
+#define ASTAR_HASH( x ) ( checksum = ( checksum ^ (unsigned int)( x ) ) * 16777619u )
+	for( i = 0; i < numNodes; i++ )
+	{
+		ASTAR_HASH( nodes[i].flags );
+		ASTAR_HASH( pLinks[i].numLinks );
+		for( j = 0; j < pLinks[i].numLinks && j < NODES_MAX_PLINKS; j++ )
+		{
+			ASTAR_HASH( pLinks[i].nodes[j] );
+			ASTAR_HASH( pLinks[i].dist[j] );
+			ASTAR_HASH( pLinks[i].moveType[j] );
+		}
+	}
+#undef ASTAR_HASH
+
+	return checksum;
+}
+
+//==========================================
+// AStar_LoadNextHops
+//==========================================
+static qboolean AStar_LoadNextHops( astarhops_t *hops, const char *filename, unsigned int checksum )
+{
+	int filenum;
+	int header[4];
+	int numNodes = hops->numNodes;
+
+	if( trap_FS_FOpenFile( filename, &filenum, FS_READ ) == -1 )
+		return qfalse;
+
+	if( trap_FS_Read( header, sizeof( header ), filenum ) != sizeof( header )
+		|| header[0] != HOP_FILE_VERSION || header[1] != numNodes
+		|| header[2] != hops->movetypes || (unsigned int)header[3] != checksum
+		|| trap_FS_Read( hops->next, sizeof( short int ) * numNodes * numNodes, filenum ) != (int)( sizeof( short int ) * numNodes * numNodes )
+		|| trap_FS_Read( hops->dist, sizeof( int ) * numNodes * numNodes, filenum ) != (int)( sizeof( int ) * numNodes * numNodes ) )
+	{
+		trap_FS_FCloseFile( filenum );
+		return qfalse;
+	}
+
+	trap_FS_FCloseFile( filenum );
+	return qtrue;
+}
+
+//==========================================
+// AStar_SaveNextHops
+//==========================================
+static void AStar_SaveNextHops( astarhops_t *hops, const char *filename, unsigned int checksum )
+{
+	int filenum;
+	int header[4];
+	int numNodes = hops->numNodes;
+
+	if( trap_FS_FOpenFile( filename, &filenum, FS_WRITE ) == -1 )
+		return;
+
+	header[0] = HOP_FILE_VERSION;
+	header[1] = numNodes;
+	header[2] = hops->movetypes;
+	header[3] = (int)checksum;
+
+	trap_FS_Write( header, sizeof( header ), filenum );
+	trap_FS_Write( hops->next, sizeof( short int ) * numNodes * numNodes, filenum );
+	trap_FS_Write( hops->dist, sizeof( int ) * numNodes * numNodes, filenum );
+	trap_FS_FCloseFile( filenum );
+}
+
+//==========================================
+// AStar_FreeNextHops
+//==========================================
+void AStar_FreeNextHops( void )
+{
+	int i;
+
+	for( i = 0; i < astarhops_num; i++ )
+	{
+		G_Free( astarhops[i].next );
+		G_Free( astarhops[i].dist );
+	}
+
+	memset( astarhops, 0, sizeof( astarhops ) );
+	astarhops_num = 0;
+}
+
+//==========================================
+// AStar_BuildNextHops
+// (re)makes the table for the current nodes and links. It's loaded
+// from the navigation folder, or made and saved there
+//==========================================
+static void AStar_BuildNextHops( astarhops_t *hops )
+{
+	char filename[MAX_QPATH];
+	int i, numNodes = nav.num_nodes;
+
+	if( hops->numNodes != numNodes )
+	{
+		if( hops->next )
+		{
+			G_Free( hops->next );
+			G_Free( hops->dist );
+		}
+		hops->numNodes = numNodes;
+		hops->next = G_Malloc( sizeof( short int ) * numNodes * numNodes );
+		hops->dist = G_Malloc( sizeof( int ) * numNodes * numNodes );
+	}
+
+	hops->checksum = AStar_NextHopsChecksum( numNodes );
+	hops->linksVersion = nav.linksVersion;
+
+	Q_snprintfz( filename, sizeof( filename ), "%s/%s_%x.%s", NAV_FILE_FOLDER, level.mapname, hops->movetypes, HOP_FILE_EXTENSION );
+	if( AStar_LoadNextHops( hops, filename, hops->checksum ) )
+		return;
+
+	G_Printf( "AI: Building next hop table for movetypes %x\n", hops->movetypes );
+
+	for( i = 0; i < numNodes * numNodes; i++ )
+	{
+		hops->next[i] = NODE_INVALID;
+		hops->dist[i] = -1;
+	}
+
+	Apath = NULL;
+	ValidLinksMask = hops->movetypes;
+	for( i = 0; i < numNodes; i++ )
+		AStar_FillNextHops( hops, i );
+
+	AStar_SaveNextHops( hops, filename, hops->checksum );
+}
+
+//==========================================
+// AStar_NextHopsValid
+// the table still matches the nodes and links. The checksum is
+// only compared again after links were added
+//==========================================
+static qboolean AStar_NextHopsValid( astarhops_t *hops )
+{
+	if( hops->numNodes != nav.num_nodes )
+		return qfalse;
+
+	if( hops->linksVersion != nav.linksVersion )
+	{
+		if( AStar_NextHopsChecksum( hops->numNodes ) != hops->checksum )
+			return qfalse;
+		hops->linksVersion = nav.linksVersion;
+	}
+
+	return qtrue;
+}
+
+//==========================================
+// AStar_AddNextHops
+//==========================================
+static void AStar_AddNextHops( int movetypes )
+{
+	astarhops_t *hops;
+	int i;
+
+	for( i = 0; i < astarhops_num; i++ )
+	{
+		if( astarhops[i].movetypes == movetypes )
+			return;
+	}
+
+	if( astarhops_num == ASTAR_MAX_HOPTABLES )
+		return;
+
+	hops = &astarhops[astarhops_num++];
+	hops->movetypes = movetypes;
+	AStar_BuildNextHops( hops );
+}
+
+//==========================================
+// AStar_InitNextHops
+// makes the tables for the movetypes bots use, once the
+// navigation data is loaded
+//==========================================
+void AStar_InitNextHops( void )
+{
+	if( !bot_nexthops->integer || !nav.loaded || nav.editmode || !nav.num_nodes )
+		return;
+
+	AStar_AddNextHops( DEFAULT_MOVETYPES_MASK );
+	AStar_AddNextHops( LINK_MASK_DMBOT );
+}
+
+//==========================================
+// AStar_NextHopsForMovetypes
+// finds the table for the movetypes, NULL if there's none. It's
+// made again if the nodes or links changed since
+//==========================================
+static astarhops_t *AStar_NextHopsForMovetypes( int movetypes )
+{
+	int i;
+
+	if( !bot_nexthops->integer || !nav.loaded || nav.editmode || !nav.num_nodes )
+		return NULL;
+
+	for( i = 0; i < astarhops_num; i++ )
+	{
+		if( astarhops[i].movetypes != movetypes )
+			continue;
+
+		if( !AStar_NextHopsValid( &astarhops[i] ) )
+			AStar_BuildNextHops( &astarhops[i] );
+		return &astarhops[i];
+	}
+
+	return NULL;
+}
+
+//==========================================
+// AStar_NextHopsPath
+// reads the path from the next hop table
+//==========================================
+static int AStar_NextHopsPath( astarhops_t *hops, int origin, int goal, struct astarpath_s *path )
+{
+	static short int hopnodes[MAX_NODES];
+	int i, count, cur;
+
+	if( origin == goal || origin < 0 || origin >= hops->numNodes || goal >= hops->numNodes )
+		return 0;
+
+	count = 0;
+	for( cur = origin; cur != goal; )
+	{
+		cur = hops->next[cur * hops->numNodes + goal];
+		if( cur == NODE_INVALID || count == hops->numNodes )
+			return 0;
+		hopnodes[count++] = cur;
+	}
+
+	//stored from the goal back, like AStar_ListsToPath
+	for( i = 0; i < count; i++ )
+		path->nodes[i] = hopnodes[count - 1 - i];
+
+	path->numNodes = count - 1;
+	path->totalDistance = hops->dist[origin * hops->numNodes + goal];
+	return 1;
+}
+
 int AStar_GetPath( int origin, int goal, int movetypes, struct astarpath_s *path )
 {
-	Apath = path;
+	astarhops_t *hops;
 
 	if( goal < 0 )
 		return 0;
 
+	if( !movetypes )
+		movetypes = DEFAULT_MOVETYPES_MASK;
+
+	hops = AStar_NextHopsForMovetypes( movetypes );
+	if( hops && goal < hops->numNodes )
+	{
+		if( !AStar_NextHopsPath( hops, origin, goal, path ) )
+			return 0;
+
+		path->originNode = origin;
+		path->goalNode = goal;
+		return 1;
+	}
+
+	Apath = path;
+
 	if( !AStar_ResolvePath( origin, goal, movetypes ) )
 		return 0;
 
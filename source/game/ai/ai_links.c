@@ -186,6 +186,7 @@ qboolean AI_AddLink( int n1, int n2, int linkType )
 	pLinks[n1].dist[pLinks[n1].numLinks] = (int)AI_FindLinkDistance( n1, n2, linkType );
 	
 	pLinks[n1].numLinks++;
+	nav.linksVersion++;
 
 	return qtrue;
 }
@@ -33,6 +33,7 @@ extern cvar_t *bot_showcombat;
 extern cvar_t *bot_showsrgoal;
 extern cvar_t *bot_showlrgoal;
 extern cvar_t *bot_dummy;
+extern cvar_t *bot_nexthops;
 extern cvar_t *sv_botpersonality;
 
 //----------------------------------------------------------
@@ -123,6 +124,9 @@ extern cvar_t *sv_botpersonality;
 
 #define LINK_INVALID 0x00001000
 
+// movetypes of the dm bot class
+#define LINK_MASK_DMBOT ( LINK_MOVE|LINK_STAIRS|LINK_FALL|LINK_WATER|LINK_WATERJUMP|LINK_JUMPPAD|LINK_PLATFORM|LINK_TELEPORT|LINK_LADDER|LINK_JUMP|LINK_CROUCH )
+
 typedef struct nav_plink_s
 {
 	int numLinks;
@@ -158,6 +162,21 @@ typedef struct nav_path_s
 nav_plink_t pLinks[MAX_NODES];      // pLinks array
 nav_node_t nodes[MAX_NODES];        // nodes array
 
+#define NODEGRID_CELL_SIZE ( NODE_DENSITY * 2 )
+#define NODEGRID_MAX_CELLS 64
+
+// nodes sorted into cells on x/y, for finding the close ones
+typedef struct nav_nodegrid_s
+{
+	int numNodes;           // nodes it was made for, 0 if not made
+	float origin[2];
+	float cellSize;
+	int size[2];
+	int cells[NODEGRID_MAX_CELLS * NODEGRID_MAX_CELLS + 1];  // where each cell starts in cellNodes
+	short int cellNodes[MAX_NODES];
+
+} nav_nodegrid_t;
+
 typedef struct
 {
 	qboolean loaded;
@@ -166,6 +185,7 @@ typedef struct
 
 	int num_nodes;          // total number of nodes
 	int serverNodesStart;
+	int linksVersion;       // increased each time a link is added
 
 	int num_goalEnts;
 	nav_ents_t goalEnts[MAX_EDICTS]; // entities which are potential goals
@@ -173,6 +193,8 @@ typedef struct
 	int num_navigableEnts;
 	nav_ents_t navigableEnts[MAX_EDICTS]; // plats, etc
 
+	nav_nodegrid_t grid;
+
 } ai_navigation_t;
 
 ai_navigation_t	nav;
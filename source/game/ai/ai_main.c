@@ -39,6 +39,7 @@ void AI_InitLevel( void )
 	bot_showsrgoal = trap_Cvar_Get( "bot_showsrgoal", "0", 0 );
 	bot_showlrgoal = trap_Cvar_Get( "bot_showlrgoal", "0", 0 );
 	bot_dummy = trap_Cvar_Get( "bot_dummy", "0", 0 );
+	bot_nexthops = trap_Cvar_Get( "bot_nexthops", "0", CVAR_ARCHIVE );
 	sv_botpersonality =	    trap_Cvar_Get( "sv_botpersonality", "0", CVAR_ARCHIVE );
 
 	nav.debugMode = qfalse;
@@ -36,6 +36,128 @@ int AI_FindCost( int from, int to, int movetypes )
 	return path.totalDistance;
 }
 
+typedef struct
+{
+	float dist;
+	int node;
+} nav_closenode_t;
+
+//==========================================
+// AI_BuildNodeGrid
+// the nodes don't change once the navigation is loaded
+//==========================================
+static void AI_BuildNodeGrid( void )
+{
+	nav_nodegrid_t *grid = &nav.grid;
+	static int cellOf[MAX_NODES];
+	vec3_t mins, maxs;
+	float size;
+	int i, j, x, y, numCells;
+
+	ClearBounds( mins, maxs );
+	for( i = 0; i < nav.num_nodes; i++ )
+		AddPointToBounds( nodes[i].origin, mins, maxs );
+
+	size = max( maxs[0] - mins[0], maxs[1] - mins[1] );
+	grid->cellSize = max( NODEGRID_CELL_SIZE, size / ( NODEGRID_MAX_CELLS - 1 ) );
+	for( j = 0; j < 2; j++ )
+	{
+		grid->origin[j] = mins[j];
+		grid->size[j] = (int)( ( maxs[j] - mins[j] ) / grid->cellSize ) + 1;
+		clamp( grid->size[j], 1, NODEGRID_MAX_CELLS );
+	}
+	numCells = grid->size[0] * grid->size[1];
+
+	// count the nodes of each cell, then place them
+	memset( grid->cells, 0, sizeof( grid->cells ) );
+	for( i = 0; i < nav.num_nodes; i++ )
+	{
+		x = (int)( ( nodes[i].origin[0] - grid->origin[0] ) / grid->cellSize );
+		y = (int)( ( nodes[i].origin[1] - grid->origin[1] ) / grid->cellSize );
+		clamp( x, 0, grid->size[0] - 1 );
+		clamp( y, 0, grid->size[1] - 1 );
+		cellOf[i] = y * grid->size[0] + x;
+		grid->cells[cellOf[i] + 1]++;
+	}
+
+	for( i = 0; i < numCells; i++ )
+		grid->cells[i + 1] += grid->cells[i];
+
+	for( i = 0; i < nav.num_nodes; i++ )
+		grid->cellNodes[grid->cells[cellOf[i]]++] = i;
+
+	// placing moved each start to the next one
+	for( i = numCells; i > 0; i-- )
+		grid->cells[i] = grid->cells[i - 1];
+	grid->cells[0] = 0;
+
+	grid->numNodes = nav.num_nodes;
+}
+
+//==========================================
+// AI_FindCloseNodes
+// the nodes matching flagsmask between mindist and range of origin,
+// returns qfalse if the grid can't be used and all nodes need checking
+//==========================================
+static qboolean AI_FindCloseNodes( vec3_t origin, float mindist, float range, int flagsmask, nav_closenode_t *list, int *count )
+{
+	nav_nodegrid_t *grid = &nav.grid;
+	int cmins[2], cmaxs[2];
+	int i, j, x, y, node;
+	float dist;
+
+	// nodes are still being added or edited
+	if( !nav.loaded || nav.editmode || !nav.num_nodes )
+		return qfalse;
+
+	if( grid->numNodes != nav.num_nodes )
+		AI_BuildNodeGrid();
+
+	for( j = 0; j < 2; j++ )
+	{
+		cmins[j] = (int)floor( ( origin[j] - range - grid->origin[j] ) / grid->cellSize );
+		cmaxs[j] = (int)floor( ( origin[j] + range - grid->origin[j] ) / grid->cellSize );
+		clamp( cmins[j], 0, grid->size[j] - 1 );
+		clamp( cmaxs[j], 0, grid->size[j] - 1 );
+	}
+
+	*count = 0;
+	for( y = cmins[1]; y <= cmaxs[1]; y++ )
+	{
+		for( x = cmins[0]; x <= cmaxs[0]; x++ )
+		{
+			i = y * grid->size[0] + x;
+			for( j = grid->cells[i]; j < grid->cells[i + 1]; j++ )
+			{
+				node = grid->cellNodes[j];
+				if( flagsmask != NODE_ALL && !( nodes[node].flags & flagsmask ) )
+					continue;
+
+				dist = DistanceFast( nodes[node].origin, origin );
+				if( dist > mindist && dist < range )
+				{
+					list[*count].dist = dist;
+					list[*count].node = node;
+					( *count )++;
+				}
+			}
+		}
+	}
+
+	return qtrue;
+}
+
+static int AI_CompareCloseNodes( const void *a, const void *b )
+{
+	const nav_closenode_t *n1 = (const nav_closenode_t *)a;
+	const nav_closenode_t *n2 = (const nav_closenode_t *)b;
+
+	if( n1->dist != n2->dist )
+		return ( n1->dist < n2->dist ) ? -1 : 1;
+
+	return n1->node - n2->node;
+}
+
 int AI_FindClosestReachableNode( vec3_t origin, edict_t *passent, int range, int flagsmask )
 {
 	int i;
@@ -44,6 +166,8 @@ int AI_FindClosestReachableNode( vec3_t origin, edict_t *passent, int range, int
 	int node = -1;
 	trace_t	tr;
 	vec3_t maxs, mins;
+	static nav_closenode_t closeNodes[MAX_NODES];
+	int numCloseNodes;
 
 	VectorSet( mins, -8, -8, -8 );
 	VectorSet( maxs, 8, 8, 8 );
@@ -55,6 +179,20 @@ int AI_FindClosestReachableNode( vec3_t origin, edict_t *passent, int range, int
 		VectorCopy( vec3_origin, mins );
 	}
 
+	// try the close nodes from the closest one on, until one is visible
+	if( AI_FindCloseNodes( origin, -1, range, flagsmask, closeNodes, &numCloseNodes ) )
+	{
+		qsort( closeNodes, numCloseNodes, sizeof( nav_closenode_t ), AI_CompareCloseNodes );
+
+		for( i = 0; i < numCloseNodes; i++ )
+		{
+			G_Trace( &tr, origin, mins, maxs, nodes[closeNodes[i].node].origin, passent, MASK_NODESOLID );
+			if( tr.fraction == 1.0 )
+				return closeNodes[i].node;
+		}
+		return -1;
+	}
+
 	closest = range;
 
 	for( i = 0; i < nav.num_nodes; i++ )
@@ -84,9 +222,21 @@ int AI_FindClosestNode( vec3_t origin, float mindist, int range, int flagsmask )
 	float closest;
 	float dist;
 	int node = NODE_INVALID;
+	static nav_closenode_t closeNodes[MAX_NODES];
+	int numCloseNodes;
 
 	if( mindist > range ) return -1;
 
+	if( AI_FindCloseNodes( origin, mindist, range, flagsmask, closeNodes, &numCloseNodes ) )
+	{
+		for( i = 0; i < numCloseNodes; i++ )
+		{
+			if( node == NODE_INVALID || AI_CompareCloseNodes( &closeNodes[i], &closeNodes[node] ) < 0 )
+				node = i;
+		}
+		return ( node == NODE_INVALID ) ? NODE_INVALID : closeNodes[node].node;
+	}
+
 	closest = range;
 
 	for( i = 0; i < nav.num_nodes; i++ )
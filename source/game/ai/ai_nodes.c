@@ -1145,6 +1145,9 @@ void AI_InitEntitiesData( void )
 	G_Printf( "       : AI Navigation Initialized.\n" );
 
 	nav.loaded = qtrue;
+
+	// now, so bots don't stall a frame making them on their first path
+	AStar_InitNextHops();
 }
 
 /*
@@ -1156,6 +1159,8 @@ void AI_InitNavigationData( qboolean silent )
 	int i;
 	int linkscount;
 
+	AStar_FreeNextHops();
+
 	memset( &nav, 0, sizeof( nav ) );
 	memset( nodes, 0, sizeof( nav_node_t ) * MAX_NODES );
 	memset( pLinks, 0, sizeof( nav_plink_t ) * MAX_NODES );
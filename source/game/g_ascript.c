@@ -2077,6 +2077,11 @@ static void objectGameClient_SetRaceTime( int sector, unsigned int time, gclient
 	G_SetRaceTime( &game.edicts[ playerNum + 1 ], sector, time );
 }
 
+static double objectGameClient_getTouchTime( gclient_t *self )
+{
+	return G_Client_TouchTime( self );
+}
+
 static const asFuncdef_t gameclient_Funcdefs[] =
 {
 	ASLIB_FUNCDEF_NULL
@@ -2125,6 +2130,7 @@ static const asMethod_t gameclient_Methods[] =
 	{ ASLIB_FUNCTION_DECL(void, setChaseActive, ( bool active )), objectGameClient_ChaseCam, asCALL_CDECL_OBJLAST },
 	{ ASLIB_FUNCTION_DECL(void, newRaceRun, ( int numSectors )), objectGameClient_NewRaceRun, asCALL_CDECL_OBJLAST },
 	{ ASLIB_FUNCTION_DECL(void, setRaceTime, ( int sector, uint time )), objectGameClient_SetRaceTime, asCALL_CDECL_OBJLAST },
+	{ ASLIB_FUNCTION_DECL(double, getTouchTime, () const), objectGameClient_getTouchTime, asCALL_CDECL_OBJLAST },
 
 	ASLIB_METHOD_NULL
 };
@@ -3126,6 +3132,8 @@ static asstring_t *asFunc_RS_PrintQueryCallback(int player_id )
 	char *result;
 	asstring_t *result_as;
 	result = RS_PrintQueryCallback(player_id);
+	if( !result )
+		return angelExport->asStringFactoryBuffer( NULL, 0 );
 	result_as=angelExport->asStringFactoryBuffer(result, strlen(result));
 	free(result);
 	return result_as;
@@ -157,7 +157,7 @@ static qboolean G_VoteMapValidate( callvotedata_t *data, qboolean first )
 	// racesow : vote a map number
 	mapnumber = atoi( data->argv[0] );
 
-	if( !Q_stricmp( data->argv[0], va( "%i", mapnumber ) ) && ( mapnumber <= mapcount ) )
+	if( !Q_stricmp( data->argv[0], va( "%i", mapnumber ) ) && ( mapnumber <= RS_MapCount() ) )
 	{
 		map = RS_GetMapByNum(mapnumber);
 
@@ -203,26 +203,10 @@ static qboolean G_VoteMapValidate( callvotedata_t *data, qboolean first )
 		// check if valid map is in map pool when on
 		if( g_enforce_map_pool->integer )
 		{
-			char *s, *tok;
-			static const char *seps = " ,";
-
 			// if map pool is empty, basically turn it off
-			if( strlen(maplist) < 2 ) //racesow : use maplist
+			if( !RS_MapCount() || RS_MapInList( mapname ) ) //racesow : use the map catalogue
 				return qtrue;
 
-			s = G_CopyString(maplist); //racesow : use maplist
-			tok = strtok( s, seps );
-			while ( tok != NULL )
-			{
-				if ( !Q_stricmp( tok, mapname ) )
-				{
-					G_Free( s );
-					return qtrue;
-				}
-				else
-					tok = strtok( NULL, seps );
-			}
-			G_Free( s );
 			G_PrintMsg( data->caller, "%sMap is not in map pool.\n", S_COLOR_RED );
 			return qfalse;
 		}
@@ -253,34 +237,19 @@ static char *G_VoteMapCurrent( void )
  */
 qboolean RS_VoteRandmapValidate( callvotedata_t *vote, qboolean first )
 {
-	int index = brandom( 1, mapcount );
+	char *map;
 	int size = 0;
-	char *s, *tok;
-	static const char *seps = " ,\n\r";
 
 	if( !first )
 		return qtrue;
 
-	s = G_CopyString( maplist );
-	tok = strtok( s, seps );
-
-	while ( tok != NULL )
-	{
-		if( Q_stricmp( tok, level.mapname ) )
-			index--;
-
-		if ( index == 0)
-			break;
-
-		tok = strtok( NULL, seps );
-	}
-
-	G_Free(s);
+	map = RS_GetRandomMap( level.mapname, random() );
 
-	if ( index == 0){
-		size = strlen( tok ) + 1;
+	if ( map != NULL ){
+		size = strlen( map ) + 1;
 		vote->data = G_Malloc( size );
-		Q_strncpyz(vote->data, tok, size);
+		Q_strncpyz(vote->data, map, size);
+		free( map );
 		return qtrue;
 	}
 	else
@@ -43,16 +43,88 @@ typedef struct areanode_s
 	link_t solid_edicts;
 } areanode_t;
 
-#define	AREA_DEPTH  5
-#define	AREA_NODES  64
+#define	AREA_DEPTH  8
+#define	AREA_NODES  512
+
+// the tree is rebuilt from where the entities are: crowded nodes are split where
+// the fewest entities are walked, the rest is split in halves like the world was
+#define AREA_UNIFORM_DEPTH	5
+#define AREA_LEAF_EDICTS	8
+#define AREA_SPLITS			8       // candidate split positions on each axis
+#define AREA_MIN_SIZE		64
+#define AREA_REBUILD_TIME	1000
 
 areanode_t sv_areanodes[AREA_NODES];
 int sv_numareanodes;
 
+static vec3_t sv_areaMins, sv_areaMaxs;
+static unsigned int sv_areaRebuildTime;
+static int sv_areaEdicts[MAX_EDICTS];
+static float sv_areaCenters[MAX_EDICTS];
+
+// triggers which don't move are kept in a uniform grid over the world instead,
+// so that maps with hundreds of them don't pile them up in a few area nodes
+#define TRIGGERGRID_CELL_SIZE		256
+#define TRIGGERGRID_MAX_CELLS		64          // on each axis
+#define TRIGGERGRID_MAX_ENTCELLS	16          // bigger triggers stay in the area nodes
+#define TRIGGERGRID_MAX_MOVES		1           // relinked elsewhere more often, they are moving ones
+
+#define TRIGGERCACHE_MAX_ENTS		32
+#define TRIGGERCACHE_MARGIN			64
+
+typedef struct
+{
+	int entNum;
+	int next;
+} triggercell_t;
+
+typedef struct
+{
+	qboolean linked;            // linked into sv_triggerGrid.edicts, not into an area node
+	qboolean gridded;
+	qboolean moving;            // or too big, always linked into the area nodes
+	int moves;
+	vec3_t absmin, absmax;      // where it's in the grid
+	unsigned int touchcount;
+} triggerent_t;
+
+// the grid triggers near a player, which are reused while the player stays among them.
+// Each one still gets its contact test on every step: touch callbacks like pushers and
+// race timers run each frame a player is inside, so they can't be skipped until a leave
+typedef struct
+{
+	unsigned int generation;
+	vec3_t mins, maxs;
+	qboolean crowded;           // too many to keep, looked up on each step
+	int numEnts;
+	int ents[TRIGGERCACHE_MAX_ENTS];
+} triggercache_t;
+
+typedef struct
+{
+	vec3_t origin;
+	float cellSize;
+	int size[2];
+	int *cells;                 // [size[0] * size[1]], first triggercell_t of each cell
+
+	int numNodes, maxNodes;
+	int freeNodes, numFreeNodes;    // nodes of removed triggers, chained by next
+	triggercell_t *nodes;
+
+	triggerent_t *ents;         // [game.maxentities]
+	triggercache_t *caches;     // [gs.maxclients]
+	link_t edicts;
+
+	unsigned int generation;    // changes when triggers are added
+	unsigned int touchcount;
+} triggergrid_t;
+
+static triggergrid_t sv_triggerGrid;
+
 extern cvar_t *g_antilag;
 extern cvar_t *g_antilag_maxtimedelta;
 
-#define	CFRAME_UPDATE_BACKUP	64  // copies of entity_state_t to keep buffered (1 second of backup at 62 fps).
+#define	CFRAME_UPDATE_BACKUP	64  // frames of collision history to keep buffered (1 second of backup at 62 fps).
 #define	CFRAME_UPDATE_MASK	( CFRAME_UPDATE_BACKUP-1 )
 
 typedef struct c4clipedict_s
@@ -61,82 +133,216 @@ typedef struct c4clipedict_s
 	entity_shared_t	r;
 } c4clipedict_t;
 
-//backups of all server frames areas and edicts
-typedef struct c4frame_s
+// the part of an edict the collision tests need, as it was from a backed up frame on
+typedef struct c4clipstate_s
 {
-	c4clipedict_t clipEdicts[MAX_EDICTS];   // fixme: there is a g_maxentities cvar. We have to adjust to it
-	int numedicts;
-
-	unsigned int timestamp;
 	unsigned int framenum;
-} c4frame_t;
+	qboolean inuse;
+	solid_t solid;
+	unsigned int modelindex;
+	vec3_t origin;
+	vec3_t angles;
+	vec3_t mins, maxs;
+	vec3_t absmin, absmax;
+} c4clipstate_t;
+
+// backups of an edict, a new state is only stored when it changes
+typedef struct c4cliphistory_s
+{
+	unsigned int numStates;         // the last CFRAME_UPDATE_BACKUP ones are kept
+	unsigned int solidFramenum;     // first frame with the current solid and inuse values
+	c4clipstate_t states[CFRAME_UPDATE_BACKUP];
+} c4cliphistory_t;
 
-c4frame_t sv_collisionframes[CFRAME_UPDATE_BACKUP];
+static c4cliphistory_t *sv_collisionHistory;    // [game.maxentities]
+static unsigned int sv_collisionTimestamps[CFRAME_UPDATE_BACKUP];
 static unsigned int sv_collisionFrameNum = 0;
 
+/*
+* GClip_SkipsAntilag
+* entities which are always clipped at their current position
+*/
+static qboolean GClip_SkipsAntilag( edict_t *ent, int entNum )
+{
+	return ( !ent->r.inuse || ent->r.solid == SOLID_NOT 
+		|| ( ent->r.solid == SOLID_TRIGGER && !(entNum >= 1 && entNum <= gs.maxclients) ) );
+}
+
+/*
+* GClip_ClearCollisionHistory
+*/
+static void GClip_ClearCollisionHistory( void )
+{
+	int i;
+
+	sv_collisionFrameNum = 0;
+	if( !sv_collisionHistory )
+		return;
+
+	for( i = 0; i < game.maxentities; i++ )
+		sv_collisionHistory[i].numStates = 0;
+}
+
+/*
+* GClip_FreeCollisionHistory
+*/
+void GClip_FreeCollisionHistory( void )
+{
+	if( sv_collisionHistory )
+	{
+		G_Free( sv_collisionHistory );
+		sv_collisionHistory = NULL;
+	}
+	sv_collisionFrameNum = 0;
+}
+
+/*
+* GClip_BackUpClipState
+*/
+static void GClip_BackUpClipState( int entNum, unsigned int framenum )
+{
+	edict_t	*svedict = &game.edicts[entNum];
+	c4cliphistory_t *history = &sv_collisionHistory[entNum];
+	c4clipstate_t state, *last = NULL;
+
+	if( history->numStates )
+	{
+		last = &history->states[( history->numStates - 1 ) & CFRAME_UPDATE_MASK];
+		state = *last;
+	}
+	else
+	{
+		memset( &state, 0, sizeof( state ) );
+	}
+
+	state.inuse = svedict->r.inuse;
+	state.solid = svedict->r.solid;
+	if( !GClip_SkipsAntilag( svedict, entNum ) )
+	{
+		state.modelindex = svedict->s.modelindex;
+		VectorCopy( svedict->s.origin, state.origin );
+		VectorCopy( svedict->s.angles, state.angles );
+		VectorCopy( svedict->r.mins, state.mins );
+		VectorCopy( svedict->r.maxs, state.maxs );
+		VectorCopy( svedict->r.absmin, state.absmin );
+		VectorCopy( svedict->r.absmax, state.absmax );
+	}
+
+	// unchanged since the last backup
+	if( last && !memcmp( &state, last, sizeof( state ) ) )
+		return;
+
+	if( !last || state.inuse != last->inuse || state.solid != last->solid )
+		history->solidFramenum = framenum;
+
+	state.framenum = framenum;
+	history->states[history->numStates & CFRAME_UPDATE_MASK] = state;
+	history->numStates++;
+}
+
+/*
+* GClip_ClipStateForFrame
+* returns the state the edict had in the given frame
+*/
+static c4clipstate_t *GClip_ClipStateForFrame( c4cliphistory_t *history, unsigned int framenum )
+{
+	unsigned int first, low, high, mid;
+	c4clipstate_t *state = NULL;
+
+	first = history->numStates > CFRAME_UPDATE_BACKUP ? history->numStates - CFRAME_UPDATE_BACKUP : 0;
+
+	// find the last state stored before or in the frame
+	low = first;
+	high = history->numStates;
+	while( low < high )
+	{
+		mid = low + ( high - low ) / 2;
+		if( history->states[mid & CFRAME_UPDATE_MASK].framenum <= framenum )
+		{
+			state = &history->states[mid & CFRAME_UPDATE_MASK];
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	return state;
+}
+
+/*
+* GClip_ApplyClipState
+*/
+static void GClip_ApplyClipState( c4clipedict_t *clipent, const c4clipstate_t *state )
+{
+	clipent->r.inuse = state->inuse;
+	clipent->r.solid = state->solid;
+	clipent->s.modelindex = state->modelindex;
+	VectorCopy( state->origin, clipent->s.origin );
+	VectorCopy( state->angles, clipent->s.angles );
+	VectorCopy( state->mins, clipent->r.mins );
+	VectorCopy( state->maxs, clipent->r.maxs );
+	VectorCopy( state->absmin, clipent->r.absmin );
+	VectorCopy( state->absmax, clipent->r.absmax );
+}
+
 void GClip_BackUpCollisionFrame( void )
 {
-	c4frame_t *cframe;
-	edict_t	*svedict;
 	int i;
 
 	if( !g_antilag->integer )
 		return;
 
-	// fixme: should check for any validation here?
+	if( !sv_collisionHistory )
+	{
+		sv_collisionHistory = G_Malloc( game.maxentities * sizeof( *sv_collisionHistory ) );
+		GClip_ClearCollisionHistory();
+	}
 
-	cframe = &sv_collisionframes[sv_collisionFrameNum & CFRAME_UPDATE_MASK];
-	cframe->timestamp = game.serverTime;
-	cframe->framenum = sv_collisionFrameNum;
-	sv_collisionFrameNum++;
+	// fixme: should check for any validation here?
 
-	//memset( cframe->clipEdicts, 0, sizeof(cframe->clipEdicts) );
+	sv_collisionTimestamps[sv_collisionFrameNum & CFRAME_UPDATE_MASK] = game.serverTime;
 
 	//backup edicts
 	for( i = 0; i < game.numentities; i++ )
-	{
-		svedict = &game.edicts[i];
+		GClip_BackUpClipState( i, sv_collisionFrameNum );
 
-		cframe->clipEdicts[i].r.inuse = svedict->r.inuse;
-		cframe->clipEdicts[i].r.solid = svedict->r.solid;
-		if( !svedict->r.inuse || svedict->r.solid == SOLID_NOT 
-			|| ( svedict->r.solid == SOLID_TRIGGER && !(i >= 1 && i <= gs.maxclients) ) )
-			continue;
-
-		cframe->clipEdicts[i].r = svedict->r;
-		cframe->clipEdicts[i].s = svedict->s;
-	}
-	cframe->numedicts = game.numentities;
+	sv_collisionFrameNum++;
 }
 
-static c4clipedict_t *GClip_GetClipEdictForDeltaTime( int entNum, int deltaTime )
+/*
+* GClip_GetClipEdictForDeltaTime
+* fills the caller's clipent, so it can run from several threads at once
+*/
+static c4clipedict_t *GClip_GetClipEdictForDeltaTime( int entNum, int deltaTime, c4clipedict_t *clipent )
 {
-	static int index = 0;
-	static c4clipedict_t clipEnts[8];
-	static c4clipedict_t *clipent;
-	static c4clipedict_t clipentNewer; // for interpolation
-	c4frame_t *cframe = NULL;
-	unsigned int backTime, cframenum, backframes, i;
+	c4clipedict_t clipentNewer; // for interpolation
+	c4cliphistory_t *history;
+	c4clipstate_t *state, *last;
+	unsigned int backTime, cframenum, backframes, framenum, first, low, high, mid, i;
 	edict_t	*ent = game.edicts + entNum;
 
-	// pick one of the 8 slots to prevent overwritings
-	clipent = &clipEnts[index];
-	index = ( index + 1 )&7;
+	// setup with the current entity for the data that is not backed up
+	clipent->r = ent->r;
+	clipent->s = ent->s;
 
-	if( !entNum || deltaTime >= 0 || !g_antilag->integer )
-	{                                                    // current time entity
-		clipent->r = ent->r;
-		clipent->s = ent->s;
+	if( !entNum || deltaTime >= 0 || !g_antilag->integer || !sv_collisionHistory )
+		return clipent; // current time entity
+
+	if( GClip_SkipsAntilag( ent, entNum ) )
 		return clipent;
-	}
 
-	if( !ent->r.inuse || ent->r.solid == SOLID_NOT 
-		|| ( ent->r.solid == SOLID_TRIGGER && !(entNum >= 1 && entNum <= gs.maxclients) ) )
-	{
-		clipent->r = ent->r;
-		clipent->s = ent->s;
+	// we can't step back from first
+	cframenum = sv_collisionFrameNum;
+	history = &sv_collisionHistory[entNum];
+	if( cframenum < 2 || !history->numStates )
+		return clipent;
+
+	// if solid has changed, we can't keep moving backwards
+	last = &history->states[( history->numStates - 1 ) & CFRAME_UPDATE_MASK];
+	if( ent->r.solid != last->solid || ent->r.inuse != last->inuse )
 		return clipent;
-	}
 
 	// clamp delta time inside the backed up limits
 	backTime = abs( deltaTime );
@@ -148,59 +354,57 @@ static c4clipedict_t *GClip_GetClipEdictForDeltaTime( int entNum, int deltaTime
 			backTime = (unsigned int)g_antilag_maxtimedelta->integer;
 	}
 
-	// find the first snap with timestamp < than realtime - backtime
-	cframenum = sv_collisionFrameNum;
-	for( backframes = 1; backframes < CFRAME_UPDATE_BACKUP && backframes < sv_collisionFrameNum; backframes++ ) // never overpass limits
+	// never overpass limits, nor go back past a solid change
+	first = cframenum > CFRAME_UPDATE_BACKUP - 1 ? cframenum - ( CFRAME_UPDATE_BACKUP - 1 ) : 1;
+	if( first < history->solidFramenum )
+		first = history->solidFramenum;
+
+	// find the last frame with timestamp <= than realtime - backtime
+	framenum = first;
+	low = first;
+	high = cframenum;
+	while( low < high )
 	{
-		cframe = &sv_collisionframes[( cframenum-backframes ) & CFRAME_UPDATE_MASK];
-		// if solid has changed, we can't keep moving backwards
-		if( ent->r.solid != cframe->clipEdicts[entNum].r.solid || ent->r.inuse != cframe->clipEdicts[entNum].r.inuse )
+		mid = low + ( high - low ) / 2;
+		if( game.serverTime >= sv_collisionTimestamps[mid & CFRAME_UPDATE_MASK] + backTime )
 		{
-			backframes--;
-			if( backframes == 0 )
-			{           // we can't step back from first
-				cframe = NULL;
-			}
-			else
-			{
-				cframe = &sv_collisionframes[( cframenum-backframes ) & CFRAME_UPDATE_MASK];
-			}
-			break;
+			framenum = mid;
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
 		}
-
-		if( game.serverTime >= cframe->timestamp + backTime )
-			break;
 	}
+	backframes = cframenum - framenum;
 
-	if( !cframe )
-	{           // current time entity
-		clipent->r = ent->r;
-		clipent->s = ent->s;
+	state = GClip_ClipStateForFrame( history, framenum );
+	if( !state )
 		return clipent;
-	}
 
 	// setup with older for the data that is not interpolated
-	*clipent = cframe->clipEdicts[entNum];
+	GClip_ApplyClipState( clipent, state );
 
 	// if we found an older than desired backtime frame, interpolate to find a more precise position.
-	if( game.serverTime > cframe->timestamp+backTime )
+	if( game.serverTime > sv_collisionTimestamps[framenum & CFRAME_UPDATE_MASK]+backTime )
 	{
 		float lerpFrac;
+		unsigned int timestamp = sv_collisionTimestamps[framenum & CFRAME_UPDATE_MASK];
 
 		if( backframes == 1 )
 		{               // interpolate from 1st backed up to current
-			lerpFrac = (float)( ( game.serverTime - backTime ) - cframe->timestamp ) / (float)( game.serverTime - cframe->timestamp );
+			lerpFrac = (float)( ( game.serverTime - backTime ) - timestamp ) / (float)( game.serverTime - timestamp );
 			clipentNewer.r = ent->r;
 			clipentNewer.s = ent->s;
 		}
 		else
 		{ // interpolate between 2 backed up
-			c4frame_t *cframeNewer = &sv_collisionframes[( cframenum-( backframes-1 ) ) & CFRAME_UPDATE_MASK];
-			lerpFrac = (float)( ( game.serverTime - backTime ) - cframe->timestamp ) / (float)( cframeNewer->timestamp - cframe->timestamp );
-			clipentNewer = cframeNewer->clipEdicts[entNum];
+			c4clipstate_t *stateNewer = GClip_ClipStateForFrame( history, framenum + 1 );
+			lerpFrac = (float)( ( game.serverTime - backTime ) - timestamp ) / (float)( sv_collisionTimestamps[( framenum + 1 ) & CFRAME_UPDATE_MASK] - timestamp );
+			GClip_ApplyClipState( &clipentNewer, stateNewer );
 		}
 
-		//G_Printf( "backTime:%i cframeBackTime:%i backFrames:%i lerfrac:%f\n", backTime, game.serverTime - cframe->timestamp, backframes, lerpFrac );
+		//G_Printf( "backTime:%i cframeBackTime:%i backFrames:%i lerfrac:%f\n", backTime, game.serverTime - timestamp, backframes, lerpFrac );
 
 		// interpolate
 		VectorLerp( clipent->s.origin, lerpFrac, clipentNewer.s.origin, clipent->s.origin );
@@ -210,7 +414,7 @@ static c4clipedict_t *GClip_GetClipEdictForDeltaTime( int entNum, int deltaTime
 			clipent->s.angles[i] = LerpAngle( clipent->s.angles[i], clipentNewer.s.angles[i], lerpFrac );
 	}
 
-	//G_Printf( "backTime:%i cframeBackTime:%i backFrames:%i\n", backTime, game.serverTime - cframe->timestamp, backframes );
+	//G_Printf( "backTime:%i cframeBackTime:%i backFrames:%i\n", backTime, game.serverTime - timestamp, backframes );
 
 	// back time entity
 	return clipent;
@@ -239,34 +443,112 @@ static void GClip_InsertLinkBefore( link_t *l, link_t *before, int entNum )
 	l->entNum = entNum;
 }
 
+/*
+* GClip_CompareFloats
+*/
+static int GClip_CompareFloats( const void *a, const void *b )
+{
+	float fa = *(const float *)a, fb = *(const float *)b;
+
+	return fa < fb ? -1 : ( fa > fb ? 1 : 0 );
+}
+
+/*
+* GClip_FindAreaSplit
+* Finds the split of a node that leaves the least entities to walk, counting the
+* ones crossing it and the ones on the most crowded side.
+* returns qfalse if no split is better than a leaf
+*/
+static qboolean GClip_FindAreaSplit( vec3_t mins, vec3_t maxs, int *ents, int numEnts, int *axis, float *dist )
+{
+	int i, j, k, front, back, cost, bestCost;
+	float split;
+	edict_t *ent;
+
+	bestCost = numEnts;
+	for( i = 0; i < 3; i++ )
+	{
+		if( maxs[i] - mins[i] < AREA_MIN_SIZE * 2 )
+			continue;
+
+		for( j = 0; j < numEnts; j++ )
+		{
+			ent = EDICT_NUM( ents[j] );
+			sv_areaCenters[j] = 0.5f * ( ent->r.absmin[i] + ent->r.absmax[i] );
+		}
+		qsort( sv_areaCenters, numEnts, sizeof( float ), GClip_CompareFloats );
+
+		for( k = 1; k < AREA_SPLITS; k++ )
+		{
+			split = sv_areaCenters[k * numEnts / AREA_SPLITS];
+			if( split < mins[i] + AREA_MIN_SIZE || split > maxs[i] - AREA_MIN_SIZE )
+				continue;
+
+			front = back = 0;
+			for( j = 0; j < numEnts; j++ )
+			{
+				ent = EDICT_NUM( ents[j] );
+				if( ent->r.absmin[i] > split )
+					front++;
+				else if( ent->r.absmax[i] < split )
+					back++;
+			}
+
+			cost = numEnts - front - back + max( front, back );
+			if( cost < bestCost )
+			{
+				bestCost = cost;
+				*axis = i;
+				*dist = split;
+			}
+		}
+	}
+
+	return ( bestCost < numEnts );
+}
+
 /*
 * GClip_CreateAreaNode
-* Builds a uniformly subdivided tree for the given world size
+* Builds a tree for the given world size, fitted to the given entities,
+* which are reordered to follow the nodes
 */
-static areanode_t *GClip_CreateAreaNode( int depth, vec3_t mins, vec3_t maxs )
+static areanode_t *GClip_CreateAreaNode( int depth, vec3_t mins, vec3_t maxs, int *ents, int numEnts )
 {
 	areanode_t *anode;
+	edict_t *ent;
 	vec3_t size;
 	vec3_t mins1, maxs1, mins2, maxs2;
+	int i, front, back, temp;
 
 	anode = &sv_areanodes[sv_numareanodes++];
 	GClip_ClearLink( &anode->trigger_edicts );
 	GClip_ClearLink( &anode->solid_edicts );
 
-	if( depth == AREA_DEPTH )
+	if( depth == AREA_DEPTH || ( depth >= AREA_UNIFORM_DEPTH && numEnts <= AREA_LEAF_EDICTS ) )
 	{
 		anode->axis = -1;
 		anode->children[0] = anode->children[1] = NULL;
 		return anode;
 	}
 
-	VectorSubtract( maxs, mins, size );
-	if( size[0] > size[1] )
-		anode->axis = 0;
-	else
-		anode->axis = 1;
+	if( numEnts <= AREA_LEAF_EDICTS || !GClip_FindAreaSplit( mins, maxs, ents, numEnts, &anode->axis, &anode->dist ) )
+	{
+		if( depth >= AREA_UNIFORM_DEPTH )
+		{
+			anode->axis = -1;
+			anode->children[0] = anode->children[1] = NULL;
+			return anode;
+		}
+
+		VectorSubtract( maxs, mins, size );
+		if( size[0] > size[1] )
+			anode->axis = 0;
+		else
+			anode->axis = 1;
+
+		anode->dist = 0.5 * ( maxs[anode->axis] + mins[anode->axis] );
+	}
 
-	anode->dist = 0.5 * ( maxs[anode->axis] + mins[anode->axis] );
 	VectorCopy( mins, mins1 );
 	VectorCopy( mins, mins2 );
 	VectorCopy( maxs, maxs1 );
@@ -274,12 +556,357 @@ static areanode_t *GClip_CreateAreaNode( int depth, vec3_t mins, vec3_t maxs )
 
 	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
 
-	anode->children[0] = GClip_CreateAreaNode( depth+1, mins2, maxs2 );
-	anode->children[1] = GClip_CreateAreaNode( depth+1, mins1, maxs1 );
+	// sort the entities into the ones in front, the ones behind and the crossing ones
+	front = 0;
+	back = numEnts;
+	for( i = 0; i < back; )
+	{
+		ent = EDICT_NUM( ents[i] );
+		if( ent->r.absmin[anode->axis] > anode->dist )
+		{
+			temp = ents[front]; ents[front] = ents[i]; ents[i] = temp;
+			front++;
+			i++;
+		}
+		else if( ent->r.absmax[anode->axis] < anode->dist )
+		{
+			i++;
+		}
+		else
+		{
+			back--;
+			temp = ents[back]; ents[back] = ents[i]; ents[i] = temp;
+		}
+	}
+
+	anode->children[0] = GClip_CreateAreaNode( depth+1, mins2, maxs2, ents, front );
+	anode->children[1] = GClip_CreateAreaNode( depth+1, mins1, maxs1, ents + front, back - front );
 
 	return anode;
 }
 
+/*
+* GClip_LinkAreaNode
+* links an entity into the first node its box crosses
+*/
+static void GClip_LinkAreaNode( edict_t *ent )
+{
+	areanode_t *node;
+
+	node = sv_areanodes;
+	while( 1 )
+	{
+		if( node->axis == -1 )
+			break;
+		if( ent->r.absmin[node->axis] > node->dist )
+			node = node->children[0];
+		else if( ent->r.absmax[node->axis] < node->dist )
+			node = node->children[1];
+		else
+			break; // crosses the node
+	}
+
+	if( ent->r.solid == SOLID_TRIGGER )
+		GClip_InsertLinkBefore( &ent->r.area, &node->trigger_edicts, NUM_FOR_EDICT( ent ) );
+	else
+		GClip_InsertLinkBefore( &ent->r.area, &node->solid_edicts, NUM_FOR_EDICT( ent ) );
+}
+
+/*
+* GClip_FreeTriggerGrid
+*/
+void GClip_FreeTriggerGrid( void )
+{
+	if( sv_triggerGrid.cells )
+		G_Free( sv_triggerGrid.cells );
+	if( sv_triggerGrid.nodes )
+		G_Free( sv_triggerGrid.nodes );
+	if( sv_triggerGrid.ents )
+		G_Free( sv_triggerGrid.ents );
+	if( sv_triggerGrid.caches )
+		G_Free( sv_triggerGrid.caches );
+	memset( &sv_triggerGrid, 0, sizeof( sv_triggerGrid ) );
+}
+
+/*
+* GClip_CreateTriggerGrid
+*/
+static void GClip_CreateTriggerGrid( vec3_t mins, vec3_t maxs )
+{
+	int i;
+	float size;
+
+	GClip_FreeTriggerGrid();
+
+	// cells are square and grow on big maps
+	size = max( maxs[0] - mins[0], maxs[1] - mins[1] );
+	sv_triggerGrid.cellSize = max( TRIGGERGRID_CELL_SIZE, size / TRIGGERGRID_MAX_CELLS );
+	for( i = 0; i < 2; i++ )
+	{
+		sv_triggerGrid.origin[i] = mins[i];
+		sv_triggerGrid.size[i] = (int)ceil( ( maxs[i] - mins[i] ) / sv_triggerGrid.cellSize );
+		clamp( sv_triggerGrid.size[i], 1, TRIGGERGRID_MAX_CELLS );
+	}
+
+	sv_triggerGrid.cells = G_Malloc( sv_triggerGrid.size[0] * sv_triggerGrid.size[1] * sizeof( int ) );
+	for( i = 0; i < sv_triggerGrid.size[0] * sv_triggerGrid.size[1]; i++ )
+		sv_triggerGrid.cells[i] = -1;
+
+	sv_triggerGrid.maxNodes = game.maxentities * 4;
+	sv_triggerGrid.nodes = G_Malloc( sv_triggerGrid.maxNodes * sizeof( triggercell_t ) );
+	sv_triggerGrid.freeNodes = -1;
+	sv_triggerGrid.ents = G_Malloc( game.maxentities * sizeof( triggerent_t ) );
+	sv_triggerGrid.caches = G_Malloc( gs.maxclients * sizeof( triggercache_t ) );
+
+	GClip_ClearLink( &sv_triggerGrid.edicts );
+}
+
+/*
+* GClip_TriggerGridCells
+* the range of cells a box crosses, returns qfalse if it's out of the grid
+*/
+static qboolean GClip_TriggerGridCells( vec3_t mins, vec3_t maxs, int *cmins, int *cmaxs )
+{
+	int i;
+
+	for( i = 0; i < 2; i++ )
+	{
+		cmins[i] = (int)floor( ( mins[i] - sv_triggerGrid.origin[i] ) / sv_triggerGrid.cellSize );
+		cmaxs[i] = (int)floor( ( maxs[i] - sv_triggerGrid.origin[i] ) / sv_triggerGrid.cellSize );
+		if( cmaxs[i] < 0 || cmins[i] >= sv_triggerGrid.size[i] )
+			return qfalse;
+		clamp( cmins[i], 0, sv_triggerGrid.size[i] - 1 );
+		clamp( cmaxs[i], 0, sv_triggerGrid.size[i] - 1 );
+	}
+
+	return qtrue;
+}
+
+/*
+* GClip_UngridTrigger
+* takes the trigger out of the cells it was put in
+*/
+static void GClip_UngridTrigger( int entNum )
+{
+	triggerent_t *trigger;
+	int cmins[2], cmaxs[2];
+	int x, y, i, *prev;
+
+	trigger = &sv_triggerGrid.ents[entNum];
+	if( !trigger->gridded )
+		return;
+	trigger->gridded = qfalse;
+
+	if( !GClip_TriggerGridCells( trigger->absmin, trigger->absmax, cmins, cmaxs ) )
+		return;
+
+	for( y = cmins[1]; y <= cmaxs[1]; y++ )
+	{
+		for( x = cmins[0]; x <= cmaxs[0]; x++ )
+		{
+			prev = &sv_triggerGrid.cells[y * sv_triggerGrid.size[0] + x];
+			while( ( i = *prev ) != -1 )
+			{
+				if( sv_triggerGrid.nodes[i].entNum != entNum )
+				{
+					prev = &sv_triggerGrid.nodes[i].next;
+					continue;
+				}
+
+				*prev = sv_triggerGrid.nodes[i].next;
+				sv_triggerGrid.nodes[i].next = sv_triggerGrid.freeNodes;
+				sv_triggerGrid.freeNodes = i;
+				sv_triggerGrid.numFreeNodes++;
+			}
+		}
+	}
+}
+
+/*
+* GClip_FreeGridTrigger
+* forgets the grid state of a freed entity, so a new one in its slot starts over
+*/
+void GClip_FreeGridTrigger( edict_t *ent )
+{
+	int entNum;
+
+	if( !sv_triggerGrid.ents )
+		return;
+
+	entNum = NUM_FOR_EDICT( ent );
+	GClip_UngridTrigger( entNum );
+	memset( &sv_triggerGrid.ents[entNum], 0, sizeof( triggerent_t ) );
+}
+
+/*
+* GClip_GridTrigger
+* puts the trigger in the grid cells under it, or keeps it there if it didn't move.
+* returns qfalse if it has to be linked into the area nodes instead
+*/
+static qboolean GClip_GridTrigger( edict_t *ent )
+{
+	triggerent_t *trigger;
+	triggercell_t *node;
+	int cmins[2], cmaxs[2];
+	int x, y, n, entNum;
+
+	if( !sv_triggerGrid.cells )
+		return qfalse;
+
+	entNum = NUM_FOR_EDICT( ent );
+	trigger = &sv_triggerGrid.ents[entNum];
+	if( trigger->moving )
+		return qfalse;
+
+	if( trigger->gridded )
+	{
+		if( VectorCompare( ent->r.absmin, trigger->absmin ) && VectorCompare( ent->r.absmax, trigger->absmax ) )
+			return qtrue; // still in the player caches
+
+		GClip_UngridTrigger( entNum );
+		if( ++trigger->moves > TRIGGERGRID_MAX_MOVES )
+		{
+			trigger->moving = qtrue;
+			return qfalse;
+		}
+	}
+
+	if( !GClip_TriggerGridCells( ent->r.absmin, ent->r.absmax, cmins, cmaxs ) )
+		return qfalse;
+	n = ( cmaxs[0] - cmins[0] + 1 ) * ( cmaxs[1] - cmins[1] + 1 );
+	if( n > TRIGGERGRID_MAX_ENTCELLS
+		|| n > sv_triggerGrid.maxNodes - sv_triggerGrid.numNodes + sv_triggerGrid.numFreeNodes )
+	{
+		trigger->moving = qtrue;
+		return qfalse;
+	}
+
+	for( y = cmins[1]; y <= cmaxs[1]; y++ )
+	{
+		for( x = cmins[0]; x <= cmaxs[0]; x++ )
+		{
+			if( sv_triggerGrid.freeNodes != -1 )
+			{
+				n = sv_triggerGrid.freeNodes;
+				sv_triggerGrid.freeNodes = sv_triggerGrid.nodes[n].next;
+				sv_triggerGrid.numFreeNodes--;
+			}
+			else
+				n = sv_triggerGrid.numNodes++;
+
+			node = &sv_triggerGrid.nodes[n];
+			node->entNum = entNum;
+			node->next = sv_triggerGrid.cells[y * sv_triggerGrid.size[0] + x];
+			sv_triggerGrid.cells[y * sv_triggerGrid.size[0] + x] = n;
+		}
+	}
+
+	VectorCopy( ent->r.absmin, trigger->absmin );
+	VectorCopy( ent->r.absmax, trigger->absmax );
+	trigger->gridded = qtrue;
+	sv_triggerGrid.generation++;
+	return qtrue;
+}
+
+/*
+* GClip_GridTriggers
+* like GClip_AreaEdicts for the triggers in the grid, unlinked and deactivated
+* ones are only skipped if skipInactive is set. Returns maxcount if there were more
+*/
+static int GClip_GridTriggers( vec3_t mins, vec3_t maxs, int *list, int maxcount, qboolean skipInactive )
+{
+	triggerent_t *trigger;
+	edict_t *ent;
+	int cmins[2], cmaxs[2];
+	int x, y, i, count = 0;
+
+	if( !sv_triggerGrid.cells )
+		return 0;
+	if( skipInactive && sv_triggerGrid.edicts.next == &sv_triggerGrid.edicts )
+		return 0;
+	if( !GClip_TriggerGridCells( mins, maxs, cmins, cmaxs ) )
+		return 0;
+
+	// triggers in more than one cell are only added once
+	sv_triggerGrid.touchcount++;
+
+	for( y = cmins[1]; y <= cmaxs[1]; y++ )
+	{
+		for( x = cmins[0]; x <= cmaxs[0]; x++ )
+		{
+			for( i = sv_triggerGrid.cells[y * sv_triggerGrid.size[0] + x]; i != -1; i = sv_triggerGrid.nodes[i].next )
+			{
+				trigger = &sv_triggerGrid.ents[sv_triggerGrid.nodes[i].entNum];
+				if( trigger->touchcount == sv_triggerGrid.touchcount )
+					continue;
+				trigger->touchcount = sv_triggerGrid.touchcount;
+
+				ent = EDICT_NUM( sv_triggerGrid.nodes[i].entNum );
+				if( skipInactive && ( !trigger->linked || ent->r.solid == SOLID_NOT ) )
+					continue; // unlinked or deactivated, relinking them in place keeps the caches
+
+				if( !BoundsIntersect( trigger->absmin, trigger->absmax, mins, maxs ) )
+					continue; // not touching where it's gridded
+
+				if( count == maxcount )
+					return count;
+				list[count++] = sv_triggerGrid.nodes[i].entNum;
+			}
+		}
+	}
+
+	return count;
+}
+
+/*
+* GClip_ClientGridTriggers
+* GClip_GridTriggers for a moving player, the triggers around the path of the
+* step are looked up once and reused by the next steps which stay among them
+*/
+static int GClip_ClientGridTriggers( int clientNum, vec3_t pathmins, vec3_t pathmaxs, vec3_t mins, vec3_t maxs, int *list, int maxcount )
+{
+	triggercache_t *cache;
+	edict_t *ent;
+	int i, count;
+
+	if( !sv_triggerGrid.caches || clientNum < 0 || clientNum >= gs.maxclients )
+		return GClip_GridTriggers( mins, maxs, list, maxcount, qtrue );
+
+	cache = &sv_triggerGrid.caches[clientNum];
+	if( cache->generation != sv_triggerGrid.generation
+		|| mins[0] < cache->mins[0] || mins[1] < cache->mins[1] || mins[2] < cache->mins[2]
+		|| maxs[0] > cache->maxs[0] || maxs[1] > cache->maxs[1] || maxs[2] > cache->maxs[2] )
+	{
+		for( i = 0; i < 3; i++ )
+		{
+			cache->mins[i] = pathmins[i] - TRIGGERCACHE_MARGIN;
+			cache->maxs[i] = pathmaxs[i] + TRIGGERCACHE_MARGIN;
+		}
+
+		cache->numEnts = GClip_GridTriggers( cache->mins, cache->maxs, cache->ents, TRIGGERCACHE_MAX_ENTS, qfalse );
+		cache->crowded = ( cache->numEnts == TRIGGERCACHE_MAX_ENTS );
+		cache->generation = sv_triggerGrid.generation;
+	}
+
+	if( cache->crowded )
+		return GClip_GridTriggers( mins, maxs, list, maxcount, qtrue );
+
+	count = 0;
+	for( i = 0; i < cache->numEnts && count < maxcount; i++ )
+	{
+		if( !sv_triggerGrid.ents[cache->ents[i]].linked )
+			continue;
+
+		ent = EDICT_NUM( cache->ents[i] );
+		if( ent->r.solid == SOLID_NOT || !BoundsIntersect( ent->r.absmin, ent->r.absmax, mins, maxs ) )
+			continue;
+
+		list[count++] = cache->ents[i];
+	}
+
+	return count;
+}
+
 /*
 * GClip_ClearWorld
 * called after the world model has been loaded, before linking any entities
@@ -292,9 +919,100 @@ void GClip_ClearWorld( void )
 	memset( sv_areanodes, 0, sizeof( sv_areanodes ) );
 	sv_numareanodes = 0;
 
+	// the backed up frames belong to the previous map
+	GClip_ClearCollisionHistory();
+
 	cmodel = trap_CM_InlineModel( 0 );
 	trap_CM_InlineModelBounds( cmodel, mins, maxs );
-	GClip_CreateAreaNode( 0, mins, maxs );
+	VectorCopy( mins, sv_areaMins );
+	VectorCopy( maxs, sv_areaMaxs );
+	GClip_CreateAreaNode( 0, mins, maxs, NULL, 0 );
+	GClip_CreateTriggerGrid( mins, maxs );
+
+	sv_areaRebuildTime = 0;
+}
+
+/*
+* GClip_UpdateAreaNodes
+* rebuilds the area nodes around the linked entities every now and then
+*/
+void GClip_UpdateAreaNodes( void )
+{
+	edict_t *ent;
+	int i, numEnts;
+
+	if( !sv_numareanodes || game.serverTime < sv_areaRebuildTime )
+		return;
+	sv_areaRebuildTime = game.serverTime + AREA_REBUILD_TIME;
+
+	// the entities in the nodes, the grid triggers are kept apart
+	numEnts = 0;
+	for( i = 1; i < game.numentities; i++ )
+	{
+		ent = EDICT_NUM( i );
+		if( !ent->r.area.prev )
+			continue;
+		if( sv_triggerGrid.ents && sv_triggerGrid.ents[i].linked )
+			continue;
+		sv_areaEdicts[numEnts++] = i;
+	}
+
+	memset( sv_areanodes, 0, sizeof( sv_areanodes ) );
+	sv_numareanodes = 0;
+	GClip_CreateAreaNode( 0, sv_areaMins, sv_areaMaxs, sv_areaEdicts, numEnts );
+
+	for( i = 0; i < numEnts; i++ )
+		GClip_LinkAreaNode( EDICT_NUM( sv_areaEdicts[i] ) );
+}
+
+/*
+* GClip_PrintAreaNode
+*/
+static void GClip_PrintAreaNode( areanode_t *node, int depth, int *maxEdicts )
+{
+	link_t *l;
+	int numSolid = 0, numTriggers = 0;
+
+	for( l = node->solid_edicts.next; l != &node->solid_edicts; l = l->next )
+		numSolid++;
+	for( l = node->trigger_edicts.next; l != &node->trigger_edicts; l = l->next )
+		numTriggers++;
+	if( numSolid + numTriggers > *maxEdicts )
+		*maxEdicts = numSolid + numTriggers;
+
+	if( node->axis == -1 )
+		G_Printf( "%*sleaf: %i solid, %i triggers\n", depth * 2, "", numSolid, numTriggers );
+	else
+		G_Printf( "%*s%c %.0f: %i solid, %i triggers\n", depth * 2, "", "xyz"[node->axis], node->dist, numSolid, numTriggers );
+
+	if( node->axis == -1 )
+		return;
+
+	GClip_PrintAreaNode( node->children[0], depth + 1, maxEdicts );
+	GClip_PrintAreaNode( node->children[1], depth + 1, maxEdicts );
+}
+
+/*
+* GClip_AreaNodes_f
+* prints the area nodes with the number of entities linked into each
+*/
+void GClip_AreaNodes_f( void )
+{
+	link_t *l;
+	int maxEdicts = 0, numGridTriggers = 0;
+
+	if( !sv_numareanodes )
+	{
+		G_Printf( "No map loaded\n" );
+		return;
+	}
+
+	GClip_PrintAreaNode( sv_areanodes, 0, &maxEdicts );
+
+	for( l = sv_triggerGrid.edicts.next; l && l != &sv_triggerGrid.edicts; l = l->next )
+		numGridTriggers++;
+
+	G_Printf( "%i nodes, at most %i entities in a node, %i triggers in the grid\n", sv_numareanodes, maxEdicts, numGridTriggers );
 }
 
 
@@ -310,6 +1028,9 @@ void GClip_UnlinkEntity( edict_t *ent )
 	GClip_RemoveLink( &ent->r.area );
 	ent->r.area.prev = ent->r.area.next = NULL;
 	ent->linked = qfalse;
+
+	if( sv_triggerGrid.ents )
+		sv_triggerGrid.ents[NUM_FOR_EDICT( ent )].linked = qfalse;
 }
 
 
@@ -324,7 +1045,6 @@ void GClip_UnlinkEntity( edict_t *ent )
 #define MAX_TOTAL_ENT_LEAFS	128
 void GClip_LinkEntity( edict_t *ent )
 {
-	areanode_t *node;
 	int leafs[MAX_TOTAL_ENT_LEAFS];
 	int clusters[MAX_TOTAL_ENT_LEAFS];
 	int num_leafs;
@@ -485,25 +1205,14 @@ void GClip_LinkEntity( edict_t *ent )
 	if( ent->r.solid == SOLID_NOT )
 		return;
 
-	// find the first node that the ent's box crosses
-	node = sv_areanodes;
-	while( 1 )
+	// link it in
+	if( ent->r.solid == SOLID_TRIGGER && GClip_GridTrigger( ent ) )
 	{
-		if( node->axis == -1 )
-			break;
-		if( ent->r.absmin[node->axis] > node->dist )
-			node = node->children[0];
-		else if( ent->r.absmax[node->axis] < node->dist )
-			node = node->children[1];
-		else
-			break; // crosses the node
+		GClip_InsertLinkBefore( &ent->r.area, &sv_triggerGrid.edicts, NUM_FOR_EDICT( ent ) );
+		sv_triggerGrid.ents[NUM_FOR_EDICT( ent )].linked = qtrue;
 	}
-
-	// link it in
-	if( ent->r.solid == SOLID_TRIGGER )
-		GClip_InsertLinkBefore( &ent->r.area, &node->trigger_edicts, NUM_FOR_EDICT( ent ) );
 	else
-		GClip_InsertLinkBefore( &ent->r.area, &node->solid_edicts, NUM_FOR_EDICT( ent ) );
+		GClip_LinkAreaNode( ent );
 }
 
 /*
@@ -536,7 +1245,7 @@ void GClip_SetAreaPortalState( edict_t *ent, qboolean open )
 static int GClip_AreaEdicts( vec3_t mins, vec3_t maxs, int *list, int maxcount, int areatype, int timeDelta )
 {
 	link_t *l, *start;
-	c4clipedict_t *clipEnt;
+	c4clipedict_t *clipEnt, clipEntData;
 	int stackdepth = 0, count = 0;
 	areanode_t *localstack[AREA_NODES], *node = sv_areanodes;
 
@@ -550,7 +1259,7 @@ static int GClip_AreaEdicts( vec3_t mins, vec3_t maxs, int *list, int maxcount,
 
 		for( l = start->next; l != start; l = l->next )
 		{
-			clipEnt = GClip_GetClipEdictForDeltaTime( l->entNum, timeDelta );
+			clipEnt = GClip_GetClipEdictForDeltaTime( l->entNum, timeDelta, &clipEntData );
 
 			if( clipEnt->r.solid == SOLID_NOT )
 				continue; // deactivated
@@ -631,10 +1340,11 @@ static struct cmodel_s *GClip_CollisionModelForEntity( entity_state_t *s, entity
 */
 static int GClip_PointContents( vec3_t p, int timeDelta )
 {
-	c4clipedict_t *clipEnt;
+	c4clipedict_t *clipEnt, clipEntData;
 	int touch[MAX_EDICTS];
 	int i, num;
 	int contents, c2;
+	qboolean boxModel;
 	struct cmodel_s	*cmodel;
 	float *angles;
 
@@ -646,18 +1356,26 @@ static int GClip_PointContents( vec3_t p, int timeDelta )
 
 	for( i = 0; i < num; i++ )
 	{
-		clipEnt = GClip_GetClipEdictForDeltaTime( touch[i], timeDelta );
+		clipEnt = GClip_GetClipEdictForDeltaTime( touch[i], timeDelta, &clipEntData );
+		boxModel = !ISBRUSHMODEL( clipEnt->s.modelindex );
+
+		// the temp box hulls are shared, keep them until done
+		if( boxModel )
+			G_PMove_LockBoxModels();
 
 		// might intersect, so do an exact clip
 		cmodel = GClip_CollisionModelForEntity( &clipEnt->s, &clipEnt->r );
 
-		if( !ISBRUSHMODEL( clipEnt->s.modelindex ) )
+		if( boxModel )
 			angles = vec3_origin; // boxes don't rotate
 		else
 			angles = clipEnt->s.angles;
 
 		c2 = trap_CM_TransformedPointContents( p, cmodel, clipEnt->s.origin, clipEnt->s.angles );
 		contents |= c2;
+
+		if( boxModel )
+			G_PMove_UnlockBoxModels();
 	}
 
 	return contents;
@@ -692,9 +1410,10 @@ typedef struct
 /*static*/ void GClip_ClipMoveToEntities( moveclip_t *clip, int timeDelta )
 {
 	int i, num;
-	c4clipedict_t *touch;
+	c4clipedict_t *touch, touchData;
 	int touchlist[MAX_EDICTS];
 	trace_t	trace;
+	qboolean boxModel;
 	struct cmodel_s	*cmodel;
 	float *angles;
 
@@ -704,7 +1423,7 @@ typedef struct
 	// list removed before we get to it (killtriggered)
 	for( i = 0; i < num; i++ )
 	{
-		touch = GClip_GetClipEdictForDeltaTime( touchlist[i], timeDelta );
+		touch = GClip_GetClipEdictForDeltaTime( touchlist[i], timeDelta, &touchData );
 		if( clip->passent >= 0 )
 		{
 			// when they are offseted in time, they can be a different pointer but be the same entity
@@ -723,10 +1442,19 @@ typedef struct
 		if( ( touch->r.svflags & SVF_CORPSE ) && !( clip->contentmask & CONTENTS_CORPSE ) )
 			continue;
 
+		// the temp box hulls only have CONTENTS_BODY, they can't stop this trace
+		boxModel = !ISBRUSHMODEL( touch->s.modelindex );
+		if( boxModel && !( clip->contentmask & CONTENTS_BODY ) )
+			continue;
+
+		// and they are shared, keep them until done
+		if( boxModel )
+			G_PMove_LockBoxModels();
+
 		// might intersect, so do an exact clip
 		cmodel = GClip_CollisionModelForEntity( &touch->s, &touch->r );
 
-		if( ISBRUSHMODEL( touch->s.modelindex ) )
+		if( !boxModel )
 			angles = touch->s.angles;
 		else
 			angles = vec3_origin; // boxes don't rotate
@@ -735,6 +1463,9 @@ typedef struct
 			clip->mins, clip->maxs, cmodel, clip->contentmask,
 			touch->s.origin, angles );
 
+		if( boxModel )
+			G_PMove_UnlockBoxModels();
+
 		if( trace.allsolid || trace.fraction < clip->trace->fraction )
 		{
 			trace.ent = touch->s.number;
@@ -945,7 +1676,8 @@ void GClip_TouchTriggers( edict_t *ent )
 	VectorAdd( ent->s.origin, ent->r.maxs, maxs );
 
 	// FIXME: should be s.origin + mins and s.origin + maxs because of absmin and absmax padding?
-	num = GClip_AreaEdicts( ent->r.absmin, ent->r.absmax, touch, MAX_EDICTS, AREA_TRIGGERS, 0 );
+	num = GClip_GridTriggers( ent->r.absmin, ent->r.absmax, touch, MAX_EDICTS, qtrue );
+	num += GClip_AreaEdicts( ent->r.absmin, ent->r.absmax, touch + num, MAX_EDICTS - num, AREA_TRIGGERS, 0 );
 
 	// be careful, it is possible to have an entity in this
 	// list removed before we get to it (killtriggered)
@@ -974,7 +1706,9 @@ void G_PMoveTouchTriggers( pmove_t *pm )
 	edict_t	*hit;
 	int touch[MAX_EDICTS];
 	vec3_t mins, maxs;
+	vec3_t pathmins, pathmaxs;
 	edict_t	*ent;
+	gclient_t *client;
 
 	if( pm->playerState->POVnum <= 0 || (int)pm->playerState->POVnum > gs.maxclients )
 		return;
@@ -983,6 +1717,13 @@ void G_PMoveTouchTriggers( pmove_t *pm )
 	if( !ent->r.client || G_IsDead( ent ) )  // dead things don't activate triggers!
 		return;
 
+	// keep the step for G_Client_TouchTime
+	client = ent->r.client;
+	VectorCopy( ent->s.origin, client->touchStart );
+	VectorCopy( pm->playerState->pmove.origin, client->touchEnd );
+	VectorCopy( pm->mins, client->touchMins );
+	VectorCopy( pm->maxs, client->touchMaxs );
+
 	// update the entity with the new position
 	VectorCopy( pm->playerState->pmove.origin, ent->s.origin );
 	VectorCopy( pm->playerState->pmove.velocity, ent->velocity );
@@ -1008,7 +1749,15 @@ void G_PMoveTouchTriggers( pmove_t *pm )
 	VectorAdd( pm->playerState->pmove.origin, pm->mins, mins );
 	VectorAdd( pm->playerState->pmove.origin, pm->maxs, maxs );
 
-	num = GClip_AreaEdicts( mins, maxs, touch, MAX_EDICTS, AREA_TRIGGERS, 0 );
+	// the box swept by the step
+	for( i = 0; i < 3; i++ )
+	{
+		pathmins[i] = min( client->touchStart[i], client->touchEnd[i] ) + pm->mins[i];
+		pathmaxs[i] = max( client->touchStart[i], client->touchEnd[i] ) + pm->maxs[i];
+	}
+
+	num = GClip_ClientGridTriggers( PLAYERNUM( ent ), pathmins, pathmaxs, mins, maxs, touch, MAX_EDICTS );
+	num += GClip_AreaEdicts( mins, maxs, touch + num, MAX_EDICTS - num, AREA_TRIGGERS, 0 );
 
 	// be careful, it is possible to have an entity in this
 	// list removed before we get to it (killtriggered)
@@ -1027,8 +1776,58 @@ void G_PMoveTouchTriggers( pmove_t *pm )
 		if( !hit->item && !GClip_EntityContact( mins, maxs, hit ) )
 			continue;
 
+		client->touchTrigger = hit;
 		G_CallTouch( hit, ent, NULL, 0 );
 	}
+
+	client->touchTrigger = NULL;
+}
+
+/*
+* G_Client_TouchTime
+* The time, with sub-millisecond precision, at which the box of the client first
+* touched the trigger it is touching now, found by tracing the last pmove step
+* against it. It's on the timeline of the usercmds, so it doesn't depend on the
+* rate at which they are sent or run.
+*/
+double G_Client_TouchTime( gclient_t *client )
+{
+	trace_t tr;
+	edict_t *hit;
+	struct cmodel_s *cmodel;
+	vec3_t move;
+	float frac, speed;
+
+	if( !client->ucmd.serverTimeStamp )
+		return game.serverTime;
+
+	hit = client->touchTrigger;
+	if( !hit )
+		return client->ucmd.serverTimeStamp;
+
+	cmodel = GClip_CollisionModelForEntity( &hit->s, &hit->r );
+	trap_CM_TransformedBoxTrace( &tr, client->touchStart, client->touchEnd, client->touchMins, client->touchMaxs,
+		cmodel, MASK_ALL, hit->s.origin, ISBRUSHMODEL( hit->s.modelindex ) ? hit->s.angles : vec3_origin );
+
+	if( tr.startsolid )
+	{
+		frac = 0;
+	}
+	else
+	{
+		frac = tr.fraction;
+
+		// the trace stops DIST_EPSILON short of the surface
+		VectorSubtract( client->touchEnd, client->touchStart, move );
+		speed = -DotProduct( move, tr.plane.normal );
+		if( frac < 1 && speed > 0 )
+			frac += DIST_EPSILON / speed;
+		if( frac > 1 )
+			frac = 1;
+	}
+
+	// the step ends at the timestamp of its usercmd
+	return (double)client->ucmd.serverTimeStamp - (double)client->ucmd.msec * ( 1.0 - frac );
 }
 
 /*
@@ -1038,7 +1837,7 @@ void G_PMoveTouchTriggers( pmove_t *pm )
 edict_t *GClip_FindBoxInRadius4D( edict_t *from, vec3_t org, float rad, int timeDelta )
 {
 	int i, j;
-	c4clipedict_t *check;
+	c4clipedict_t *check, checkData;
 	vec3_t mins, maxs;
 	int fromNum;
 
@@ -1050,7 +1849,7 @@ edict_t *GClip_FindBoxInRadius4D( edict_t *from, vec3_t org, float rad, int time
 		if( !game.edicts[i].r.inuse )
 			continue;
 
-		check = GClip_GetClipEdictForDeltaTime( i, timeDelta );
+		check = GClip_GetClipEdictForDeltaTime( i, timeDelta, &checkData );
 		if( !check->r.inuse )
 			continue;
 		if( check->r.solid == SOLID_NOT )
@@ -1072,9 +1871,9 @@ edict_t *GClip_FindBoxInRadius4D( edict_t *from, vec3_t org, float rad, int time
 
 void G_SplashFrac4D( int entNum, vec3_t hitpoint, float maxradius, vec3_t pushdir, float *kickFrac, float *dmgFrac, int timeDelta )
 {
-	c4clipedict_t *clipEnt;
+	c4clipedict_t *clipEnt, clipEntData;
 
-	clipEnt = GClip_GetClipEdictForDeltaTime( entNum, timeDelta );
+	clipEnt = GClip_GetClipEdictForDeltaTime( entNum, timeDelta, &clipEntData );
 	// racesow - weqo
 	rs_SplashFrac( clipEnt->s.origin, clipEnt->r.mins, clipEnt->r.maxs, hitpoint, maxradius, pushdir, kickFrac, dmgFrac );
 	// to use default settings:
@@ -1084,14 +1883,22 @@ void G_SplashFrac4D( int entNum, vec3_t hitpoint, float maxradius, vec3_t pushdi
 
 entity_state_t *G_GetEntityStateForDeltaTime( int entNum, int deltaTime )
 {
+	static int index = 0;
+	static c4clipedict_t clipEnts[8];
 	c4clipedict_t *clipEnt;
 
 	if( entNum == -1 )
 		return NULL;
 
-	assert( entNum >= 0 && entNum < MAX_EDICTS );
+	assert( entNum >= 0 && entNum < game.maxentities );
 
-	clipEnt = GClip_GetClipEdictForDeltaTime( entNum, deltaTime );
+	// the current state can be read in place, also from parallel pmoves
+	if( deltaTime >= 0 )
+		return &game.edicts[entNum].s;
+
+	// pick one of the 8 slots to prevent overwritings
+	clipEnt = GClip_GetClipEdictForDeltaTime( entNum, deltaTime, &clipEnts[index] );
+	index = ( index + 1 )&7;
 
 	return &clipEnt->s;
 }
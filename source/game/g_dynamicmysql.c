@@ -641,6 +641,134 @@ qboolean LoadMySQLFunctions( void )
       Com_Printf("Got mysql_warning_count\n");
     }
 
+    mysql_stmt_init_pointer = dlsym(libmysqlclient,"mysql_stmt_init");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_init\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_init\n");
+    }
+
+    mysql_stmt_prepare_pointer = dlsym(libmysqlclient,"mysql_stmt_prepare");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_prepare\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_prepare\n");
+    }
+
+    mysql_stmt_execute_pointer = dlsym(libmysqlclient,"mysql_stmt_execute");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_execute\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_execute\n");
+    }
+
+    mysql_stmt_fetch_pointer = dlsym(libmysqlclient,"mysql_stmt_fetch");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_fetch\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_fetch\n");
+    }
+
+    mysql_stmt_store_result_pointer = dlsym(libmysqlclient,"mysql_stmt_store_result");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_store_result\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_store_result\n");
+    }
+
+    mysql_stmt_attr_set_pointer = dlsym(libmysqlclient,"mysql_stmt_attr_set");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_attr_set\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_attr_set\n");
+    }
+
+    mysql_stmt_bind_param_pointer = dlsym(libmysqlclient,"mysql_stmt_bind_param");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_bind_param\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_bind_param\n");
+    }
+
+    mysql_stmt_bind_result_pointer = dlsym(libmysqlclient,"mysql_stmt_bind_result");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_bind_result\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_bind_result\n");
+    }
+
+    mysql_stmt_close_pointer = dlsym(libmysqlclient,"mysql_stmt_close");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_close\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_close\n");
+    }
+
+    mysql_stmt_free_result_pointer = dlsym(libmysqlclient,"mysql_stmt_free_result");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_free_result\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_free_result\n");
+    }
+
+    mysql_stmt_result_metadata_pointer = dlsym(libmysqlclient,"mysql_stmt_result_metadata");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_result_metadata\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_result_metadata\n");
+    }
+
+    mysql_stmt_errno_pointer = dlsym(libmysqlclient,"mysql_stmt_errno");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_errno\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_errno\n");
+    }
+
+    mysql_stmt_error_pointer = dlsym(libmysqlclient,"mysql_stmt_error");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_error\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_error\n");
+    }
+
+    mysql_stmt_num_rows_pointer = dlsym(libmysqlclient,"mysql_stmt_num_rows");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_num_rows\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_num_rows\n");
+    }
+
+    mysql_stmt_affected_rows_pointer = dlsym(libmysqlclient,"mysql_stmt_affected_rows");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_affected_rows\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_affected_rows\n");
+    }
+
+    mysql_stmt_insert_id_pointer = dlsym(libmysqlclient,"mysql_stmt_insert_id");
+    if((error = dlerror()) != NULL) {
+      Com_Printf("No mysql_stmt_insert_id\n");
+      return qfalse;
+    } else {
+      Com_Printf("Got mysql_stmt_insert_id\n");
+    }
+
     Com_Printf("\nDone.\n");
 
     return qtrue;
@@ -725,6 +853,22 @@ mysql_thread_init_pointer=NULL;
 mysql_thread_safe_pointer=NULL;
 mysql_use_result_pointer=NULL;
 mysql_warning_count_pointer=NULL;
+mysql_stmt_init_pointer=NULL;
+mysql_stmt_prepare_pointer=NULL;
+mysql_stmt_execute_pointer=NULL;
+mysql_stmt_fetch_pointer=NULL;
+mysql_stmt_store_result_pointer=NULL;
+mysql_stmt_attr_set_pointer=NULL;
+mysql_stmt_bind_param_pointer=NULL;
+mysql_stmt_bind_result_pointer=NULL;
+mysql_stmt_close_pointer=NULL;
+mysql_stmt_free_result_pointer=NULL;
+mysql_stmt_result_metadata_pointer=NULL;
+mysql_stmt_errno_pointer=NULL;
+mysql_stmt_error_pointer=NULL;
+mysql_stmt_num_rows_pointer=NULL;
+mysql_stmt_affected_rows_pointer=NULL;
+mysql_stmt_insert_id_pointer=NULL;
 
 #undef my_init
 #undef mysql_affected_rows
@@ -803,4 +947,20 @@ mysql_warning_count_pointer=NULL;
 #undef mysql_thread_safe
 #undef mysql_use_result
 #undef mysql_warning_count
+#undef mysql_stmt_init
+#undef mysql_stmt_prepare
+#undef mysql_stmt_execute
+#undef mysql_stmt_fetch
+#undef mysql_stmt_store_result
+#undef mysql_stmt_attr_set
+#undef mysql_stmt_bind_param
+#undef mysql_stmt_bind_result
+#undef mysql_stmt_close
+#undef mysql_stmt_free_result
+#undef mysql_stmt_result_metadata
+#undef mysql_stmt_errno
+#undef mysql_stmt_error
+#undef mysql_stmt_num_rows
+#undef mysql_stmt_affected_rows
+#undef mysql_stmt_insert_id
 }
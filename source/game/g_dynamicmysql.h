@@ -82,6 +82,22 @@ my_bool (*mysql_thread_init_pointer)(void);
 unsigned int (*mysql_thread_safe_pointer)(void);
 MYSQL_RES *(*mysql_use_result_pointer)(MYSQL *mysql);
 unsigned int (*mysql_warning_count_pointer)(MYSQL *mysql);
+MYSQL_STMT *(*mysql_stmt_init_pointer)(MYSQL *mysql);
+int (*mysql_stmt_prepare_pointer)(MYSQL_STMT *stmt, const char *query, unsigned long length);
+int (*mysql_stmt_execute_pointer)(MYSQL_STMT *stmt);
+int (*mysql_stmt_fetch_pointer)(MYSQL_STMT *stmt);
+int (*mysql_stmt_store_result_pointer)(MYSQL_STMT *stmt);
+my_bool (*mysql_stmt_attr_set_pointer)(MYSQL_STMT *stmt, enum enum_stmt_attr_type attr_type, const void *attr);
+my_bool (*mysql_stmt_bind_param_pointer)(MYSQL_STMT *stmt, MYSQL_BIND *bnd);
+my_bool (*mysql_stmt_bind_result_pointer)(MYSQL_STMT *stmt, MYSQL_BIND *bnd);
+my_bool (*mysql_stmt_close_pointer)(MYSQL_STMT *stmt);
+my_bool (*mysql_stmt_free_result_pointer)(MYSQL_STMT *stmt);
+MYSQL_RES *(*mysql_stmt_result_metadata_pointer)(MYSQL_STMT *stmt);
+unsigned int (*mysql_stmt_errno_pointer)(MYSQL_STMT *stmt);
+const char *(*mysql_stmt_error_pointer)(MYSQL_STMT *stmt);
+my_ulonglong (*mysql_stmt_num_rows_pointer)(MYSQL_STMT *stmt);
+my_ulonglong (*mysql_stmt_affected_rows_pointer)(MYSQL_STMT *stmt);
+my_ulonglong (*mysql_stmt_insert_id_pointer)(MYSQL_STMT *stmt);
 
 //Redefine mysql functions with the pointers from the dynamic loaded library
 #define my_init(x) my_init_pointer(x)
@@ -164,3 +180,19 @@ unsigned int (*mysql_warning_count_pointer)(MYSQL *mysql);
 #define mysql_thread_safe() mysql_thread_safe_pointer()
 #define mysql_use_result(x) mysql_use_result_pointer(x)
 #define mysql_warning_count(x) mysql_warning_count_pointer(x)
+#define mysql_stmt_init(x) mysql_stmt_init_pointer(x)
+#define mysql_stmt_prepare(x,y,z) mysql_stmt_prepare_pointer(x,y,z)
+#define mysql_stmt_execute(x) mysql_stmt_execute_pointer(x)
+#define mysql_stmt_fetch(x) mysql_stmt_fetch_pointer(x)
+#define mysql_stmt_store_result(x) mysql_stmt_store_result_pointer(x)
+#define mysql_stmt_attr_set(x,y,z) mysql_stmt_attr_set_pointer(x,y,z)
+#define mysql_stmt_bind_param(x,y) mysql_stmt_bind_param_pointer(x,y)
+#define mysql_stmt_bind_result(x,y) mysql_stmt_bind_result_pointer(x,y)
+#define mysql_stmt_close(x) mysql_stmt_close_pointer(x)
+#define mysql_stmt_free_result(x) mysql_stmt_free_result_pointer(x)
+#define mysql_stmt_result_metadata(x) mysql_stmt_result_metadata_pointer(x)
+#define mysql_stmt_errno(x) mysql_stmt_errno_pointer(x)
+#define mysql_stmt_error(x) mysql_stmt_error_pointer(x)
+#define mysql_stmt_num_rows(x) mysql_stmt_num_rows_pointer(x)
+#define mysql_stmt_affected_rows(x) mysql_stmt_affected_rows_pointer(x)
+#define mysql_stmt_insert_id(x) mysql_stmt_insert_id_pointer(x)
@@ -701,6 +701,7 @@ static void G_RunClients( void )
 {
 	int i, step;
 	edict_t *ent;
+	qboolean queued;
 
 	if( level.framenum & 1 )
 	{
@@ -713,6 +714,9 @@ static void G_RunClients( void )
 		step = 1;
 	}
 
+	// in race gametypes the usercmds may be queued and moved in parallel afterwards
+	queued = G_PMove_BeginThinks();
+
 	for( ; i < gs.maxclients && i >= 0; i += step )
 	{
 		ent = game.edicts + 1 + i;
@@ -720,6 +724,25 @@ static void G_RunClients( void )
 			continue;
 
 		G_ClientThink( ent );
+		if( queued )
+			continue;
+
+		if( ent->takedamage )
+			ent->s.effects |= EF_TAKEDAMAGE;
+		else
+			ent->s.effects &= ~EF_TAKEDAMAGE;
+	}
+
+	if( !queued )
+		return;
+
+	G_PMove_EndThinks();
+
+	for( i = 0; i < gs.maxclients; i++ )
+	{
+		ent = game.edicts + 1 + i;
+		if( !ent->r.inuse )
+			continue;
 
 		if( ent->takedamage )
 			ent->s.effects |= EF_TAKEDAMAGE;
@@ -774,6 +797,8 @@ void G_RunFrame( unsigned int msec, unsigned int serverTime )
 
 	G_SpawnQueue_Think();
 
+	GClip_UpdateAreaNodes();
+
 	// run the world
 	G_RunClients();
 	G_RunEntities();
@@ -341,6 +341,7 @@ extern cvar_t *g_deadbody_autogib_delay;
 extern cvar_t *g_challengers_queue;
 extern cvar_t *g_antilag_timenudge;
 extern cvar_t *g_antilag_maxtimedelta;
+extern cvar_t *g_pmovethreads;
 
 extern cvar_t *g_teams_maxplayers;
 extern cvar_t *g_teams_allow_uneven;
@@ -701,15 +702,21 @@ void	G_Trace( trace_t *tr, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, e
 int G_PointContents4D( vec3_t p, int timeDelta );
 void G_Trace4D( trace_t *tr, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *passedict, int contentmask, int timeDelta );
 void GClip_BackUpCollisionFrame( void );
+void GClip_FreeCollisionHistory( void );
+void GClip_FreeTriggerGrid( void );
+void GClip_FreeGridTrigger( edict_t *ent );
 edict_t *GClip_FindBoxInRadius4D( edict_t *from, vec3_t org, float rad, int timeDelta );
 void G_SplashFrac4D( int entNum, vec3_t hitpoint, float maxradius, vec3_t pushdir, float *kickFrac, float *dmgFrac, int timeDelta );
 void	GClip_ClearWorld( void );
+void	GClip_UpdateAreaNodes( void );
+void	GClip_AreaNodes_f( void );
 void	GClip_SetBrushModel( edict_t *ent, char *name );
 void	GClip_SetAreaPortalState( edict_t *ent, qboolean open );
 void	GClip_LinkEntity( edict_t *ent );
 void	GClip_UnlinkEntity( edict_t *ent );
 void	GClip_TouchTriggers( edict_t *ent );
 void G_PMoveTouchTriggers( pmove_t *pm );
+double G_Client_TouchTime( gclient_t *client );
 
 
 
@@ -804,6 +811,8 @@ void G_ClientRespawn( edict_t *self, qboolean ghost );
 void G_ClientClearStats( edict_t *ent );
 void G_GhostClient( edict_t *self );
 qboolean ClientMultiviewChanged( edict_t *ent, qboolean multiview );
+void G_Client_BeginMove( edict_t *ent, usercmd_t *ucmd, int timeDelta, pmove_t *pm );
+void G_Client_EndMove( edict_t *ent, usercmd_t *ucmd, pmove_t *pm );
 void ClientThink( edict_t *ent, usercmd_t *cmd, int timeDelta );
 void G_ClientThink( edict_t *ent );
 void G_CheckClientRespawnClick( edict_t *ent );
@@ -813,6 +822,17 @@ void ClientBegin( edict_t *ent );
 void ClientCommand( edict_t *ent );
 void G_PredictedEvent( int entNum, int ev, int parm );
 
+//
+// p_move.c
+//
+void G_PMove_Shutdown( void );
+qboolean G_PMove_BeginThinks( void );
+void G_PMove_EndThinks( void );
+qboolean G_PMove_QueueThink( edict_t *ent, usercmd_t *ucmd, int timeDelta );
+qboolean G_PMove_DeferEvent( int entNum, int ev, int parm );
+void G_PMove_LockBoxModels( void );
+void G_PMove_UnlockBoxModels( void );
+
 //
 // g_player.c
 //
@@ -1166,6 +1186,11 @@ struct gclient_s
 
 	pmove_state_t old_pmove;    // for detecting out-of-pmove changes
 
+	// the trigger being touched from G_PMoveTouchTriggers and the step that touched it
+	edict_t *touchTrigger;
+	vec3_t touchStart, touchEnd;
+	vec3_t touchMins, touchMaxs;
+
 	int asRefCount, asFactored;
 };
 
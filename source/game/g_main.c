@@ -64,6 +64,7 @@ cvar_t *bot_showcombat;
 cvar_t *bot_showsrgoal;
 cvar_t *bot_showlrgoal;
 cvar_t *bot_dummy;
+cvar_t *bot_nexthops;
 //[end]
 
 cvar_t *g_projectile_touch_owner;
@@ -73,6 +74,7 @@ cvar_t *g_maxtimeouts;
 cvar_t *g_antilag;
 cvar_t *g_antilag_maxtimedelta;
 cvar_t *g_antilag_timenudge;
+cvar_t *g_pmovethreads;
 cvar_t *g_autorecord;
 cvar_t *g_autorecord_maxdemos;
 
@@ -301,6 +303,7 @@ void G_Init( unsigned int seed, unsigned int framemsec, int protocol )
 	g_antilag_maxtimedelta->modified = qtrue;
 	g_antilag_timenudge = trap_Cvar_Get( "g_antilag_timenudge", "0", CVAR_ARCHIVE );
 	g_antilag_timenudge->modified = qtrue;
+	g_pmovethreads = trap_Cvar_Get( "g_pmovethreads", "0", CVAR_ARCHIVE );
 
 	g_allow_spectator_voting = trap_Cvar_Get( "g_allow_spectator_voting", "1", CVAR_ARCHIVE );
 
@@ -405,6 +408,8 @@ void G_Shutdown( void )
 	RS_Shutdown();
 	//!racesow
 
+	G_PMove_Shutdown();
+
 	G_asCallShutdownScript();
 	G_asShutdownGametypeScript();
 
@@ -426,6 +431,9 @@ void G_Shutdown( void )
 			G_FreeEdict( &game.edicts[i] );
 	}
 
+	GClip_FreeCollisionHistory();
+	GClip_FreeTriggerGrid();
+
 	G_Free( game.edicts );
 	G_Free( game.clients );
 }
@@ -9,6 +9,9 @@
 #include "g_dynamicmysql.h"
 #endif
 #define MOSQUITTO
+#ifdef MOSQUITTO
+#include "net_mosq.h"
+#endif
 
 qboolean mysqlclient_present=qfalse;
 
@@ -25,6 +28,7 @@ cvar_t *rs_mysqlPort;
 cvar_t *rs_mysqlUser;
 cvar_t *rs_mysqlPass;
 cvar_t *rs_mysqlDb;
+cvar_t *rs_mysqlWorkers;
 
 cvar_t *rs_queryGetPlayerAuth;
 cvar_t *rs_queryGetPlayerAuthByToken;
@@ -65,6 +69,7 @@ cvar_t *rs_queryGetPlayerMapHighscore;
 cvar_t *rs_queryGetPlayerMapHighscores;
 cvar_t *rs_queryResetPlayerMapPoints;
 cvar_t *rs_queryUpdatePlayerMapPoints;
+cvar_t *rs_queryUpdateMapPoints;
 cvar_t *rs_querySetMapRating;
 cvar_t *rs_queryLoadMapList;
 cvar_t *rs_queryLoadMapHighscores;
@@ -73,6 +78,7 @@ cvar_t *rs_querySetMapOneliner;
 cvar_t *rs_queryMapFilter;
 cvar_t *rs_queryMapFilterCount;
 cvar_t *rs_queryUpdateCheckpoint;
+cvar_t *rs_queryUpdateCheckpoints;
 cvar_t *rs_queryGetPlayerMapCheckpoints;
 cvar_t *rs_queryLoadRanking;
 cvar_t *rs_queryGetUserIdByPlayerId;
@@ -95,28 +101,10 @@ cvar_t *rs_mqttEnabled;
 cvar_t *rs_mqttClientId;
 cvar_t *rs_mqttHost;
 cvar_t *rs_mqttPort;
-char err[1024];
-char publish_message[1024];
-char publish_topic[32];
-#ifdef MOSQUITTO
-struct mosquitto *mosq = NULL;
-#endif
-int rc;
-int keepalive = 0;
-int retain = 0;
-static uint16_t mid_sent = 0;
-static int qos = 0;
-
-/**
- * Store the result of different requests from players.
- */
-char *players_query[MAX_CLIENTS]={0};
 
 /**
  * map-list related global variables
  */
-unsigned int mapcount = 0;
-char maplist[50000] = {0}; // around 5000 maps..
 char previousMapName[MAX_CONFIGSTRING_CHARS];
 
 /**
@@ -138,24 +126,182 @@ const unsigned int RACESOW_CALLBACK_RANKING = 10;
 static MYSQL mysql;
 
 /**
- * Attributes given to eachs thread
+ * handler for thread synchronization
  */
-pthread_attr_t threadAttr;
+pthread_mutex_t mutexsum;
 
 /**
- * handler for thread synchronization
+ * Prepared statements
+ *
+ * The rs_query* cvars are printf-style templates. A quoted '%s' and any
+ * %d/%u become bound parameters, a bare %s (column names, sort order, id
+ * lists) is pasted into the statement text. Each connection caches the
+ * statements it prepared, keyed on the resulting statement text.
  */
-pthread_mutex_t mutexsum;
-pthread_mutex_t mutex_callback;
+#define RS_MYSQL_STMT_CACHE_SIZE 64
+#define RS_MYSQL_MAX_PARAMS 16
+#define RS_MYSQL_MAX_COLUMNS 16
+#define RS_MYSQL_BATCH_LENGTH 1024	// max length of the row lists pasted into multi-row statements
+
+typedef struct
+{
+	qboolean isString;
+	qboolean isUnsigned;
+	int intValue;
+	const char *stringValue;
+	unsigned long length;
+} rs_mysqlparam_t;
+
+typedef struct
+{
+	enum enum_field_types type;	// what the column is fetched as: LONGLONG, DOUBLE or STRING
+	long long intValue;
+	double floatValue;
+	char *string;
+	unsigned long size;
+	unsigned long length;
+	my_bool isNull;
+	char number[32];			// string form of numeric columns
+} rs_mysqlcolumn_t;
+
+typedef struct
+{
+	cvar_t *query;
+	char *format;				// query->string the statement was built from
+	char *sql;
+	unsigned int hash;
+	unsigned int lastUsed;
+	MYSQL_STMT *stmt;
+	MYSQL_RES *metadata;
+	int numColumns;
+	MYSQL_BIND binds[RS_MYSQL_MAX_COLUMNS];
+	rs_mysqlcolumn_t columns[RS_MYSQL_MAX_COLUMNS];
+} rs_mysqlstmt_t;
+
+typedef struct
+{
+	rs_mysqlstmt_t stmts[RS_MYSQL_STMT_CACHE_SIZE];
+	int numStmts;
+	unsigned int useCount;
+	unsigned int hits, misses;
+} rs_mysqlstmtcache_t;
+
+static void RS_MysqlReconnect( void );
+static void RS_MysqlFlushStatements( rs_mysqlstmtcache_t *cache );
+static rs_mysqlstmt_t *RS_MysqlExecute( cvar_t *query, ... );
+static qboolean RS_MysqlFetch( rs_mysqlstmt_t *stmt );
+static qboolean RS_MysqlIsNull( rs_mysqlstmt_t *stmt, int column );
+static int RS_MysqlGetInt( rs_mysqlstmt_t *stmt, int column );
+static long long RS_MysqlGetInt64( rs_mysqlstmt_t *stmt, int column );
+static const char *RS_MysqlGetString( rs_mysqlstmt_t *stmt, int column );
+static unsigned int RS_MysqlNumRows( rs_mysqlstmt_t *stmt );
+static int RS_MysqlInsertId( rs_mysqlstmt_t *stmt );
+static void RS_MysqlFreeResult( rs_mysqlstmt_t *stmt );
+static void RS_LeaderboardFree( void );
+static void RS_FreeMaplist( void );
+static void RS_InitCallbackRing( void );
+static void RS_ShutdownCallbackRing( void );
+static void RS_PrintCallbackStats( void );
+static void RS_PushStringCallback( const char *string, int command, int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, int arg7 );
+
+/**
+ * MySQL worker pool
+ *
+ * A fixed number of long-lived workers, each owning its own connection,
+ * consume jobs from a bounded queue. Jobs flagged as exclusive (the ones
+ * rewriting shared ranking data) never run concurrently with each other.
+ */
+#define RS_MYSQL_MAX_WORKERS 16
+#define RS_MYSQL_JOB_QUEUE_SIZE 256
+
+// jobs release their data and return qfalse on errors, the worker rolls back what they left open
+typedef qboolean (*rs_mysqljobfunc_t)( void *in );
+
+typedef struct
+{
+	rs_mysqljobfunc_t func;
+	void *in;
+	qboolean exclusive;
+	unsigned int key;		// jobs with the same non-zero key never run concurrently
+	unsigned int queued;	// trap_Milliseconds() at push time
+} rs_mysqljob_t;
+
+typedef struct
+{
+	int num;
+	pthread_t thread;
+	MYSQL mysql;
+	qboolean connected;
+	unsigned int jobKey;	// key of the running job
+	qboolean inTransaction;	// rolled back if the job ends without committing
+	rs_mysqlstmtcache_t stmtCache;
+} rs_mysqlworker_t;
+
+typedef struct
+{
+	rs_mysqlworker_t workers[RS_MYSQL_MAX_WORKERS];
+	int numWorkers;
+	qboolean running;
+	qboolean shutdown;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_key_t workerKey;
+
+	rs_mysqljob_t queue[RS_MYSQL_JOB_QUEUE_SIZE];
+	int queueHead;
+	int queueSize;
+	int exclusiveRunning;
+	int busyWorkers;
+
+	// statistics
+	int queueHighWater;
+	unsigned int jobsDone;
+	unsigned int jobsFailed;
+	unsigned int jobsRejected;
+	unsigned int totalWait, maxWait;
+	unsigned int totalExec, maxExec;
+} rs_mysqlpool_t;
+
+static rs_mysqlpool_t rs_mysqlPool;
+
+/**
+ * The worker running on the calling thread, NULL on the game thread
+ */
+static rs_mysqlworker_t *RS_MysqlCurrentWorker( void )
+{
+	if( !rs_mysqlPool.running )
+		return NULL;
+	return (rs_mysqlworker_t *)pthread_getspecific( rs_mysqlPool.workerKey );
+}
+
+/**
+ * The connection to use from the calling thread
+ */
+static MYSQL *RS_MysqlHandle( void )
+{
+	rs_mysqlworker_t *worker = RS_MysqlCurrentWorker();
+	return worker ? &worker->mysql : &mysql;
+}
+
+/**
+ * Statements prepared on the main connection
+ */
+static rs_mysqlstmtcache_t rs_mysqlStmtCache;
+
+/**
+ * Id of this server in the gameserver table, looked up on connect
+ */
+static int rs_mysqlServerId;
 
 /**
- * callback queue variables used for de-threadization of mysql calls
+ * The statement cache of the connection used from the calling thread
  */
-#define MAX_SIZE_CALLBACK_QUEUE 100
-int callback_queue_size=0;
-int callback_queue_write_index=0;
-int callback_queue_read_index=0;
-int callback_queue[MAX_SIZE_CALLBACK_QUEUE][8];
+static rs_mysqlstmtcache_t *RS_MysqlStmtCache( void )
+{
+	rs_mysqlworker_t *worker = RS_MysqlCurrentWorker();
+	return worker ? &worker->stmtCache : &rs_mysqlStmtCache;
+}
 
 int MysqlConnected = 0;
 
@@ -165,21 +311,346 @@ int MysqlConnected = 0;
 
 
 /**
- * MySQL errorhandler for threads
+ * MySQL errorhandler for jobs, when a statement failed it jumps to the
+ * error label of the job, which releases what the job holds and returns qfalse
  *
  * not a function anymore
  */
-#define RS_CheckMysqlThreadError(query) { \
-    if (rs_mysqlDebug->integer){\
-        G_Printf("%s\n", query);\
-    }\
-    if (RS_MysqlError()){\
+#define RS_CheckMysqlThreadError(stmt) { \
+    if (!(stmt)){\
         G_Printf("file=%s line=%d MySQL Error!\n",__FILE__,__LINE__);\
-        RS_EndMysqlThread();\
+        goto error;\
     }\
 }
 
 
+#ifdef MOSQUITTO
+/**
+ * MQTT publisher
+ *
+ * One connection to the broker, owned by its own thread. The MySQL workers
+ * only queue messages, the thread sends them in batches, keeps the
+ * connection alive and reconnects with an increasing delay when it's lost.
+ */
+#define RS_MQTT_QUEUE_SIZE 512
+#define RS_MQTT_BATCH_SIZE 32
+#define RS_MQTT_KEEPALIVE 60
+#define RS_MQTT_MIN_BACKOFF 1000
+#define RS_MQTT_MAX_BACKOFF 60000
+#define RS_MQTT_DROP_WARNING_INTERVAL 10000
+
+typedef struct rs_mqttmessage_s
+{
+	char topic[32];
+	char *payload;
+	uint32_t length;
+	struct rs_mqttmessage_s *next;
+} rs_mqttmessage_t;
+
+typedef struct
+{
+	struct mosquitto *mosq;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	qboolean running;
+	qboolean shutdown;
+	volatile qboolean connected;	// the broker accepted the connection
+	volatile qboolean refused;		// the broker refused the connection
+
+	rs_mqttmessage_t *head;
+	rs_mqttmessage_t *tail;
+	int queueSize;
+
+	unsigned int backoff;
+	unsigned int nextConnect;
+
+	unsigned int droppedSinceWarning;
+	unsigned int lastDropWarning;
+
+	// statistics
+	unsigned int queued, sent, dropped, connects;
+} rs_mqttpublisher_t;
+
+static rs_mqttpublisher_t rs_mqtt;
+
+/**
+ * The broker answered the connect request
+ */
+void mqtt_connect_callback(void *obj, int result)
+{
+	if( result )
+	{
+		// the publisher thread drops the connection, not from inside the library
+		G_Printf( "MQTT Error: connection refused (%i)\n", result );
+		rs_mqtt.refused = qtrue;
+		return;
+	}
+
+	rs_mqtt.connected = qtrue;
+	rs_mqtt.backoff = 0;
+}
+
+/**
+ * The connection to the broker was closed
+ */
+void mqtt_disconnect_callback(void *obj)
+{
+	rs_mqtt.connected = qfalse;
+}
+
+/**
+ * A message was written to the broker
+ */
+void mqtt_publish_callback(void *obj, uint16_t mid)
+{
+	rs_mqtt.sent++;
+}
+
+/**
+ * Close the connection and schedule the next attempt, doubling the delay
+ * each time
+ *
+ * @return void
+ */
+static void RS_MqttBackoff( void )
+{
+	// the socket may still be open, the reconnect only happens without one
+	if( mosquitto_socket( rs_mqtt.mosq ) >= 0 )
+		_mosquitto_socket_close( rs_mqtt.mosq );
+
+	rs_mqtt.connected = qfalse;
+	rs_mqtt.refused = qfalse;
+	rs_mqtt.backoff = rs_mqtt.backoff ? min( rs_mqtt.backoff * 2, RS_MQTT_MAX_BACKOFF ) : RS_MQTT_MIN_BACKOFF;
+	rs_mqtt.nextConnect = trap_Milliseconds() + rs_mqtt.backoff;
+}
+
+/**
+ * Publisher main loop
+ *
+ * @return NULL
+ */
+static void *RS_MqttPublisher_Thread( void *in )
+{
+	rs_mqttmessage_t *batch, *message;
+	struct timespec wakeup;
+	int count;
+
+	while( qtrue )
+	{
+		// (re)connect when there's no socket, not more often than the backoff allows
+		if( mosquitto_socket( rs_mqtt.mosq ) < 0 )
+		{
+			int delay = (int)( rs_mqtt.nextConnect - trap_Milliseconds() );
+
+			rs_mqtt.connected = qfalse;
+
+			pthread_mutex_lock( &rs_mqtt.mutex );
+			if( rs_mqtt.shutdown )
+			{
+				pthread_mutex_unlock( &rs_mqtt.mutex );
+				break;
+			}
+			if( delay > 0 )
+			{
+				wakeup.tv_sec = time( NULL ) + ( delay + 999 ) / 1000;
+				wakeup.tv_nsec = 0;
+				pthread_cond_timedwait( &rs_mqtt.cond, &rs_mqtt.mutex, &wakeup );
+				pthread_mutex_unlock( &rs_mqtt.mutex );
+				continue;
+			}
+			pthread_mutex_unlock( &rs_mqtt.mutex );
+
+			rs_mqtt.connects++;
+			if( mosquitto_connect( rs_mqtt.mosq, rs_mqttHost->string, rs_mqttPort->integer, RS_MQTT_KEEPALIVE, true ) != MOSQ_ERR_SUCCESS )
+			{
+				RS_MqttBackoff();
+				G_Printf( "MQTT Error: could not connect to %s:%i, next try in %ums\n", rs_mqttHost->string, rs_mqttPort->integer, rs_mqtt.backoff );
+				continue;
+			}
+		}
+
+		// take a batch, once the broker accepted the connection
+		batch = NULL;
+		count = 0;
+		pthread_mutex_lock( &rs_mqtt.mutex );
+		if( rs_mqtt.shutdown && ( !rs_mqtt.connected || !rs_mqtt.head ) )
+		{
+			pthread_mutex_unlock( &rs_mqtt.mutex );
+			break;
+		}
+		if( rs_mqtt.connected && rs_mqtt.head )
+		{
+			batch = message = rs_mqtt.head;
+			while( ++count < RS_MQTT_BATCH_SIZE && message->next )
+				message = message->next;
+			rs_mqtt.head = message->next;
+			if( !rs_mqtt.head )
+				rs_mqtt.tail = NULL;
+			message->next = NULL;
+			rs_mqtt.queueSize -= count;
+		}
+		pthread_mutex_unlock( &rs_mqtt.mutex );
+
+		while( batch )
+		{
+			message = batch;
+			batch = batch->next;
+			mosquitto_publish( rs_mqtt.mosq, NULL, message->topic, message->length, (uint8_t *)message->payload, 0, false );
+			free( message->payload );
+			free( message );
+		}
+
+		// flush the writes, read the answers and keep the connection alive
+		if( mosquitto_loop( rs_mqtt.mosq, count ? 0 : 100 ) != MOSQ_ERR_SUCCESS )
+		{
+			RS_MqttBackoff();
+			G_Printf( "MQTT Error: lost the connection to %s:%i, next try in %ums\n", rs_mqttHost->string, rs_mqttPort->integer, rs_mqtt.backoff );
+		}
+		else if( rs_mqtt.refused )
+		{
+			RS_MqttBackoff();
+			G_Printf( "MQTT Error: %s:%i refused the connection, next try in %ums\n", rs_mqttHost->string, rs_mqttPort->integer, rs_mqtt.backoff );
+		}
+	}
+
+	if( mosquitto_socket( rs_mqtt.mosq ) >= 0 )
+	{
+		mosquitto_disconnect( rs_mqtt.mosq );
+		mosquitto_loop( rs_mqtt.mosq, 0 );
+	}
+
+	return NULL;
+}
+
+/**
+ * Queue a message for the broker, the oldest one is dropped when the
+ * queue is full
+ *
+ * @return void
+ */
+static void RS_MqttPublish( const char *topic, const char *payload )
+{
+	rs_mqttmessage_t *message, *dropped = NULL;
+	unsigned int now, droppedCount = 0;
+
+	if( !rs_mqtt.running )
+		return;
+
+	message = malloc( sizeof( *message ) );
+	Q_strncpyz( message->topic, topic, sizeof( message->topic ) );
+	message->length = strlen( payload );
+	message->payload = malloc( message->length + 1 );
+	memcpy( message->payload, payload, message->length + 1 );
+	message->next = NULL;
+
+	pthread_mutex_lock( &rs_mqtt.mutex );
+	if( rs_mqtt.queueSize >= RS_MQTT_QUEUE_SIZE )
+	{
+		dropped = rs_mqtt.head;
+		rs_mqtt.head = dropped->next;
+		rs_mqtt.queueSize--;
+		rs_mqtt.dropped++;
+
+		// warn about the drops once in a while, not for each of them
+		now = trap_Milliseconds();
+		rs_mqtt.droppedSinceWarning++;
+		if( !rs_mqtt.lastDropWarning || now - rs_mqtt.lastDropWarning >= RS_MQTT_DROP_WARNING_INTERVAL )
+		{
+			droppedCount = rs_mqtt.droppedSinceWarning;
+			rs_mqtt.droppedSinceWarning = 0;
+			rs_mqtt.lastDropWarning = now;
+		}
+	}
+	if( rs_mqtt.tail && rs_mqtt.head )
+		rs_mqtt.tail->next = message;
+	else
+		rs_mqtt.head = message;
+	rs_mqtt.tail = message;
+	rs_mqtt.queueSize++;
+	rs_mqtt.queued++;
+	pthread_cond_signal( &rs_mqtt.cond );
+	pthread_mutex_unlock( &rs_mqtt.mutex );
+
+	if( droppedCount )
+		G_Printf( "MQTT Error: queue full, dropped %u message%s\n", droppedCount, droppedCount == 1 ? "" : "s" );
+
+	if( dropped )
+	{
+		free( dropped->payload );
+		free( dropped );
+	}
+}
+
+/**
+ * Create the client and start the publisher thread
+ *
+ * @return void
+ */
+static void RS_MqttStart( void )
+{
+	memset( &rs_mqtt, 0, sizeof( rs_mqtt ) );
+
+	mosquitto_lib_init();
+	rs_mqtt.mosq = mosquitto_new( rs_mqttClientId->string, &rs_mqtt );
+	if( !rs_mqtt.mosq )
+	{
+		G_Printf( "QMTT Error: Out of memory.\n" );
+		mosquitto_lib_cleanup();
+		return;
+	}
+	mosquitto_connect_callback_set( rs_mqtt.mosq, mqtt_connect_callback );
+	mosquitto_disconnect_callback_set( rs_mqtt.mosq, mqtt_disconnect_callback );
+	mosquitto_publish_callback_set( rs_mqtt.mosq, mqtt_publish_callback );
+
+	pthread_mutex_init( &rs_mqtt.mutex, NULL );
+	pthread_cond_init( &rs_mqtt.cond, NULL );
+	rs_mqtt.running = qtrue;
+	if( pthread_create( &rs_mqtt.thread, NULL, RS_MqttPublisher_Thread, NULL ) )
+	{
+		G_Printf( "THREAD ERROR: could not start the MQTT publisher\n" );
+		rs_mqtt.running = qfalse;
+	}
+}
+
+/**
+ * Send what's still queued if the broker is there and stop the publisher
+ *
+ * @return void
+ */
+static void RS_MqttStop( void )
+{
+	rs_mqttmessage_t *message;
+
+	if( !rs_mqtt.mosq )
+		return;
+
+	if( rs_mqtt.running )
+	{
+		pthread_mutex_lock( &rs_mqtt.mutex );
+		rs_mqtt.shutdown = qtrue;
+		pthread_cond_signal( &rs_mqtt.cond );
+		pthread_mutex_unlock( &rs_mqtt.mutex );
+		pthread_join( rs_mqtt.thread, NULL );
+		rs_mqtt.running = qfalse;
+	}
+
+	while( rs_mqtt.head )
+	{
+		message = rs_mqtt.head;
+		rs_mqtt.head = message->next;
+		free( message->payload );
+		free( message );
+	}
+
+	pthread_cond_destroy( &rs_mqtt.cond );
+	pthread_mutex_destroy( &rs_mqtt.mutex );
+	mosquitto_destroy( rs_mqtt.mosq );
+	rs_mqtt.mosq = NULL;
+	mosquitto_lib_cleanup();
+}
+#endif
+
 /**
  * Initializes racesow specific stuff
  *
@@ -189,9 +660,7 @@ void RS_Init()
 {
 	// initialize threading
     pthread_mutex_init(&mutexsum, NULL);
-	pthread_mutex_init(&mutex_callback, NULL);
-	pthread_attr_init(&threadAttr);
-	pthread_attr_setdetachstate(&threadAttr, PTHREAD_CREATE_DETACHED);
+	RS_InitCallbackRing();
 
 	rs_mqttEnabled = trap_Cvar_Get( "rs_mqttEnabled", "0", CVAR_ARCHIVE );
 	rs_mqttClientId = trap_Cvar_Get( "rs_mqttClientId", "racesow", CVAR_ARCHIVE );
@@ -203,6 +672,7 @@ void RS_Init()
     rs_loadHighscores = trap_Cvar_Get( "rs_loadHighscores", "0", CVAR_ARCHIVE);
     rs_loadPlayerCheckpoints = trap_Cvar_Get( "rs_loadPlayerCheckpoints", "0", CVAR_ARCHIVE);
     rs_mysqlDebug = trap_Cvar_Get( "rs_mysqlDebug", "0", CVAR_ARCHIVE|CVAR_NOSET);
+    rs_mysqlWorkers = trap_Cvar_Get( "rs_mysqlWorkers", "4", CVAR_ARCHIVE|CVAR_LATCH);
 
 #if !defined(_WIN32) && !defined(_WIN64)
     if ( rs_mysqlEnabled->integer )
@@ -228,14 +698,14 @@ void RS_Init()
 
     if (MysqlConnected != 0 && rs_historyDays->integer != 0)
     {
-        char query[MYSQL_QUERY_LENGTH];
-        mysql_real_query(&mysql, rs_queryUpdatePlayerHistory->string, strlen(rs_queryUpdatePlayerHistory->string));
-        RS_MysqlError();
-
-        sprintf(query, rs_queryPurgePlayerHistory->string, rs_historyDays->integer);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_MysqlError();
+        RS_MysqlExecute(rs_queryUpdatePlayerHistory);
+        RS_MysqlExecute(rs_queryPurgePlayerHistory, rs_historyDays->integer);
     }
+
+    // the workers open their own connections, so start them once the main one is up
+    if ( rs_mysqlEnabled->integer && mysqlclient_present )
+        RS_StartMysqlWorkers();
+
     RS_AddServerCommands();
     if( rs_IRCstream->integer )
         trap_Cmd_ExecuteText( EXEC_APPEND, "irc_connect" );
@@ -244,11 +714,7 @@ void RS_Init()
 
 	#ifdef MOSQUITTO
 	if (rs_mqttEnabled->integer) {
-		mosquitto_lib_init();
-		mosq = mosquitto_new(rs_mqttClientId->string, NULL);
-		if(!mosq){
-			G_Printf("QMTT Error: Out of memory.\n");
-		}
+		RS_MqttStart();
 	}
 	#endif
 }
@@ -323,11 +789,13 @@ qboolean RS_LoadCvars( void )
     rs_queryGetPlayerMapHighscores	= trap_Cvar_Get( "rs_queryGetPlayerMapHighScores",	"SELECT `p`.`id`, `pm`.`time`, `p`.`name`, `pm`.`races`, `pm`.`playtime`, `pm`.`created`, `pm`.`prejumped`, `pm`.`points` FROM `player_map` `pm` INNER JOIN `player` `p` ON `p`.`id` = `pm`.`player_id` WHERE `pm`.`time` IS NOT NULL AND `pm`.`time` > 0 AND `pm`.`map_id` = %d AND `pm`.`prejumped` in (%s) ORDER BY `pm`.`time` ASC;", CVAR_ARCHIVE );
     rs_queryResetPlayerMapPoints	= trap_Cvar_Get( "rs_queryResetPlayerMapPoints",	"UPDATE `player_map` SET `points` = 0 WHERE `map_id` = %d;", CVAR_ARCHIVE );
     rs_queryUpdatePlayerMapPoints	= trap_Cvar_Get( "rs_queryUpdatePlayerMapPoints",	"UPDATE `player_map` SET `points` = %d WHERE `map_id` = %d AND `player_id` = %d;", CVAR_ARCHIVE );
+    rs_queryUpdateMapPoints			= trap_Cvar_Get( "rs_queryUpdateMapPoints",			"UPDATE `player_map` SET `points` = CASE `player_id`%s ELSE `points` END WHERE `map_id` = %d AND `player_id` IN(%s);", CVAR_ARCHIVE );
 	rs_querySetMapRating			= trap_Cvar_Get( "rs_querySetMapRating",			"INSERT INTO `map_rating` (`player_id`, `map_id`, `value`, `created`) VALUES(%d, %d, %d, NOW()) ON DUPLICATE KEY UPDATE `value` = VALUE(`value`), `changed` = NOW();", CVAR_ARCHIVE );
 	rs_queryLoadMapList				= trap_Cvar_Get( "rs_queryLoadMapList",				"SELECT name FROM map WHERE freestyle = '%d' AND status = 'enabled' ORDER BY %s;", CVAR_ARCHIVE);
 	rs_queryMapFilter               = trap_Cvar_Get( "rs_queryMapFilter",               "SELECT id, name FROM map WHERE name LIKE '%%%s%%' AND freestyle = '%s' LIMIT %u, %u;", CVAR_ARCHIVE );
 	rs_queryMapFilterCount          = trap_Cvar_Get( "rs_queryMapFilterCount",          "SELECT COUNT(id)FROM map WHERE name LIKE '%%%s%%' AND freestyle = '%s';", CVAR_ARCHIVE );
     rs_queryUpdateCheckpoint        = trap_Cvar_Get( "rs_queryUpdateCheckpoint",        "INSERT INTO `checkpoint` (`player_id`, `map_id`, `time`, `num`) VALUES(%d, %d, %d, %d) ON DUPLICATE KEY UPDATE `time` = VALUES(`time`);", CVAR_ARCHIVE );
+    rs_queryUpdateCheckpoints       = trap_Cvar_Get( "rs_queryUpdateCheckpoints",       "INSERT INTO `checkpoint` (`player_id`, `map_id`, `time`, `num`) VALUES %s ON DUPLICATE KEY UPDATE `time` = VALUES(`time`);", CVAR_ARCHIVE );
     rs_queryGetPlayerMapCheckpoints = trap_Cvar_Get( "rs_queryGetPlayerMapCheckpoints", "SELECT `time` FROM `checkpoint` WHERE `map_id` = %d AND `player_id` = %d ORDER BY `num` ASC;", CVAR_ARCHIVE );
 	rs_queryLoadMapHighscores		= trap_Cvar_Get( "rs_queryLoadMapHighscores",		"SELECT pm.time, p.name, pm.created, pm.prejumped FROM player_map AS pm LEFT JOIN player AS p ON p.id = pm.player_id LEFT JOIN map AS m ON m.id = pm.map_id WHERE pm.time IS NOT NULL AND pm.time > 0 AND m.id = %d AND pm.prejumped in (%s) ORDER BY time ASC LIMIT %d", CVAR_ARCHIVE );
 	rs_queryLoadMapOneliners		= trap_Cvar_Get( "rs_queryLoadMapOneliners",		"SELECT `oneliner`, `pj_oneliner` FROM `map` WHERE `id` = %d;", CVAR_ARCHIVE );
@@ -369,6 +837,27 @@ qboolean RS_LoadMySQL( void )
 }
 #endif
 
+/**
+ * Open a connection using the rs_mysql* cvars
+ *
+ * @param MYSQL *conn
+ * @return qboolean
+ */
+static qboolean RS_MysqlOpen( MYSQL *conn )
+{
+    my_bool reconnect = 1;
+
+    if( mysql_init( conn ) == NULL ) {
+        return qfalse;
+    }
+    mysql_options( conn, MYSQL_OPT_RECONNECT, &reconnect );
+    if( !mysql_real_connect ( conn, rs_mysqlHost->string, rs_mysqlUser->string, rs_mysqlPass->string, rs_mysqlDb->string, rs_mysqlPort->integer, NULL, 0 ) ) {
+        return qfalse;
+    }
+
+    return qtrue;
+}
+
 /**
  * RS_MysqlConnect
  *
@@ -376,80 +865,55 @@ qboolean RS_LoadMySQL( void )
  */
 qboolean RS_MysqlConnect( void )
 {
-    char query[MYSQL_QUERY_LENGTH];
     char user[255];
-    MYSQL_ROW  row;
-    MYSQL_RES  *mysql_res;
+    rs_mysqlstmt_t *stmt;
 	int server_id=0;
 
-    my_bool reconnect = 1;
-    mysql_options(&mysql, MYSQL_OPT_RECONNECT, &reconnect);
-
     G_Printf( va( "MySQL Connection String\nmysql://%s:*****@%s:%d/%s\n", rs_mysqlUser->string, rs_mysqlHost->string, rs_mysqlPort->integer, rs_mysqlDb->string ) );
     if( !Q_stricmp( rs_mysqlHost->string, "" ) || !Q_stricmp( rs_mysqlUser->string, "user" ) || !Q_stricmp( rs_mysqlDb->string, "" ) ) {
         G_Printf( "-------------------------------------\nMySQL ERROR1: Connection-data incomplete or not available\n" );
         return qfalse;
     }
-    mysql_init( &mysql );
-    if( &mysql == NULL ) {
-        RS_MysqlError();
-        return qfalse;
-    }
-    if( !mysql_real_connect ( &mysql, rs_mysqlHost->string, rs_mysqlUser->string, rs_mysqlPass->string, rs_mysqlDb->string, rs_mysqlPort->integer, NULL, 0 ) ) {
+    if( !RS_MysqlOpen( &mysql ) ) {
         RS_MysqlError();
         return qfalse;
     }
     G_Printf( "-------------------------------------\nConnected to MySQL Server\n-------------------------------------\n" );
 
 
-    //Q_strncpyz ( user, COM_RemoveColorTokens( level.mapname ), sizeof(user) );
-	//RS_EscapeString(user);
+    user[0] = '\0';
 
-	sprintf(query, rs_queryGetServer->string, sv_port->integer);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_MysqlError();
-    mysql_res = mysql_store_result(&mysql);
-    RS_MysqlError();
-
-	if ((row = mysql_fetch_row(mysql_res)) != NULL)
+	stmt = RS_MysqlExecute(rs_queryGetServer, sv_port->integer);
+	if (RS_MysqlFetch(stmt))
     {
-        if (row[0] !=NULL && row[1] != NULL)
+        if (!RS_MysqlIsNull(stmt, 0) && !RS_MysqlIsNull(stmt, 1))
         {
-            server_id = atoi(row[0]);
-            Q_strncpyz(user, row[1], sizeof(user));
+            server_id = RS_MysqlGetInt(stmt, 0);
+            Q_strncpyz(user, RS_MysqlGetString(stmt, 1), sizeof(user));
         }
     }
 
-	mysql_free_result(mysql_res);
+	RS_MysqlFreeResult(stmt);
 
     if (server_id == 0)
     {
-        char servername[255];
-        Q_strncpyz ( servername, sv_hostname->string, sizeof(servername) );
-		RS_EscapeString(servername);
-        sprintf(query, rs_queryAddServer->string, sv_port->integer, servername);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_MysqlError();
-
-		server_id=(int)mysql_insert_id(&mysql);
-
-        sprintf(query, rs_queryGetServerById->string, server_id);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_MysqlError();
-        mysql_res = mysql_store_result(&mysql);
-        RS_MysqlError();
+        stmt = RS_MysqlExecute(rs_queryAddServer, sv_port->integer, sv_hostname->string);
+		server_id = RS_MysqlInsertId(stmt);
 
-        if ((row = mysql_fetch_row(mysql_res)) != NULL)
+        stmt = RS_MysqlExecute(rs_queryGetServerById, server_id);
+        if (RS_MysqlFetch(stmt))
         {
-            if (row[0] !=NULL && row[1] != NULL)
+            if (!RS_MysqlIsNull(stmt, 0) && !RS_MysqlIsNull(stmt, 1))
             {
-                Q_strncpyz(user, row[1], sizeof(user));
+                Q_strncpyz(user, RS_MysqlGetString(stmt, 1), sizeof(user));
             }
         }
 
-		mysql_free_result(mysql_res);
+		RS_MysqlFreeResult(stmt);
     }
 
+    rs_mysqlServerId = server_id;
+
     G_Printf( va("authenticated as %s/%d\n-------------------------------------\n", user, server_id ) );
 
     return qtrue;
@@ -462,6 +926,7 @@ qboolean RS_MysqlConnect( void )
  */
 qboolean RS_MysqlDisconnect( void )
 {
+    RS_MysqlFlushStatements( &rs_mysqlStmtCache );
     mysql_close( &mysql );
     return qtrue;
 }
@@ -473,21 +938,15 @@ qboolean RS_MysqlDisconnect( void )
  */
 qboolean RS_MysqlError( void )
 {
-    int errNo = mysql_errno(&mysql);
+    MYSQL *conn = RS_MysqlHandle();
+    int errNo = mysql_errno(conn);
     if (errNo != 0) {
 
-        G_Printf("%sMySQL ERROR: %s (%d)\n", S_COLOR_RED, mysql_error(&mysql), errNo);
+        G_Printf("%sMySQL ERROR: %s (%d)\n", S_COLOR_RED, mysql_error(conn), errNo);
 
         if (errNo == CR_SERVER_GONE_ERROR || errNo == CR_SERVER_LOST)
         {
-            if( RS_LoadCvars() )
-            {
-                MysqlConnected = RS_MysqlConnect();
-            }
-            else
-            {
-                MysqlConnected = qfalse;
-            }
+            RS_MysqlReconnect();
         }
 
         return qtrue;
@@ -496,6 +955,34 @@ qboolean RS_MysqlError( void )
     return qfalse;
 }
 
+/**
+ * Re-open the connection used from the calling thread after it was lost.
+ * The statements prepared on it are gone along with it.
+ *
+ * @return void
+ */
+static void RS_MysqlReconnect( void )
+{
+    rs_mysqlworker_t *worker = RS_MysqlCurrentWorker();
+
+    RS_MysqlFlushStatements( RS_MysqlStmtCache() );
+
+    if( worker )
+    {
+        // a worker only re-opens its own connection
+        mysql_close( &worker->mysql );
+        worker->connected = RS_MysqlOpen( &worker->mysql );
+    }
+    else if( RS_LoadCvars() )
+    {
+        MysqlConnected = RS_MysqlConnect();
+    }
+    else
+    {
+        MysqlConnected = qfalse;
+    }
+}
+
 /**
  * Shutdown racesow specific stuff
  *
@@ -503,6 +990,12 @@ qboolean RS_MysqlError( void )
  */
 void RS_Shutdown()
 {
+    // let the workers flush pending jobs before the library goes away
+    RS_StopMysqlWorkers();
+    RS_ShutdownCallbackRing();
+    RS_LeaderboardFree();
+
+    RS_FreeMaplist();
 
     if ( rs_mysqlEnabled->integer && mysqlclient_present )
     {
@@ -523,8 +1016,6 @@ void RS_Shutdown()
     // shutdown threading
     if( &mutexsum != NULL )
 	    pthread_mutex_destroy(&mutexsum);
-    if( &mutex_callback != NULL )
-	    pthread_mutex_destroy(&mutex_callback);
 	// removed it because of crash in win32 implementation, also this may be not necessary at all because this isnt in a thread
 	//pthread_exit(NULL);
 	RS_RemoveServerCommands();
@@ -532,91 +1023,1783 @@ void RS_Shutdown()
 	    trap_Dynvar_RemoveListener( irc_connected, RS_Irc_ConnectedListener_f );
 	
 	#ifdef MOSQUITTO
-	if (rs_mqttEnabled->integer) {
-	
-		mosquitto_destroy(mosq);
-		mosquitto_lib_cleanup();
-	}
+	RS_MqttStop();
 	#endif
 }
 
 
 /**
- * Escapes the string, in-place
+ * Append to the statement text
  *
- * @param char* string
- * @return void
+ * @return qboolean qfalse if it doesn't fit
  */
-void RS_EscapeString( char* string )
+static qboolean RS_MysqlAppend( char *sql, size_t size, size_t *len, const char *text, size_t count )
 {
-	char escaped_buffer[MAX_STRING_CHARS];
+	if( *len + count >= size )
+		return qfalse;
 
-	// one cannot call mysql_real_escape_string with dest string == source string
-	mysql_real_escape_string(&mysql, escaped_buffer, string, strlen(string));
-	Q_strncpyz ( string, escaped_buffer, sizeof(escaped_buffer) );
+	memcpy( sql + *len, text, count );
+	*len += count;
+	sql[*len] = '\0';
+	return qtrue;
 }
 
 /**
+ * Read a bound parameter off the argument list
  *
- * Add a command to the callback queue
- *
- * @return void
+ * @param char conversion the printf conversion character
+ * @return qboolean qfalse for unsupported conversions
  */
-void RS_PushCallbackQueue(int command, int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, int arg7)
+static qboolean RS_MysqlReadParam( char conversion, va_list *argptr, rs_mysqlparam_t *param )
 {
-	pthread_mutex_lock(&mutex_callback);
-	if (callback_queue_size<MAX_SIZE_CALLBACK_QUEUE)
-	{
-		// push!
-		callback_queue[callback_queue_write_index][0]=command;
-		callback_queue[callback_queue_write_index][1]=arg1;
-		callback_queue[callback_queue_write_index][2]=arg2;
-		callback_queue[callback_queue_write_index][3]=arg3;
-		callback_queue[callback_queue_write_index][4]=arg4;
-		callback_queue[callback_queue_write_index][5]=arg5;
-		callback_queue[callback_queue_write_index][6]=arg6;
-		callback_queue[callback_queue_write_index][7]=arg7;
+	memset( param, 0, sizeof( *param ) );
 
-		callback_queue_write_index=(callback_queue_write_index+1)%MAX_SIZE_CALLBACK_QUEUE;
-		callback_queue_size++;
+	switch( conversion )
+	{
+		case 'd':
+		case 'i':
+			param->intValue = va_arg( *argptr, int );
+			return qtrue;
+		case 'u':
+			param->intValue = (int)va_arg( *argptr, unsigned int );
+			param->isUnsigned = qtrue;
+			return qtrue;
+		case 's':
+			param->isString = qtrue;
+			param->stringValue = va_arg( *argptr, const char * );
+			if( !param->stringValue )
+				param->stringValue = "";
+			param->length = strlen( param->stringValue );
+			return qtrue;
 	}
-	else
-		G_Printf("Error: callback queue overflow\n");
-	pthread_mutex_unlock(&mutex_callback);
+
+	return qfalse;
 }
 
 /**
+ * Turn a query template into statement text and parameters
  *
- * "Is there a callback result to execute?"
- * queried at each game frame
+ * '%s' and %d/%u are replaced by placeholders, a quoted literal mixing
+ * text and conversions becomes a CONCAT(), a bare %s is pasted as-is.
  *
- * @return qboolean
+ * @param const char *format the rs_query* template
+ * @param va_list *argptr the arguments, as they would be given to sprintf
+ * @param char *sql statement text
+ * @param size_t size
+ * @param rs_mysqlparam_t *params bound parameters
+ * @return int number of parameters, -1 if the template can't be used
  */
-qboolean RS_PopCallbackQueue(int *command, int *arg1, int *arg2, int *arg3, int *arg4, int *arg5, int *arg6, int *arg7)
+static int RS_MysqlBuildStatement( const char *format, va_list *argptr, char *sql, size_t size, rs_mysqlparam_t *params )
 {
+	const char *s = format, *end, *p;
+	size_t len = 0;
+	int numParams = 0, conversions;
 
-	// if the queue is empty, do nothing this time
-	// (a push might have happened, but it doesn't matter, we'll catch it next time!)
-	if (callback_queue_size==0)
-		return qfalse;
+	sql[0] = '\0';
 
-	// retrieving a callback result
-	pthread_mutex_lock(&mutex_callback);
-	// pop!
-	*command=callback_queue[callback_queue_read_index][0];
-	*arg1=callback_queue[callback_queue_read_index][1];
-	*arg2=callback_queue[callback_queue_read_index][2];
-	*arg3=callback_queue[callback_queue_read_index][3];
-	*arg4=callback_queue[callback_queue_read_index][4];
-	*arg5=callback_queue[callback_queue_read_index][5];
-	*arg6=callback_queue[callback_queue_read_index][6];
-	*arg7=callback_queue[callback_queue_read_index][7];
-
-	callback_queue_read_index=(callback_queue_read_index+1)%MAX_SIZE_CALLBACK_QUEUE;
-	callback_queue_size--;
-	pthread_mutex_unlock(&mutex_callback);
-	return qtrue;
-}
+	while( *s )
+	{
+		if( *s == '\'' )
+		{
+			// find the end of the literal and count the conversions in it
+			conversions = 0;
+			for( end = s + 1; *end && *end != '\''; end++ )
+			{
+				if( *end == '\\' && end[1] )
+					end++;
+				else if( *end == '%' && end[1] == '%' )
+					end++;
+				else if( *end == '%' )
+					conversions++;
+			}
+			if( !*end )
+				return -1;
+
+			if( !conversions )
+			{
+				if( !RS_MysqlAppend( sql, size, &len, "'", 1 ) )
+					return -1;
+				for( p = s + 1; p < end; p++ )
+				{
+					if( *p == '%' )
+						p++;
+					if( !RS_MysqlAppend( sql, size, &len, p, 1 ) )
+						return -1;
+				}
+				if( !RS_MysqlAppend( sql, size, &len, "'", 1 ) )
+					return -1;
+			}
+			else if( end - s == 3 && s[1] == '%' )
+			{
+				if( numParams == RS_MYSQL_MAX_PARAMS || !RS_MysqlReadParam( s[2], argptr, &params[numParams++] ) )
+					return -1;
+				if( !RS_MysqlAppend( sql, size, &len, "?", 1 ) )
+					return -1;
+			}
+			else
+			{
+				qboolean inText = qfalse, first = qtrue;
+
+				if( !RS_MysqlAppend( sql, size, &len, "CONCAT(", 7 ) )
+					return -1;
+				for( p = s + 1; p < end; p++ )
+				{
+					if( *p == '%' && p[1] != '%' )
+					{
+						if( numParams == RS_MYSQL_MAX_PARAMS || !RS_MysqlReadParam( p[1], argptr, &params[numParams++] ) )
+							return -1;
+						if( ( inText && !RS_MysqlAppend( sql, size, &len, "'", 1 ) )
+							|| ( !first && !RS_MysqlAppend( sql, size, &len, ", ", 2 ) )
+							|| !RS_MysqlAppend( sql, size, &len, "?", 1 ) )
+							return -1;
+						inText = qfalse;
+						first = qfalse;
+						p++;
+						continue;
+					}
+
+					if( !inText )
+					{
+						if( ( !first && !RS_MysqlAppend( sql, size, &len, ", ", 2 ) )
+							|| !RS_MysqlAppend( sql, size, &len, "'", 1 ) )
+							return -1;
+						inText = qtrue;
+						first = qfalse;
+					}
+					if( *p == '%' || ( *p == '\\' && p + 1 < end ) )
+					{
+						if( *p == '\\' && !RS_MysqlAppend( sql, size, &len, p, 1 ) )
+							return -1;
+						p++;
+					}
+					if( !RS_MysqlAppend( sql, size, &len, p, 1 ) )
+						return -1;
+				}
+				if( ( inText && !RS_MysqlAppend( sql, size, &len, "'", 1 ) )
+					|| !RS_MysqlAppend( sql, size, &len, ")", 1 ) )
+					return -1;
+			}
+
+			s = end + 1;
+			continue;
+		}
+
+		if( *s == '%' )
+		{
+			if( s[1] == '%' )
+			{
+				if( !RS_MysqlAppend( sql, size, &len, "%", 1 ) )
+					return -1;
+			}
+			else if( s[1] == 's' )
+			{
+				const char *text = va_arg( *argptr, const char * );
+				if( text && !RS_MysqlAppend( sql, size, &len, text, strlen( text ) ) )
+					return -1;
+			}
+			else
+			{
+				if( numParams == RS_MYSQL_MAX_PARAMS || !RS_MysqlReadParam( s[1], argptr, &params[numParams++] ) )
+					return -1;
+				if( !RS_MysqlAppend( sql, size, &len, "?", 1 ) )
+					return -1;
+			}
+
+			s += 2;
+			continue;
+		}
+
+		if( !RS_MysqlAppend( sql, size, &len, s, 1 ) )
+			return -1;
+		s++;
+	}
+
+	// prepared statements don't take the terminating semicolon
+	while( len && ( sql[len-1] == ';' || sql[len-1] == ' ' || sql[len-1] == '\t' || sql[len-1] == '\n' ) )
+		sql[--len] = '\0';
+
+	return numParams;
+}
+
+/**
+ * Close a cached statement and remove it from the cache
+ *
+ * @return void
+ */
+static void RS_MysqlDropStatement( rs_mysqlstmtcache_t *cache, int index )
+{
+	rs_mysqlstmt_t *stmt = &cache->stmts[index];
+	int i;
+
+	if( stmt->metadata )
+		mysql_free_result( stmt->metadata );
+	if( stmt->stmt )
+		mysql_stmt_close( stmt->stmt );
+	for( i = 0; i < RS_MYSQL_MAX_COLUMNS; i++ )
+		free( stmt->columns[i].string );
+	free( stmt->format );
+	free( stmt->sql );
+
+	cache->numStmts--;
+	if( index != cache->numStmts )
+		*stmt = cache->stmts[cache->numStmts];
+	memset( &cache->stmts[cache->numStmts], 0, sizeof( rs_mysqlstmt_t ) );
+}
+
+/**
+ * Close all statements of a connection
+ *
+ * @return void
+ */
+static void RS_MysqlFlushStatements( rs_mysqlstmtcache_t *cache )
+{
+	while( cache->numStmts )
+		RS_MysqlDropStatement( cache, cache->numStmts - 1 );
+}
+
+/**
+ * Handle an error on a statement
+ *
+ * The statement is dropped so that the next use prepares it again,
+ * a lost connection is re-opened.
+ *
+ * @return void
+ */
+static void RS_MysqlStmtError( rs_mysqlstmtcache_t *cache, rs_mysqlstmt_t *stmt )
+{
+	unsigned int errNo = mysql_stmt_errno( stmt->stmt );
+
+	G_Printf( "%sMySQL ERROR: %s (%d)\n", S_COLOR_RED, mysql_stmt_error( stmt->stmt ), errNo );
+
+	if( errNo == CR_SERVER_GONE_ERROR || errNo == CR_SERVER_LOST )
+		RS_MysqlReconnect();
+	else
+		RS_MysqlDropStatement( cache, stmt - cache->stmts );
+}
+
+/**
+ * Find the statement for a query in the cache of the calling thread's
+ * connection, preparing it if needed.
+ *
+ * Statements built from an older value of the query cvar are dropped.
+ *
+ * @param cvar_t *query
+ * @param const char *sql the statement text
+ * @return rs_mysqlstmt_t * NULL on errors
+ */
+static rs_mysqlstmt_t *RS_MysqlGetStatement( cvar_t *query, const char *sql )
+{
+	rs_mysqlstmtcache_t *cache = RS_MysqlStmtCache();
+	rs_mysqlstmt_t *stmt;
+	MYSQL_FIELD *fields;
+	unsigned int hash = 0;
+	my_bool updateMaxLength = 1;
+	const char *p;
+	int i;
+
+	for( p = sql; *p; p++ )
+		hash = hash * 31 + (unsigned char)*p;
+
+	cache->useCount++;
+
+	for( i = 0; i < cache->numStmts; i++ )
+	{
+		stmt = &cache->stmts[i];
+		if( stmt->query == query && strcmp( stmt->format, query->string ) )
+		{
+			// the cvar was changed since the statement was prepared
+			RS_MysqlDropStatement( cache, i-- );
+			continue;
+		}
+
+		if( stmt->hash == hash && !strcmp( stmt->sql, sql ) )
+		{
+			stmt->lastUsed = cache->useCount;
+			cache->hits++;
+			return stmt;
+		}
+	}
+
+	cache->misses++;
+
+	if( cache->numStmts == RS_MYSQL_STMT_CACHE_SIZE )
+	{
+		int oldest = 0;
+		for( i = 1; i < cache->numStmts; i++ )
+		{
+			if( cache->stmts[i].lastUsed < cache->stmts[oldest].lastUsed )
+				oldest = i;
+		}
+		RS_MysqlDropStatement( cache, oldest );
+	}
+
+	stmt = &cache->stmts[cache->numStmts++];
+	stmt->query = query;
+	stmt->format = strdup( query->string );
+	stmt->sql = strdup( sql );
+	stmt->hash = hash;
+	stmt->lastUsed = cache->useCount;
+
+	stmt->stmt = mysql_stmt_init( RS_MysqlHandle() );
+	if( !stmt->stmt )
+	{
+		RS_MysqlDropStatement( cache, cache->numStmts - 1 );
+		RS_MysqlError();
+		return NULL;
+	}
+
+	if( mysql_stmt_prepare( stmt->stmt, sql, strlen( sql ) ) )
+	{
+		RS_MysqlStmtError( cache, stmt );
+		return NULL;
+	}
+
+	// so that string buffers can be sized to the stored result
+	mysql_stmt_attr_set( stmt->stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &updateMaxLength );
+
+	stmt->metadata = mysql_stmt_result_metadata( stmt->stmt );
+	if( !stmt->metadata )
+		return stmt;
+
+	stmt->numColumns = mysql_num_fields( stmt->metadata );
+	if( stmt->numColumns > RS_MYSQL_MAX_COLUMNS )
+	{
+		G_Printf( "%sMySQL ERROR: %s returns more than %i columns\n", S_COLOR_RED, query->name, RS_MYSQL_MAX_COLUMNS );
+		RS_MysqlDropStatement( cache, stmt - cache->stmts );
+		return NULL;
+	}
+
+	fields = mysql_fetch_fields( stmt->metadata );
+	for( i = 0; i < stmt->numColumns; i++ )
+	{
+		switch( fields[i].type )
+		{
+			case MYSQL_TYPE_TINY:
+			case MYSQL_TYPE_SHORT:
+			case MYSQL_TYPE_LONG:
+			case MYSQL_TYPE_INT24:
+			case MYSQL_TYPE_LONGLONG:
+			case MYSQL_TYPE_YEAR:
+				stmt->columns[i].type = MYSQL_TYPE_LONGLONG;
+				break;
+			case MYSQL_TYPE_DECIMAL:
+			case MYSQL_TYPE_NEWDECIMAL:
+			case MYSQL_TYPE_FLOAT:
+			case MYSQL_TYPE_DOUBLE:
+				stmt->columns[i].type = MYSQL_TYPE_DOUBLE;
+				break;
+			default:
+				stmt->columns[i].type = MYSQL_TYPE_STRING;
+				break;
+		}
+	}
+
+	return stmt;
+}
+
+/**
+ * Run a query on the connection of the calling thread
+ *
+ * The arguments are given the same way as to sprintf with the query
+ * template. The result, if any, is read with RS_MysqlFetch and the
+ * RS_MysqlGet* functions and must be released with RS_MysqlFreeResult.
+ *
+ * @param cvar_t *query one of the rs_query* cvars
+ * @return rs_mysqlstmt_t * NULL on errors
+ */
+static rs_mysqlstmt_t *RS_MysqlExecute( cvar_t *query, ... )
+{
+	char sql[MYSQL_QUERY_LENGTH];
+	rs_mysqlparam_t params[RS_MYSQL_MAX_PARAMS];
+	MYSQL_BIND binds[RS_MYSQL_MAX_PARAMS];
+	rs_mysqlstmtcache_t *cache = RS_MysqlStmtCache();
+	rs_mysqlstmt_t *stmt;
+	MYSQL_FIELD *fields;
+	va_list argptr;
+	int i, numParams;
+
+	va_start( argptr, query );
+	numParams = RS_MysqlBuildStatement( query->string, &argptr, sql, sizeof( sql ), params );
+	va_end( argptr );
+
+	if( rs_mysqlDebug->integer )
+		G_Printf( "%s\n", sql );
+
+	if( numParams < 0 )
+	{
+		G_Printf( "%sMySQL ERROR: %s can't be used as a prepared statement\n", S_COLOR_RED, query->name );
+		return NULL;
+	}
+
+	stmt = RS_MysqlGetStatement( query, sql );
+	if( !stmt )
+		return NULL;
+
+	memset( binds, 0, sizeof( binds ) );
+	for( i = 0; i < numParams; i++ )
+	{
+		if( params[i].isString )
+		{
+			binds[i].buffer_type = MYSQL_TYPE_STRING;
+			binds[i].buffer = (void *)params[i].stringValue;
+			binds[i].buffer_length = params[i].length;
+			binds[i].length = &params[i].length;
+		}
+		else
+		{
+			binds[i].buffer_type = MYSQL_TYPE_LONG;
+			binds[i].buffer = &params[i].intValue;
+			binds[i].is_unsigned = params[i].isUnsigned;
+		}
+	}
+
+	if( ( numParams && mysql_stmt_bind_param( stmt->stmt, binds ) ) || mysql_stmt_execute( stmt->stmt ) )
+	{
+		RS_MysqlStmtError( cache, stmt );
+		return NULL;
+	}
+
+	if( !stmt->numColumns )
+		return stmt;
+
+	if( mysql_stmt_store_result( stmt->stmt ) )
+	{
+		RS_MysqlStmtError( cache, stmt );
+		return NULL;
+	}
+
+	// bind the result, growing the string buffers to the longest value
+	fields = mysql_fetch_fields( stmt->metadata );
+	memset( stmt->binds, 0, sizeof( stmt->binds ) );
+	for( i = 0; i < stmt->numColumns; i++ )
+	{
+		rs_mysqlcolumn_t *column = &stmt->columns[i];
+		MYSQL_BIND *bind = &stmt->binds[i];
+
+		bind->buffer_type = column->type;
+		bind->is_null = &column->isNull;
+		bind->length = &column->length;
+
+		if( column->type == MYSQL_TYPE_LONGLONG )
+		{
+			bind->buffer = &column->intValue;
+			bind->is_unsigned = ( fields[i].flags & UNSIGNED_FLAG ) ? 1 : 0;
+		}
+		else if( column->type == MYSQL_TYPE_DOUBLE )
+		{
+			bind->buffer = &column->floatValue;
+		}
+		else
+		{
+			// max_length is not maintained for dates, hence the minimum
+			if( !column->string || column->size < fields[i].max_length + 1 )
+			{
+				free( column->string );
+				column->size = max( fields[i].max_length, 64 ) + 1;
+				column->string = malloc( column->size );
+			}
+			bind->buffer = column->string;
+			bind->buffer_length = column->size;
+		}
+	}
+
+	if( mysql_stmt_bind_result( stmt->stmt, stmt->binds ) )
+	{
+		RS_MysqlStmtError( cache, stmt );
+		return NULL;
+	}
+
+	return stmt;
+}
+
+/**
+ * Run a write whose text is different every time, like the multi-row
+ * statements, as a plain query. Preparing those would only push the
+ * reused statements out of the cache.
+ *
+ * @param cvar_t *query one of the rs_query* cvars, filled in like sprintf
+ * @return qboolean qfalse on errors
+ */
+static qboolean RS_MysqlRun( cvar_t *query, ... )
+{
+	char sql[MYSQL_QUERY_LENGTH];
+	va_list argptr;
+
+	va_start( argptr, query );
+	Q_vsnprintfz( sql, sizeof( sql ), query->string, argptr );
+	va_end( argptr );
+
+	if( rs_mysqlDebug->integer )
+		G_Printf( "%s\n", sql );
+
+	if( mysql_real_query( RS_MysqlHandle(), sql, strlen( sql ) ) )
+	{
+		RS_MysqlError();
+		return qfalse;
+	}
+
+	return qtrue;
+}
+
+/**
+ * Whether a query cvar was changed from its default
+ *
+ * @return qboolean
+ */
+static qboolean RS_MysqlQueryChanged( cvar_t *query )
+{
+	return ( query->dvalue && strcmp( query->string, query->dvalue ) ) ? qtrue : qfalse;
+}
+
+/**
+ * Fetch the next row of a result
+ *
+ * @return qboolean qfalse when there are no more rows
+ */
+static qboolean RS_MysqlFetch( rs_mysqlstmt_t *stmt )
+{
+	int ret, i;
+
+	if( !stmt || !stmt->numColumns )
+		return qfalse;
+
+	ret = mysql_stmt_fetch( stmt->stmt );
+	if( ret != 0 && ret != MYSQL_DATA_TRUNCATED )
+		return qfalse;
+
+	for( i = 0; i < stmt->numColumns; i++ )
+	{
+		rs_mysqlcolumn_t *column = &stmt->columns[i];
+
+		if( column->type == MYSQL_TYPE_STRING && !column->isNull )
+			column->string[min( column->length, column->size - 1 )] = '\0';
+	}
+
+	return qtrue;
+}
+
+/**
+ * @return qboolean qtrue if the column of the current row is NULL
+ */
+static qboolean RS_MysqlIsNull( rs_mysqlstmt_t *stmt, int column )
+{
+	if( !stmt || column < 0 || column >= stmt->numColumns )
+		return qtrue;
+
+	return stmt->columns[column].isNull ? qtrue : qfalse;
+}
+
+/**
+ * @return int the column of the current row as a number, 0 for NULL
+ */
+static int RS_MysqlGetInt( rs_mysqlstmt_t *stmt, int column )
+{
+	rs_mysqlcolumn_t *col;
+
+	if( RS_MysqlIsNull( stmt, column ) )
+		return 0;
+
+	col = &stmt->columns[column];
+	if( col->type == MYSQL_TYPE_LONGLONG )
+		return (int)col->intValue;
+	if( col->type == MYSQL_TYPE_DOUBLE )
+		return (int)col->floatValue;
+
+	return atoi( col->string );
+}
+
+/**
+ * @return long long the column of the current row as a 64 bit number, 0 for NULL
+ */
+static long long RS_MysqlGetInt64( rs_mysqlstmt_t *stmt, int column )
+{
+	rs_mysqlcolumn_t *col;
+
+	if( RS_MysqlIsNull( stmt, column ) )
+		return 0;
+
+	col = &stmt->columns[column];
+	if( col->type == MYSQL_TYPE_LONGLONG )
+		return col->intValue;
+	if( col->type == MYSQL_TYPE_DOUBLE )
+		return (long long)col->floatValue;
+
+	return strtoll( col->string, NULL, 10 );
+}
+
+/**
+ * @return const char * the column of the current row as a string, "" for
+ * NULL. Only valid until the next fetch.
+ */
+static const char *RS_MysqlGetString( rs_mysqlstmt_t *stmt, int column )
+{
+	rs_mysqlcolumn_t *col;
+
+	if( RS_MysqlIsNull( stmt, column ) )
+		return "";
+
+	col = &stmt->columns[column];
+	if( col->type == MYSQL_TYPE_LONGLONG )
+	{
+		Q_snprintfz( col->number, sizeof( col->number ), "%lld", col->intValue );
+		return col->number;
+	}
+	if( col->type == MYSQL_TYPE_DOUBLE )
+	{
+		Q_snprintfz( col->number, sizeof( col->number ), "%g", col->floatValue );
+		return col->number;
+	}
+
+	return col->string;
+}
+
+/**
+ * @return unsigned int number of rows in the result
+ */
+static unsigned int RS_MysqlNumRows( rs_mysqlstmt_t *stmt )
+{
+	if( !stmt || !stmt->numColumns )
+		return 0;
+
+	return (unsigned int)mysql_stmt_num_rows( stmt->stmt );
+}
+
+/**
+ * @return int the id generated by an INSERT
+ */
+static int RS_MysqlInsertId( rs_mysqlstmt_t *stmt )
+{
+	if( !stmt )
+		return 0;
+
+	return (int)mysql_stmt_insert_id( stmt->stmt );
+}
+
+/**
+ * Release the result of a statement, the statement stays prepared
+ *
+ * @return void
+ */
+static void RS_MysqlFreeResult( rs_mysqlstmt_t *stmt )
+{
+	if( stmt && stmt->numColumns )
+		mysql_stmt_free_result( stmt->stmt );
+}
+
+/**
+ * Start a transaction on the connection of the calling worker
+ *
+ * @return qboolean
+ */
+static qboolean RS_MysqlBeginTransaction( void )
+{
+	rs_mysqlworker_t *worker = RS_MysqlCurrentWorker();
+
+	if( mysql_autocommit( RS_MysqlHandle(), 0 ) )
+	{
+		G_Printf( "MySQL ERROR: could not start transaction: %s\n", mysql_error( RS_MysqlHandle() ) );
+		return qfalse;
+	}
+
+	if( worker )
+		worker->inTransaction = qtrue;
+
+	return qtrue;
+}
+
+/**
+ * Commit the transaction of the calling worker and go back to autocommit
+ *
+ * @return qboolean
+ */
+static qboolean RS_MysqlCommit( void )
+{
+	rs_mysqlworker_t *worker = RS_MysqlCurrentWorker();
+	qboolean committed;
+
+	committed = mysql_commit( RS_MysqlHandle() ) ? qfalse : qtrue;
+	if( !committed )
+	{
+		G_Printf( "MySQL ERROR: could not commit transaction: %s\n", mysql_error( RS_MysqlHandle() ) );
+		mysql_rollback( RS_MysqlHandle() );
+	}
+
+	mysql_autocommit( RS_MysqlHandle(), 1 );
+	if( worker )
+		worker->inTransaction = qfalse;
+
+	return committed;
+}
+
+/**
+ * Throw away the transaction of a worker whose job failed
+ *
+ * @return void
+ */
+static void RS_MysqlRollback( rs_mysqlworker_t *worker )
+{
+	if( !worker->inTransaction )
+		return;
+
+	G_Printf( "MySQL worker %i: rolling back unfinished transaction\n", worker->num );
+	if( worker->connected )
+	{
+		mysql_rollback( &worker->mysql );
+		mysql_autocommit( &worker->mysql, 1 );
+	}
+	worker->inTransaction = qfalse;
+}
+
+/**
+ * Whether a job with the given key is running on one of the workers
+ *
+ * @return qboolean
+ */
+static qboolean RS_MysqlKeyRunning( unsigned int key )
+{
+	int i;
+
+	if( !key )
+		return qfalse;
+
+	for( i = 0; i < rs_mysqlPool.numWorkers; i++ )
+	{
+		if( rs_mysqlPool.workers[i].jobKey == key )
+			return qtrue;
+	}
+
+	return qfalse;
+}
+
+/**
+ * Take the next runnable job off the queue, waiting for one if needed.
+ * Exclusive jobs are skipped while another exclusive job is running,
+ * keyed jobs while another job with the same key is running.
+ *
+ * @return qfalse when the pool is shut down and the queue is drained
+ */
+static qboolean RS_MysqlPopJob( rs_mysqlworker_t *worker, rs_mysqljob_t *job )
+{
+	int i, index;
+
+	pthread_mutex_lock( &rs_mysqlPool.mutex );
+	while( qtrue )
+	{
+		for( i = 0; i < rs_mysqlPool.queueSize; i++ )
+		{
+			index = ( rs_mysqlPool.queueHead + i ) % RS_MYSQL_JOB_QUEUE_SIZE;
+			if( rs_mysqlPool.queue[index].exclusive && rs_mysqlPool.exclusiveRunning )
+				continue;
+			if( RS_MysqlKeyRunning( rs_mysqlPool.queue[index].key ) )
+				continue;
+			break;
+		}
+
+		if( i < rs_mysqlPool.queueSize )
+			break;
+
+		if( rs_mysqlPool.shutdown && !rs_mysqlPool.queueSize )
+		{
+			pthread_mutex_unlock( &rs_mysqlPool.mutex );
+			return qfalse;
+		}
+
+		pthread_cond_wait( &rs_mysqlPool.cond, &rs_mysqlPool.mutex );
+	}
+
+	*job = rs_mysqlPool.queue[index];
+
+	// close the gap left by the job, keeping the others in order
+	for( ; i > 0; i-- )
+	{
+		int prev = ( rs_mysqlPool.queueHead + i - 1 ) % RS_MYSQL_JOB_QUEUE_SIZE;
+		rs_mysqlPool.queue[( rs_mysqlPool.queueHead + i ) % RS_MYSQL_JOB_QUEUE_SIZE] = rs_mysqlPool.queue[prev];
+	}
+	rs_mysqlPool.queueHead = ( rs_mysqlPool.queueHead + 1 ) % RS_MYSQL_JOB_QUEUE_SIZE;
+	rs_mysqlPool.queueSize--;
+
+	if( job->exclusive )
+		rs_mysqlPool.exclusiveRunning++;
+	worker->jobKey = job->key;
+	rs_mysqlPool.busyWorkers++;
+	pthread_mutex_unlock( &rs_mysqlPool.mutex );
+
+	return qtrue;
+}
+
+/**
+ * Account a finished job and wake up workers waiting on exclusive or keyed jobs
+ */
+static void RS_MysqlFinishJob( rs_mysqlworker_t *worker, const rs_mysqljob_t *job, unsigned int started, qboolean failed )
+{
+	unsigned int now = trap_Milliseconds();
+	unsigned int wait = started - job->queued;
+	unsigned int exec = now - started;
+
+	pthread_mutex_lock( &rs_mysqlPool.mutex );
+	if( job->exclusive )
+		rs_mysqlPool.exclusiveRunning--;
+	worker->jobKey = 0;
+	rs_mysqlPool.busyWorkers--;
+	rs_mysqlPool.jobsDone++;
+	if( failed )
+		rs_mysqlPool.jobsFailed++;
+	rs_mysqlPool.totalWait += wait;
+	rs_mysqlPool.totalExec += exec;
+	if( wait > rs_mysqlPool.maxWait )
+		rs_mysqlPool.maxWait = wait;
+	if( exec > rs_mysqlPool.maxExec )
+		rs_mysqlPool.maxExec = exec;
+	if( job->exclusive || job->key )
+		pthread_cond_broadcast( &rs_mysqlPool.cond );
+	pthread_mutex_unlock( &rs_mysqlPool.mutex );
+}
+
+/**
+ * Worker main loop
+ *
+ * @param void *in the worker
+ * @return NULL
+ */
+static void *RS_MysqlWorker_Thread( void *in )
+{
+	rs_mysqlworker_t *worker = (rs_mysqlworker_t *)in;
+	rs_mysqljob_t job;
+	unsigned int started;
+	qboolean failed;
+
+	pthread_setspecific( rs_mysqlPool.workerKey, worker );
+
+	// always, the connection may only come up later in RS_StartMysqlThread
+	mysql_thread_init();
+
+	if( MysqlConnected )
+	{
+		worker->connected = RS_MysqlOpen( &worker->mysql );
+		if( !worker->connected )
+			G_Printf( "%sMySQL worker %i: %s\n", S_COLOR_RED, worker->num, mysql_error( &worker->mysql ) );
+	}
+
+	while( RS_MysqlPopJob( worker, &job ) )
+	{
+		started = trap_Milliseconds();
+
+		// a failed job has released its data, but may have left its transaction open
+		failed = !job.func( job.in );
+		RS_MysqlRollback( worker );
+
+		RS_MysqlFinishJob( worker, &job, started, failed );
+	}
+
+	if( worker->connected )
+	{
+		RS_MysqlFlushStatements( &worker->stmtCache );
+		mysql_close( &worker->mysql );
+	}
+	worker->connected = qfalse;
+	mysql_thread_end();
+
+	return NULL;
+}
+
+/**
+ * Start the MySQL worker pool
+ *
+ * @return void
+ */
+void RS_StartMysqlWorkers( void )
+{
+	int i, count;
+
+	if( rs_mysqlPool.running )
+		return;
+
+	count = min( max( rs_mysqlWorkers->integer, 1 ), RS_MYSQL_MAX_WORKERS );
+
+	memset( &rs_mysqlPool, 0, sizeof( rs_mysqlPool ) );
+	pthread_mutex_init( &rs_mysqlPool.mutex, NULL );
+	pthread_cond_init( &rs_mysqlPool.cond, NULL );
+	pthread_key_create( &rs_mysqlPool.workerKey, NULL );
+
+	// set before spawning so that RS_MysqlCurrentWorker works in the workers
+	rs_mysqlPool.running = qtrue;
+
+	for( i = 0; i < count; i++ )
+	{
+		rs_mysqlworker_t *worker = &rs_mysqlPool.workers[i];
+
+		worker->num = i;
+		if( pthread_create( &worker->thread, NULL, RS_MysqlWorker_Thread, (void *)worker ) )
+		{
+			G_Printf( "THREAD ERROR: could not start MySQL worker %i\n", i );
+			break;
+		}
+		rs_mysqlPool.numWorkers++;
+	}
+
+	if( !rs_mysqlPool.numWorkers )
+	{
+		rs_mysqlPool.running = qfalse;
+		pthread_key_delete( rs_mysqlPool.workerKey );
+		pthread_cond_destroy( &rs_mysqlPool.cond );
+		pthread_mutex_destroy( &rs_mysqlPool.mutex );
+	}
+}
+
+/**
+ * Stop the MySQL worker pool, the queued jobs are run first
+ *
+ * @return void
+ */
+void RS_StopMysqlWorkers( void )
+{
+	int i;
+
+	if( !rs_mysqlPool.running )
+		return;
+
+	pthread_mutex_lock( &rs_mysqlPool.mutex );
+	rs_mysqlPool.shutdown = qtrue;
+	pthread_cond_broadcast( &rs_mysqlPool.cond );
+	pthread_mutex_unlock( &rs_mysqlPool.mutex );
+
+	for( i = 0; i < rs_mysqlPool.numWorkers; i++ )
+		pthread_join( rs_mysqlPool.workers[i].thread, NULL );
+
+	rs_mysqlPool.running = qfalse;
+	pthread_key_delete( rs_mysqlPool.workerKey );
+	pthread_cond_destroy( &rs_mysqlPool.cond );
+	pthread_mutex_destroy( &rs_mysqlPool.mutex );
+}
+
+/**
+ * Queue a job for the worker pool
+ *
+ * @param rs_mysqljobfunc_t func
+ * @param void *in job data, owned by the job
+ * @param qboolean exclusive don't run along other exclusive jobs
+ * @param unsigned int key don't run along other jobs with the same key, 0 for none
+ * @return qboolean qfalse if the job could not be queued
+ */
+static qboolean RS_PushMysqlJobKey( rs_mysqljobfunc_t func, void *in, qboolean exclusive, unsigned int key )
+{
+	rs_mysqljob_t *job;
+
+	if( !rs_mysqlPool.running )
+	{
+		G_Printf( "THREAD ERROR: MySQL worker pool is not running\n" );
+		return qfalse;
+	}
+
+	pthread_mutex_lock( &rs_mysqlPool.mutex );
+	if( rs_mysqlPool.queueSize >= RS_MYSQL_JOB_QUEUE_SIZE || rs_mysqlPool.shutdown )
+	{
+		rs_mysqlPool.jobsRejected++;
+		pthread_mutex_unlock( &rs_mysqlPool.mutex );
+		G_Printf( "THREAD ERROR: MySQL job queue is full\n" );
+		return qfalse;
+	}
+
+	job = &rs_mysqlPool.queue[( rs_mysqlPool.queueHead + rs_mysqlPool.queueSize ) % RS_MYSQL_JOB_QUEUE_SIZE];
+	job->func = func;
+	job->in = in;
+	job->exclusive = exclusive;
+	job->key = key;
+	job->queued = trap_Milliseconds();
+
+	rs_mysqlPool.queueSize++;
+	if( rs_mysqlPool.queueSize > rs_mysqlPool.queueHighWater )
+		rs_mysqlPool.queueHighWater = rs_mysqlPool.queueSize;
+
+	pthread_cond_signal( &rs_mysqlPool.cond );
+	pthread_mutex_unlock( &rs_mysqlPool.mutex );
+
+	return qtrue;
+}
+
+/**
+ * Queue a job for the worker pool, see RS_PushMysqlJobKey
+ *
+ * @return qboolean qfalse if the job could not be queued
+ */
+static qboolean RS_PushMysqlJob( rs_mysqljobfunc_t func, void *in, qboolean exclusive )
+{
+	return RS_PushMysqlJobKey( func, in, exclusive, 0 );
+}
+
+/**
+ * Print the worker pool statistics
+ *
+ * @return void
+ */
+static void RS_Cmd_MysqlStats_f( void )
+{
+	int i, connected = 0, statements = 0;
+	unsigned int hits = 0, misses = 0;
+
+	if( !rs_mysqlPool.running )
+	{
+		G_Printf( "MySQL worker pool is not running\n" );
+		return;
+	}
+
+	pthread_mutex_lock( &rs_mysqlPool.mutex );
+	for( i = 0; i < rs_mysqlPool.numWorkers; i++ )
+	{
+		if( rs_mysqlPool.workers[i].connected )
+			connected++;
+		statements += rs_mysqlPool.workers[i].stmtCache.numStmts;
+		hits += rs_mysqlPool.workers[i].stmtCache.hits;
+		misses += rs_mysqlPool.workers[i].stmtCache.misses;
+	}
+
+	G_Printf( "workers: %i (%i connected, %i busy)\n", rs_mysqlPool.numWorkers, connected, rs_mysqlPool.busyWorkers );
+	G_Printf( "queue: %i/%i, high-water mark %i\n", rs_mysqlPool.queueSize, RS_MYSQL_JOB_QUEUE_SIZE, rs_mysqlPool.queueHighWater );
+	G_Printf( "jobs: %u done, %u failed, %u rejected\n", rs_mysqlPool.jobsDone, rs_mysqlPool.jobsFailed, rs_mysqlPool.jobsRejected );
+	if( rs_mysqlPool.jobsDone )
+	{
+		G_Printf( "wait: avg %ums, max %ums\n", rs_mysqlPool.totalWait / rs_mysqlPool.jobsDone, rs_mysqlPool.maxWait );
+		G_Printf( "exec: avg %ums, max %ums\n", rs_mysqlPool.totalExec / rs_mysqlPool.jobsDone, rs_mysqlPool.maxExec );
+	}
+	G_Printf( "prepared statements: %i cached, %u hits, %u prepared\n", statements, hits, misses );
+	pthread_mutex_unlock( &rs_mysqlPool.mutex );
+
+	RS_PrintCallbackStats();
+#ifdef MOSQUITTO
+	if( rs_mqtt.mosq )
+		G_Printf( "mqtt: %s, %i waiting, %u queued, %u sent, %u dropped, %u connection attempts\n", rs_mqtt.connected ? "connected" : "not connected",
+			rs_mqtt.queueSize, rs_mqtt.queued, rs_mqtt.sent, rs_mqtt.dropped, rs_mqtt.connects );
+#endif
+}
+
+/**
+ * In-memory leaderboard of the loaded map
+ *
+ * Holds every time set on the map, sorted like rs_queryGetPlayerMapHighscores.
+ * It is read once per map and then kept in sync by the race inserts, which
+ * compute positions and points from it instead of reading the list back.
+ */
+#define RS_LEADERBOARD_MAX_POSITIONS 30
+
+typedef struct
+{
+	unsigned int player_id;
+	unsigned int time;
+	int points;
+	qboolean prejumped;
+	char name[64];
+	char created[32];
+} rs_leaderboardentry_t;
+
+typedef struct
+{
+	pthread_mutex_t mutex;
+	qboolean loaded;			// qfalse while missing or out of sync with the database
+	unsigned int generation;	// bumped on every load
+	unsigned int map_id;
+	char mapname[64];
+	char oneliner[100];
+	char pjOneliner[100];
+	rs_leaderboardentry_t *entries;
+	int numEntries;
+	int maxEntries;
+} rs_leaderboard_t;
+
+typedef struct
+{
+	unsigned int player_id;
+	int oldPoints;
+	int points;
+} rs_pointchange_t;
+
+static rs_leaderboard_t rs_leaderboard = { PTHREAD_MUTEX_INITIALIZER };
+
+// point changes of the race being inserted, race inserts never run concurrently
+static rs_pointchange_t *rs_pointChanges;
+static int rs_maxPointChanges;
+
+/**
+ * Index of the first entry slower than time, or at least as slow with inclusive set
+ *
+ * @return int
+ */
+static int RS_LeaderboardSearch( const rs_leaderboardentry_t *entries, int numEntries, unsigned int time, qboolean inclusive )
+{
+	int low = 0, high = numEntries;
+
+	while( low < high )
+	{
+		int middle = ( low + high ) / 2;
+
+		if( entries[middle].time < time || ( !inclusive && entries[middle].time == time ) )
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+/**
+ * Points given for a position
+ *
+ * @return int
+ */
+static int RS_LeaderboardPositionPoints( unsigned int position )
+{
+	int points = ( RS_LEADERBOARD_MAX_POSITIONS + 1 ) - (int)position;
+
+	switch( position )
+	{
+		case 1:
+			points += 10;
+			break;
+		case 2:
+			points += 5;
+			break;
+		case 3:
+			points += 3;
+			break;
+	}
+
+	return points > 0 ? points : 0;
+}
+
+/**
+ * Recompute the points of the whole list. Prejumped times are ranked among
+ * all times, clean times among the clean ones only, equal times share a position.
+ *
+ * @param changes receives the entries whose points changed, numEntries big
+ * @return int number of changes
+ */
+static int RS_LeaderboardComputePoints( rs_leaderboard_t *board, rs_pointchange_t *changes )
+{
+	unsigned int position = 0, cleanPosition = 0, offset = 0, cleanOffset = 0;
+	unsigned int lastTime = 0, lastCleanTime = 0, realPosition;
+	int i, points, numChanges = 0;
+
+	for( i = 0; i < board->numEntries; i++ )
+	{
+		rs_leaderboardentry_t *entry = &board->entries[i];
+
+		offset = ( entry->time == lastTime ) ? offset + 1 : 0;
+		cleanOffset = ( !entry->prejumped && entry->time == lastCleanTime ) ? cleanOffset + 1 : 0;
+
+		position++;
+		if( !entry->prejumped )
+		{
+			cleanPosition++;
+			realPosition = cleanPosition - cleanOffset;
+			lastCleanTime = entry->time;
+		}
+		else
+		{
+			realPosition = position - offset;
+		}
+		lastTime = entry->time;
+
+		points = RS_LeaderboardPositionPoints( realPosition );
+		if( points != entry->points )
+		{
+			changes[numChanges].player_id = entry->player_id;
+			changes[numChanges].oldPoints = entry->points;
+			changes[numChanges].points = points;
+			numChanges++;
+			entry->points = points;
+		}
+	}
+
+	return numChanges;
+}
+
+/**
+ * Read the leaderboard of a map from the database, replacing the current one
+ *
+ * @param unsigned int map_id
+ * @param const char *mapname
+ * @return qboolean
+ */
+static qboolean RS_LeaderboardLoad( unsigned int map_id, const char *mapname )
+{
+	rs_mysqlstmt_t *stmt;
+	rs_leaderboardentry_t *entries, *oldEntries;
+	int numEntries = 0, maxEntries;
+	char oneliner[100], pjOneliner[100];
+
+	stmt = RS_MysqlExecute(rs_queryGetPlayerMapHighscores, map_id, "'true','false'");
+	if( !stmt )
+		return qfalse;
+
+	maxEntries = max( RS_MysqlNumRows( stmt ), 16 );
+	entries = malloc( maxEntries * sizeof( *entries ) );
+	while( RS_MysqlFetch( stmt ) && numEntries < maxEntries )
+	{
+		rs_leaderboardentry_t *entry = &entries[numEntries];
+
+		if( RS_MysqlIsNull( stmt, 0 ) || RS_MysqlIsNull( stmt, 1 ) )
+			continue;
+
+		entry->player_id = RS_MysqlGetInt( stmt, 0 );
+		entry->time = RS_MysqlGetInt( stmt, 1 );
+		entry->points = RS_MysqlGetInt( stmt, 7 );
+		entry->prejumped = !Q_stricmp( RS_MysqlGetString( stmt, 6 ), "true" ) ? qtrue : qfalse;
+		Q_strncpyz( entry->name, RS_MysqlGetString( stmt, 2 ), sizeof( entry->name ) );
+		Q_strncpyz( entry->created, RS_MysqlGetString( stmt, 5 ), sizeof( entry->created ) );
+		numEntries++;
+	}
+	RS_MysqlFreeResult( stmt );
+
+	oneliner[0] = pjOneliner[0] = '\0';
+	stmt = RS_MysqlExecute(rs_queryLoadMapOneliners, map_id);
+	if( !stmt )
+	{
+		free( entries );
+		return qfalse;
+	}
+	if( RS_MysqlFetch( stmt ) )
+	{
+		Q_strncpyz( oneliner, RS_MysqlGetString( stmt, 0 ), sizeof( oneliner ) );
+		Q_strncpyz( pjOneliner, RS_MysqlGetString( stmt, 1 ), sizeof( pjOneliner ) );
+	}
+	RS_MysqlFreeResult( stmt );
+
+	pthread_mutex_lock( &rs_leaderboard.mutex );
+	oldEntries = rs_leaderboard.entries;
+	rs_leaderboard.entries = entries;
+	rs_leaderboard.numEntries = numEntries;
+	rs_leaderboard.maxEntries = maxEntries;
+	rs_leaderboard.map_id = map_id;
+	Q_strncpyz( rs_leaderboard.mapname, mapname, sizeof( rs_leaderboard.mapname ) );
+	Q_strncpyz( rs_leaderboard.oneliner, oneliner, sizeof( rs_leaderboard.oneliner ) );
+	Q_strncpyz( rs_leaderboard.pjOneliner, pjOneliner, sizeof( rs_leaderboard.pjOneliner ) );
+	rs_leaderboard.generation++;
+	rs_leaderboard.loaded = qtrue;
+	pthread_mutex_unlock( &rs_leaderboard.mutex );
+
+	if( oldEntries )
+		free( oldEntries );
+
+	return qtrue;
+}
+
+/**
+ * Forget the leaderboard
+ *
+ * @return void
+ */
+static void RS_LeaderboardFree( void )
+{
+	pthread_mutex_lock( &rs_leaderboard.mutex );
+	if( rs_leaderboard.entries )
+		free( rs_leaderboard.entries );
+	rs_leaderboard.entries = NULL;
+	rs_leaderboard.numEntries = rs_leaderboard.maxEntries = 0;
+	rs_leaderboard.map_id = 0;
+	rs_leaderboard.loaded = qfalse;
+	pthread_mutex_unlock( &rs_leaderboard.mutex );
+
+	if( rs_pointChanges )
+		free( rs_pointChanges );
+	rs_pointChanges = NULL;
+	rs_maxPointChanges = 0;
+}
+
+/**
+ * Keep the cached oneliner in sync with the map table
+ *
+ * @return void
+ */
+static void RS_LeaderboardSetOneliner( unsigned int map_id, qboolean prejumped, const char *oneliner )
+{
+	pthread_mutex_lock( &rs_leaderboard.mutex );
+	if( rs_leaderboard.map_id == map_id )
+	{
+		if( prejumped )
+			Q_strncpyz( rs_leaderboard.pjOneliner, oneliner, sizeof( rs_leaderboard.pjOneliner ) );
+		else
+			Q_strncpyz( rs_leaderboard.oneliner, oneliner, sizeof( rs_leaderboard.oneliner ) );
+	}
+	pthread_mutex_unlock( &rs_leaderboard.mutex );
+}
+
+/**
+ * Print a highscore list
+ *
+ * @param char *highscores output buffer
+ * @param const rs_leaderboardentry_t *entries sorted times to print
+ * @param const char *oneliner shown next to the best clean time
+ * @param const char *pjOneliner shown next to the best prejumped time
+ * @return void
+ */
+static void RS_FormatHighscores( char *highscores, size_t size, const char *mapname, int limit, const rs_leaderboardentry_t *entries, int numEntries, const char *oneliner, const char *pjOneliner )
+{
+    unsigned int position = 0;
+    unsigned int last_position = 0;
+    unsigned int draw_position = 0;
+    unsigned int cleanBest = 0;
+    unsigned int pjBest = 0;
+    char last_time[16];
+    char draw_time[16];
+    char diff_time[16];
+    int i, min, sec, milli, dmin, dsec, dmilli;
+    unsigned int replay_record;
+
+    highscores[0]='\0';
+
+    if( numEntries == 0 )
+    {
+        Q_strncatz(highscores, va( "%sNo highscores found yet!\n", S_COLOR_RED ), size);
+        return;
+    }
+
+    replay_record=entries[0].time;
+    last_time[0]='\0';
+    draw_time[0]='\0';
+    diff_time[0]='\0';
+
+    Q_strncatz(highscores, va( "%sTop %d players on map '%s'%s\n", S_COLOR_ORANGE, limit, mapname, S_COLOR_WHITE ), size);
+
+    for( i = 0; i < numEntries; i++ )
+    {
+        const rs_leaderboardentry_t *entry = &entries[i];
+
+        position++;
+        if (!entry->prejumped && cleanBest == 0) //update the positions
+            cleanBest = position;
+        if (entry->prejumped && pjBest == 0)
+            pjBest = position;
+
+        // convert time into MM:SS:mmm
+        milli = entry->time;
+        min = milli / 60000;
+        milli -= min * 60000;
+        sec = milli / 1000;
+        milli -= sec * 1000;
+
+        dmilli = entry->time - replay_record;
+        dmin = dmilli / 60000;
+        dmilli -= dmin * 60000;
+        dsec = dmilli / 1000;
+        dmilli -= dsec * 1000;
+
+        Q_strncpyz( draw_time, va( "%d:%d.%03d", min, sec, milli ), sizeof(draw_time) );
+        Q_strncpyz( diff_time, va( "+%d:%d.%03d", dmin, dsec, dmilli ), sizeof(diff_time) );
+
+        if( !Q_stricmp( va( "%s", last_time ), va( "%s", draw_time ) ) )
+            draw_position = last_position;
+        else
+            draw_position = position;
+
+        last_position = draw_position;
+        Q_strncpyz( last_time, va( "%d:%d.%d", min, sec, milli ), sizeof(last_time) );
+
+        Q_strncatz( highscores, va( "%s%3d. %s%6s  %s[%s]  %s %s  %s(%s) %s%s%s\n", S_COLOR_WHITE, draw_position, entry->prejumped?S_COLOR_RED:S_COLOR_GREEN, draw_time, S_COLOR_YELLOW, diff_time, S_COLOR_WHITE, entry->name, S_COLOR_WHITE, entry->created, S_COLOR_YELLOW,
+            ( position == pjBest && pjOneliner[0] ) ? va( "\"%s\"", pjOneliner ) : "", ( position == cleanBest && oneliner[0] ) ? va( "\"%s\"", oneliner ) : "" ), size );
+    }
+}
+
+/**
+ * Callback ring
+ *
+ * The MySQL jobs hand their results to the game frame through a bounded
+ * lock-free queue: any number of workers push, only the game frame pops.
+ * The sequence number of a slot tells whether it is free for the producer
+ * at that position or filled for the consumer. Results which don't fit
+ * into a full ring go to an overflow list instead of being dropped.
+ */
+#define RS_CALLBACK_RING_SIZE 1024	// must be a power of two
+
+#ifdef WIN32
+#define RS_AtomicCompareAndSwap(ptr, oldValue, newValue) ( InterlockedCompareExchange( (volatile LONG *)(ptr), (LONG)(newValue), (LONG)(oldValue) ) == (LONG)(oldValue) )
+#define RS_AtomicIncrement(ptr) InterlockedIncrement( (volatile LONG *)(ptr) )
+#define RS_MemoryBarrier() MemoryBarrier()
+#else
+#define RS_AtomicCompareAndSwap(ptr, oldValue, newValue) __sync_bool_compare_and_swap( (ptr), (oldValue), (newValue) )
+#define RS_AtomicIncrement(ptr) __sync_add_and_fetch( (ptr), 1 )
+#define RS_MemoryBarrier() __sync_synchronize()
+#endif
+
+typedef enum
+{
+	RS_CALLBACK_PAYLOAD_NONE,
+	RS_CALLBACK_PAYLOAD_STRING,
+	RS_CALLBACK_PAYLOAD_HIGHSCORES
+} rs_callbackpayload_t;
+
+typedef struct
+{
+	char mapname[64];
+	int limit;
+	rs_leaderboardentry_t *entries;
+	int numEntries;
+	char oneliner[100];
+	char pjOneliner[100];
+} rs_highscorespayload_t;
+
+typedef struct rs_callback_s
+{
+	int command;
+	int args[7];				// args[0] is the player number of player callbacks
+	rs_callbackpayload_t type;
+	union
+	{
+		char *string;
+		rs_highscorespayload_t *highscores;
+	} payload;					// owned by the callback
+	struct rs_callback_s *next;	// overflow list
+} rs_callback_t;
+
+typedef struct
+{
+	volatile unsigned int sequence;
+	rs_callback_t callback;
+} rs_callbackslot_t;
+
+typedef struct
+{
+	rs_callbackslot_t slots[RS_CALLBACK_RING_SIZE];
+	volatile unsigned int pushPos;
+	volatile unsigned int popPos;	// only written by the game frame
+
+	// statistics
+	volatile unsigned int pushed;
+	volatile unsigned int highWater;
+	unsigned int overflowed;
+
+	pthread_mutex_t overflowMutex;
+	rs_callback_t *overflowHead;
+	rs_callback_t *overflowTail;
+} rs_callbackring_t;
+
+static rs_callbackring_t rs_callbackRing;
+
+// payload of the last callback popped for each player, read by RS_PrintQueryCallback
+static rs_callback_t rs_callbackResults[MAX_CLIENTS];
+
+/**
+ * Free what a callback carries
+ *
+ * @return void
+ */
+static void RS_FreeCallbackPayload( rs_callback_t *callback )
+{
+	switch( callback->type )
+	{
+		case RS_CALLBACK_PAYLOAD_STRING:
+			free( callback->payload.string );
+			break;
+		case RS_CALLBACK_PAYLOAD_HIGHSCORES:
+			free( callback->payload.highscores->entries );
+			free( callback->payload.highscores );
+			break;
+		default:
+			break;
+	}
+
+	callback->type = RS_CALLBACK_PAYLOAD_NONE;
+}
+
+/**
+ * Reset the ring, before any worker is started
+ *
+ * @return void
+ */
+static void RS_InitCallbackRing( void )
+{
+	unsigned int i;
+
+	memset( &rs_callbackRing, 0, sizeof( rs_callbackRing ) );
+	for( i = 0; i < RS_CALLBACK_RING_SIZE; i++ )
+		rs_callbackRing.slots[i].sequence = i;
+	pthread_mutex_init( &rs_callbackRing.overflowMutex, NULL );
+
+	memset( rs_callbackResults, 0, sizeof( rs_callbackResults ) );
+}
+
+/**
+ * Add a callback to the ring, or to the overflow list when it's full
+ *
+ * @return void
+ */
+static void RS_PushCallback( const rs_callback_t *callback )
+{
+	rs_callbackslot_t *slot;
+	rs_callback_t *overflow;
+	unsigned int pos, used, highWater;
+	int diff;
+
+	RS_AtomicIncrement( &rs_callbackRing.pushed );
+
+	while( qtrue )
+	{
+		pos = rs_callbackRing.pushPos;
+		slot = &rs_callbackRing.slots[pos & ( RS_CALLBACK_RING_SIZE - 1 )];
+		RS_MemoryBarrier();
+		diff = (int)( slot->sequence - pos );
+
+		if( diff == 0 )
+		{
+			// the slot is free, claim the position
+			if( RS_AtomicCompareAndSwap( &rs_callbackRing.pushPos, pos, pos + 1 ) )
+				break;
+		}
+		else if( diff < 0 )
+		{
+			// the game frame is a full ring behind
+			overflow = malloc( sizeof( *overflow ) );
+			*overflow = *callback;
+			overflow->next = NULL;
+
+			pthread_mutex_lock( &rs_callbackRing.overflowMutex );
+			if( rs_callbackRing.overflowTail )
+				rs_callbackRing.overflowTail->next = overflow;
+			else
+				rs_callbackRing.overflowHead = overflow;
+			rs_callbackRing.overflowTail = overflow;
+			rs_callbackRing.overflowed++;
+			pthread_mutex_unlock( &rs_callbackRing.overflowMutex );
+
+			G_Printf( "WARNING: callback ring full, callback %i queued on the overflow list\n", callback->command );
+			return;
+		}
+	}
+
+	slot->callback = *callback;
+	RS_MemoryBarrier();
+	slot->sequence = pos + 1;
+
+	used = pos + 1 - rs_callbackRing.popPos;
+	do
+	{
+		highWater = rs_callbackRing.highWater;
+	} while( used > highWater && !RS_AtomicCompareAndSwap( &rs_callbackRing.highWater, highWater, used ) );
+}
+
+/**
+ * Take the oldest callback, only called from the game frame
+ *
+ * @return qfalse when nothing is pending
+ */
+static qboolean RS_PopCallback( rs_callback_t *callback )
+{
+	rs_callbackslot_t *slot;
+	rs_callback_t *overflow;
+	unsigned int pos = rs_callbackRing.popPos;
+
+	slot = &rs_callbackRing.slots[pos & ( RS_CALLBACK_RING_SIZE - 1 )];
+	RS_MemoryBarrier();
+	if( slot->sequence == pos + 1 )
+	{
+		*callback = slot->callback;
+		RS_MemoryBarrier();
+		slot->sequence = pos + RS_CALLBACK_RING_SIZE;
+		rs_callbackRing.popPos = pos + 1;
+		return qtrue;
+	}
+
+	// the ring is drained, deliver what overflowed
+	if( !rs_callbackRing.overflowHead )
+		return qfalse;
+
+	pthread_mutex_lock( &rs_callbackRing.overflowMutex );
+	overflow = rs_callbackRing.overflowHead;
+	if( overflow )
+	{
+		rs_callbackRing.overflowHead = overflow->next;
+		if( !rs_callbackRing.overflowHead )
+			rs_callbackRing.overflowTail = NULL;
+	}
+	pthread_mutex_unlock( &rs_callbackRing.overflowMutex );
+
+	if( !overflow )
+		return qfalse;
+
+	*callback = *overflow;
+	free( overflow );
+	return qtrue;
+}
+
+/**
+ * Throw away everything still pending, once the workers are stopped
+ *
+ * @return void
+ */
+static void RS_ShutdownCallbackRing( void )
+{
+	rs_callback_t callback;
+	int i;
+
+	while( RS_PopCallback( &callback ) )
+		RS_FreeCallbackPayload( &callback );
+
+	for( i = 0; i < MAX_CLIENTS; i++ )
+		RS_FreeCallbackPayload( &rs_callbackResults[i] );
+
+	pthread_mutex_destroy( &rs_callbackRing.overflowMutex );
+}
+
+/**
+ * Print the state of the callback ring
+ *
+ * @return void
+ */
+static void RS_PrintCallbackStats( void )
+{
+	G_Printf( "callbacks: %u pushed, %u pending, high-water mark %u/%i, %u overflowed\n", rs_callbackRing.pushed,
+		rs_callbackRing.pushPos - rs_callbackRing.popPos, rs_callbackRing.highWater, RS_CALLBACK_RING_SIZE, rs_callbackRing.overflowed );
+}
+
+/**
+ *
+ * Add a command to the callback queue
+ *
+ * @return void
+ */
+void RS_PushCallbackQueue(int command, int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, int arg7)
+{
+	rs_callback_t callback;
+
+	memset( &callback, 0, sizeof( callback ) );
+	callback.command = command;
+	callback.args[0] = arg1;
+	callback.args[1] = arg2;
+	callback.args[2] = arg3;
+	callback.args[3] = arg4;
+	callback.args[4] = arg5;
+	callback.args[5] = arg6;
+	callback.args[6] = arg7;
+
+	RS_PushCallback( &callback );
+}
+
+/**
+ * Add a command to the callback queue with a text for the player, the
+ * text is copied
+ *
+ * @return void
+ */
+static void RS_PushStringCallback(const char *string, int command, int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, int arg7)
+{
+	rs_callback_t callback;
+	size_t size = strlen( string ) + 1;
+
+	memset( &callback, 0, sizeof( callback ) );
+	callback.command = command;
+	callback.args[0] = arg1;
+	callback.args[1] = arg2;
+	callback.args[2] = arg3;
+	callback.args[3] = arg4;
+	callback.args[4] = arg5;
+	callback.args[5] = arg6;
+	callback.args[6] = arg7;
+	callback.type = RS_CALLBACK_PAYLOAD_STRING;
+	callback.payload.string = malloc( size );
+	memcpy( callback.payload.string, string, size );
+
+	RS_PushCallback( &callback );
+}
+
+/**
+ * Add a highscores callback, the rows are printed when the game frame
+ * asks for them
+ *
+ * @param rs_highscorespayload_t *highscores malloc'd rows, owned by the callback afterwards
+ * @return void
+ */
+static void RS_PushHighscoresCallback(int playerNum, rs_highscorespayload_t *highscores)
+{
+	rs_callback_t callback;
+
+	memset( &callback, 0, sizeof( callback ) );
+	callback.command = RACESOW_CALLBACK_HIGHSCORES;
+	callback.args[0] = playerNum;
+	callback.type = RS_CALLBACK_PAYLOAD_HIGHSCORES;
+	callback.payload.highscores = highscores;
+
+	RS_PushCallback( &callback );
+}
+
+/**
+ *
+ * "Is there a callback result to execute?"
+ * queried at each game frame
+ *
+ * @return qboolean
+ */
+qboolean RS_PopCallbackQueue(int *command, int *arg1, int *arg2, int *arg3, int *arg4, int *arg5, int *arg6, int *arg7)
+{
+	rs_callback_t callback;
+
+	if( !RS_PopCallback( &callback ) )
+		return qfalse;
+
+	*command=callback.command;
+	*arg1=callback.args[0];
+	*arg2=callback.args[1];
+	*arg3=callback.args[2];
+	*arg4=callback.args[3];
+	*arg5=callback.args[4];
+	*arg6=callback.args[5];
+	*arg7=callback.args[6];
+
+	// keep the payload around until the script asks for it
+	if( callback.type != RS_CALLBACK_PAYLOAD_NONE )
+	{
+		if( callback.args[0] >= 0 && callback.args[0] < MAX_CLIENTS )
+		{
+			RS_FreeCallbackPayload( &rs_callbackResults[callback.args[0]] );
+			rs_callbackResults[callback.args[0]] = callback;
+		}
+		else
+		{
+			RS_FreeCallbackPayload( &callback );
+		}
+	}
+
+	return qtrue;
+}
+
+/**
+ * Answer a highscore request from the leaderboard, without going to the database
+ *
+ * @return qboolean qfalse if the leaderboard doesn't cover the requested map
+ */
+static qboolean RS_LeaderboardHighscores( int playerNum, int limit, int map_id, const char *mapname, pjflag prejumpFlag )
+{
+	rs_highscorespayload_t *highscores;
+	int i;
+
+	if( limit <= 0 )
+		return qfalse;
+
+	pthread_mutex_lock( &rs_leaderboard.mutex );
+	if( !rs_leaderboard.loaded
+		|| ( mapname && mapname[0] ? Q_stricmp( mapname, rs_leaderboard.mapname ) : map_id != (int)rs_leaderboard.map_id ) )
+	{
+		pthread_mutex_unlock( &rs_leaderboard.mutex );
+		return qfalse;
+	}
+
+	highscores = malloc( sizeof( *highscores ) );
+	highscores->entries = malloc( min( limit, max( rs_leaderboard.numEntries, 1 ) ) * sizeof( rs_leaderboardentry_t ) );
+	highscores->numEntries = 0;
+	for( i = 0; i < rs_leaderboard.numEntries && highscores->numEntries < limit; i++ )
+	{
+		if( ( prejumpFlag == RS_PREJUMPED && !rs_leaderboard.entries[i].prejumped )
+			|| ( prejumpFlag == RS_NOTPREJUMPED && rs_leaderboard.entries[i].prejumped ) )
+			continue;
+		highscores->entries[highscores->numEntries++] = rs_leaderboard.entries[i];
+	}
+	Q_strncpyz( highscores->oneliner, rs_leaderboard.oneliner, sizeof( highscores->oneliner ) );
+	Q_strncpyz( highscores->pjOneliner, rs_leaderboard.pjOneliner, sizeof( highscores->pjOneliner ) );
+	pthread_mutex_unlock( &rs_leaderboard.mutex );
+
+	Q_strncpyz( highscores->mapname, mapname && mapname[0] ? mapname : level.mapname, sizeof( highscores->mapname ) );
+	highscores->limit = limit;
+	RS_PushHighscoresCallback( playerNum, highscores );
+
+	return qtrue;
+}
 
 /**
  * Calls the load-map thread
@@ -626,11 +2809,9 @@ qboolean RS_PopCallbackQueue(int *command, int *arg1, int *arg2, int *arg3, int
  */
 qboolean RS_MysqlLoadMap()
 {
-	pthread_t thread;
-	int returnCode = pthread_create(&thread, &threadAttr, RS_MysqlLoadMap_Thread, NULL);
-	if (returnCode) {
-
-		G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+	// exclusive, so that the leaderboard isn't replaced under a race insert
+	if( !RS_PushMysqlJob( RS_MysqlLoadMap_Thread, NULL, qtrue ) )
+	{
 		return qfalse;
 	}
 
@@ -641,64 +2822,73 @@ qboolean RS_MysqlLoadMap()
  * Getting map id and servbest, and returning them as a callback
  *
  * @param void *in
- * @return void
+ * @return qboolean qfalse on errors
  */
-void *RS_MysqlLoadMap_Thread(void *in)
+qboolean RS_MysqlLoadMap_Thread(void *in)
 {
-    char query[MYSQL_QUERY_LENGTH];
     char name[64];
-    MYSQL_ROW  row;
-    MYSQL_RES  *mysql_res;
-	int map_id=0;
+    rs_mysqlstmt_t *stmt;
+	int map_id=0, i;
 	unsigned int bestTime=0;
 	RS_StartMysqlThread();
     Q_strncpyz ( name, COM_RemoveColorTokens( level.mapname ), sizeof(name) );
-	RS_EscapeString(name);
 
-	sprintf(query, rs_queryGetMap->string, name);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
-    mysql_res = mysql_store_result(&mysql);
-    RS_CheckMysqlThreadError(query);
+	stmt = RS_MysqlExecute(rs_queryGetMap, name);
+    RS_CheckMysqlThreadError(stmt);
 
-	if ((row = mysql_fetch_row(mysql_res)) != NULL) {
-        map_id=atoi(row[0]);
+	if (RS_MysqlFetch(stmt)) {
+        map_id = RS_MysqlGetInt(stmt, 0);
+        RS_MysqlFreeResult(stmt);
     } else {
+        RS_MysqlFreeResult(stmt);
 
-        sprintf(query, rs_queryAddMap->string, name);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
+        stmt = RS_MysqlExecute(rs_queryAddMap, name);
+        RS_CheckMysqlThreadError(stmt);
+
+		map_id = RS_MysqlInsertId(stmt);
+    }
 
-		map_id=(int)mysql_insert_id(&mysql);
+    // load the leaderboard and retrieve server best from it
+    if (!RS_LeaderboardLoad(map_id, name))
+    {
+        G_Printf("MySQL ERROR: could not load the leaderboard of %s\n", name);
+        goto error;
     }
-    mysql_free_result(mysql_res);
 
-    // retrieve server best
-	sprintf(query, rs_queryGetPlayerMapHighscores->string, map_id, "'false'");
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
-    mysql_res = mysql_store_result(&mysql);
-    RS_CheckMysqlThreadError(query);
-    if ((row = mysql_fetch_row(mysql_res)) != NULL)
+	pthread_mutex_lock(&rs_leaderboard.mutex);
+	for (i = 0; i < rs_leaderboard.numEntries; i++)
 	{
-		if (row[0] !=NULL && row[1] != NULL)
+		if (!rs_leaderboard.entries[i].prejumped)
 		{
-			unsigned int playerId, raceTime;
-            playerId = atoi(row[0]);
-            raceTime = atoi(row[1]);
-            if (bestTime == 0)
-                bestTime = raceTime;
+			bestTime = rs_leaderboard.entries[i].time;
+			break;
 		}
 	}
-	mysql_free_result(mysql_res);
+	pthread_mutex_unlock(&rs_leaderboard.mutex);
 
 	RS_PushCallbackQueue(RACESOW_CALLBACK_LOADMAP, 0, map_id, bestTime, 0, 0, 0, 0);
 
 	// remember this map name
 	strcpy(previousMapName,level.mapname);
 
-	RS_EndMysqlThread();
-	return NULL;
+	return qtrue;
+
+error:
+	return qfalse;
+}
+
+/**
+ * Release the data of an insert race job
+ *
+ * @param void *in raceDataStruct
+ * @return void
+ */
+static void RS_FreeRaceData( void *in )
+{
+	struct raceDataStruct *raceData = (struct raceDataStruct *)in;
+
+	free( raceData->checkpoints );
+	free( raceData );
 }
 
 /**
@@ -711,9 +2901,7 @@ void *RS_MysqlLoadMap_Thread(void *in)
  */
 qboolean RS_MysqlInsertRace( unsigned int player_id, unsigned int nick_id, unsigned int map_id, unsigned int race_time, unsigned int playerNum, unsigned int tries, unsigned int duration, char *checkpoints, qboolean prejumped) {
 
-	int returnCode;
     struct raceDataStruct *raceData=malloc(sizeof(struct raceDataStruct));
-	pthread_t thread;
 
     // player finished a race while using a protected nickname
     if (player_id == 0) {
@@ -730,11 +2918,9 @@ qboolean RS_MysqlInsertRace( unsigned int player_id, unsigned int nick_id, unsig
 	raceData->checkpoints = strdup( checkpoints );
 	raceData->prejumped = prejumped;
 
-	returnCode = pthread_create(&thread, &threadAttr, RS_MysqlInsertRace_Thread, (void *)raceData);
-
-	if (returnCode) {
-
-		G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+	if( !RS_PushMysqlJob( RS_MysqlInsertRace_Thread, (void *)raceData, qtrue ) )
+	{
+		RS_FreeRaceData( raceData );
 		return qfalse;
 	}
 
@@ -742,153 +2928,207 @@ qboolean RS_MysqlInsertRace( unsigned int player_id, unsigned int nick_id, unsig
 
 }
 
+/**
+ * Write a batch of changed map points and refresh the global points of
+ * the players in it
+ *
+ * @param int map_id
+ * @param char *cases "WHEN <player_id> THEN <points>" list, emptied afterwards
+ * @param char *ids comma separated player ids, emptied afterwards
+ * @return qboolean qfalse on errors
+ */
+static qboolean RS_MysqlUpdateMapPoints( int map_id, char *cases, char *ids )
+{
+    if ( !ids[0] )
+        return qtrue;
+
+    // the points were already written row by row if cases is empty
+    if ( cases[0] && !RS_MysqlRun(rs_queryUpdateMapPoints, cases, map_id, ids) )
+        return qfalse;
+
+    if ( !RS_MysqlRun(rs_queryUpdatePlayerPoints, ids) )
+        return qfalse;
+
+    cases[0] = '\0';
+    ids[0] = '\0';
+    return qtrue;
+}
+
+/**
+ * Queue the new map points of a player for RS_MysqlUpdateMapPoints,
+ * writing the batch when it's full.
+ *
+ * A customized rs_queryUpdatePlayerMapPoints is still honoured, the
+ * points are then written row by row with it.
+ *
+ * @param int map_id
+ * @param unsigned int player_id
+ * @param int points
+ * @param char *cases RS_MYSQL_BATCH_LENGTH long
+ * @param char *ids RS_MYSQL_BATCH_LENGTH long
+ * @return qboolean qfalse on errors
+ */
+static qboolean RS_MysqlQueueMapPoints( int map_id, unsigned int player_id, int points, char *cases, char *ids )
+{
+    char pointCase[48], playerIdString[16];
+
+    pointCase[0] = '\0';
+    if ( RS_MysqlQueryChanged( rs_queryUpdatePlayerMapPoints ) )
+    {
+        rs_mysqlstmt_t *stmt = RS_MysqlExecute(rs_queryUpdatePlayerMapPoints, points, map_id, player_id);
+        RS_CheckMysqlThreadError(stmt);
+    }
+    else
+    {
+        Q_snprintfz( pointCase, sizeof(pointCase), " WHEN %u THEN %d", player_id, points );
+    }
+
+    Q_snprintfz( playerIdString, sizeof(playerIdString), "%s%u", ids[0] ? "," : "", player_id );
+    if ( strlen( cases ) + strlen( pointCase ) >= RS_MYSQL_BATCH_LENGTH
+        || strlen( ids ) + strlen( playerIdString ) >= RS_MYSQL_BATCH_LENGTH )
+    {
+        if ( !RS_MysqlUpdateMapPoints( map_id, cases, ids ) )
+            return qfalse;
+        Q_snprintfz( playerIdString, sizeof(playerIdString), "%u", player_id );
+    }
+    Q_strncatz( cases, pointCase, RS_MYSQL_BATCH_LENGTH );
+    Q_strncatz( ids, playerIdString, RS_MYSQL_BATCH_LENGTH );
+    return qtrue;
+
+error:
+    return qfalse;
+}
+
 /**
  * Thread to insert a new race
  *
+ * All writes happen in a single transaction, the checkpoints and the
+ * changed points are sent as multi-row statements. Positions and points
+ * come from the in-memory leaderboard, only the changed rows are written.
+ *
  * @param void *in
- * @return void
+ * @return qboolean qfalse on errors
  */
-void *RS_MysqlInsertRace_Thread(void *in)
+qboolean RS_MysqlInsertRace_Thread(void *in)
 {
-    char query[MYSQL_QUERY_LENGTH];
-    char affectedPlayerIds[1000];
-	unsigned int maxPositions, newPoints, currentPosition, currentCleanPosition, realPosition, offset, cleanOffset, lastRaceTime, lastCleanRaceTime, bestTime, oldTime, oldPoints, oldBestTime, oldOtherBestTime, oldBestPlayerId, oldOtherBestPlayerId, allPoints, newPosition, server_id;
-	int points, oldpoints, diffPoints;
+    char affectedPlayerIds[RS_MYSQL_BATCH_LENGTH];
+    char pointCases[RS_MYSQL_BATCH_LENGTH];
+    char checkpointValues[RS_MYSQL_BATCH_LENGTH];
+    char simplified[64];
+	unsigned int newPoints, oldTime, oldPoints, oldBestTime, oldOtherBestTime, oldBestPlayerId, oldOtherBestPlayerId, allPoints, server_id, generation;
+	int i, numChanges, diffPoints;
 	struct raceDataStruct *raceData;
-    MYSQL_ROW  row;
-    MYSQL_RES  *mysql_res;
+    rs_leaderboardentry_t newEntry;
+    rs_mysqlstmt_t *stmt;
     char *t; //token to parse checkpoints
     static const char *seps = " "; //token separator in checkpoints string
     int index = 0; //checkpoint number
 
     affectedPlayerIds[0] = '\0';
+    pointCases[0] = '\0';
+    checkpointValues[0] = '\0';
+    simplified[0] = '\0';
     oldTime = 0;
-    bestTime = 0;
-    maxPositions = 30;
     oldBestTime = 0;
     oldOtherBestTime = 0;
     oldBestPlayerId = 0;
     oldOtherBestPlayerId = 0;
-    offset = 0;
-    cleanOffset = 0;
-    newPosition = 0;
 	newPoints = 0;
 	oldPoints = 0;
-	currentPosition = 0;
-	currentCleanPosition = 0;
-    lastRaceTime = 0;
-    lastCleanRaceTime = 0;
     allPoints = 0;
-    server_id = 0;
+    numChanges = 0;
 	raceData =(struct raceDataStruct *)in;
 
 	RS_StartMysqlThread();
 
-	// read current points and time
-	sprintf(query, rs_queryGetPlayerMap->string, raceData->player_id, raceData->map_id);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
-	mysql_res = mysql_store_result(&mysql);
-    RS_CheckMysqlThreadError(query);
-    if ((row = mysql_fetch_row(mysql_res)) != NULL) {
-		if (row[0] != NULL && row[1] != NULL)
-        {
-			oldPoints = atoi(row[0]);
-            oldTime = atoi(row[1]);
-            newPoints = oldPoints;
-        }
-    }
-	mysql_free_result(mysql_res);
+	// the leaderboard is normally loaded with the map, read it if it's missing or stale
+	pthread_mutex_lock(&rs_leaderboard.mutex);
+	i = rs_leaderboard.loaded && rs_leaderboard.map_id == raceData->map_id;
+	pthread_mutex_unlock(&rs_leaderboard.mutex);
+	if (!i && !RS_LeaderboardLoad(raceData->map_id, COM_RemoveColorTokens(level.mapname)))
+	{
+		G_Printf("MySQL ERROR: could not load the leaderboard for map %u\n", raceData->map_id);
+		goto error;
+	}
 
-    // retrieve server best in the category (pj/nopj) of the race to be inserted
-	sprintf(query, rs_queryGetPlayerMapHighscores->string, raceData->map_id, raceData->prejumped?"'true'":"'false'");
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
-    mysql_res = mysql_store_result(&mysql);
-    RS_CheckMysqlThreadError(query);
-    if ((row = mysql_fetch_row(mysql_res)) != NULL)
+	// read current points and time, and server best in both categories (pj/nopj)
+	pthread_mutex_lock(&rs_leaderboard.mutex);
+	generation = rs_leaderboard.generation;
+	for (i = 0; i < rs_leaderboard.numEntries; i++)
 	{
-		if (row[1] !=NULL)
+		rs_leaderboardentry_t *entry = &rs_leaderboard.entries[i];
+
+		if (entry->player_id == raceData->player_id)
+		{
+			oldPoints = entry->points;
+			oldTime = entry->time;
+		}
+		if (entry->prejumped == raceData->prejumped && !oldBestTime)
+		{
+			oldBestPlayerId = entry->player_id;
+			oldBestTime = entry->time;
+		}
+		else if (entry->prejumped != raceData->prejumped && !oldOtherBestTime)
 		{
-		    oldBestPlayerId = atoi(row[0]);
-            oldBestTime = atoi(row[1]);
+			oldOtherBestPlayerId = entry->player_id;
+			oldOtherBestTime = entry->time;
 		}
 	}
-	mysql_free_result(mysql_res);
+	pthread_mutex_unlock(&rs_leaderboard.mutex);
+	newPoints = oldPoints;
 
-    // retrieve server best in the other category (pj/nopj) of the race to be inserted
-    sprintf(query, rs_queryGetPlayerMapHighscores->string, raceData->map_id, raceData->prejumped?"'false'":"'true'");
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
-    mysql_res = mysql_store_result(&mysql);
-    RS_CheckMysqlThreadError(query);
-    if ((row = mysql_fetch_row(mysql_res)) != NULL)
+    // the server id doesn't change, it's only looked up if the connect didn't get it
+    server_id = rs_mysqlServerId;
+    if (server_id == 0)
     {
-        if (row[1] !=NULL)
-        {
-            oldOtherBestPlayerId = atoi(row[0]);
-            oldOtherBestTime = atoi(row[1]);
-        }
-    }
-    mysql_free_result(mysql_res);
-
+        stmt = RS_MysqlExecute(rs_queryGetServer, sv_port->integer);
+        RS_CheckMysqlThreadError(stmt);
 
-    // get server_id
-    sprintf(query, rs_queryGetServer->string, sv_port->integer);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
-    mysql_res = mysql_store_result(&mysql);
-    RS_CheckMysqlThreadError(query);
-
-	if ((row = mysql_fetch_row(mysql_res)) != NULL)
-    {
-        if (row[0] !=NULL && row[1] != NULL)
+        if (RS_MysqlFetch(stmt))
         {
-            server_id = atoi(row[0]);
+            if (!RS_MysqlIsNull(stmt, 0) && !RS_MysqlIsNull(stmt, 1))
+            {
+                server_id = rs_mysqlServerId = RS_MysqlGetInt(stmt, 0);
+            }
         }
-    }
 
-	mysql_free_result(mysql_res);
+        RS_MysqlFreeResult(stmt);
+    }
 
     if (server_id != 0)
     {
+        if (!RS_MysqlBeginTransaction())
+            goto error;
+
         // insert race
-        sprintf(query, rs_queryAddRace->string, raceData->player_id, raceData->map_id, raceData->race_time, raceData->tries, raceData->duration, server_id, raceData->prejumped?"true":"false");
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
+        stmt = RS_MysqlExecute(rs_queryAddRace, raceData->player_id, raceData->map_id, raceData->race_time, raceData->tries, raceData->duration, server_id, raceData->prejumped?"true":"false");
+        RS_CheckMysqlThreadError(stmt);
 
         // increment player races
-        sprintf(query, rs_queryUpdatePlayerRaces->string, raceData->player_id);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
+        stmt = RS_MysqlExecute(rs_queryUpdatePlayerRaces, raceData->player_id);
+        RS_CheckMysqlThreadError(stmt);
 
         // increment map races
-        sprintf(query, rs_queryUpdateMapRaces->string, raceData->map_id);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
+        stmt = RS_MysqlExecute(rs_queryUpdateMapRaces, raceData->map_id);
+        RS_CheckMysqlThreadError(stmt);
 
         // increment server races
-        sprintf(query, rs_queryIncrementServerRaces->string, sv_port->integer);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
+        stmt = RS_MysqlExecute(rs_queryIncrementServerRaces, sv_port->integer);
+        RS_CheckMysqlThreadError(stmt);
 
         // insert or update player_map (aka personal record)
-        sprintf(query, rs_queryUpdatePlayerMap->string, raceData->player_id, raceData->map_id, raceData->race_time, server_id, raceData->player_id, raceData->map_id, raceData->player_id, raceData->map_id, raceData->prejumped?"true":"false");
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
+        stmt = RS_MysqlExecute(rs_queryUpdatePlayerMap, raceData->player_id, raceData->map_id, raceData->race_time, server_id, raceData->player_id, raceData->map_id, raceData->player_id, raceData->map_id, raceData->prejumped?"true":"false");
+        RS_CheckMysqlThreadError(stmt);
 
         // only when the new time is better than the old one, recompute the points
         if (oldTime == 0 || raceData->race_time < oldTime)
         {
-
             // clear the current oneliner in the race category if the rec of this category was beaten
             if ( raceData->race_time < oldBestTime )
             {
-                char empty_oneliner[1];
-                empty_oneliner[0] = '\0';
-                sprintf(query, rs_querySetMapOneliner->string, raceData->prejumped?"pj_oneliner":"oneliner", empty_oneliner, raceData->map_id);
-                mysql_real_query(&mysql, query, strlen(query));
-                RS_CheckMysqlThreadError(query);
+                stmt = RS_MysqlExecute(rs_querySetMapOneliner, raceData->prejumped?"pj_oneliner":"oneliner", "", raceData->map_id);
+                RS_CheckMysqlThreadError(stmt);
+                RS_LeaderboardSetOneliner(raceData->map_id, raceData->prejumped, "");
             }
 
             // - clear the current oneliner in the other category if current racer was the record holder in this category
@@ -896,193 +3136,222 @@ void *RS_MysqlInsertRace_Thread(void *in)
             // - also clear the prejumped oneliner if a nopj absolute record was made
             if ( raceData->player_id == oldOtherBestPlayerId || ( ( !raceData->prejumped ) && ( raceData->race_time < oldOtherBestTime ) ) )
             {
-                char empty_oneliner[1];
-                empty_oneliner[0] = '\0';
-                sprintf(query, rs_querySetMapOneliner->string, raceData->prejumped?"oneliner":"pj_oneliner", empty_oneliner, raceData->map_id);
-                mysql_real_query(&mysql, query, strlen(query));
-                RS_CheckMysqlThreadError(query);
+                stmt = RS_MysqlExecute(rs_querySetMapOneliner, raceData->prejumped?"oneliner":"pj_oneliner", "", raceData->map_id);
+                RS_CheckMysqlThreadError(stmt);
+                RS_LeaderboardSetOneliner(raceData->map_id, !raceData->prejumped, "");
             }
 
-            //update player checkpoints
+            //update player checkpoints, as few multi-row statements as possible,
+            //or row by row if rs_queryUpdateCheckpoint was customized
             t = strtok( raceData->checkpoints , seps );
             while( t != NULL )
             {
+                char row[64];
+
                 index++;
-                sprintf(query, rs_queryUpdateCheckpoint->string, raceData->player_id, raceData->map_id, atoi(t), index);
-                mysql_real_query(&mysql, query, strlen(query));
-                RS_CheckMysqlThreadError(query);
+                if ( RS_MysqlQueryChanged( rs_queryUpdateCheckpoint ) )
+                {
+                    stmt = RS_MysqlExecute(rs_queryUpdateCheckpoint, raceData->player_id, raceData->map_id, atoi(t), index);
+                    RS_CheckMysqlThreadError(stmt);
+                    t = strtok( NULL, seps);
+                    continue;
+                }
+
+                Q_snprintfz( row, sizeof(row), "%s(%u, %u, %d, %d)", checkpointValues[0] ? "," : "", raceData->player_id, raceData->map_id, atoi(t), index );
+                if ( strlen( checkpointValues ) + strlen( row ) >= sizeof( checkpointValues ) )
+                {
+                    if ( !RS_MysqlRun(rs_queryUpdateCheckpoints, checkpointValues) )
+                        goto error;
+                    Q_snprintfz( row, sizeof(row), "(%u, %u, %d, %d)", raceData->player_id, raceData->map_id, atoi(t), index );
+                    checkpointValues[0] = '\0';
+                }
+                Q_strncatz( checkpointValues, row, sizeof(checkpointValues) );
                 t = strtok( NULL, seps);
             }
+            if ( checkpointValues[0] && !RS_MysqlRun(rs_queryUpdateCheckpoints, checkpointValues) )
+                goto error;
+
+            // the new leaderboard row, name and date as the database has them
+            memset(&newEntry, 0, sizeof(newEntry));
+            newEntry.player_id = raceData->player_id;
+            newEntry.time = raceData->race_time;
+            newEntry.points = oldPoints;
+            newEntry.prejumped = raceData->prejumped;
+            stmt = RS_MysqlExecute(rs_queryGetPlayerMapHighscore, raceData->map_id, raceData->player_id);
+            RS_CheckMysqlThreadError(stmt);
+            if (RS_MysqlFetch(stmt))
+            {
+                Q_strncpyz(newEntry.name, RS_MysqlGetString(stmt, 3), sizeof(newEntry.name));
+                Q_strncpyz(newEntry.created, RS_MysqlGetString(stmt, 6), sizeof(newEntry.created));
+            }
+            RS_MysqlFreeResult(stmt);
 
-            /*// reset points in player_map
-            sprintf(query, rs_queryResetPlayerMapPoints->string, raceData->map_id);
-            mysql_real_query(&mysql, query, strlen(query));
-            RS_CheckMysqlThreadError(query);*/
+            // move the racer in the leaderboard and recompute the points locally. It's
+            // flagged as not loaded until the transaction is committed, if the job
+            // fails it gets read again from the database.
+            pthread_mutex_lock(&rs_leaderboard.mutex);
+            if (rs_leaderboard.generation != generation)
+            {
+                pthread_mutex_unlock(&rs_leaderboard.mutex);
+                G_Printf("MySQL ERROR: leaderboard reloaded during a race insert\n");
+                goto error;
+            }
+            rs_leaderboard.loaded = qfalse;
 
-            // update points in player_map
-            sprintf(query, rs_queryGetPlayerMapHighscores->string, raceData->map_id, "'true','false'");
-            mysql_real_query(&mysql, query, strlen(query));
-            RS_CheckMysqlThreadError(query);
-            mysql_res = mysql_store_result(&mysql);
-            while ((row = mysql_fetch_row(mysql_res)) != NULL)
+            if (oldTime)
             {
-                points = 0;
-                oldpoints = 0;
-                if (row[0] !=NULL && row[1] != NULL)
+                i = RS_LeaderboardSearch(rs_leaderboard.entries, rs_leaderboard.numEntries, oldTime, qtrue);
+                for (; i < rs_leaderboard.numEntries && rs_leaderboard.entries[i].time == oldTime; i++)
                 {
-                    unsigned int playerId, raceTime;
-                    qboolean prejumped;
-
-                    playerId = atoi(row[0]);
-                    raceTime = atoi(row[1]);
-                    oldpoints = atoi(row[7]);
-
-                    if ( !Q_stricmp(row[6],"true") )
-                        prejumped = qtrue;
-                    else
-                        prejumped = qfalse;
-
-                    if (bestTime == 0)
-                        bestTime = raceTime;
-
-                    if (raceTime == lastRaceTime)
-                        offset++;
-                    else
-                        offset = 0;
-
-                    if ( !prejumped && raceTime == lastCleanRaceTime )
-                        cleanOffset++;
-                    else
-                        cleanOffset = 0;
-
-                    currentPosition++;
-                    if ( !prejumped )
+                    if (rs_leaderboard.entries[i].player_id == raceData->player_id)
                     {
-                        currentCleanPosition++;
-                        realPosition = currentCleanPosition - cleanOffset;
-                        lastCleanRaceTime = raceTime;
-                    }
-                    else
-                    {
-                        realPosition = currentPosition - offset;
-                    }
-
-                    points = (maxPositions + 1) - realPosition;
-                    switch (realPosition)
-                    {
-                        case 1:
-                            points += 10;
-                            break;
-                        case 2:
-                            points += 5;
-                            break;
-                        case 3:
-                            points += 3;
-                            break;
+                        memmove(&rs_leaderboard.entries[i], &rs_leaderboard.entries[i+1], (rs_leaderboard.numEntries - i - 1) * sizeof(rs_leaderboardentry_t));
+                        rs_leaderboard.numEntries--;
+                        break;
                     }
+                }
+            }
 
-                    points = points > 0 ? points : 0;
+            if (rs_leaderboard.numEntries == rs_leaderboard.maxEntries)
+            {
+                rs_leaderboard.maxEntries = rs_leaderboard.maxEntries * 2 + 16;
+                rs_leaderboard.entries = realloc(rs_leaderboard.entries, rs_leaderboard.maxEntries * sizeof(rs_leaderboardentry_t));
+            }
 
-                    if (playerId == raceData->player_id) {
+            i = RS_LeaderboardSearch(rs_leaderboard.entries, rs_leaderboard.numEntries, raceData->race_time, qfalse);
+            memmove(&rs_leaderboard.entries[i+1], &rs_leaderboard.entries[i], (rs_leaderboard.numEntries - i) * sizeof(rs_leaderboardentry_t));
+            rs_leaderboard.entries[i] = newEntry;
+            rs_leaderboard.numEntries++;
 
-                        newPoints = points;
-                        newPosition = realPosition;
-                    }
+            if (rs_maxPointChanges < rs_leaderboard.numEntries)
+            {
+                rs_maxPointChanges = rs_leaderboard.maxEntries;
+                rs_pointChanges = realloc(rs_pointChanges, rs_maxPointChanges * sizeof(rs_pointchange_t));
+            }
+            numChanges = RS_LeaderboardComputePoints(&rs_leaderboard, rs_pointChanges);
+            newPoints = rs_leaderboard.entries[i].points;
+            pthread_mutex_unlock(&rs_leaderboard.mutex);
 
-                    lastRaceTime = raceTime;
+            // update points in player_map, only for players whose points have changed
+            for (i = 0; i < numChanges; i++)
+            {
+                rs_pointchange_t *change = &rs_pointChanges[i];
+
+                // queue the points in player_map and the player for global point re-computation
+                if ( !RS_MysqlQueueMapPoints( raceData->map_id, change->player_id, change->points, pointCases, affectedPlayerIds ) )
+                    goto error;
+
+				// notify the user! about his lost points
+				diffPoints = change->oldPoints - change->points;
+				if (rs_mqttEnabled->integer && diffPoints > 0) {
+
+					stmt = RS_MysqlExecute(rs_queryGetUserIdByPlayerId, change->player_id);
+					RS_CheckMysqlThreadError(stmt);
+					if (RS_MysqlFetch(stmt))
+					{
+						if (!RS_MysqlIsNull(stmt, 0))
+						{
+							unsigned int userId;
+							userId = RS_MysqlGetInt(stmt, 0);
+							RS_MysqlFreeResult(stmt);
+
+							// the name of the racer only needs to be read once
+							if (!simplified[0])
+							{
+								stmt = RS_MysqlExecute(rs_queryGetPlayerSimplified, raceData->player_id);
+								RS_CheckMysqlThreadError(stmt);
+								if (RS_MysqlFetch(stmt) && !RS_MysqlIsNull(stmt, 0))
+									Q_strncpyz(simplified, RS_MysqlGetString(stmt, 0), sizeof(simplified));
+							}
 
-                    //only update points for players whose points have changed
-                    if ( oldpoints != points )
-                    {
-                        // set points in player_map
-                        sprintf(query, rs_queryUpdatePlayerMapPoints->string, points, raceData->map_id, playerId);
-                        mysql_real_query(&mysql, query, strlen(query));
-                        RS_CheckMysqlThreadError(query);
-
-                        //select the player for global point re-computation
-                        if ( Q_stricmp( affectedPlayerIds, "" ) )
-                            Q_strncatz( affectedPlayerIds, ",", sizeof(affectedPlayerIds));
-
-                        Q_strncatz( affectedPlayerIds, row[0], sizeof(affectedPlayerIds));
-						
-						// notify the user! about his lost points
-						diffPoints = oldpoints - points;
-						if (rs_mqttEnabled->integer && diffPoints > 0) {
-	
-							sprintf(query, rs_queryGetUserIdByPlayerId->string, playerId);
-							mysql_real_query(&mysql, query, strlen(query));
-							RS_CheckMysqlThreadError(query);
-							mysql_res = mysql_store_result(&mysql);
-							if ((row = mysql_fetch_row(mysql_res)) != NULL)
+							if (simplified[0])
 							{
-								if (row[0] != NULL)
-								{
-									unsigned int userId;
-									userId = atoi(row[0]);
-									
-									sprintf(query, rs_queryGetPlayerSimplified->string, raceData->player_id);
-									mysql_real_query(&mysql, query, strlen(query));
-									RS_CheckMysqlThreadError(query);
-									mysql_res = mysql_store_result(&mysql);
-									if ((row = mysql_fetch_row(mysql_res)) != NULL)
-									{
-										if (row[0] != NULL)
-										{
-										#ifdef MOSQUITTO
-											rc = mosquitto_connect(mosq, rs_mqttHost->string, rs_mqttPort->integer, 0, true);
-											if(!rc){
-											
-												sprintf(publish_topic, "user_%d", userId);
-												sprintf(publish_message, "<?xml version=\"1.0\"?><record><player><![CDATA[%s]]></player><map><![CDATA[%s]]></map><time><![CDATA[%d]]></time><oldpoints><![CDATA[%d]]></oldpoints><newpoints><![CDATA[%d]]></newpoints></record>", row[0], level.mapname, raceData->race_time, oldpoints, points);
-												rc =  mosquitto_publish(mosq, &mid_sent, publish_topic, strlen(publish_message), (uint8_t *)publish_message, qos, retain);
-											}
-
-											mosquitto_disconnect(mosq);
-										#endif
-										}
-									}
-								}
+							#ifdef MOSQUITTO
+								char publish_topic[32], publish_message[1024];
+
+								// only queued here, the publisher thread sends it
+								Q_snprintfz(publish_topic, sizeof(publish_topic), "user_%d", userId);
+								Q_snprintfz(publish_message, sizeof(publish_message), "<?xml version=\"1.0\"?><record><player><![CDATA[%s]]></player><map><![CDATA[%s]]></map><time><![CDATA[%d]]></time><oldpoints><![CDATA[%d]]></oldpoints><newpoints><![CDATA[%d]]></newpoints></record>", simplified, level.mapname, raceData->race_time, change->oldPoints, change->points);
+								RS_MqttPublish(publish_topic, publish_message);
+							#endif
 							}
 						}
-                    }
-                }
+					}
+					RS_MysqlFreeResult(stmt);
+				}
             }
 
-            mysql_free_result(mysql_res);
-            RS_CheckMysqlThreadError(query);
+            // write what's left of the changed points
+            if ( !RS_MysqlUpdateMapPoints( raceData->map_id, pointCases, affectedPlayerIds ) )
+                goto error;
+        }
+
+        if (!RS_MysqlCommit())
+            goto error;
 
-            // update points for affected players
-            if ( Q_stricmp( affectedPlayerIds, "" ) )
+        // the leaderboard matches the database again
+        pthread_mutex_lock(&rs_leaderboard.mutex);
+        if (rs_leaderboard.generation == generation)
+            rs_leaderboard.loaded = qtrue;
+        pthread_mutex_unlock(&rs_leaderboard.mutex);
+
+        //get the global number of points
+        stmt = RS_MysqlExecute(rs_queryGetPlayerPoints, raceData->player_id);
+        RS_CheckMysqlThreadError(stmt);
+        if (RS_MysqlFetch(stmt))
+        {
+            if (!RS_MysqlIsNull(stmt, 0))
             {
-                sprintf(query, rs_queryUpdatePlayerPoints->string, affectedPlayerIds);
-                mysql_real_query(&mysql, query, strlen(query));
-                RS_CheckMysqlThreadError(query);
+                allPoints = RS_MysqlGetInt(stmt, 0);
             }
         }
 
-        //get the global number of points
-        sprintf(query, rs_queryGetPlayerPoints->string, raceData->player_id);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
-        RS_CheckMysqlThreadError(query);
-        if ((row = mysql_fetch_row(mysql_res)) != NULL)
-        {
-            if (row[0] !=NULL)
-            {
-                allPoints = atoi(row[0]);
-            }
-        }
+		RS_MysqlFreeResult(stmt);
+
+        RS_PushCallbackQueue(RACESOW_CALLBACK_RACE, raceData->playerNum, allPoints, oldPoints, newPoints, oldTime, oldBestTime, raceData->race_time);
+    }
+
+    RS_FreeRaceData(raceData);
+    return qtrue;
+
+error:
+    RS_FreeRaceData(raceData);
+    return qfalse;
+}
+
+/**
+ * Release the data of a player appear or nick job
+ *
+ * @param void *in playerDataStruct
+ * @return void
+ */
+static void RS_FreePlayerData( void *in )
+{
+	struct playerDataStruct *playerData = (struct playerDataStruct *)in;
+
+	free( playerData->name );
+	free( playerData->authName );
+	free( playerData->authPass );
+	free( playerData->authToken );
+	free( playerData );
+}
 
-		mysql_free_result(mysql_res);
+/**
+ * Job key of a nickname, the same for all the ways the database
+ * matches it when looking up the player
+ *
+ * @param const char *name
+ * @return unsigned int never 0
+ */
+static unsigned int RS_MysqlNickKey( const char *name )
+{
+	const char *p;
+	unsigned int key = 0;
 
-        RS_PushCallbackQueue(RACESOW_CALLBACK_RACE, raceData->playerNum, allPoints, oldPoints, newPoints, oldTime, oldBestTime, raceData->race_time);
-    }
+	for( p = COM_RemoveColorTokens( name ); *p; p++ )
+		key = key * 31 + tolower( (unsigned char)*p );
 
-    free(raceData->checkpoints);
-	free(raceData);
-	RS_EndMysqlThread();
-    return NULL;
+	return key ? key : 1;
 }
 
 /**
@@ -1094,8 +3363,6 @@ void *RS_MysqlInsertRace_Thread(void *in)
  */
 qboolean RS_MysqlPlayerAppear( char *name, int playerNum, int player_id, int map_id, int is_authed, char *authName, char *authPass, char *authToken )
 {
-	pthread_t thread;
-	int returnCode;
 	struct playerDataStruct *playerData=malloc(sizeof(struct playerDataStruct));
 
     playerData->name = strdup(name);
@@ -1106,10 +3373,10 @@ qboolean RS_MysqlPlayerAppear( char *name, int playerNum, int player_id, int map
     playerData->authPass = strdup(authPass);
     playerData->authToken = strdup(authToken);
 
-	returnCode = pthread_create(&thread, &threadAttr, RS_MysqlPlayerAppear_Thread, (void *)playerData);
-	if (returnCode) {
-
-		G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+	// jobs of the same nick are serialized, or two of them could both add the player
+	if( !RS_PushMysqlJobKey( RS_MysqlPlayerAppear_Thread, (void *)playerData, qfalse, RS_MysqlNickKey( name ) ) )
+	{
+		RS_FreePlayerData( playerData );
 		return qfalse;
 	}
 
@@ -1124,11 +3391,10 @@ qboolean RS_MysqlPlayerAppear( char *name, int playerNum, int player_id, int map
  * if he's not authed, his player_id will jump to another player_id
  *
  * @param void *in
- * @return void
+ * @return qboolean qfalse on errors
  */
-void *RS_MysqlPlayerAppear_Thread(void *in)
+qboolean RS_MysqlPlayerAppear_Thread(void *in)
 {
-    char query[MYSQL_QUERY_LENGTH];
 	char name[64];
 	char simplified[64];
 	char authName[64];
@@ -1136,16 +3402,13 @@ void *RS_MysqlPlayerAppear_Thread(void *in)
 	char authToken[64];
 	char checkpoints[MAX_STRING_CHARS];
 	//char sessionToken[64];
-	MYSQL_ROW  row;
-    MYSQL_RES  *mysql_res;
+	rs_mysqlstmt_t *stmt;
 	unsigned int player_id, auth_mask, player_id_for_nick, auth_mask_for_nick, personalBest, player_id_for_time, overall_tries;
-	int size;
 	struct playerDataStruct *playerData;
 	//edict_t *ent;
 
 	RS_StartMysqlThread();
 	checkpoints[0]='\0';
-	size = 0;
 	player_id = 0;
 	auth_mask = 0;
 	player_id_for_nick = 0;
@@ -1166,31 +3429,21 @@ void *RS_MysqlPlayerAppear_Thread(void *in)
     }
 	*/
 
-    // escape strings
     Q_strncpyz ( simplified, COM_RemoveColorTokens(playerData->name), sizeof(simplified) );
-    RS_EscapeString(simplified);
-
 	Q_strncpyz ( name, playerData->name, sizeof(name) );
-	RS_EscapeString(name);
-
     Q_strncpyz ( authName, playerData->authName, sizeof(authName) );
-	RS_EscapeString(authName);
-
     Q_strncpyz ( authPass, playerData->authPass, sizeof(authPass) );
-	RS_EscapeString(authPass);
-
     Q_strncpyz ( authToken, playerData->authToken, sizeof(authToken) );
-	RS_EscapeString(authToken);
 
 	/*
     // try to authenticate by session
     if (Q_stricmp( sessionToken, "" ))
     {
         sprintf(query, rs_queryGetPlayerAuthBySession->string, sessionToken);
-        mysql_real_query(&mysql, query, strlen(query));
+        mysql_real_query(RS_MysqlHandle(), query, strlen(query));
 
         RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
+        mysql_res = mysql_store_result(RS_MysqlHandle());
         RS_CheckMysqlThreadError(query);
         if ((row = mysql_fetch_row(mysql_res)) != NULL)
         {
@@ -1208,48 +3461,40 @@ void *RS_MysqlPlayerAppear_Thread(void *in)
     // try to authenticate by token
     if (player_id == 0 && Q_stricmp( authToken, "" ))
     {
-        sprintf(query, rs_queryGetPlayerAuthByToken->string, authToken, rs_tokenSalt->string);
-        mysql_real_query(&mysql, query, strlen(query));
-
-        RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
-        RS_CheckMysqlThreadError(query);
-        if ((row = mysql_fetch_row(mysql_res)) != NULL)
+        stmt = RS_MysqlExecute(rs_queryGetPlayerAuthByToken, authToken, rs_tokenSalt->string);
+        RS_CheckMysqlThreadError(stmt);
+        if (RS_MysqlFetch(stmt))
         {
-            if (row[0]!=NULL && row[1]!=NULL )
+            if (!RS_MysqlIsNull(stmt, 0) && !RS_MysqlIsNull(stmt, 1))
             {
-                player_id = atoi(row[0]);
-                auth_mask = atoi(row[1]);
+                player_id = RS_MysqlGetInt(stmt, 0);
+                auth_mask = RS_MysqlGetInt(stmt, 1);
             }
         }
 
-        mysql_free_result(mysql_res);
+        RS_MysqlFreeResult(stmt);
     }
 
     // when no token is given or was invalid, try by username and password
     if (player_id == 0 && Q_stricmp( authName, "" ) && Q_stricmp( authPass, "" ))
     {
-        sprintf(query, rs_queryGetPlayerAuth->string, authName, authPass, rs_tokenSalt->string);
-
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
-        RS_CheckMysqlThreadError(query);
-        if ((row = mysql_fetch_row(mysql_res)) != NULL)
+        stmt = RS_MysqlExecute(rs_queryGetPlayerAuth, authName, authPass, rs_tokenSalt->string);
+        RS_CheckMysqlThreadError(stmt);
+        if (RS_MysqlFetch(stmt))
         {
-            if (row[0]!=NULL && row[1]!=NULL) // token may be null
+            if (!RS_MysqlIsNull(stmt, 0) && !RS_MysqlIsNull(stmt, 1)) // token may be null
             {
-                player_id = atoi(row[0]);
-                auth_mask = atoi(row[1]);
+                player_id = RS_MysqlGetInt(stmt, 0);
+                auth_mask = RS_MysqlGetInt(stmt, 1);
 
-                if (row[2] != NULL)
+                if (!RS_MysqlIsNull(stmt, 2))
                 {
-                    Q_strncpyz(authToken, row[2], sizeof(authToken));
+                    Q_strncpyz(authToken, RS_MysqlGetString(stmt, 2), sizeof(authToken));
             }
         }
         }
 
-        mysql_free_result(mysql_res);
+        RS_MysqlFreeResult(stmt);
     }
 
 	/*
@@ -1266,32 +3511,28 @@ void *RS_MysqlPlayerAppear_Thread(void *in)
 	*/
 	
     // try to get information about the player the nickname belongs to
-    sprintf(query, rs_queryGetPlayer->string, simplified);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
-    mysql_res = mysql_store_result(&mysql);
-    RS_CheckMysqlThreadError(query);
-    if ((row = mysql_fetch_row(mysql_res)) != NULL)
-    {
-        if (row[0]!=NULL && row[1]!=NULL)
+    stmt = RS_MysqlExecute(rs_queryGetPlayer, simplified);
+    RS_CheckMysqlThreadError(stmt);
+    if (RS_MysqlFetch(stmt))
+    {
+        if (!RS_MysqlIsNull(stmt, 0) && !RS_MysqlIsNull(stmt, 1))
         {
-            player_id_for_nick = atoi(row[0]);
-            auth_mask_for_nick = atoi(row[1]);
+            player_id_for_nick = RS_MysqlGetInt(stmt, 0);
+            auth_mask_for_nick = RS_MysqlGetInt(stmt, 1);
         }
     }
 
-	mysql_free_result(mysql_res);
+	RS_MysqlFreeResult(stmt);
 
     // only add a new player if
 	// 1) noone has this nick already, and
 	// 2) the player isn't already authed (if he his, we keep using the nick associated to his auth)
     if ( player_id_for_nick == 0 && player_id == 0)
     {
-        sprintf(query, rs_queryAddPlayer->string, name, simplified);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
+        stmt = RS_MysqlExecute(rs_queryAddPlayer, name, simplified);
+        RS_CheckMysqlThreadError(stmt);
 
-        player_id_for_nick = (int)mysql_insert_id(&mysql);
+        player_id_for_nick = RS_MysqlInsertId(stmt);
     }
 
     if (player_id != 0)
@@ -1306,43 +3547,33 @@ void *RS_MysqlPlayerAppear_Thread(void *in)
 	if (rs_loadHighscores->integer)
 	{
 		// retrieve personal best
-		sprintf(query, rs_queryGetPlayerMapHighscore->string, playerData->map_id, player_id_for_time);
-		mysql_real_query(&mysql, query, strlen(query));
-		RS_CheckMysqlThreadError(query);
-		mysql_res = mysql_store_result(&mysql);
-		RS_CheckMysqlThreadError(query);
+		stmt = RS_MysqlExecute(rs_queryGetPlayerMapHighscore, playerData->map_id, player_id_for_time);
+		RS_CheckMysqlThreadError(stmt);
 
-		if ((row = mysql_fetch_row(mysql_res)) != NULL)
+		if (RS_MysqlFetch(stmt))
 		{
 
-			if (row[0]!=NULL && row[1] != NULL)
-				personalBest = atoi(row[1]);
-			if (row[2] != NULL)
-				overall_tries = atoi(row[2]);
+			if (!RS_MysqlIsNull(stmt, 0) && !RS_MysqlIsNull(stmt, 1))
+				personalBest = RS_MysqlGetInt(stmt, 1);
+			if (!RS_MysqlIsNull(stmt, 2))
+				overall_tries = RS_MysqlGetInt(stmt, 2);
 		}
 
-		mysql_free_result(mysql_res);
+		RS_MysqlFreeResult(stmt);
 	}
 
 	if ( rs_loadPlayerCheckpoints->integer )
 	{
 	    //get player checkpoints on this map
-	    sprintf(query, rs_queryGetPlayerMapCheckpoints->string, playerData->map_id, player_id_for_time);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
-        RS_CheckMysqlThreadError(query);
+	    stmt = RS_MysqlExecute(rs_queryGetPlayerMapCheckpoints, playerData->map_id, player_id_for_time);
+        RS_CheckMysqlThreadError(stmt);
 
-        while ( (row = mysql_fetch_row(mysql_res) ) != NULL )
+        while ( RS_MysqlFetch(stmt) )
         {
-            Q_strncatz( checkpoints, va("%s ",row[0]), sizeof( checkpoints ) );
+            Q_strncatz( checkpoints, va("%d ", RS_MysqlGetInt(stmt, 0)), sizeof( checkpoints ) );
         }
 
-		mysql_free_result(mysql_res);
-
-        size = strlen( checkpoints )+1;
-        players_query[playerData->playerNum] = malloc( size );
-        Q_strncpyz( players_query[playerData->playerNum], checkpoints, size);
+		RS_MysqlFreeResult(stmt);
 	}
 
 	/*
@@ -1364,16 +3595,16 @@ void *RS_MysqlPlayerAppear_Thread(void *in)
     }
 	*/
 	
-    RS_PushCallbackQueue(RACESOW_CALLBACK_APPEAR, playerData->playerNum, player_id, auth_mask, player_id_for_nick, auth_mask_for_nick, personalBest, overall_tries);
+    // the checkpoints (may be empty) are read by the script with RS_PrintQueryCallback
+    RS_PushStringCallback(checkpoints, RACESOW_CALLBACK_APPEAR, playerData->playerNum, player_id, auth_mask, player_id_for_nick, auth_mask_for_nick, personalBest, overall_tries);
 
-	free(playerData->name);
-	free(playerData->authName);
-	free(playerData->authPass);
-	free(playerData->authToken);
-	free(playerData);
-	RS_EndMysqlThread();
+	RS_FreePlayerData(playerData);
 
-    return NULL;
+    return qtrue;
+
+error:
+	RS_FreePlayerData(playerData);
+	return qfalse;
 }
 
 
@@ -1414,14 +3645,14 @@ char *RS_GenerateNewToken(int playerId)
         }
 
         sprintf(query, rs_queryGetPlayerAuthByToken->string, hex_output, rs_tokenSalt->string);
-        mysql_real_query(&mysql, query, strlen(query));
+        mysql_real_query(RS_MysqlHandle(), query, strlen(query));
         RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
+        mysql_res = mysql_store_result(RS_MysqlHandle());
         RS_CheckMysqlThreadError(query);
         if (mysql_fetch_row(mysql_res) == NULL)
         {
             sprintf(query, rs_querySetTokenForPlayer->string, hex_output, rs_tokenSalt->string, playerId);
-            mysql_real_query(&mysql, query, strlen(query));
+            mysql_real_query(RS_MysqlHandle(), query, strlen(query));
             RS_CheckMysqlThreadError(query);
 
             mysql_free_result(mysql_res);
@@ -1472,14 +3703,14 @@ char *RS_StartPlayerSession(int playerId)
         }
 
         sprintf(query, rs_queryGetPlayerAuthBySession->string, hex_output);
-        mysql_real_query(&mysql, query, strlen(query));
+        mysql_real_query(RS_MysqlHandle(), query, strlen(query));
         RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
+        mysql_res = mysql_store_result(RS_MysqlHandle());
         RS_CheckMysqlThreadError(query);
         if (mysql_fetch_row(mysql_res) == NULL)
         {
             sprintf(query, rs_querySetSessionForPlayer->string, hex_output, playerId);
-            mysql_real_query(&mysql, query, strlen(query));
+            mysql_real_query(RS_MysqlHandle(), query, strlen(query));
             RS_CheckMysqlThreadError(query);
 
             mysql_free_result(mysql_res);
@@ -1493,6 +3724,20 @@ char *RS_StartPlayerSession(int playerId)
 }
 */
 
+/**
+ * Release the data of a player disappear job
+ *
+ * @param void *in playtimeDataStruct
+ * @return void
+ */
+static void RS_FreePlaytimeData( void *in )
+{
+	struct playtimeDataStruct *playtimeData = (struct playtimeDataStruct *)in;
+
+	free( playtimeData->name );
+	free( playtimeData );
+}
+
 /**
  * Calls the player disappear thread
  *
@@ -1502,8 +3747,6 @@ char *RS_StartPlayerSession(int playerId)
  */
 qboolean RS_MysqlPlayerDisappear( char *name, int playtime, int overall_tries, int racing_time, int player_id, int nick_id, int map_id, int is_authed, int is_threaded)
 {
-	pthread_t thread;
-	int returnCode;
 	struct playtimeDataStruct *playtimeData=malloc(sizeof(struct playtimeDataStruct));
 
     // player disappeard while using a protected nickname
@@ -1528,10 +3771,9 @@ qboolean RS_MysqlPlayerDisappear( char *name, int playtime, int overall_tries, i
 		return qtrue;
 	}
 
-	returnCode = pthread_create(&thread, &threadAttr, RS_MysqlPlayerDisappear_Thread, (void *)playtimeData);
-	if (returnCode) {
-
-		G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+	if( !RS_PushMysqlJob( RS_MysqlPlayerDisappear_Thread, (void *)playtimeData, qfalse ) )
+	{
+		RS_FreePlaytimeData( playtimeData );
 		return qfalse;
 	}
 
@@ -1542,15 +3784,12 @@ qboolean RS_MysqlPlayerDisappear( char *name, int playtime, int overall_tries, i
  * Thread when player disappears
  *
  * @param void *in
- * @return void
+ * @return qboolean qfalse on errors
  */
-void *RS_MysqlPlayerDisappear_Thread(void *in)
+qboolean RS_MysqlPlayerDisappear_Thread(void *in)
 {
-    char query[MYSQL_QUERY_LENGTH];
-	char name[64];
-    char servername[255];
-	char simplified[64];
 	struct playtimeDataStruct *playtimeData;
+	rs_mysqlstmt_t *stmt;
 	int is_threaded;
 
 	playtimeData = (struct playtimeDataStruct*)in;
@@ -1562,48 +3801,39 @@ void *RS_MysqlPlayerDisappear_Thread(void *in)
 	else
 		pthread_mutex_lock(&mutexsum);
 
-    Q_strncpyz ( simplified, COM_RemoveColorTokens( playtimeData->name ), sizeof(simplified) );
-	RS_EscapeString(simplified);
-	Q_strncpyz ( name, playtimeData->name, sizeof(name) );
-	RS_EscapeString(name);
-
     // increment map playtime
-	sprintf(query, rs_queryUpdateMapPlaytime->string, playtimeData->playtime, playtimeData->map_id);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
+	stmt = RS_MysqlExecute(rs_queryUpdateMapPlaytime, playtimeData->playtime, playtimeData->map_id);
+    RS_CheckMysqlThreadError(stmt);
 
     // increment player playtime
-    sprintf(query, rs_queryUpdatePlayerPlaytime->string, playtimeData->playtime, playtimeData->player_id);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
+    stmt = RS_MysqlExecute(rs_queryUpdatePlayerPlaytime, playtimeData->playtime, playtimeData->player_id);
+    RS_CheckMysqlThreadError(stmt);
 
     // update player map info
-    sprintf(query, rs_queryUpdatePlayerMapInfo->string, playtimeData->player_id, playtimeData->map_id, playtimeData->playtime, playtimeData->overall_tries, playtimeData->racing_time);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
+    stmt = RS_MysqlExecute(rs_queryUpdatePlayerMapInfo, playtimeData->player_id, playtimeData->map_id, playtimeData->playtime, playtimeData->overall_tries, playtimeData->racing_time);
+    RS_CheckMysqlThreadError(stmt);
 
     // update the players's number of played maps
-    sprintf(query, rs_queryUpdatePlayerMaps->string,  playtimeData->player_id);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
+    stmt = RS_MysqlExecute(rs_queryUpdatePlayerMaps, playtimeData->player_id);
+    RS_CheckMysqlThreadError(stmt);
 
     // update the server's number of played maps and playtime and the hostname
-    Q_strncpyz ( servername, sv_hostname->string, sizeof(servername) );
-	RS_EscapeString(servername);
-    sprintf(query, rs_queryUpdateServerData->string, servername, playtimeData->playtime, sv_port->integer);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
+    stmt = RS_MysqlExecute(rs_queryUpdateServerData, sv_hostname->string, playtimeData->playtime, sv_port->integer);
+    RS_CheckMysqlThreadError(stmt);
 
-	free(playtimeData->name);
-	free(playtimeData);
+	RS_FreePlaytimeData(playtimeData);
 
-	if (is_threaded)
-		RS_EndMysqlThread();
-	else
+	if (!is_threaded)
 		pthread_mutex_unlock(&mutexsum);
 
 
-    return NULL;
+    return qtrue;
+
+error:
+	RS_FreePlaytimeData(playtimeData);
+	if (!is_threaded)
+		pthread_mutex_unlock(&mutexsum);
+	return qfalse;
 }
 
 /**
@@ -1615,19 +3845,15 @@ void *RS_MysqlPlayerDisappear_Thread(void *in)
  */
 qboolean RS_GetPlayerNick( int playerNum, int player_id )
 {
-    pthread_t thread;
-    int returnCode;
 	struct playerDataStruct *playerData=malloc(sizeof(struct playerDataStruct));
 
-	playerData->name = NULL;
+	memset( playerData, 0, sizeof( *playerData ) );
 	playerData->playerNum = playerNum;
 	playerData->player_id = player_id;
 
-    returnCode = pthread_create(&thread, &threadAttr, RS_GetPlayerNick_Thread, (void *)playerData);
-
-    if (returnCode) {
-
-        G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+    if( !RS_PushMysqlJob( RS_GetPlayerNick_Thread, (void *)playerData, qfalse ) )
+    {
+        RS_FreePlayerData( playerData );
         return qfalse;
     }
 
@@ -1638,48 +3864,36 @@ qboolean RS_GetPlayerNick( int playerNum, int player_id )
  * Thread that calls the database and returns the player current protected nick
  *
  * @param in Input data (int player_id)
- * @return NULL on success
+ * @return qboolean qfalse on errors
  */
-void *RS_GetPlayerNick_Thread( void *in )
+qboolean RS_GetPlayerNick_Thread( void *in )
 {
 	struct playerDataStruct *playerData;
     char name[MAX_STRING_CHARS];
-	int size;
-	MYSQL_ROW  row;
-    MYSQL_RES  *mysql_res;
-	char query[MYSQL_QUERY_LENGTH];
+	rs_mysqlstmt_t *stmt;
 
 	RS_StartMysqlThread();
 	playerData = (struct playerDataStruct*)in;
+	name[0] = '\0';
 
-	sprintf(query, rs_queryGetPlayerNick->string, playerData->player_id);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_MysqlError();
-    mysql_res = mysql_store_result(&mysql);
-    RS_MysqlError();
+	stmt = RS_MysqlExecute(rs_queryGetPlayerNick, playerData->player_id);
 
-	if ((row = mysql_fetch_row(mysql_res)) != NULL)
+	if (RS_MysqlFetch(stmt))
     {
-        if (row[0] !=NULL)
+        if (!RS_MysqlIsNull(stmt, 0))
 		{
-			Q_strncpyz(name, row[0], sizeof(name));
+			Q_strncpyz(name, RS_MysqlGetString(stmt, 0), sizeof(name));
 		}
 
     }
 
-	mysql_free_result(mysql_res);
+	RS_MysqlFreeResult(stmt);
 
-	size = strlen( name )+1;
-    players_query[playerData->playerNum] = malloc( size );
-    Q_strncpyz( players_query[playerData->playerNum], name, size);
-    RS_PushCallbackQueue(RACESOW_CALLBACK_PLAYERNICK, playerData->playerNum, 1, 0, 0, 0, 0, 0);
+	RS_PushStringCallback(name, RACESOW_CALLBACK_PLAYERNICK, playerData->playerNum, 1, 0, 0, 0, 0, 0);
 
-	free(playerData->name);
-	free(playerData);
+	RS_FreePlayerData(playerData);
 
-	RS_EndMysqlThread();
-
-    return NULL;
+    return qtrue;
 }
 
 /**
@@ -1692,19 +3906,16 @@ void *RS_GetPlayerNick_Thread( void *in )
  */
 qboolean RS_UpdatePlayerNick( char *name, int playerNum, int player_id )
 {
-    pthread_t thread;
-    int returnCode;
 	struct playerDataStruct *playerData=malloc(sizeof(struct playerDataStruct));
 
+	memset( playerData, 0, sizeof( *playerData ) );
     playerData->name = strdup(name);
 	playerData->playerNum = playerNum;
 	playerData->player_id = player_id;
 
-    returnCode = pthread_create(&thread, &threadAttr, RS_UpdatePlayerNick_Thread, (void *)playerData);
-
-    if (returnCode) {
-
-        G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+    if( !RS_PushMysqlJob( RS_UpdatePlayerNick_Thread, (void *)playerData, qtrue ) )
+    {
+        RS_FreePlayerData( playerData );
         return qfalse;
     }
 
@@ -1715,17 +3926,14 @@ qboolean RS_UpdatePlayerNick( char *name, int playerNum, int player_id )
  * Thread that updates the database with the player new protected nick
  *
  * @param in Input data
- * @return NULL on success
+ * @return qboolean qfalse on errors
  */
-void *RS_UpdatePlayerNick_Thread( void *in )
+qboolean RS_UpdatePlayerNick_Thread( void *in )
 {
 	struct playerDataStruct *playerData;
-	char query[MYSQL_QUERY_LENGTH];
 	char name[64];
 	char simplified[64];
-	MYSQL_ROW  row;
-    MYSQL_RES  *mysql_res;
-	int size;
+	rs_mysqlstmt_t *stmt;
 	unsigned int player_id_for_nick, auth_mask_for_nick;
 
 	RS_StartMysqlThread();
@@ -1735,79 +3943,72 @@ void *RS_UpdatePlayerNick_Thread( void *in )
 	auth_mask_for_nick = 0;
 
 	Q_strncpyz ( simplified, COM_RemoveColorTokens(playerData->name), sizeof(simplified) );
-	RS_EscapeString(simplified);
-
 	Q_strncpyz ( name, playerData->name, sizeof(name) );
-	RS_EscapeString(name);
 
 	// test if the wanted nick is protected
-	sprintf(query, rs_queryGetPlayer->string, simplified);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
-    mysql_res = mysql_store_result(&mysql);
-    RS_CheckMysqlThreadError(query);
-    if ((row = mysql_fetch_row(mysql_res)) != NULL)
-    {
-        if (row[0]!=NULL && row[1]!=NULL)
+	stmt = RS_MysqlExecute(rs_queryGetPlayer, simplified);
+    RS_CheckMysqlThreadError(stmt);
+    if (RS_MysqlFetch(stmt))
+    {
+        if (!RS_MysqlIsNull(stmt, 0) && !RS_MysqlIsNull(stmt, 1))
         {
-            player_id_for_nick = atoi(row[0]);
-            auth_mask_for_nick = atoi(row[1]);
+            player_id_for_nick = RS_MysqlGetInt(stmt, 0);
+            auth_mask_for_nick = RS_MysqlGetInt(stmt, 1);
         }
     }
 
-	mysql_free_result(mysql_res);
+	RS_MysqlFreeResult(stmt);
 
 	// if it's already protected, stop
 	if (auth_mask_for_nick > 0 && player_id_for_nick != playerData->player_id )
 	{
-		size = strlen( name )+1;
-		players_query[playerData->playerNum] = malloc( size );
-		Q_strncpyz( players_query[playerData->playerNum], name, size);
-		RS_PushCallbackQueue(RACESOW_CALLBACK_PLAYERNICK, playerData->playerNum, 0, 0, 0, 0, 0, 0);
+		RS_PushStringCallback(name, RACESOW_CALLBACK_PLAYERNICK, playerData->playerNum, 0, 0, 0, 0, 0, 0);
 
-		free(playerData->name);
-		free(playerData);
-		RS_EndMysqlThread();
-		return NULL;
+		RS_FreePlayerData(playerData);
+		return qtrue;
 	}
 
 
 	// update nick
-	sprintf(query, rs_queryUpdatePlayerNick->string, name, simplified, playerData->player_id);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
+	stmt = RS_MysqlExecute(rs_queryUpdatePlayerNick, name, simplified, playerData->player_id);
+    RS_CheckMysqlThreadError(stmt);
 
 	// return confirmation of the new nick to the player
-	size = strlen( name )+1;
-    players_query[playerData->playerNum] = malloc( size );
-    Q_strncpyz( players_query[playerData->playerNum], name, size);
-    RS_PushCallbackQueue(RACESOW_CALLBACK_PLAYERNICK, playerData->playerNum, 2, 0, 0, 0, 0, 0);
+	RS_PushStringCallback(name, RACESOW_CALLBACK_PLAYERNICK, playerData->playerNum, 2, 0, 0, 0, 0, 0);
 
-	free(playerData->name);
- 	free(playerData);
+	RS_FreePlayerData(playerData);
 
-	RS_EndMysqlThread();
+    return qtrue;
 
-    return NULL;
+error:
+	RS_FreePlayerData(playerData);
+	return qfalse;
 }
 
 /**
  * RS_UpdateMapList function registered in AS API
  *
- * This function just creates a thread that actually does the job
+ * This function just creates a thread that actually does the job,
+ * it doesn't use the database so it doesn't take a MySQL worker
  * @param int playerNum the player making the request
  */
 qboolean RS_UpdateMapList(int playerNum)
 {
     pthread_t thread;
+    pthread_attr_t attr;
     int returnCode;
     int* player = malloc(sizeof(int));
     *player = playerNum;
-    returnCode = pthread_create(&thread, &threadAttr, RS_UpdateMapList_Thread, (void *)player);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    returnCode = pthread_create(&thread, &attr, RS_UpdateMapList_Thread, (void *)player);
+    pthread_attr_destroy(&attr);
 
     if (returnCode) {
 
            G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+           free( player );
            return qfalse;
        }
 
@@ -1823,9 +4024,374 @@ qboolean RS_UpdateMapList(int playerNum)
 void *RS_UpdateMapList_Thread(void* in)
 {
     trap_ML_Update();
+    free(in);
     return NULL;
 }
 
+/**
+ * Map catalogue
+ *
+ * Built once by RS_LoadMaplist from the maps that passed RS_MapValidate, so
+ * every entry is known to exist. Names are interned in one string pool next
+ * to their lowercase form, a hash answers name lookups and a trigram index
+ * over the lowercase names narrows substring filters down to a candidate
+ * list. Workers read it under the mutex, only RS_LoadMaplist replaces it.
+ */
+#define RS_MAPCATALOGUE_TRIGRAMS 16384
+
+typedef struct
+{
+	size_t name;			// offset of the name in the pool
+	size_t lower;			// offset of the lowercase name in the pool
+} rs_mapentry_t;
+
+typedef struct
+{
+	char *pool;
+	size_t poolLength;
+	size_t poolSize;
+	rs_mapentry_t *maps;
+	int numMaps;
+	int maxMaps;
+	int *nameHash;			// map index + 1, 0 for an empty slot
+	int nameHashSize;
+	int *trigramStart;		// RS_MAPCATALOGUE_TRIGRAMS + 1 offsets into trigramMaps
+	int *trigramMaps;		// ascending map indexes per trigram
+} rs_mapcatalogue_t;
+
+static pthread_mutex_t rs_mapCatalogueMutex = PTHREAD_MUTEX_INITIALIZER;
+static rs_mapcatalogue_t rs_mapCatalogue;
+
+#define RS_MapCatalogueName( cat, num ) ( (cat)->pool + (cat)->maps[num].name )
+#define RS_MapCatalogueLower( cat, num ) ( (cat)->pool + (cat)->maps[num].lower )
+
+/**
+ * Case insensitive hash of a map name
+ *
+ * @return unsigned int
+ */
+static unsigned int RS_MapNameHash( const char *name )
+{
+	unsigned int hash = 2166136261u;
+
+	while( *name )
+	{
+		hash ^= (unsigned char)tolower( *name++ );
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+ * Trigram bucket of the three lowercase characters at s
+ *
+ * @return unsigned int
+ */
+static unsigned int RS_MapTrigram( const char *s )
+{
+	return ( ( (unsigned char)s[0] * 961u ) + ( (unsigned char)s[1] * 31u ) + (unsigned char)s[2] ) & ( RS_MAPCATALOGUE_TRIGRAMS - 1 );
+}
+
+/**
+ * Release everything the catalogue holds
+ *
+ * @return void
+ */
+static void RS_MapCatalogueFree( rs_mapcatalogue_t *cat )
+{
+	if( cat->pool )
+		free( cat->pool );
+	if( cat->maps )
+		free( cat->maps );
+	if( cat->nameHash )
+		free( cat->nameHash );
+	if( cat->trigramStart )
+		free( cat->trigramStart );
+	if( cat->trigramMaps )
+		free( cat->trigramMaps );
+	memset( cat, 0, sizeof( *cat ) );
+}
+
+/**
+ * Index of a map in the catalogue
+ *
+ * @param cat catalogue to search
+ * @param mapname case insensitive map name
+ * @return int map index or -1
+ */
+static int RS_MapCatalogueFind( const rs_mapcatalogue_t *cat, const char *mapname )
+{
+	unsigned int slot;
+
+	if( !cat->nameHashSize )
+		return -1;
+
+	slot = RS_MapNameHash( mapname ) & ( cat->nameHashSize - 1 );
+	while( cat->nameHash[slot] )
+	{
+		if( !Q_stricmp( RS_MapCatalogueName( cat, cat->nameHash[slot] - 1 ), mapname ) )
+			return cat->nameHash[slot] - 1;
+		slot = ( slot + 1 ) & ( cat->nameHashSize - 1 );
+	}
+
+	return -1;
+}
+
+/**
+ * Grow the name hash so it stays at most half full
+ *
+ * @param cat catalogue being built
+ * @return void
+ */
+static void RS_MapCatalogueGrowHash( rs_mapcatalogue_t *cat )
+{
+	unsigned int slot;
+	int i;
+
+	if( ( cat->numMaps + 1 ) * 2 <= cat->nameHashSize )
+		return;
+
+	if( cat->nameHash )
+		free( cat->nameHash );
+	cat->nameHashSize = cat->nameHashSize ? cat->nameHashSize * 2 : 512;
+	cat->nameHash = calloc( cat->nameHashSize, sizeof( *cat->nameHash ) );
+
+	for( i = 0; i < cat->numMaps; i++ )
+	{
+		slot = RS_MapNameHash( RS_MapCatalogueName( cat, i ) ) & ( cat->nameHashSize - 1 );
+		while( cat->nameHash[slot] )
+			slot = ( slot + 1 ) & ( cat->nameHashSize - 1 );
+		cat->nameHash[slot] = i + 1;
+	}
+}
+
+/**
+ * Append a map to a catalogue being built, duplicates are dropped
+ *
+ * @param cat catalogue being built
+ * @param mapname map name, already validated
+ * @return void
+ */
+static void RS_MapCatalogueAdd( rs_mapcatalogue_t *cat, const char *mapname )
+{
+	size_t length = strlen( mapname ) + 1;
+	rs_mapentry_t *entry;
+	unsigned int slot;
+
+	if( RS_MapCatalogueFind( cat, mapname ) >= 0 )
+		return;
+
+	RS_MapCatalogueGrowHash( cat );
+
+	if( cat->numMaps == cat->maxMaps )
+	{
+		cat->maxMaps = cat->maxMaps ? cat->maxMaps * 2 : 256;
+		cat->maps = realloc( cat->maps, cat->maxMaps * sizeof( *cat->maps ) );
+	}
+
+	while( cat->poolLength + length * 2 > cat->poolSize )
+	{
+		cat->poolSize = cat->poolSize ? cat->poolSize * 2 : 8192;
+		cat->pool = realloc( cat->pool, cat->poolSize );
+	}
+
+	entry = &cat->maps[cat->numMaps];
+	entry->name = cat->poolLength;
+	memcpy( cat->pool + entry->name, mapname, length );
+	entry->lower = entry->name + length;
+	memcpy( cat->pool + entry->lower, mapname, length );
+	Q_strlwr( cat->pool + entry->lower );
+	cat->poolLength += length * 2;
+
+	slot = RS_MapNameHash( mapname ) & ( cat->nameHashSize - 1 );
+	while( cat->nameHash[slot] )
+		slot = ( slot + 1 ) & ( cat->nameHashSize - 1 );
+	cat->nameHash[slot] = ++cat->numMaps;
+}
+
+/**
+ * Build the trigram index once all maps are in
+ *
+ * Counts the distinct trigrams of every name first, then fills the lists in
+ * map order, so each list ends up sorted and free of duplicates.
+ *
+ * @param cat catalogue being built
+ * @return void
+ */
+static void RS_MapCatalogueIndex( rs_mapcatalogue_t *cat )
+{
+	int *last, *fill;
+	const char *s;
+	unsigned int t;
+	int i, pass;
+
+	cat->trigramStart = calloc( RS_MAPCATALOGUE_TRIGRAMS + 1, sizeof( int ) );
+	last = malloc( RS_MAPCATALOGUE_TRIGRAMS * sizeof( int ) );
+	fill = NULL;
+
+	for( pass = 0; pass < 2; pass++ )
+	{
+		for( t = 0; t < RS_MAPCATALOGUE_TRIGRAMS; t++ )
+			last[t] = -1;
+
+		for( i = 0; i < cat->numMaps; i++ )
+		{
+			for( s = RS_MapCatalogueLower( cat, i ); s[0] && s[1] && s[2]; s++ )
+			{
+				t = RS_MapTrigram( s );
+				if( last[t] == i )
+					continue;
+				last[t] = i;
+
+				if( pass == 0 )
+					cat->trigramStart[t + 1]++;
+				else
+					cat->trigramMaps[fill[t]++] = i;
+			}
+		}
+
+		if( pass == 0 )
+		{
+			for( t = 0; t < RS_MAPCATALOGUE_TRIGRAMS; t++ )
+				cat->trigramStart[t + 1] += cat->trigramStart[t];
+			cat->trigramMaps = malloc( ( cat->trigramStart[RS_MAPCATALOGUE_TRIGRAMS] + 1 ) * sizeof( int ) );
+
+			// fill from a copy of the offsets
+			fill = malloc( RS_MAPCATALOGUE_TRIGRAMS * sizeof( int ) );
+			memcpy( fill, cat->trigramStart, RS_MAPCATALOGUE_TRIGRAMS * sizeof( int ) );
+		}
+	}
+
+	free( fill );
+	free( last );
+}
+
+/**
+ * Candidate maps for a lowercase substring filter
+ *
+ * Picks the shortest trigram list of the filter, every match is in it. Filters
+ * shorter than a trigram get no list and must scan all maps.
+ *
+ * @param cat catalogue to search
+ * @param filter lowercase filter
+ * @param candidates receives the list, or NULL for all maps
+ * @return int number of candidates
+ */
+static int RS_MapCatalogueCandidates( const rs_mapcatalogue_t *cat, const char *filter, const int **candidates )
+{
+	int best = cat->numMaps, count;
+	unsigned int t;
+	const char *s;
+
+	*candidates = NULL;
+	if( !cat->trigramStart )
+		return 0;
+
+	for( s = filter; s[0] && s[1] && s[2]; s++ )
+	{
+		t = RS_MapTrigram( s );
+		count = cat->trigramStart[t + 1] - cat->trigramStart[t];
+		if( !*candidates || count < best )
+		{
+			*candidates = cat->trigramMaps + cat->trigramStart[t];
+			best = count;
+		}
+	}
+
+	return best;
+}
+
+/**
+ * Drop the catalogue
+ *
+ * @return void
+ */
+static void RS_FreeMaplist( void )
+{
+	pthread_mutex_lock( &rs_mapCatalogueMutex );
+	RS_MapCatalogueFree( &rs_mapCatalogue );
+	pthread_mutex_unlock( &rs_mapCatalogueMutex );
+}
+
+/**
+ * Number of maps in the catalogue
+ *
+ * @return int
+ */
+int RS_MapCount( void )
+{
+	int count;
+
+	pthread_mutex_lock( &rs_mapCatalogueMutex );
+	count = rs_mapCatalogue.numMaps;
+	pthread_mutex_unlock( &rs_mapCatalogueMutex );
+
+	return count;
+}
+
+/**
+ * Check whether a map is in the catalogue
+ *
+ * @param mapname case insensitive map name
+ * @return qboolean
+ */
+qboolean RS_MapInList( const char *mapname )
+{
+	qboolean found;
+
+	pthread_mutex_lock( &rs_mapCatalogueMutex );
+	found = RS_MapCatalogueFind( &rs_mapCatalogue, mapname ) >= 0 ? qtrue : qfalse;
+	pthread_mutex_unlock( &rs_mapCatalogueMutex );
+
+	return found;
+}
+
+/**
+ * Pick a random map other than the given one
+ *
+ * @param exclude map to leave out, may be NULL
+ * @param frac number in [0, 1)
+ * @return char* malloc'd map name, NULL if there is no other map
+ */
+char *RS_GetRandomMap( const char *exclude, float frac )
+{
+	rs_mapcatalogue_t *cat = &rs_mapCatalogue;
+	char *result = NULL;
+	int skip, count, num;
+
+	pthread_mutex_lock( &rs_mapCatalogueMutex );
+
+	skip = exclude ? RS_MapCatalogueFind( cat, exclude ) : -1;
+	count = cat->numMaps - ( skip >= 0 ? 1 : 0 );
+	if( count > 0 )
+	{
+		num = (int)( frac * count );
+		num = max( 0, min( num, count - 1 ) );
+		if( skip >= 0 && num >= skip )
+			num++;
+		result = strdup( RS_MapCatalogueName( cat, num ) );
+	}
+
+	pthread_mutex_unlock( &rs_mapCatalogueMutex );
+
+	return result;
+}
+
+/**
+ * Release the data of a map filter job
+ *
+ * @param void *in filterDataStruct
+ * @return void
+ */
+static void RS_FreeFilterData( void *in )
+{
+	struct filterDataStruct *filterData = (struct filterDataStruct *)in;
+
+	free( filterData->filter );
+	free( filterData );
+}
+
 /**
  * Mapfilter function registered in AS API.
  *
@@ -1838,17 +4404,20 @@ void *RS_UpdateMapList_Thread(void* in)
  */
 qboolean RS_MapFilter(int playerNum, char *filter, unsigned int page )
 {
-    pthread_t thread;
-    int returnCode;
     struct filterDataStruct *filterdata=malloc(sizeof(struct filterDataStruct));
     filterdata->playerNum = playerNum;
     filterdata->filter = strdup(filter);
     filterdata->page = page;
-    returnCode = pthread_create(&thread, &threadAttr, RS_MapFilter_Thread, (void *)filterdata);
-
-    if (returnCode) {
+    // the catalogue is in memory, without the MySQL workers it's searched right away
+    if( !rs_mysqlPool.running )
+    {
+        RS_MapFilter_Thread( filterdata );
+        return qtrue;
+    }
 
-        G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+    if( !RS_PushMysqlJob( RS_MapFilter_Thread, (void *)filterdata, qfalse ) )
+    {
+        RS_FreeFilterData( filterdata );
         return qfalse;
     }
 
@@ -1856,56 +4425,50 @@ qboolean RS_MapFilter(int playerNum, char *filter, unsigned int page )
 }
 
 /**
- * Map filter thread, parse the maplist array
+ * Map filter thread, search the map catalogue
  *
  * @param in Input data, cast to filterDataStruct
- * @return NULL on success
+ * @return qboolean qfalse on errors
  */
-void *RS_MapFilter_Thread( void *in )
+qboolean RS_MapFilter_Thread( void *in )
 {
     struct filterDataStruct *filterData = (struct filterDataStruct *)in;
-    int filterCount = 0, totalPages = 0, mapCount = 0, size = 0;
-    static const char *seps = " ,\n\r";
-    char *s, *t;
+    rs_mapcatalogue_t *cat = &rs_mapCatalogue;
+    int filterCount = 0, totalPages = 0;
     int page = filterData->page;
     const int MAPS_PER_PAGE = 15;
+    const int *candidates;
+    int i, num, numCandidates;
     char result[MAX_STRING_CHARS]; //stores the result string
+    char rows[MAX_STRING_CHARS]; //stores the maps of the requested page
     char filter[MAX_CONFIGSTRING_CHARS]; //stores the lowercase version of the filter
-    char temp[MAX_CONFIGSTRING_CHARS]; //stores the lowercase version of the map name
 
 	result[0]='\0';
-    filter[0]='\0';
-    temp[0]='\0';
+    rows[0]='\0';
     Q_strncpyz(filter,filterData->filter, sizeof( filter ) );
     Q_strlwr(filter);
 
-    s = G_CopyString( maplist );
-    t = strtok( s, seps );
-
-    //first get the count of maps matching the search
-    while( t != NULL )
+    // count the matches and keep the requested page in one pass
+    pthread_mutex_lock( &rs_mapCatalogueMutex );
+    numCandidates = RS_MapCatalogueCandidates( cat, filter, &candidates );
+    for( i = 0; i < numCandidates; i++ )
     {
-        Q_strncpyz( temp, t, sizeof( temp ) );
-        Q_strlwr( temp );
+        num = candidates ? candidates[i] : i;
+        if ( strstr( RS_MapCatalogueLower( cat, num ), filter ) == NULL )
+            continue;
 
-        if ( !( strstr( temp, filter ) == NULL ) )
-            filterCount++;
-
-        t = strtok( NULL, seps);
+        filterCount++;
+        if ( ( filterCount >= ((page-1)*MAPS_PER_PAGE + 1) ) && ( filterCount <= page*MAPS_PER_PAGE  ) )
+            Q_strncatz( rows, va( "%s#%4d%s : %s\n", S_COLOR_ORANGE, num + 1, S_COLOR_WHITE, RS_MapCatalogueName( cat, num ) ),  sizeof( rows ) );
     }
-
-    G_Free( s );
+    pthread_mutex_unlock( &rs_mapCatalogueMutex );
 
     if ( filterCount == 0 )
         Q_strncatz( result, va( "No maps found for your search on %s%s.\n", S_COLOR_YELLOW, filterData->filter ), sizeof( result ) );
 
     else
     {
-        //dirty hack to compute the number of pages, should use ceil function
-        if ( (filterCount/MAPS_PER_PAGE)*MAPS_PER_PAGE == filterCount )
-            totalPages = filterCount/MAPS_PER_PAGE;
-        else
-            totalPages = filterCount/MAPS_PER_PAGE + 1;
+        totalPages = ( filterCount + MAPS_PER_PAGE - 1 ) / MAPS_PER_PAGE;
 
         if ( page > totalPages )
         {
@@ -1916,52 +4479,42 @@ void *RS_MapFilter_Thread( void *in )
                     S_COLOR_YELLOW,
                     filterData->filter,
                     S_COLOR_WHITE ), sizeof ( result ) );
-    }
-    else
-    {
-        Q_strncatz( result, va( "Printing page %d/%d of maps matching %s%s.\n%sUse %smapfilter %s <pagenum> %sto print other pages.\n",
-                page,
-                totalPages,
-                S_COLOR_YELLOW,
-                filterData->filter,
-                S_COLOR_WHITE,
-                S_COLOR_YELLOW,
-                filterData->filter,
-                S_COLOR_WHITE),  sizeof(result));
-
-            s = G_CopyString( maplist );
-            t = strtok( s, seps );
-            filterCount = 0;
-
-            while( ( t != NULL ) && ( filterCount <= page*MAPS_PER_PAGE ) )
-            {
-                mapCount++;
-                Q_strncpyz( temp, t, sizeof( temp ) );
-                Q_strlwr( temp );
-                if ( !( strstr( temp, filter ) == NULL ) )
-                {
-                    filterCount++;
-                    if ( ( filterCount >= ((page-1)*MAPS_PER_PAGE + 1) ) && ( filterCount <= page*MAPS_PER_PAGE  ) )
-                        Q_strncatz( result, va( "%s#%4d%s : %s\n", S_COLOR_ORANGE, mapCount, S_COLOR_WHITE, t ),  sizeof( result ) );
         }
-
-                t = strtok( NULL, seps);
+        else
+        {
+            Q_strncatz( result, va( "Printing page %d/%d of maps matching %s%s.\n%sUse %smapfilter %s <pagenum> %sto print other pages.\n",
+                    page,
+                    totalPages,
+                    S_COLOR_YELLOW,
+                    filterData->filter,
+                    S_COLOR_WHITE,
+                    S_COLOR_YELLOW,
+                    filterData->filter,
+                    S_COLOR_WHITE),  sizeof(result));
+            Q_strncatz( result, rows, sizeof( result ) );
         }
-
-            G_Free( s );
-    }
     }
 
-    size = strlen( result )+1;
-    players_query[filterData->playerNum] = malloc( size );
-    Q_strncpyz( players_query[filterData->playerNum], result, size);
-    RS_PushCallbackQueue(RACESOW_CALLBACK_MAPFILTER, filterData->playerNum, filterCount, 0, 0, 0, 0, 0);
+    RS_PushStringCallback(result, RACESOW_CALLBACK_MAPFILTER, filterData->playerNum, filterCount, 0, 0, 0, 0, 0);
 
-    free(filterData->filter);
-    free(filterData);
-    RS_EndMysqlThread();
+    RS_FreeFilterData(filterData);
 
-    return NULL;
+    return qtrue;
+}
+
+/**
+ * Release the data of a stats job
+ *
+ * @param void *in statsRequest_t
+ * @return void
+ */
+static void RS_FreeStatsRequest( void *in )
+{
+	struct statsRequest_t *statsRequest = (struct statsRequest_t *)in;
+
+	free( statsRequest->what );
+	free( statsRequest->which );
+	free( statsRequest );
 }
 
 /**
@@ -1974,17 +4527,13 @@ void *RS_MapFilter_Thread( void *in )
  */
 qboolean RS_LoadStats(int playerNum, char *what, char *which)
 {
-    pthread_t thread;
-    int returnCode;
     struct statsRequest_t *statsRequest=malloc(sizeof(struct statsRequest_t));
     statsRequest->playerNum = playerNum;
     statsRequest->what = strdup(what);
     statsRequest->which = strdup(which);
-    returnCode = pthread_create(&thread, &threadAttr, RS_LoadStats_Thread, (void *)statsRequest);
-
-    if (returnCode) {
-
-        G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+    if( !RS_PushMysqlJob( RS_LoadStats_Thread, (void *)statsRequest, qfalse ) )
+    {
+        RS_FreeStatsRequest( statsRequest );
         return qfalse;
     }
 
@@ -1995,17 +4544,14 @@ qboolean RS_LoadStats(int playerNum, char *what, char *which)
 /**
  * Load stats thread
  *
- * @return NULL on success
+ * @return qboolean qfalse on errors
  */
-void *RS_LoadStats_Thread( void *in )
+qboolean RS_LoadStats_Thread( void *in )
 {
     struct statsRequest_t *statsRequest = (struct statsRequest_t *)in;
     char result[MAX_STRING_CHARS];
-    char query[MYSQL_QUERY_LENGTH];
     char which[64];
-    MYSQL_ROW  row;
-    MYSQL_RES  *mysql_res;
-    int size = 0;
+    rs_mysqlstmt_t *stmt;
 	result[0]='\0';
 
     RS_StartMysqlThread();
@@ -2028,48 +4574,44 @@ void *RS_LoadStats_Thread( void *in )
         avgTries = 0;
 
         Q_strncpyz( which, COM_RemoveColorTokens(statsRequest->which), sizeof( which ) );
-		RS_EscapeString(which);
-        sprintf(query, rs_queryGetMapStats->string, which);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
-        RS_CheckMysqlThreadError(query);
-        if ((row = mysql_fetch_row(mysql_res)) != NULL)
+        stmt = RS_MysqlExecute(rs_queryGetMapStats, which);
+        RS_CheckMysqlThreadError(stmt);
+        if (RS_MysqlFetch(stmt))
         {
-            if (row[0]!=NULL)
+            if (!RS_MysqlIsNull(stmt, 0))
             {
                  //  0        1        2            3                  4            5              6           7           8            9             10
                 // `type`, `races`, `tries`, `avg_overall_tries`, `avg_tries`, `avg_duration`, `playtime`, `created`, `best_time`, `worst_time`, `players`
 
-                    if (row[4] != NULL) {
+                    if (!RS_MysqlIsNull(stmt, 4)) {
 
-                        avgTries = atoi(row[4]);
+                        avgTries = RS_MysqlGetInt(stmt, 4);
                     }
 
-                    if (row[5] != NULL) {
-                        agMilli = atoi( row[5] );
+                    if (!RS_MysqlIsNull(stmt, 5)) {
+                        agMilli = RS_MysqlGetInt(stmt, 5);
                         agHour = agMilli / 3600000;
                         agMilli -= agHour * 3600000;
                         agMin = agMilli / 60000 + 1;
                     }
 
-                    if (row[6] != NULL) {
-                        ptMilli = atoi( row[6] );
+                    if (!RS_MysqlIsNull(stmt, 6)) {
+                        ptMilli = RS_MysqlGetInt(stmt, 6);
                         ptHour = ptMilli / 3600000;
                         ptMilli -= ptHour * 3600000;
                         ptMin = ptMilli / 60000 + 1;
                     }
 
-                    if (row[8] != NULL) {
-                        btMilli = atoi( row[8] );
+                    if (!RS_MysqlIsNull(stmt, 8)) {
+                        btMilli = RS_MysqlGetInt(stmt, 8);
                         btMin = btMilli / 60000;
                         btMilli -= btMin * 60000;
                         btSec = btMilli / 1000;
                         btMilli -= btSec * 1000;
                     }
 
-                    if (row[9] != NULL) {
-                        wtMilli = atoi( row[9] );
+                    if (!RS_MysqlIsNull(stmt, 9)) {
+                        wtMilli = RS_MysqlGetInt(stmt, 9);
                         wtMin = wtMilli / 60000;
                         wtMilli -= wtMin * 60000;
                         wtSec = wtMilli / 1000;
@@ -2077,19 +4619,19 @@ void *RS_LoadStats_Thread( void *in )
                     }
 
                     Q_strncatz( result, va( "%sStats for %s:\n", S_COLOR_YELLOW, statsRequest->which ), sizeof( result ) );
-                    if (row[0]!=NULL)
-                        Q_strncatz( result, va( "%sMap type: %s%s\n", S_COLOR_ORANGE, S_COLOR_WHITE, row[0] ), sizeof( result ) );
-                    if (row[7]!=NULL)
-                        Q_strncatz( result, va( "%sAvaiable since: %s%s\n", S_COLOR_ORANGE, S_COLOR_WHITE, row[7] ), sizeof( result ) );
+                    if (!RS_MysqlIsNull(stmt, 0))
+                        Q_strncatz( result, va( "%sMap type: %s%s\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetString(stmt, 0) ), sizeof( result ) );
+                    if (!RS_MysqlIsNull(stmt, 7))
+                        Q_strncatz( result, va( "%sAvaiable since: %s%s\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetString(stmt, 7) ), sizeof( result ) );
                     Q_strncatz( result, va( "%sPlaytime: %s%d hours %d minutes\n", S_COLOR_ORANGE, S_COLOR_WHITE, ptHour, ptMin ), sizeof( result ) );
-                    if (row[10]!=NULL)
-                        Q_strncatz( result, va( "%sNumber of players: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, atoi(row[10]) ), sizeof( result ) );
-                    if (row[1]!=NULL)
-                        Q_strncatz( result, va( "%sFinished races: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, atoi(row[1])), sizeof( result ) );
-                    if (row[2]!=NULL)
-                        Q_strncatz( result, va( "%sStarted races (overall tries): %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, atoi(row[2])), sizeof( result ) );
-                    if (row[3]!=NULL)
-                        Q_strncatz( result, va( "%sAvg. started races: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, atoi(row[3])), sizeof( result ) );
+                    if (!RS_MysqlIsNull(stmt, 10))
+                        Q_strncatz( result, va( "%sNumber of players: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetInt(stmt, 10) ), sizeof( result ) );
+                    if (!RS_MysqlIsNull(stmt, 1))
+                        Q_strncatz( result, va( "%sFinished races: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetInt(stmt, 1)), sizeof( result ) );
+                    if (!RS_MysqlIsNull(stmt, 2))
+                        Q_strncatz( result, va( "%sStarted races (overall tries): %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetInt(stmt, 2)), sizeof( result ) );
+                    if (!RS_MysqlIsNull(stmt, 3))
+                        Q_strncatz( result, va( "%sAvg. started races: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetInt(stmt, 3)), sizeof( result ) );
                     Q_strncatz( result, va( "%sAvg. tries to personal best: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, avgTries), sizeof( result ) );
                     Q_strncatz( result, va( "%sAvg. duration to personal Best: %s%d hours %d minutes\n", S_COLOR_ORANGE, S_COLOR_WHITE, agHour, agMin), sizeof( result ) );
                     Q_strncatz( result, va( "%sBest personal record: %s%d:%d:%03d\n", S_COLOR_ORANGE, S_COLOR_WHITE, btMin, btSec, btMilli), sizeof( result ) );
@@ -2101,18 +4643,14 @@ void *RS_LoadStats_Thread( void *in )
             Q_strncatz( result, va( "%sError: map '%s' not found\n", S_COLOR_RED, statsRequest->which ), sizeof( result ) );
         }
 
-        mysql_free_result(mysql_res);
+        RS_MysqlFreeResult(stmt);
     }
     else if (!Q_stricmp(statsRequest->what, "player"))
     {
         Q_strncpyz( which, COM_RemoveColorTokens(statsRequest->which), sizeof( which ) );
-		RS_EscapeString(which);
-        sprintf(query, rs_queryGetPlayerStats->string, which);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
-        RS_CheckMysqlThreadError(query);
-        if ((row = mysql_fetch_row(mysql_res)) != NULL)
+        stmt = RS_MysqlExecute(rs_queryGetPlayerStats, which);
+        RS_CheckMysqlThreadError(stmt);
+        if (RS_MysqlFetch(stmt))
         {
             int oHour, oMin, oMilli, rHour, rMin, rMilli;
             oHour = 0;
@@ -2125,42 +4663,42 @@ void *RS_LoadStats_Thread( void *in )
             //   0        1               2         3           4        5            6             7                  8
             // `points`, `diff_points`, `races`, `race_tries`, `maps`, `playtime`, `racing_time`, `first_seen`,  `last_seen`
 
-            if (row[5] != NULL) {
-                oMilli = atoi( row[5] );
+            if (!RS_MysqlIsNull(stmt, 5)) {
+                oMilli = RS_MysqlGetInt(stmt, 5);
                 oHour = oMilli / 3600000;
                 oMilli -= oHour * 3600000;
                 oMin = oMilli / 60000 + 1;
             }
 
-            if (row[6] != NULL) {
-                rMilli = atoi( row[6] );
+            if (!RS_MysqlIsNull(stmt, 6)) {
+                rMilli = RS_MysqlGetInt(stmt, 6);
                 rHour = rMilli / 3600000;
                 rMilli -= rHour * 3600000;
                 rMin = rMilli / 60000 + 1;
             }
 
             Q_strncatz( result, va( "%sStats for %s:\n", S_COLOR_YELLOW, statsRequest->which ), sizeof( result ) );
-            if (row[0]!=NULL && row[1]!=NULL)
-                Q_strncatz( result, va( "%sPoints: %s%d (%s%d)\n", S_COLOR_ORANGE, S_COLOR_WHITE, atoi(row[0]), (atoi(row[1]) < 0 ? "" : "+"), atoi(row[1])), sizeof( result ) );
-            if (row[2]!=NULL)
-                Q_strncatz( result, va( "%sFinished races: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, atoi(row[2]) ), sizeof( result ) );
-            if (row[3]!=NULL)
-                Q_strncatz( result, va( "%sStarted races: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, atoi(row[3]) ), sizeof( result ) );
-            if (row[4]!=NULL)
-                Q_strncatz( result, va( "%sPlayed maps: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, atoi(row[4]) ), sizeof( result ) );
+            if (!RS_MysqlIsNull(stmt, 0) && !RS_MysqlIsNull(stmt, 1))
+                Q_strncatz( result, va( "%sPoints: %s%d (%s%d)\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetInt(stmt, 0), (RS_MysqlGetInt(stmt, 1) < 0 ? "" : "+"), RS_MysqlGetInt(stmt, 1)), sizeof( result ) );
+            if (!RS_MysqlIsNull(stmt, 2))
+                Q_strncatz( result, va( "%sFinished races: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetInt(stmt, 2) ), sizeof( result ) );
+            if (!RS_MysqlIsNull(stmt, 3))
+                Q_strncatz( result, va( "%sStarted races: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetInt(stmt, 3) ), sizeof( result ) );
+            if (!RS_MysqlIsNull(stmt, 4))
+                Q_strncatz( result, va( "%sPlayed maps: %s%d\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetInt(stmt, 4) ), sizeof( result ) );
                 Q_strncatz( result, va( "%sOnline time: %s%d hours %d minutes \n", S_COLOR_ORANGE, S_COLOR_WHITE, oHour, oMin ), sizeof( result ) );
                 Q_strncatz( result, va( "%sRacing time: %s%d hours %d minutes\n", S_COLOR_ORANGE, S_COLOR_WHITE, rHour, rMin ), sizeof( result ) );
-            if (row[7]!=NULL)
-                Q_strncatz( result, va( "%sFirst seen: %s%s\n", S_COLOR_ORANGE, S_COLOR_WHITE, row[7] ), sizeof( result ) );
-            if (row[8]!=NULL)
-                Q_strncatz( result, va( "%sLast seen: %s%s\n", S_COLOR_ORANGE, S_COLOR_WHITE, row[8] ), sizeof( result ) );
+            if (!RS_MysqlIsNull(stmt, 7))
+                Q_strncatz( result, va( "%sFirst seen: %s%s\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetString(stmt, 7) ), sizeof( result ) );
+            if (!RS_MysqlIsNull(stmt, 8))
+                Q_strncatz( result, va( "%sLast seen: %s%s\n", S_COLOR_ORANGE, S_COLOR_WHITE, RS_MysqlGetString(stmt, 8) ), sizeof( result ) );
         }
         else
         {
             Q_strncatz( result, va( "%sError: player '%s' not found\n", S_COLOR_RED, statsRequest->which ), sizeof( result ) );
         }
 
-        mysql_free_result(mysql_res);
+        RS_MysqlFreeResult(stmt);
     }
     else
     {
@@ -2174,17 +4712,15 @@ void *RS_LoadStats_Thread( void *in )
     */
 
 
-    size = strlen( result )+1;
-    players_query[statsRequest->playerNum] = malloc( size );
-    Q_strncpyz( players_query[statsRequest->playerNum], result, size);
-    RS_PushCallbackQueue(RACESOW_CALLBACK_MAPFILTER, statsRequest->playerNum, 0, 0, 0, 0, 0, 0);
+    RS_PushStringCallback(result, RACESOW_CALLBACK_MAPFILTER, statsRequest->playerNum, 0, 0, 0, 0, 0, 0);
 
-    free(statsRequest->what);
-    free(statsRequest->which);
-    free(statsRequest);
-    RS_EndMysqlThread();
+    RS_FreeStatsRequest(statsRequest);
 
-    return NULL;
+    return qtrue;
+
+error:
+    RS_FreeStatsRequest(statsRequest);
+    return qfalse;
 }
 
 /**
@@ -2197,23 +4733,32 @@ void *RS_LoadStats_Thread( void *in )
  */
 char *RS_PrintQueryCallback(int player_id )
 {
-    unsigned int size;
+    rs_callback_t *callback;
+    rs_highscorespayload_t *highscores;
     char *result;
 
-    if ( players_query[player_id] != NULL )
-    {
-        size = strlen(players_query[player_id])+1;
-        result=malloc(size);
-        Q_strncpyz(result, players_query[player_id] , size);
-        free(players_query[player_id]);
-        players_query[player_id] = NULL;
-        return result;
-    }
-    else
-    {
+    if ( player_id < 0 || player_id >= MAX_CLIENTS )
         return NULL;
-    }
 
+    callback = &rs_callbackResults[player_id];
+    switch ( callback->type )
+    {
+        case RS_CALLBACK_PAYLOAD_STRING:
+            // hand the string over to the caller
+            result = callback->payload.string;
+            callback->type = RS_CALLBACK_PAYLOAD_NONE;
+            return result;
+
+        case RS_CALLBACK_PAYLOAD_HIGHSCORES:
+            highscores = callback->payload.highscores;
+            result = malloc(10000);
+            RS_FormatHighscores( result, 10000, highscores->mapname, highscores->limit, highscores->entries, highscores->numEntries, highscores->oneliner, highscores->pjOneliner );
+            RS_FreeCallbackPayload( callback );
+            return result;
+
+        default:
+            return NULL;
+    }
 }
 
 /**
@@ -2227,16 +4772,19 @@ char *RS_PrintQueryCallback(int player_id )
  */
 qboolean RS_Maplist(int playerNum, unsigned int page)
 {
-    pthread_t thread;
-    int returnCode;
     struct maplistDataStruct *maplistdata=malloc(sizeof(struct maplistDataStruct));
     maplistdata->playerNum = playerNum;
     maplistdata->page = page;
-    returnCode = pthread_create(&thread, &threadAttr, RS_Maplist_Thread, (void *)maplistdata);
-
-    if (returnCode) {
+    // the catalogue is in memory, without the MySQL workers it's printed right away
+    if( !rs_mysqlPool.running )
+    {
+        RS_Maplist_Thread( maplistdata );
+        return qtrue;
+    }
 
-        G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+    if( !RS_PushMysqlJob( RS_Maplist_Thread, (void *)maplistdata, qfalse ) )
+    {
+        free( maplistdata );
         return qfalse;
     }
 
@@ -2244,35 +4792,33 @@ qboolean RS_Maplist(int playerNum, unsigned int page)
 }
 
 /**
- * Maplist thread, parse the maplist array
+ * Maplist thread, print a page of the map catalogue
  *
  * @param in Input data, cast to maplistDataStruct
  */
-void *RS_Maplist_Thread(void *in)
-    {
+qboolean RS_Maplist_Thread(void *in)
+{
     struct maplistDataStruct *maplistData = (struct maplistDataStruct *)in ;
-    int mapsFound = 0, totalPages = 0, size = 0;
+    rs_mapcatalogue_t *cat = &rs_mapCatalogue;
+    int totalPages = 0, num, last;
     int page = maplistData->page;
-    static const char *seps = " ,\n\r";
-    char *s, *t;
     const int MAPS_PER_PAGE = 20;
     char result[MAX_STRING_CHARS]; //stores the result string
     result[0]='\0';
 
-    if ( (mapcount/MAPS_PER_PAGE)*MAPS_PER_PAGE == mapcount )
-        totalPages = mapcount/MAPS_PER_PAGE;
-    else
-        totalPages = mapcount/MAPS_PER_PAGE + 1;
+    pthread_mutex_lock( &rs_mapCatalogueMutex );
+
+    totalPages = ( cat->numMaps + MAPS_PER_PAGE - 1 ) / MAPS_PER_PAGE;
 
     if ( ( page > totalPages ) || (page < 1 ) )
     {
         Q_strncatz( result , va( "You should enter a page number between%s %d%s and%s %d%s\n",
-                     S_COLOR_YELLOW,
+                S_COLOR_YELLOW,
                 1,
-                     S_COLOR_WHITE,
-                     S_COLOR_YELLOW,
+                S_COLOR_WHITE,
+                S_COLOR_YELLOW,
                 totalPages,
-                     S_COLOR_WHITE),  sizeof(result));
+                S_COLOR_WHITE),  sizeof(result));
     }
     else
     {
@@ -2282,33 +4828,35 @@ void *RS_Maplist_Thread(void *in)
                 totalPages,
                 S_COLOR_YELLOW ),  sizeof( result ) );
 
-        s = G_CopyString( maplist );
-        t = strtok( s, seps );
-
-        while( ( t != NULL ) && ( mapsFound <= page*MAPS_PER_PAGE ) )
-        {
-            mapsFound++;
-            if ( ( mapsFound >= ((page-1)*MAPS_PER_PAGE + 1) ) && ( mapsFound <= page*MAPS_PER_PAGE  ) )
-                Q_strncatz( result, va( "%s#%4d%s : %s\n", S_COLOR_ORANGE, mapsFound, S_COLOR_WHITE, t ),  sizeof( result ) );
-
-            t = strtok( NULL, seps);
-        }
-
-        G_Free( s );
+        last = min( page*MAPS_PER_PAGE, cat->numMaps );
+        for( num = (page-1)*MAPS_PER_PAGE; num < last; num++ )
+            Q_strncatz( result, va( "%s#%4d%s : %s\n", S_COLOR_ORANGE, num + 1, S_COLOR_WHITE, RS_MapCatalogueName( cat, num ) ),  sizeof( result ) );
     }
 
-    size = strlen( result )+1;
-    players_query[maplistData->playerNum] = malloc( size );
-    Q_strncpyz( players_query[maplistData->playerNum], result, size);
-    RS_PushCallbackQueue(RACESOW_CALLBACK_MAPLIST, maplistData->playerNum, 0, 0, 0, 0, 0, 0);
+    pthread_mutex_unlock( &rs_mapCatalogueMutex );
+
+    RS_PushStringCallback(result, RACESOW_CALLBACK_MAPLIST, maplistData->playerNum, 0, 0, 0, 0, 0, 0);
 
     free(maplistData);
-    RS_EndMysqlThread();
 
-    return NULL;
+    return qtrue;
 }
 
 
+/**
+ * Release the data of a highscores job
+ *
+ * @param void *in highscoresDataStruct
+ * @return void
+ */
+static void RS_FreeHighscoresData( void *in )
+{
+	struct highscoresDataStruct *highscoresData = (struct highscoresDataStruct *)in;
+
+	free( highscoresData->mapname );
+	free( highscoresData );
+}
+
 /**
  * Calls the highscores thread
  *
@@ -2318,10 +4866,13 @@ void *RS_Maplist_Thread(void *in)
  */
 qboolean RS_MysqlLoadHighscores( int playerNum, int  limit, int map_id, char *mapname, pjflag prejumpFlag)
 {
-	pthread_t thread;
-	int returnCode;
+	struct highscoresDataStruct *highscoresData;
+
+	// the current map is answered from memory
+	if( RS_LeaderboardHighscores( playerNum, limit, map_id, mapname, prejumpFlag ) )
+		return qtrue;
 
-	struct highscoresDataStruct *highscoresData=malloc(sizeof(struct highscoresDataStruct));
+	highscoresData=malloc(sizeof(struct highscoresDataStruct));
 
     highscoresData->map_id=map_id;
 	highscoresData->playerNum=playerNum;
@@ -2329,10 +4880,9 @@ qboolean RS_MysqlLoadHighscores( int playerNum, int  limit, int map_id, char *ma
 	highscoresData->limit = limit;
 	highscoresData->prejumpflag = prejumpFlag;
 
-	returnCode = pthread_create(&thread, &threadAttr, RS_MysqlLoadHighscores_Thread, (void *)highscoresData);
-	if (returnCode) {
-
-		G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+	if( !RS_PushMysqlJob( RS_MysqlLoadHighscores_Thread, (void *)highscoresData, qfalse ) )
+	{
+		RS_FreeHighscoresData( highscoresData );
 		return qfalse;
 	}
 
@@ -2345,28 +4895,24 @@ qboolean RS_MysqlLoadHighscores( int playerNum, int  limit, int map_id, char *ma
 // straight from 0.42 with some changes
 //=================
 
-void *RS_MysqlLoadHighscores_Thread( void* in ) {
+qboolean RS_MysqlLoadHighscores_Thread( void* in ) {
 
-		MYSQL_ROW  row;
-        MYSQL_RES  *mysql_res;
-        char query[MYSQL_QUERY_LENGTH];
+		rs_mysqlstmt_t *stmt;
 		char oneliner[100];
 		char pjoneliner[100];
 		int playerNum;
 		int map_id;
 		int limit;
 		int mapNumber;
-		char highscores[10000];
+		rs_highscorespayload_t *highscores;
 		struct highscoresDataStruct *highscoresData;
 		char *mapname;
 		char *prejumpflag;
-		qboolean prejumped;
 
 		highscoresData = (struct highscoresDataStruct *)in;
 		playerNum = highscoresData->playerNum;
 		limit = highscoresData->limit;
 		mapname = strdup(highscoresData->mapname);
-		prejumped = qfalse;
 
 		switch (highscoresData->prejumpflag)
 		{
@@ -2394,21 +4940,28 @@ void *RS_MysqlLoadHighscores_Thread( void* in ) {
 				//first, free the old mapname, as a new one is malloc'd in RS_GetMapByNum
 				free(mapname);
 		        mapname = RS_GetMapByNum( mapNumber );
+		        if( !mapname )
+		        {
+		            char error[64];
+
+		            Q_snprintfz( error, sizeof( error ), "%sError: map number %i not found\n", S_COLOR_RED, mapNumber );
+		            RS_PushStringCallback( error, RACESOW_CALLBACK_HIGHSCORES, playerNum, 0, 0, 0, 0, 0, 0 );
+
+		            RS_FreeHighscoresData(highscoresData);
+		            return qtrue;
+		        }
 		    }
 
 		    //get the map_id corresponding to the mapname
-		    sprintf(query, rs_queryGetMap->string, mapname);
-		    mysql_real_query(&mysql, query, strlen(query));
-	        RS_CheckMysqlThreadError(query);
-	        mysql_res = mysql_store_result(&mysql);
-	        RS_CheckMysqlThreadError(query);
-
-	        if ( (row = mysql_fetch_row(mysql_res)) != NULL )
-	            map_id = atoi(row[0]);
+		    stmt = RS_MysqlExecute(rs_queryGetMap, mapname);
+	        RS_CheckMysqlThreadError(stmt);
+
+	        if ( RS_MysqlFetch(stmt) )
+	            map_id = RS_MysqlGetInt(stmt, 0);
 	        else
 	            map_id = 0;
 
-	        mysql_free_result(mysql_res);
+	        RS_MysqlFreeResult(stmt);
 		}
 		else //use given map_id (current map id)
 		{
@@ -2420,126 +4973,75 @@ void *RS_MysqlLoadHighscores_Thread( void* in ) {
 		// get map oneliners (may not be present)
 		oneliner[0]='\0';
 		pjoneliner[0]='\0';
-		sprintf(query, rs_queryLoadMapOneliners->string, map_id);
-		mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
-        RS_CheckMysqlThreadError(query);
-		if ((row = mysql_fetch_row(mysql_res)) != NULL)
+		stmt = RS_MysqlExecute(rs_queryLoadMapOneliners, map_id);
+        RS_CheckMysqlThreadError(stmt);
+		if (RS_MysqlFetch(stmt))
 	    {
-		    if (row[0] !=NULL)
+		    if (!RS_MysqlIsNull(stmt, 0))
 			{
-				if ( strlen(row[0]) > 0 )
+				if ( strlen(RS_MysqlGetString(stmt, 0)) > 0 )
 				{
-						Q_strncpyz(oneliner, va("\"%s\"", row[0]), sizeof(oneliner));
+						Q_strncpyz(oneliner, RS_MysqlGetString(stmt, 0), sizeof(oneliner));
 				}
 			}
-			if (row[1] !=NULL)
+			if (!RS_MysqlIsNull(stmt, 1))
 			{
-                if ( strlen(row[1]) > 0 )
+                if ( strlen(RS_MysqlGetString(stmt, 1)) > 0 )
                 {
-                        Q_strncpyz(pjoneliner, va("\"%s\"", row[1]), sizeof(pjoneliner));
+                        Q_strncpyz(pjoneliner, RS_MysqlGetString(stmt, 1), sizeof(pjoneliner));
                 }
 			}
 	    }
-		mysql_free_result(mysql_res);
+		RS_MysqlFreeResult(stmt);
 
         // get top players on map
-		sprintf(query, rs_queryLoadMapHighscores->string, map_id, prejumpflag, limit);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
-        RS_CheckMysqlThreadError(query);
-
-		highscores[0]='\0';
-
-        if( (unsigned long)mysql_num_rows( mysql_res ) == 0 )
-            Q_strncatz(highscores, va( "%sNo highscores found yet!\n", S_COLOR_RED ), sizeof(highscores));
-
-        else {
-            unsigned int position = 0;
-            unsigned int last_position = 0;
-            unsigned int draw_position = 0;
-            unsigned int cleanBest = 0;
-            unsigned int pjBest = 0;
-            char last_time[16];
-            char draw_time[16];
-            char diff_time[16];
-            int min, sec, milli, dmin, dsec, dmilli;
-			int replay_record;
-
-			replay_record=0;
-			last_time[0]='\0';
-			draw_time[0]='\0';
-			diff_time[0]='\0';
+		stmt = RS_MysqlExecute(rs_queryLoadMapHighscores, map_id, prejumpflag, limit);
+        RS_CheckMysqlThreadError(stmt);
 
+		highscores = malloc( sizeof( *highscores ) );
+		highscores->numEntries = 0;
+		highscores->entries = malloc( max( RS_MysqlNumRows( stmt ), 1 ) * sizeof( rs_leaderboardentry_t ) );
+		while( RS_MysqlFetch( stmt ) && highscores->numEntries < (int)RS_MysqlNumRows( stmt ) )
+		{
+			rs_leaderboardentry_t *entry = &highscores->entries[highscores->numEntries++];
 
-            Q_strncatz(highscores, va( "%sTop %d players on map '%s'%s\n", S_COLOR_ORANGE, limit, mapname, S_COLOR_WHITE ), sizeof(highscores));
+			memset( entry, 0, sizeof( *entry ) );
+			entry->time = RS_MysqlGetInt( stmt, 0 );
+			entry->prejumped = !Q_stricmp(RS_MysqlGetString( stmt, 3 ), "true") ? qtrue : qfalse;
+			Q_strncpyz( entry->name, RS_MysqlGetString( stmt, 1 ), sizeof( entry->name ) );
+			Q_strncpyz( entry->created, RS_MysqlGetString( stmt, 2 ), sizeof( entry->created ) );
+		}
 
-            while( ( row = mysql_fetch_row( mysql_res ) ) != NULL )
-			{
+        RS_MysqlFreeResult(stmt);
 
-				if( /*load_replay_record && */	!position && row[0] ) {
-                    replay_record = atoi( row[0] );
-                    /*
-					Q_strncpyz(level_items.record_player, row[1], sizeof(level_items.record_player));
-                    if( rs_restoreHighscores->integer )
-                        game.race_record = atoi( row[0] );
-					*/
-                }
-                position++;
-                //check is the time is prejumped
-                if ( !Q_stricmp(row[3], "true") )
-                    prejumped = qtrue;
-                else
-                    prejumped = qfalse;
-
-                if (!prejumped && cleanBest == 0) //update the positions
-                    cleanBest = position;
-                if (prejumped && pjBest == 0)
-                    pjBest = position;
-
-                // convert time into MM:SS:mmm
-                milli = atoi( row[0] );
-                min = milli / 60000;
-                milli -= min * 60000;
-                sec = milli / 1000;
-                milli -= sec * 1000;
-
-				dmilli = atoi( row[0] ) - replay_record;
-                dmin = dmilli / 60000;
-                dmilli -= dmin * 60000;
-                dsec = dmilli / 1000;
-                dmilli -= dsec * 1000;
-
-                Q_strncpyz( draw_time, va( "%d:%d.%03d", min, sec, milli ), sizeof(draw_time) );
-                Q_strncpyz( diff_time, va( "+%d:%d.%03d", dmin, dsec, dmilli ), sizeof(diff_time) );
-
-                if( !Q_stricmp( va( "%s", last_time ), va( "%s", draw_time ) ) )
-                    draw_position = last_position;
-                else
-                    draw_position = position;
-
-                last_position = draw_position;
-                Q_strncpyz( last_time, va( "%d:%d.%d", min, sec, milli ), sizeof(last_time) );
-
-				Q_strncatz( highscores, va( "%s%3d. %s%6s  %s[%s]  %s %s  %s(%s) %s%s%s\n", S_COLOR_WHITE, draw_position, prejumped?S_COLOR_RED:S_COLOR_GREEN, draw_time, S_COLOR_YELLOW, diff_time, S_COLOR_WHITE, row[1], S_COLOR_WHITE, row[2], S_COLOR_YELLOW, ( position == pjBest ? pjoneliner : "" ), ( position == cleanBest ? oneliner : "" ) ), sizeof(highscores) );
-			}
-        }
+		Q_strncpyz( highscores->mapname, mapname, sizeof( highscores->mapname ) );
+		Q_strncpyz( highscores->oneliner, oneliner, sizeof( highscores->oneliner ) );
+		Q_strncpyz( highscores->pjOneliner, pjoneliner, sizeof( highscores->pjOneliner ) );
+		highscores->limit = limit;
+		RS_PushHighscoresCallback( playerNum, highscores );
 
-        mysql_free_result(mysql_res);
+		free(mapname);
+		RS_FreeHighscoresData(highscoresData);
+		return qtrue;
 
-        players_query[playerNum]=malloc(strlen(highscores)+1);
-        players_query[playerNum][0]='\0';
-        Q_strncpyz( players_query[playerNum],highscores, strlen(highscores) + 1);
+error:
+		free(mapname);
+		RS_FreeHighscoresData(highscoresData);
+		return qfalse;
+}
 
-		RS_PushCallbackQueue(RACESOW_CALLBACK_HIGHSCORES, playerNum, 0, 0, 0, 0, 0, 0);
+/**
+ * Release the data of a ranking job
+ *
+ * @param void *in rankingDataStruct
+ * @return void
+ */
+static void RS_FreeRankingData( void *in )
+{
+	struct rankingDataStruct *rankingData = (struct rankingDataStruct *)in;
 
-		free(highscoresData->mapname);
-		free(mapname);
-		free(highscoresData);
-		RS_EndMysqlThread();
-		return NULL;
+	free( rankingData->order );
+	free( rankingData );
 }
 
 /**
@@ -2551,8 +5053,6 @@ void *RS_MysqlLoadHighscores_Thread( void* in ) {
  */
 qboolean RS_MysqlLoadRanking( int playerNum, int  page, char *order )
 {
-	pthread_t thread;
-	int returnCode;
 
 	struct rankingDataStruct *rankingData=malloc(sizeof(struct rankingDataStruct));
 
@@ -2560,10 +5060,9 @@ qboolean RS_MysqlLoadRanking( int playerNum, int  page, char *order )
     rankingData->page = page;
 	rankingData->order = strdup(order);
 
-	returnCode = pthread_create(&thread, &threadAttr, RS_MysqlLoadRanking_Thread, (void *)rankingData);
-	if (returnCode) {
-
-		G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+	if( !RS_PushMysqlJob( RS_MysqlLoadRanking_Thread, (void *)rankingData, qfalse ) )
+	{
+		RS_FreeRankingData( rankingData );
 		return qfalse;
 	}
 
@@ -2572,13 +5071,11 @@ qboolean RS_MysqlLoadRanking( int playerNum, int  page, char *order )
 
 /**
  * Load the ranking
- * @return void
+ * @return qboolean qfalse on errors
  */
-void *RS_MysqlLoadRanking_Thread( void* in ) {
+qboolean RS_MysqlLoadRanking_Thread( void* in ) {
 
-		MYSQL_ROW  row;
-        MYSQL_RES  *mysql_res;
-        char query[MYSQL_QUERY_LENGTH];
+		rs_mysqlstmt_t *stmt;
 		int playerNum;
 		int limit;
 		int offset;
@@ -2597,15 +5094,12 @@ void *RS_MysqlLoadRanking_Thread( void* in ) {
         // get top players on map
 		limit = 20;
 		offset = (page - 1) * limit;
-		sprintf(query, rs_queryLoadRanking->string, order, "DESC", offset, limit);
-        mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
-        RS_CheckMysqlThreadError(query);
+		stmt = RS_MysqlExecute(rs_queryLoadRanking, order, "DESC", offset, limit);
+        RS_CheckMysqlThreadError(stmt);
 
 		ranking[0]='\0';
 
-        if( (unsigned long)mysql_num_rows( mysql_res ) == 0 )
+        if( RS_MysqlNumRows( stmt ) == 0 )
 		{
             Q_strncatz(ranking, va( "%sNo ranking found!\n", S_COLOR_RED ), sizeof(ranking));
 		}
@@ -2619,21 +5113,21 @@ void *RS_MysqlLoadRanking_Thread( void* in ) {
 			else
 				Q_strncatz(ranking, va( "%sPlayer      %s\n", S_COLOR_WHITE, order ), sizeof(ranking));
 
-            while( ( row = mysql_fetch_row( mysql_res ) ) != NULL )
+            while( RS_MysqlFetch( stmt ) )
 			{
 				position++;
 				
 				if ( !Q_stricmp(order, "points") || !Q_stricmp(order, "diff_points") )
-					Q_strncatz( ranking, va( "%s%d. %s      %s%d (%d)\n", S_COLOR_WHITE, position, row[0], S_COLOR_WHITE, atoi(row[1]), atoi(row[2]) ), sizeof(ranking) );
+					Q_strncatz( ranking, va( "%s%d. %s      %s%d (%d)\n", S_COLOR_WHITE, position, RS_MysqlGetString(stmt, 0), S_COLOR_WHITE, RS_MysqlGetInt(stmt, 1), RS_MysqlGetInt(stmt, 2) ), sizeof(ranking) );
 				else if ( !Q_stricmp(order, "races") )
-					Q_strncatz( ranking, va( "%s%d. %s      %s%d\n", S_COLOR_WHITE, position, row[0], S_COLOR_WHITE, atoi(row[3]) ), sizeof(ranking) );
+					Q_strncatz( ranking, va( "%s%d. %s      %s%d\n", S_COLOR_WHITE, position, RS_MysqlGetString(stmt, 0), S_COLOR_WHITE, RS_MysqlGetInt(stmt, 3) ), sizeof(ranking) );
 				else if ( !Q_stricmp(order, "maps") )
-					Q_strncatz( ranking, va( "%s%d. %s      %s%d\n", S_COLOR_WHITE, position, row[0], S_COLOR_WHITE, atoi(row[4]) ), sizeof(ranking) );
+					Q_strncatz( ranking, va( "%s%d. %s      %s%d\n", S_COLOR_WHITE, position, RS_MysqlGetString(stmt, 0), S_COLOR_WHITE, RS_MysqlGetInt(stmt, 4) ), sizeof(ranking) );
 				else if ( !Q_stricmp(order, "playtime") )
 				{
 					unsigned long int playtimeMillis, playtimeSeconds, playtimeMinutes, playtimeHours, playtimeDays, playtimeMonths, playtimeYears;
 					
-					playtimeMillis = strtoul(row[5], NULL, 10);
+					playtimeMillis = (unsigned long int)RS_MysqlGetInt64(stmt, 5);
 					playtimeYears = playtimeMillis / 31104000000;
 					playtimeMillis -= playtimeYears * 31104000000;
 					playtimeMonths = playtimeMillis / 2592000000;
@@ -2646,24 +5140,37 @@ void *RS_MysqlLoadRanking_Thread( void* in ) {
 					playtimeMillis -= playtimeMinutes * 60000;
 					playtimeSeconds = playtimeMillis / 1000;
 					
-					Q_strncatz( ranking, va( "%s%d. %s      %s%uY %uM %uD %uh %um %us\n", S_COLOR_WHITE, position, row[0], S_COLOR_WHITE, playtimeYears, playtimeMonths, playtimeDays, playtimeHours, playtimeMinutes, playtimeSeconds ), sizeof(ranking) );
+					Q_strncatz( ranking, va( "%s%d. %s      %s%uY %uM %uD %uh %um %us\n", S_COLOR_WHITE, position, RS_MysqlGetString(stmt, 0), S_COLOR_WHITE, playtimeYears, playtimeMonths, playtimeDays, playtimeHours, playtimeMinutes, playtimeSeconds ), sizeof(ranking) );
 				}
 			}
         }
 
-        mysql_free_result(mysql_res);
+        RS_MysqlFreeResult(stmt);
 
-        players_query[playerNum]=malloc(strlen(ranking)+1);
-        players_query[playerNum][0]='\0';
-        Q_strncpyz( players_query[playerNum],ranking, strlen(ranking) + 1);
+		RS_PushStringCallback(ranking, RACESOW_CALLBACK_RANKING, playerNum, 0, 0, 0, 0, 0, 0);
 
-		RS_PushCallbackQueue(RACESOW_CALLBACK_RANKING, playerNum, 0, 0, 0, 0, 0, 0);
+		free(order);
+		RS_FreeRankingData(rankingData);
+		return qtrue;
 
-		free(rankingData->order);
-		free(rankingData);
+error:
 		free(order);
-		RS_EndMysqlThread();
-		return NULL;
+		RS_FreeRankingData(rankingData);
+		return qfalse;
+}
+
+/**
+ * Release the data of a oneliner job
+ *
+ * @param void *in onelinerDataStruct
+ * @return void
+ */
+static void RS_FreeOnelinerData( void *in )
+{
+	struct onelinerDataStruct *onelinerData = (struct onelinerDataStruct *)in;
+
+	free( onelinerData->oneliner );
+	free( onelinerData );
 }
 
 /**
@@ -2673,8 +5180,6 @@ void *RS_MysqlLoadRanking_Thread( void* in ) {
  */
 qboolean RS_MysqlSetOneliner( int playerNum, int player_id, int map_id, char *oneliner)
 {
-    pthread_t thread;
-    int returnCode;
 	struct onelinerDataStruct *onelinerData=malloc(sizeof(struct onelinerDataStruct));
 
     onelinerData->oneliner = strdup(oneliner);
@@ -2682,11 +5187,9 @@ qboolean RS_MysqlSetOneliner( int playerNum, int player_id, int map_id, char *on
 	onelinerData->player_id = player_id;
 	onelinerData->map_id = map_id;
 
-    returnCode = pthread_create(&thread, &threadAttr, RS_MysqlSetOneliner_Thread, (void *)onelinerData);
-
-    if (returnCode) {
-
-        G_Printf("THREAD ERROR: return code from pthread_create() is %d\n", returnCode);
+    if( !RS_PushMysqlJob( RS_MysqlSetOneliner_Thread, (void *)onelinerData, qtrue ) )
+    {
+        RS_FreeOnelinerData( onelinerData );
         return qfalse;
     }
 
@@ -2697,16 +5200,13 @@ qboolean RS_MysqlSetOneliner( int playerNum, int player_id, int map_id, char *on
  * Thread that updates the database with the player new protected nick
  *
  * @param in Input data
- * @return NULL on success
+ * @return qboolean qfalse on errors
  */
-void *RS_MysqlSetOneliner_Thread( void *in )
+qboolean RS_MysqlSetOneliner_Thread( void *in )
 {
 	struct onelinerDataStruct *onelinerData;
-	char query[MYSQL_QUERY_LENGTH];
 	char response[1024];
-	MYSQL_ROW  row;
-    MYSQL_RES  *mysql_res;
-	int size;
+	rs_mysqlstmt_t *stmt;
 	int failure;
 	int best_player_id;
 	char old_oneliner[100];
@@ -2721,36 +5221,30 @@ void *RS_MysqlSetOneliner_Thread( void *in )
 	prejumped = qfalse;
 
     // read current player record to know if it was prejumped or not
-    sprintf(query, rs_queryGetPlayerMap->string, onelinerData->player_id, onelinerData->map_id);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
-    mysql_res = mysql_store_result(&mysql);
-    RS_CheckMysqlThreadError(query);
-    if ((row = mysql_fetch_row(mysql_res)) != NULL) {
-        if (row[0] != NULL && row[1] != NULL)
+    stmt = RS_MysqlExecute(rs_queryGetPlayerMap, onelinerData->player_id, onelinerData->map_id);
+    RS_CheckMysqlThreadError(stmt);
+    if (RS_MysqlFetch(stmt)) {
+        if (!RS_MysqlIsNull(stmt, 0) && !RS_MysqlIsNull(stmt, 1))
         {
-            if ( !Q_stricmp(row[2],"true") )
+            if ( !Q_stricmp(RS_MysqlGetString(stmt, 2),"true") )
                 prejumped = qtrue;
             else
                 prejumped = qfalse;
         }
     }
-    mysql_free_result(mysql_res);
+    RS_MysqlFreeResult(stmt);
 
 	// retrieve server best
-	sprintf(query, rs_queryGetPlayerMapHighscores->string, onelinerData->map_id, prejumped?"'true','false'":"'false'");
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
-    mysql_res = mysql_store_result(&mysql);
-    RS_CheckMysqlThreadError(query);
-    if ((row = mysql_fetch_row(mysql_res)) != NULL)
-	{
-		if (row[0] !=NULL && row[1] != NULL)
+	stmt = RS_MysqlExecute(rs_queryGetPlayerMapHighscores, onelinerData->map_id, prejumped?"'true','false'":"'false'");
+    RS_CheckMysqlThreadError(stmt);
+    if (RS_MysqlFetch(stmt))
+	{
+		if (!RS_MysqlIsNull(stmt, 0) && !RS_MysqlIsNull(stmt, 1))
 		{
-            best_player_id = atoi(row[0]);
+            best_player_id = RS_MysqlGetInt(stmt, 0);
 		}
 	}
-	mysql_free_result(mysql_res);
+	RS_MysqlFreeResult(stmt);
 
 	// test if the player is allowed to set the oneliner, else stop
 	if ( best_player_id == 0 || best_player_id != onelinerData->player_id )
@@ -2764,24 +5258,21 @@ void *RS_MysqlSetOneliner_Thread( void *in )
 		// testing if the player has already set a oneliner
 		// retrieve the existing oneliner
 		old_oneliner[0]='\0';
-		sprintf(query, rs_queryLoadMapOneliners->string, onelinerData->map_id);
-		mysql_real_query(&mysql, query, strlen(query));
-        RS_CheckMysqlThreadError(query);
-        mysql_res = mysql_store_result(&mysql);
-        RS_CheckMysqlThreadError(query);
-		if ((row = mysql_fetch_row(mysql_res)) != NULL)
+		stmt = RS_MysqlExecute(rs_queryLoadMapOneliners, onelinerData->map_id);
+        RS_CheckMysqlThreadError(stmt);
+		if (RS_MysqlFetch(stmt))
 	    {
-		    if ( !prejumped && row[0] !=NULL)
+		    if ( !prejumped && !RS_MysqlIsNull(stmt, 0))
 			{
-				Q_strncpyz(old_oneliner, row[0], sizeof(old_oneliner));
+				Q_strncpyz(old_oneliner, RS_MysqlGetString(stmt, 0), sizeof(old_oneliner));
 			}
-            if ( prejumped && row[1] !=NULL)
+            if ( prejumped && !RS_MysqlIsNull(stmt, 1))
             {
-                Q_strncpyz(old_oneliner, row[1], sizeof(old_oneliner));
+                Q_strncpyz(old_oneliner, RS_MysqlGetString(stmt, 1), sizeof(old_oneliner));
             }
 	    }
 
-		mysql_free_result(mysql_res);
+		RS_MysqlFreeResult(stmt);
 
 		if ( strlen(old_oneliner) > 0 )
 		{
@@ -2793,37 +5284,29 @@ void *RS_MysqlSetOneliner_Thread( void *in )
 	// return a failure message
 	if ( failure )
 	{
-		size = strlen( response )+1;
-		players_query[onelinerData->playerNum] = malloc( size );
-		Q_strncpyz( players_query[onelinerData->playerNum], response, size);
-		RS_PushCallbackQueue(RACESOW_CALLBACK_ONELINER, onelinerData->playerNum, 0, 0, 0, 0, 0, 0);
+		RS_PushStringCallback(response, RACESOW_CALLBACK_ONELINER, onelinerData->playerNum, 0, 0, 0, 0, 0, 0);
 
-		free(onelinerData->oneliner);
-		free(onelinerData);
-		RS_EndMysqlThread();
-		return NULL;
+		RS_FreeOnelinerData(onelinerData);
+		return qtrue;
 	}
 
 	// update the new oneliner
 	Q_strncpyz ( oneliner, onelinerData->oneliner, sizeof(oneliner) );
-	RS_EscapeString(oneliner);
-	sprintf(query, rs_querySetMapOneliner->string, prejumped?"pj_oneliner":"oneliner", oneliner, onelinerData->map_id);
-    mysql_real_query(&mysql, query, strlen(query));
-    RS_CheckMysqlThreadError(query);
+	stmt = RS_MysqlExecute(rs_querySetMapOneliner, prejumped?"pj_oneliner":"oneliner", oneliner, onelinerData->map_id);
+    RS_CheckMysqlThreadError(stmt);
+	RS_LeaderboardSetOneliner(onelinerData->map_id, prejumped, oneliner);
 
 	// return confirmation to the player (needed, because the command is waiting for a callback)
 	Q_strncpyz( response, va("Oneliner successfully set to: %s\n", oneliner), sizeof(response));
-	size = strlen( response )+1;
-    players_query[onelinerData->playerNum] = malloc( size );
-    Q_strncpyz( players_query[onelinerData->playerNum], response, size);
-    RS_PushCallbackQueue(RACESOW_CALLBACK_ONELINER, onelinerData->playerNum, 0, 0, 0, 0, 0, 0);
+	RS_PushStringCallback(response, RACESOW_CALLBACK_ONELINER, onelinerData->playerNum, 0, 0, 0, 0, 0, 0);
 
-	free(onelinerData->oneliner);
- 	free(onelinerData);
+	RS_FreeOnelinerData(onelinerData);
 
-	RS_EndMysqlThread();
+    return qtrue;
 
-    return NULL;
+error:
+	RS_FreeOnelinerData(onelinerData);
+	return qfalse;
 }
 
 
@@ -2865,53 +5348,44 @@ qboolean RS_MapValidate( char *mapname)
  * maplist is loaded only once at the beginning of a map, so we don't really
  * need to thread it, also because threads dont support string output.
  *
+ * @param cat catalogue being built
  * @param is_freestyle
  * @return success boolean
  */
-qboolean RS_MysqlLoadMaplist( int is_freestyle )
+static qboolean RS_MysqlLoadMaplist( rs_mapcatalogue_t *cat, int is_freestyle )
 {
-        MYSQL_ROW  row;
-        MYSQL_RES  *mysql_res;
-        char query[MYSQL_QUERY_LENGTH];
-        mapcount = 0;
-        maplist[0] = '\0';
+        rs_mysqlstmt_t *stmt;
 
-        sprintf(query, rs_queryLoadMapList->string, is_freestyle, "name");
-        mysql_real_query(&mysql, query, strlen(query));
-       	if (RS_MysqlError()) {
+        stmt = RS_MysqlExecute(rs_queryLoadMapList, is_freestyle, "name");
+       	if (!stmt) {
             return qfalse;
         }
 
-        mysql_res = mysql_store_result(&mysql);
-       	if (RS_MysqlError()) {
-            return qfalse;
-        }
+       	while( RS_MysqlFetch( stmt ) ) {
 
-       	while( ( row = mysql_fetch_row( mysql_res ) ) ) {
+            char *name = (char *)RS_MysqlGetString( stmt, 0 );
 
-            if ( !RS_MapValidate( row[0] ) )
+            if ( !RS_MapValidate( name ) )
        	        continue;
 
-       	    Q_strncatz( maplist, va( "%s ", row[0] ), sizeof( maplist ) );
-            mapcount++;
-            }
+            RS_MapCatalogueAdd( cat, name );
+        }
 
-        mysql_free_result(mysql_res);
+        RS_MysqlFreeResult(stmt);
         return qtrue;
 }
 
 /**
  * Load the maplist from a given string map list
  *
+ * @param cat catalogue being built
  * @param stringMapList a list of map names separated with spaces
  * @return boolean success
  */
-qboolean RS_BasicLoadMaplist(char *stringMapList)
+static qboolean RS_BasicLoadMaplist( rs_mapcatalogue_t *cat, char *stringMapList )
 {
     char *s, *t;
     static const char *seps = " ,\n\r";
-    maplist[0] = '\0';
-    mapcount = 0;
 
     s = G_CopyString( stringMapList );
     t = strtok( s, seps );
@@ -2919,10 +5393,7 @@ qboolean RS_BasicLoadMaplist(char *stringMapList)
     while( t != NULL )
     {
         if ( RS_MapValidate( t ) )
-        {
-            Q_strncatz( maplist, va("%s ", t), sizeof( maplist ) );
-        mapcount++;
-        }
+            RS_MapCatalogueAdd( cat, t );
 
         t = strtok( NULL, seps);
     }
@@ -2933,60 +5404,70 @@ qboolean RS_BasicLoadMaplist(char *stringMapList)
 
 /**
  * General maplist load function
+ *
+ * Builds a new catalogue and swaps it in, workers keep reading the old one
+ * until then.
  */
 void RS_LoadMaplist( int is_freestyle)
 {
+    rs_mapcatalogue_t cat, old;
+
+    memset( &cat, 0, sizeof( cat ) );
+
     if ( g_enforce_map_pool->integer )
     {
-        RS_BasicLoadMaplist( g_map_pool->string );
+        RS_BasicLoadMaplist( &cat, g_map_pool->string );
     }
     else if ( MysqlConnected )
     {
-        RS_MysqlLoadMaplist( is_freestyle );
+        RS_MysqlLoadMaplist( &cat, is_freestyle );
     }
     else
     {
-        RS_BasicLoadMaplist( g_maplist->string );
+        RS_BasicLoadMaplist( &cat, g_maplist->string );
     }
 
-    G_Printf( "Maplist loaded : %u maps found.\n", mapcount );
+    RS_MapCatalogueIndex( &cat );
+
+    pthread_mutex_lock( &rs_mapCatalogueMutex );
+    old = rs_mapCatalogue;
+    rs_mapCatalogue = cat;
+    pthread_mutex_unlock( &rs_mapCatalogueMutex );
+
+    RS_MapCatalogueFree( &old );
+
+    G_Printf( "Maplist loaded : %i maps found.\n", cat.numMaps );
 }
 
 /**
- * Start the mysql thread
+ * Prepare the worker connection for a job
  *
  * @param void
  * @return void
  */
 void RS_StartMysqlThread()
 {
-    int errNo;
+    rs_mysqlworker_t *worker = RS_MysqlCurrentWorker();
     unsigned long threadId;
 
-    pthread_mutex_lock(&mutexsum);
-
-    threadId = mysql_thread_id(&mysql);
-    errNo = mysql_ping(&mysql);
+    if( !worker || !MysqlConnected )
+        return;
 
-    if (mysql_thread_id(&mysql) != threadId) {
-
-        G_Printf("-------------------------------------\nReconnected to Mysql server\n-------------------------------------\n");
+    if( !worker->connected )
+    {
+        worker->connected = RS_MysqlOpen( &worker->mysql );
+        return;
     }
 
+    threadId = mysql_thread_id(&worker->mysql);
+    mysql_ping(&worker->mysql);
 
-}
+    if (mysql_thread_id(&worker->mysql) != threadId) {
 
-/**
- * Cleanly end the mysql thread
- *
- * @param void
- * @return void
- */
-void RS_EndMysqlThread()
-{
-	//mysql_thread_end(); // looks like thread_init and thread_end are not really needed, saw that on some webpage
-    pthread_mutex_unlock(&mutexsum);
-	pthread_exit(NULL);
+        // the server forgot about our statements
+        RS_MysqlFlushStatements( &worker->stmtCache );
+        G_Printf("-------------------------------------\nMySQL worker %i reconnected\n-------------------------------------\n", worker->num);
+    }
 }
 
 // Functions
@@ -3099,126 +5580,46 @@ void rs_TimeDeltaPrestepProjectile( edict_t *projectile, int timeDelta )
 
 char *RS_ChooseNextMap()
 {
+    static char nextmap[MAX_CONFIGSTRING_CHARS];
+    rs_mapcatalogue_t *cat = &rs_mapCatalogue;
     edict_t *ent = NULL;
-    char *s, *t, *f;
-    static const char *seps = " ,\n\r";
+    char *map;
+    int num;
 
     if( *level.forcemap )
     {
         return level.forcemap;
     }
 
-    if( !( *maplist ) || strlen( maplist ) == 0 || g_maprotation->integer == 0 )
+    if( !RS_MapCount() || g_maprotation->integer == 0 )
     {
         // same map again
         return level.mapname;
     }
     else if( g_maprotation->integer == 1 )
     {
-        // next map in list
-        s = G_CopyString( maplist );
-        f = NULL;
-        t = strtok( s, seps );
-
-        while( t != NULL )
-        {
-            if( !Q_stricmp( t, level.mapname ) )
-            {
-                // it's in the list, go to the next one
-                do {
-                t = strtok( NULL, seps );
-                } while ( t && !trap_ML_FilenameExists( t ) );
-
-                if( t == NULL )
-                {
-                    // end of list, go to first one. if there isn't a first one, same level
-                    if ( f == NULL )
-                    {
-                        G_Free( s );
-                        return level.mapname;
-                    }
-                    else
-                    {
-                        G_Free( s );
-                        return f;
-                    }
-                }
-                else
-                {
-                    G_Free( s );
-                    return t;
-                }
-            }
-            if( !f && trap_ML_FilenameExists( t ) )
-                f = t;
-            t = strtok( NULL, seps );
-        }
-
-        // not in the list, we go for the first one
-        if ( f == NULL )
-        {
-            G_Free( s );
-            return level.mapname;
-        }
-        else
-        {
-            G_Free( s );
-            return f;
-        }
+        // next map in list, or the first one when we're not in the list.
+        // the catalogue is only replaced from this thread, so it can be read unlocked
+        num = RS_MapCatalogueFind( cat, level.mapname );
+        num = ( num + 1 ) % cat->numMaps;
+        Q_strncpyz( nextmap, RS_MapCatalogueName( cat, num ), sizeof( nextmap ) );
+        return nextmap;
     }
     else if( g_maprotation->integer == 2 )
     {
         // random from the list, but not the same
-        char *s1;
-        size_t str_size;
-
-        int count = 0;
-        s = G_CopyString( maplist );
-
-        str_size = strlen( s ) + 1;
-        s1 = G_Malloc( str_size );
-        s1[0] = s1[str_size-1] = '\0';
-
-        t = strtok( s, seps );
-        while( t != NULL )
-        {
-            if( Q_stricmp( t, level.mapname ) && trap_ML_FilenameExists( t ) ) {
-                count++;
-                if( *s1 ) {
-                    Q_strncatz( s1, " ", str_size );
-                }
-                Q_strncatz( s1, t, str_size );
-            }
-            t = strtok( NULL, seps );
-        }
-
-        G_Free( s );
-        s = NULL;
+        int seed = game.realtime;
 
-        if( count < 1 )
+        map = RS_GetRandomMap( level.mapname, Q_random( &seed ) );
+        if( !map )
         {
             // no other maps found, restart
-            G_Free( s1 );
             return level.mapname;
         }
-        else
-        {
-            int seed = game.realtime;
-            count -= (int)Q_brandom( &seed, 0, count ); // this should give random integer from 0 to count-1
-            ent = NULL; // shutup compiler warning;
 
-            t = strtok( s1, seps );
-            while( t != NULL )
-            {
-                count--;
-                if( count == 0 )
-                {
-                    G_Free( s1 );
-                    return t;
-                }
-                t = strtok( NULL, seps );
-            }
-        }
+        Q_strncpyz( nextmap, map, sizeof( nextmap ) );
+        free( map );
+        return nextmap;
     }
 
     if( level.nextmap[0] )  // go to a specific map
@@ -3235,34 +5636,22 @@ char *RS_ChooseNextMap()
     return ent->map;
 }
 
+/**
+ * Name of the map with the given number in the maplist
+ *
+ * @param num 1-based map number
+ * @return char* malloc'd map name, NULL if out of range
+ */
 char *RS_GetMapByNum(int num)
 {
-    char *s, *tok;
-    char *result;
-    int size = 0;
-    static const char *seps = " ,\n\r";
-    int maps = 0;
-
-    s = G_CopyString( maplist );
-    tok = strtok( s, seps );
+    char *result = NULL;
 
-    while ( tok != NULL )
-    {
-        maps++;
-        if ( maps == num )
-        {
-            size = strlen(tok)+1;
-            result = malloc(size);
-            Q_strncpyz(result, tok, size);
-            G_Free( s );
-            return result;
-        }
-        else
-            tok = strtok( NULL, seps );
-    }
+    pthread_mutex_lock( &rs_mapCatalogueMutex );
+    if ( num >= 1 && num <= rs_mapCatalogue.numMaps )
+        result = strdup( RS_MapCatalogueName( &rs_mapCatalogue, num - 1 ) );
+    pthread_mutex_unlock( &rs_mapCatalogueMutex );
 
-    G_Free( s );
-    return NULL;
+    return result;
 }
 
 static void RS_Irc_ConnectedListener_f( void *connected )
@@ -3305,12 +5694,14 @@ void RS_AddServerCommands( void )
 {
     if( rs_IRCstream->integer )
         trap_Cmd_AddCommand( "ircprint", RS_Cmd_ircPrint_f );
+    trap_Cmd_AddCommand( "rs_mysqlstats", RS_Cmd_MysqlStats_f );
 }
 
 void RS_RemoveServerCommands( void )
 {
     if( rs_IRCstream->integer )
         trap_Cmd_RemoveCommand( "ircprint" );
+    trap_Cmd_RemoveCommand( "rs_mysqlstats" );
 }
 
 /**
@@ -399,6 +399,8 @@ void G_AddServerCommands( void )
 
 	trap_Cmd_AddCommand( "listratings", G_ListRatings_f );
 	trap_Cmd_AddCommand( "listraces", G_ListRaces_f );
+
+	trap_Cmd_AddCommand( "areanodes", GClip_AreaNodes_f );
 }
 
 /*
@@ -437,4 +439,6 @@ void G_RemoveCommands( void )
 
 	trap_Cmd_RemoveCommand( "listratings" );
 	trap_Cmd_RemoveCommand( "listraces" );
+
+	trap_Cmd_RemoveCommand( "areanodes" );
 }
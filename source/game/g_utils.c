@@ -871,6 +871,7 @@ void G_FreeEdict( edict_t *ed )
 	qboolean evt = ISEVENTENTITY( &ed->s );
 
 	GClip_UnlinkEntity( ed );   // unlink from world
+	GClip_FreeGridTrigger( ed );
 
 	AI_RemoveGoalEntity( ed );
 	G_FreeAI( ed );
@@ -1312,6 +1312,10 @@ void G_PredictedEvent( int entNum, int ev, int parm )
 	edict_t	*ent;
 	vec3_t upDir = { 0, 0, 1 };
 
+	// replayed later if raised from a parallel pmove
+	if( G_PMove_DeferEvent( entNum, ev, parm ) )
+		return;
+
 	ent = &game.edicts[entNum];
 	switch( ev )
 	{
@@ -1395,13 +1399,13 @@ qboolean ClientMultiviewChanged( edict_t *ent, qboolean multiview )
 }
 
 /*
-* ClientThink
+* G_Client_BeginMove
+* Prepares the pmove of one usercmd
 */
-void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
+void G_Client_BeginMove( edict_t *ent, usercmd_t *ucmd, int timeDelta, pmove_t *pm )
 {
 	gclient_t *client;
-	int i, j;
-	static pmove_t pm;
+	int i;
 	int delta, count;
 
 	client = ent->r.client;
@@ -1484,15 +1488,24 @@ void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
 		client->ps.pmove.pm_type = PM_NORMAL;
 
 	// set up for pmove
-	memset( &pm, 0, sizeof( pmove_t ) );
-	pm.playerState = &client->ps;
-	pm.cmd = *ucmd;
+	memset( pm, 0, sizeof( pmove_t ) );
+	pm->playerState = &client->ps;
+	pm->cmd = *ucmd;
 
 	if( memcmp( &client->old_pmove, &client->ps.pmove, sizeof( pmove_state_t ) ) )
-		pm.snapinitial = qtrue;
+		pm->snapinitial = qtrue;
+}
 
-	// perform a pmove
-	Pmove( &pm );
+/*
+* G_Client_EndMove
+* Applies the results of the pmove of one usercmd to the entity
+*/
+void G_Client_EndMove( edict_t *ent, usercmd_t *ucmd, pmove_t *pm )
+{
+	gclient_t *client;
+	int i, j;
+
+	client = ent->r.client;
 
 	// save results of pmove
 	client->old_pmove = client->ps.pmove;
@@ -1502,12 +1515,12 @@ void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
 	VectorCopy( client->ps.pmove.velocity, ent->velocity );
 	VectorCopy( client->ps.viewangles, ent->s.angles );
 	ent->viewheight = client->ps.viewheight;
-	VectorCopy( pm.mins, ent->r.mins );
-	VectorCopy( pm.maxs, ent->r.maxs );
+	VectorCopy( pm->mins, ent->r.mins );
+	VectorCopy( pm->maxs, ent->r.maxs );
 
-	ent->waterlevel = pm.waterlevel;
-	ent->watertype = pm.watertype;
-	if( pm.groundentity == -1 )
+	ent->waterlevel = pm->waterlevel;
+	ent->watertype = pm->watertype;
+	if( pm->groundentity == -1 )
 	{
 		ent->groundentity = NULL;
 	}
@@ -1515,7 +1528,7 @@ void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
 	{
 		G_AwardResetPlayerComboStats( ent );
 
-		ent->groundentity = &game.edicts[pm.groundentity];
+		ent->groundentity = &game.edicts[pm->groundentity];
 		ent->groundentity_linkcount = ent->groundentity->r.linkcount;
 	}
 	
@@ -1539,12 +1552,12 @@ void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
 		edict_t *other;
 
 		// touch other objects
-		for( i = 0; i < pm.numtouch; i++ )
+		for( i = 0; i < pm->numtouch; i++ )
 		{
-			other = &game.edicts[pm.touchents[i]];
+			other = &game.edicts[pm->touchents[i]];
 			for( j = 0; j < i; j++ )
 			{
-				if( &game.edicts[pm.touchents[j]] == other )
+				if( &game.edicts[pm->touchents[j]] == other )
 					break;
 			}
 			if( j != i )
@@ -1577,7 +1590,7 @@ void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
 	// trigger the instashield
 	if( GS_Instagib() && g_instashield->integer )
 	{
-		if( client->ps.pmove.pm_type == PM_NORMAL && pm.cmd.upmove < 0 &&
+		if( client->ps.pmove.pm_type == PM_NORMAL && pm->cmd.upmove < 0 &&
 			client->resp.instashieldCharge == INSTA_SHIELD_MAX && 
 			client->ps.inventory[POWERUP_SHELL] == 0 )
 		{
@@ -1590,6 +1603,25 @@ void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
 	ClientMakePlrkeys( client, ucmd );
 }
 
+/*
+* ClientThink
+*/
+void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
+{
+	pmove_t pm;
+
+	// race gametypes may run it later, together with other clients
+	if( G_PMove_QueueThink( ent, ucmd, timeDelta ) )
+		return;
+
+	G_Client_BeginMove( ent, ucmd, timeDelta, &pm );
+
+	// perform a pmove
+	Pmove( &pm );
+
+	G_Client_EndMove( ent, ucmd, &pm );
+}
+
 /*
 * G_ClientThink
 * Client frame think, and call to execute its usercommands thinking
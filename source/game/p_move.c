@@ -0,0 +1,347 @@
+// p_move.c -- parallel player movement for race gametypes
+//
+// Racers don't block each other, so while G_RunClients executes the client
+// thinks, their usercmds are only queued. Afterwards they are run in rounds,
+// one usercmd of every client per round: the usercmds are prepared in client
+// order, the movement of all clients runs on a worker pool, and the results,
+// predicted events and trigger touches are applied again in client order.
+
+#include "g_local.h"
+#include <pthread.h>
+
+#define G_PMOVE_MAX_THREADS		32
+#define G_PMOVE_MAX_QUEUED		64	// usercmds of a client per frame, like the server's CMD_BACKUP
+#define G_PMOVE_MAX_EVENTS		8
+
+typedef struct
+{
+	usercmd_t ucmd;
+	int timeDelta;
+} g_pmovethink_t;
+
+typedef struct
+{
+	int numThinks;
+	g_pmovethink_t thinks[G_PMOVE_MAX_QUEUED];
+
+	pmove_t pm;
+
+	int numEvents;
+	int events[G_PMOVE_MAX_EVENTS][2];
+} g_pmoveclient_t;
+
+typedef struct
+{
+	int numThreads;             // including the main thread
+	pthread_t threads[G_PMOVE_MAX_THREADS];
+
+	pthread_mutex_t mutex;
+	pthread_cond_t wakeCond;
+	pthread_cond_t doneCond;
+	pthread_mutex_t boxMutex;
+
+	unsigned int batch;
+	int numJobs, nextJob, numDone;
+	qboolean quit;
+
+	qboolean queueing;          // ClientThink queues the usercmds
+	qboolean moving;            // Pmove_Move is running on the pool
+
+	g_pmoveclient_t *clients;   // [gs.maxclients]
+	int numQueued;
+	int queued[MAX_CLIENTS];    // client numbers, in the order of their first usercmd
+	int jobs[MAX_CLIENTS];      // client numbers moving in this round
+} g_pmovepool_t;
+
+static g_pmovepool_t g_pmovePool;
+
+/*
+* G_PMove_RunJobs
+* called with the mutex locked
+*/
+static void G_PMove_RunJobs( void )
+{
+	int job;
+
+	while( g_pmovePool.nextJob < g_pmovePool.numJobs )
+	{
+		job = g_pmovePool.nextJob++;
+		pthread_mutex_unlock( &g_pmovePool.mutex );
+
+		Pmove_Move( &g_pmovePool.clients[g_pmovePool.jobs[job]].pm );
+
+		pthread_mutex_lock( &g_pmovePool.mutex );
+		if( ++g_pmovePool.numDone == g_pmovePool.numJobs )
+			pthread_cond_signal( &g_pmovePool.doneCond );
+	}
+}
+
+/*
+* G_PMove_Worker
+*/
+static void *G_PMove_Worker( void *param )
+{
+	unsigned int batch = 0;
+
+	pthread_mutex_lock( &g_pmovePool.mutex );
+	while( 1 )
+	{
+		while( !g_pmovePool.quit && g_pmovePool.batch == batch )
+			pthread_cond_wait( &g_pmovePool.wakeCond, &g_pmovePool.mutex );
+		if( g_pmovePool.quit )
+			break;
+
+		batch = g_pmovePool.batch;
+		G_PMove_RunJobs();
+	}
+	pthread_mutex_unlock( &g_pmovePool.mutex );
+
+	return NULL;
+}
+
+/*
+* G_PMove_Shutdown
+*/
+void G_PMove_Shutdown( void )
+{
+	int i;
+
+	if( !g_pmovePool.numThreads )
+		return;
+
+	pthread_mutex_lock( &g_pmovePool.mutex );
+	g_pmovePool.quit = qtrue;
+	pthread_cond_broadcast( &g_pmovePool.wakeCond );
+	pthread_mutex_unlock( &g_pmovePool.mutex );
+
+	for( i = 1; i < g_pmovePool.numThreads; i++ )
+		pthread_join( g_pmovePool.threads[i], NULL );
+
+	pthread_cond_destroy( &g_pmovePool.doneCond );
+	pthread_cond_destroy( &g_pmovePool.wakeCond );
+	pthread_mutex_destroy( &g_pmovePool.boxMutex );
+	pthread_mutex_destroy( &g_pmovePool.mutex );
+
+	G_Free( g_pmovePool.clients );
+
+	memset( &g_pmovePool, 0, sizeof( g_pmovePool ) );
+}
+
+/*
+* G_PMove_Init
+*/
+static void G_PMove_Init( int numThreads )
+{
+	int i;
+
+	memset( &g_pmovePool, 0, sizeof( g_pmovePool ) );
+
+	pthread_mutex_init( &g_pmovePool.mutex, NULL );
+	pthread_mutex_init( &g_pmovePool.boxMutex, NULL );
+	pthread_cond_init( &g_pmovePool.wakeCond, NULL );
+	pthread_cond_init( &g_pmovePool.doneCond, NULL );
+
+	g_pmovePool.clients = G_Malloc( gs.maxclients * sizeof( g_pmoveclient_t ) );
+
+	g_pmovePool.numThreads = 1;
+	for( i = 1; i < numThreads; i++ )
+	{
+		if( pthread_create( &g_pmovePool.threads[i], NULL, G_PMove_Worker, NULL ) )
+		{
+			G_Printf( "G_PMove_Init: failed to create a worker thread\n" );
+			break;
+		}
+		g_pmovePool.numThreads++;
+	}
+
+	G_Printf( "Parallel player movement with %i threads\n", g_pmovePool.numThreads );
+}
+
+/*
+* G_PMove_BeginThinks
+* returns qtrue if the usercmds of this frame are queued until G_PMove_EndThinks
+*/
+qboolean G_PMove_BeginThinks( void )
+{
+	int numThreads;
+
+	numThreads = g_pmovethreads->integer;
+	clamp( numThreads, 0, G_PMOVE_MAX_THREADS );
+	if( numThreads == 1 )
+		numThreads = 0;
+
+	if( numThreads != g_pmovePool.numThreads )
+	{
+		G_PMove_Shutdown();
+		if( numThreads )
+			G_PMove_Init( numThreads );
+	}
+
+	if( g_pmovePool.numThreads < 2 || !GS_RaceGametype() )
+		return qfalse;
+
+	g_pmovePool.numQueued = 0;
+	g_pmovePool.queueing = qtrue;
+	return qtrue;
+}
+
+/*
+* G_PMove_QueueThink
+* returns qtrue if the usercmd was queued to be run later
+*/
+qboolean G_PMove_QueueThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
+{
+	g_pmoveclient_t *pmclient;
+	g_pmovethink_t *think;
+	pmove_t pm;
+	int i, clientNum;
+
+	if( !g_pmovePool.queueing )
+		return qfalse;
+
+	clientNum = PLAYERNUM( ent );
+	if( clientNum < 0 || clientNum >= gs.maxclients )
+		return qfalse;
+
+	pmclient = &g_pmovePool.clients[clientNum];
+	if( !pmclient->numThinks )
+	{
+		g_pmovePool.queued[g_pmovePool.numQueued++] = clientNum;
+	}
+	else if( pmclient->numThinks == G_PMOVE_MAX_QUEUED )
+	{
+		// too many, run the queued ones now so the order is kept
+		g_pmovePool.queueing = qfalse;
+		for( i = 0; i < pmclient->numThinks; i++ )
+		{
+			think = &pmclient->thinks[i];
+			G_Client_BeginMove( ent, &think->ucmd, think->timeDelta, &pm );
+			Pmove( &pm );
+			G_Client_EndMove( ent, &think->ucmd, &pm );
+		}
+		pmclient->numThinks = 0;
+		g_pmovePool.queueing = qtrue;
+	}
+
+	think = &pmclient->thinks[pmclient->numThinks++];
+	think->ucmd = *ucmd;
+	think->timeDelta = timeDelta;
+	return qtrue;
+}
+
+/*
+* G_PMove_DeferEvent
+* returns qtrue if the event was raised from Pmove_Move on the pool and has to wait
+*/
+qboolean G_PMove_DeferEvent( int entNum, int ev, int parm )
+{
+	g_pmoveclient_t *pmclient;
+
+	if( !g_pmovePool.moving )
+		return qfalse;
+
+	// only the moving player can raise them, so no locking is needed
+	pmclient = &g_pmovePool.clients[entNum - 1];
+	if( pmclient->numEvents < G_PMOVE_MAX_EVENTS )
+	{
+		pmclient->events[pmclient->numEvents][0] = ev;
+		pmclient->events[pmclient->numEvents][1] = parm;
+		pmclient->numEvents++;
+	}
+	return qtrue;
+}
+
+/*
+* G_PMove_LockBoxModels
+* the temporary box hulls of the collision model are shared
+*/
+void G_PMove_LockBoxModels( void )
+{
+	if( g_pmovePool.moving )
+		pthread_mutex_lock( &g_pmovePool.boxMutex );
+}
+
+/*
+* G_PMove_UnlockBoxModels
+*/
+void G_PMove_UnlockBoxModels( void )
+{
+	if( g_pmovePool.moving )
+		pthread_mutex_unlock( &g_pmovePool.boxMutex );
+}
+
+/*
+* G_PMove_EndThinks
+* runs the queued usercmds
+*/
+void G_PMove_EndThinks( void )
+{
+	int i, j, round, clientNum, numJobs;
+	g_pmoveclient_t *pmclient;
+	g_pmovethink_t *think;
+	edict_t *ent;
+
+	g_pmovePool.queueing = qfalse;
+
+	for( round = 0; ; round++ )
+	{
+		// prepare the moves of this round, in client order. The workers
+		// don't look at the jobs until numJobs is set below
+		numJobs = 0;
+		for( i = 0; i < g_pmovePool.numQueued; i++ )
+		{
+			clientNum = g_pmovePool.queued[i];
+			pmclient = &g_pmovePool.clients[clientNum];
+			if( round >= pmclient->numThinks )
+				continue;
+
+			// it may have been dropped by a touch in the previous round
+			ent = game.edicts + 1 + clientNum;
+			if( !ent->r.inuse || !ent->r.client )
+				continue;
+
+			think = &pmclient->thinks[round];
+			G_Client_BeginMove( ent, &think->ucmd, think->timeDelta, &pmclient->pm );
+			pmclient->numEvents = 0;
+			g_pmovePool.jobs[numJobs++] = clientNum;
+		}
+
+		if( !numJobs )
+			break;
+
+		// move them all, the main thread helps the workers
+		pthread_mutex_lock( &g_pmovePool.mutex );
+		g_pmovePool.moving = qtrue;
+		g_pmovePool.numJobs = numJobs;
+		g_pmovePool.nextJob = 0;
+		g_pmovePool.numDone = 0;
+		g_pmovePool.batch++;
+		pthread_cond_broadcast( &g_pmovePool.wakeCond );
+
+		G_PMove_RunJobs();
+		while( g_pmovePool.numDone < g_pmovePool.numJobs )
+			pthread_cond_wait( &g_pmovePool.doneCond, &g_pmovePool.mutex );
+		g_pmovePool.moving = qfalse;
+		pthread_mutex_unlock( &g_pmovePool.mutex );
+
+		// apply the results, in client order
+		for( i = 0; i < numJobs; i++ )
+		{
+			clientNum = g_pmovePool.jobs[i];
+			pmclient = &g_pmovePool.clients[clientNum];
+			ent = game.edicts + 1 + clientNum;
+			if( !ent->r.inuse || !ent->r.client )
+				continue;
+
+			for( j = 0; j < pmclient->numEvents; j++ )
+				G_PredictedEvent( ENTNUM( ent ), pmclient->events[j][0], pmclient->events[j][1] );
+
+			Pmove_Finish( &pmclient->pm );
+			G_Client_EndMove( ent, &pmclient->thinks[round].ucmd, &pmclient->pm );
+		}
+	}
+
+	for( i = 0; i < g_pmovePool.numQueued; i++ )
+		g_pmovePool.clients[g_pmovePool.queued[i]].numThinks = 0;
+	g_pmovePool.numQueued = 0;
+}
@@ -83,9 +83,6 @@ typedef struct
 	float dashPlayerSpeed;
 } pml_t;
 
-pmove_t	*pm;
-pml_t pml;
-
 // movement parameters
 
 #define DEFAULT_WALKSPEED 160.0f
@@ -119,7 +116,7 @@ const float pm_wjupspeed = ( 330.0f * GRAVITY_COMPENSATE );
 const float pm_failedwjupspeed = ( 50.0f * GRAVITY_COMPENSATE );
 const float pm_wjbouncefactor = 0.3f;
 const float pm_failedwjbouncefactor = 0.1f;
-#define pm_wjminspeed ( ( pml.maxWalkSpeed + pml.maxPlayerSpeed ) * 0.5f )
+#define pm_wjminspeed ( ( pml->maxWalkSpeed + pml->maxPlayerSpeed ) * 0.5f )
 #endif
 
 //
@@ -148,7 +145,7 @@ static vec_t VectorNormalize2D( vec3_t v ) // ByMiK : normalize horizontally (do
 // maxZnormal is the Z value of the normal of a poly to considere it as a wall
 // normal is a pointer to the normal of the nearest wall
 
-static void PlayerTouchWall( int nbTestDir, float maxZnormal, vec3_t *normal )
+static void PlayerTouchWall( pmove_t *pm, pml_t *pml, int nbTestDir, float maxZnormal, vec3_t *normal )
 {
 	vec3_t min, max, dir;
 	int i, j;
@@ -158,10 +155,10 @@ static void PlayerTouchWall( int nbTestDir, float maxZnormal, vec3_t *normal )
 
 	for( i = 0; i < nbTestDir; i++ )
 	{
-		//FIXME: the 0.015f were pml.frametime in racesow 0.62. Was this an tracked racesow change? -K1ll
-		dir[0] = pml.origin[0] + ( pm->maxs[0]*cos( ( M_TWOPI/nbTestDir )*i ) + pml.velocity[0] * 0.015f );
-		dir[1] = pml.origin[1] + ( pm->maxs[1]*sin( ( M_TWOPI/nbTestDir )*i ) + pml.velocity[1] * 0.015f );
-		dir[2] = pml.origin[2];
+		//FIXME: the 0.015f were pml->frametime in racesow 0.62. Was this an tracked racesow change? -K1ll
+		dir[0] = pml->origin[0] + ( pm->maxs[0]*cos( ( M_TWOPI/nbTestDir )*i ) + pml->velocity[0] * 0.015f );
+		dir[1] = pml->origin[1] + ( pm->maxs[1]*sin( ( M_TWOPI/nbTestDir )*i ) + pml->velocity[1] * 0.015f );
+		dir[2] = pml->origin[2];
 
 		for( j = 0; j < 2; j++ )
 		{
@@ -171,7 +168,7 @@ static void PlayerTouchWall( int nbTestDir, float maxZnormal, vec3_t *normal )
 		min[2] = max[2] = 0;
 		VectorScale( dir, 1.002, dir );
 
-		module_Trace( &trace, pml.origin, min, max, dir, pm->playerState->POVnum, pm->contentmask, 0 );
+		module_Trace( &trace, pml->origin, min, max, dir, pm->playerState->POVnum, pm->contentmask, 0 );
 
 		if( trace.allsolid ) return;
 
@@ -212,7 +209,7 @@ static void PlayerTouchWall( int nbTestDir, float maxZnormal, vec3_t *normal )
 
 #define	MAX_CLIP_PLANES	5
 
-static void PM_AddTouchEnt( int entNum )
+static void PM_AddTouchEnt( pmove_t *pm, int entNum )
 {
 	int i;
 
@@ -232,7 +229,7 @@ static void PM_AddTouchEnt( int entNum )
 }
 
 
-static int PM_SlideMove( void )
+static int PM_SlideMove( pmove_t *pm, pml_t *pml )
 {
 	vec3_t end, dir;
 	vec3_t old_velocity, last_valid_origin;
@@ -242,34 +239,34 @@ static int PM_SlideMove( void )
 	trace_t	trace;
 	int moves, i, j, k;
 	int maxmoves = 4;
-	float remainingTime = pml.frametime;
+	float remainingTime = pml->frametime;
 	int blockedmask = 0;
 
-	VectorCopy( pml.velocity, old_velocity );
-	VectorCopy( pml.origin, last_valid_origin );
+	VectorCopy( pml->velocity, old_velocity );
+	VectorCopy( pml->origin, last_valid_origin );
 
 	if( pm->groundentity != -1 )
 	{                          // clip velocity to ground, no need to wait
 		// if the ground is not horizontal (a ramp) clipping will slow the player down
-		if( pml.groundplane.normal[2] == 1.0f && pml.velocity[2] < 0.0f )
-			pml.velocity[2] = 0.0f;
+		if( pml->groundplane.normal[2] == 1.0f && pml->velocity[2] < 0.0f )
+			pml->velocity[2] = 0.0f;
 	}
 
 	numplanes = 0; // clean up planes count for checking
 
 	for( moves = 0; moves < maxmoves; moves++ )
 	{
-		VectorMA( pml.origin, remainingTime, pml.velocity, end );
-		module_Trace( &trace, pml.origin, pm->mins, pm->maxs, end, pm->playerState->POVnum, pm->contentmask, 0 );
+		VectorMA( pml->origin, remainingTime, pml->velocity, end );
+		module_Trace( &trace, pml->origin, pm->mins, pm->maxs, end, pm->playerState->POVnum, pm->contentmask, 0 );
 		if( trace.allsolid )
 		{               // trapped into a solid
-			VectorCopy( last_valid_origin, pml.origin );
+			VectorCopy( last_valid_origin, pml->origin );
 			return SLIDEMOVEFLAG_TRAPPED;
 		}
 
 		if( trace.fraction > 0 )
 		{                   // actually covered some distance
-			VectorCopy( trace.endpos, pml.origin );
+			VectorCopy( trace.endpos, pml->origin );
 			VectorCopy( trace.endpos, last_valid_origin );
 		}
 
@@ -277,7 +274,7 @@ static int PM_SlideMove( void )
 			break; // move done
 
 		// save touched entity for return output
-		PM_AddTouchEnt( trace.ent );
+		PM_AddTouchEnt( pm, trace.ent );
 
 		// at this point we are blocked but not trapped.
 
@@ -297,7 +294,7 @@ static int PM_SlideMove( void )
 		{
 			if( DotProduct( trace.plane.normal, planes[i] ) > ( 1.0f - SLIDEMOVE_PLANEINTERACT_EPSILON ) )
 			{
-				VectorAdd( trace.plane.normal, pml.velocity, pml.velocity );
+				VectorAdd( trace.plane.normal, pml->velocity, pml->velocity );
 				break;
 			}
 		}
@@ -307,7 +304,7 @@ static int PM_SlideMove( void )
 		// security check: we can't store more planes
 		if( numplanes >= MAX_CLIP_PLANES )
 		{
-			VectorClear( pml.velocity );
+			VectorClear( pml->velocity );
 			return SLIDEMOVEFLAG_TRAPPED;
 		}
 
@@ -321,39 +318,39 @@ static int PM_SlideMove( void )
 
 		for( i = 0; i < numplanes; i++ )
 		{
-			if( DotProduct( pml.velocity, planes[i] ) >= SLIDEMOVE_PLANEINTERACT_EPSILON )  // would not touch it
+			if( DotProduct( pml->velocity, planes[i] ) >= SLIDEMOVE_PLANEINTERACT_EPSILON )  // would not touch it
 				continue;
 
-			GS_ClipVelocity( pml.velocity, planes[i], pml.velocity, PM_OVERBOUNCE );
+			GS_ClipVelocity( pml->velocity, planes[i], pml->velocity, PM_OVERBOUNCE );
 			// see if we enter a second plane
 			for( j = 0; j < numplanes; j++ )
 			{
 				if( j == i )  // it's the same plane
 					continue;
-				if( DotProduct( pml.velocity, planes[j] ) >= SLIDEMOVE_PLANEINTERACT_EPSILON )
+				if( DotProduct( pml->velocity, planes[j] ) >= SLIDEMOVE_PLANEINTERACT_EPSILON )
 					continue; // not with this one
 
 				//there was a second one. Try to slide along it too
-				GS_ClipVelocity( pml.velocity, planes[j], pml.velocity, PM_OVERBOUNCE );
+				GS_ClipVelocity( pml->velocity, planes[j], pml->velocity, PM_OVERBOUNCE );
 
 				// check if the slide sent it back to the first plane
-				if( DotProduct( pml.velocity, planes[i] ) >= SLIDEMOVE_PLANEINTERACT_EPSILON )
+				if( DotProduct( pml->velocity, planes[i] ) >= SLIDEMOVE_PLANEINTERACT_EPSILON )
 					continue;
 
 				// bad luck: slide the original velocity along the crease
 				CrossProduct( planes[i], planes[j], dir );
 				VectorNormalize( dir );
-				value = DotProduct( dir, pml.velocity );
-				VectorScale( dir, value, pml.velocity );
+				value = DotProduct( dir, pml->velocity );
+				VectorScale( dir, value, pml->velocity );
 
 				// check if there is a third plane, in that case we're trapped
 				for( k = 0; k < numplanes; k++ )
 				{
 					if( j == k || i == k )  // it's the same plane
 						continue;
-					if( DotProduct( pml.velocity, planes[k] ) >= SLIDEMOVE_PLANEINTERACT_EPSILON )
+					if( DotProduct( pml->velocity, planes[k] ) >= SLIDEMOVE_PLANEINTERACT_EPSILON )
 						continue; // not with this one
-					VectorClear( pml.velocity );
+					VectorClear( pml->velocity );
 					break;
 				}
 			}
@@ -362,7 +359,7 @@ static int PM_SlideMove( void )
 
 	if( pm->playerState->pmove.pm_time )
 	{
-		VectorCopy( old_velocity, pml.velocity );
+		VectorCopy( old_velocity, pml->velocity );
 	}
 
 	return blockedmask;
@@ -374,7 +371,7 @@ static int PM_SlideMove( void )
 * Each intersection will try to step over the obstruction instead of
 * sliding along it.
 */
-static void PM_StepSlideMove( void )
+static void PM_StepSlideMove( pmove_t *pm, pml_t *pml )
 {
 	vec3_t start_o, start_v;
 	vec3_t down_o, down_v;
@@ -383,13 +380,13 @@ static void PM_StepSlideMove( void )
 	vec3_t up, down;
 	int blocked;
 
-	VectorCopy( pml.origin, start_o );
-	VectorCopy( pml.velocity, start_v );
+	VectorCopy( pml->origin, start_o );
+	VectorCopy( pml->velocity, start_v );
 
-	blocked = PM_SlideMove();
+	blocked = PM_SlideMove( pm, pml );
 
-	VectorCopy( pml.origin, down_o );
-	VectorCopy( pml.velocity, down_v );
+	VectorCopy( pml->origin, down_o );
+	VectorCopy( pml->velocity, down_v );
 
 	VectorCopy( start_o, up );
 	up[2] += STEPSIZE;
@@ -399,21 +396,21 @@ static void PM_StepSlideMove( void )
 		return; // can't step up
 
 	// try sliding above
-	VectorCopy( up, pml.origin );
-	VectorCopy( start_v, pml.velocity );
+	VectorCopy( up, pml->origin );
+	VectorCopy( start_v, pml->velocity );
 
-	PM_SlideMove();
+	PM_SlideMove( pm, pml );
 
 	// push down the final amount
-	VectorCopy( pml.origin, down );
+	VectorCopy( pml->origin, down );
 	down[2] -= STEPSIZE;
-	module_Trace( &trace, pml.origin, pm->mins, pm->maxs, down, pm->playerState->POVnum, pm->contentmask, 0 );
+	module_Trace( &trace, pml->origin, pm->mins, pm->maxs, down, pm->playerState->POVnum, pm->contentmask, 0 );
 	if( !trace.allsolid )
 	{
-		VectorCopy( trace.endpos, pml.origin );
+		VectorCopy( trace.endpos, pml->origin );
 	}
 
-	VectorCopy( pml.origin, up );
+	VectorCopy( pml->origin, up );
 
 	// decide which one went farther
 	down_dist = ( down_o[0] - start_o[0] )*( down_o[0] - start_o[0] )
@@ -423,22 +420,22 @@ static void PM_StepSlideMove( void )
 
 	if( down_dist >= up_dist || trace.allsolid || ( trace.fraction != 1.0 && !ISWALKABLEPLANE( &trace.plane ) ) )
 	{
-		VectorCopy( down_o, pml.origin );
-		VectorCopy( down_v, pml.velocity );
+		VectorCopy( down_o, pml->origin );
+		VectorCopy( down_v, pml->velocity );
 		return;
 	}
 
 	// only add the stepping output when it was a vertical step (second case is at the exit of a ramp)
 	if( ( blocked & SLIDEMOVEFLAG_WALL_BLOCKED ) || trace.plane.normal[2] == 1.0f - SLIDEMOVE_PLANEINTERACT_EPSILON )
 	{
-		pm->step = ( pml.origin[2] - pml.previous_origin[2] );
+		pm->step = ( pml->origin[2] - pml->previous_origin[2] );
 	}
 
 	// wsw : jal : The following line is what produces the ramp sliding.
 
 	//!! Special case
 	// if we were walking along a plane, then we need to copy the Z over
-	pml.velocity[2] = down_v[2];
+	pml->velocity[2] = down_v[2];
 }
 
 /*
@@ -446,14 +443,14 @@ static void PM_StepSlideMove( void )
 * 
 * Handles both ground friction and water friction
 */
-static void PM_Friction( void )
+static void PM_Friction( pmove_t *pm, pml_t *pml )
 {
 	float *vel;
 	float speed, newspeed, control;
 	float friction;
 	float drop;
 
-	vel = pml.velocity;
+	vel = pml->velocity;
 
 	speed = vel[0]*vel[0] +vel[1]*vel[1] + vel[2]*vel[2];
 	if( speed < 1 )
@@ -467,19 +464,19 @@ static void PM_Friction( void )
 	drop = 0;
 
 	// apply ground friction
-	if( ( ( ( ( pm->groundentity != -1 ) && !( pml.groundsurfFlags & SURF_SLICK ) ) ) && ( pm->waterlevel < 2 ) ) || ( pml.ladder ) )
+	if( ( ( ( ( pm->groundentity != -1 ) && !( pml->groundsurfFlags & SURF_SLICK ) ) ) && ( pm->waterlevel < 2 ) ) || ( pml->ladder ) )
 	{
 		if( pm->playerState->pmove.stats[PM_STAT_KNOCKBACK] <= 0 )
 		{
 			friction = pm_friction;
 			control = speed < pm_decelerate ? pm_decelerate : speed;
-			drop += control * friction * pml.frametime;
+			drop += control * friction * pml->frametime;
 		}
 	}
 
 	// apply water friction
-	if( ( pm->waterlevel >= 2 ) && !pml.ladder )
-		drop += speed * pm_waterfriction * pm->waterlevel * pml.frametime;
+	if( ( pm->waterlevel >= 2 ) && !pml->ladder )
+		drop += speed * pm_waterfriction * pm->waterlevel * pml->frametime;
 
 	// scale the velocity
 	newspeed = speed - drop;
@@ -500,24 +497,24 @@ static void PM_Friction( void )
 * 
 * Handles user intended acceleration
 */
-static void PM_Accelerate( vec3_t wishdir, float wishspeed, float accel )
+static void PM_Accelerate( pml_t *pml, vec3_t wishdir, float wishspeed, float accel )
 {
 	int i;
 	float addspeed, accelspeed, currentspeed;
 
-	currentspeed = DotProduct( pml.velocity, wishdir );
+	currentspeed = DotProduct( pml->velocity, wishdir );
 	addspeed = wishspeed - currentspeed;
 	if( addspeed <= 0 )
 		return;
-	accelspeed = accel*pml.frametime*wishspeed;
+	accelspeed = accel*pml->frametime*wishspeed;
 	if( accelspeed > addspeed )
 		accelspeed = addspeed;
 
 	for( i = 0; i < 3; i++ )
-		pml.velocity[i] += accelspeed*wishdir[i];
+		pml->velocity[i] += accelspeed*wishdir[i];
 }
 
-static void PM_AirAccelerate( vec3_t wishdir, float wishspeed )
+static void PM_AirAccelerate( pml_t *pml, vec3_t wishdir, float wishspeed )
 {
 	vec3_t curvel, wishvel, acceldir, curdir;
 	float addspeed, accelspeed, curspeed;
@@ -534,28 +531,28 @@ static void PM_AirAccelerate( vec3_t wishdir, float wishspeed )
 	if( !wishspeed )
 		return;
 
-	VectorCopy( pml.velocity, curvel );
+	VectorCopy( pml->velocity, curvel );
 	curvel[2] = 0;
 	curspeed = VectorLength( curvel );
 
 	if( wishspeed > curspeed * 1.01f ) // moving below pm_maxspeed
 	{
-		float accelspeed = curspeed + airforwardaccel * pml.maxPlayerSpeed * pml.frametime;
+		float accelspeed = curspeed + airforwardaccel * pml->maxPlayerSpeed * pml->frametime;
 		if( accelspeed < wishspeed )
 			wishspeed = accelspeed;
 	}
 	else
 	{
-		float f = ( bunnytopspeed - curspeed ) / ( bunnytopspeed - pml.maxPlayerSpeed );
+		float f = ( bunnytopspeed - curspeed ) / ( bunnytopspeed - pml->maxPlayerSpeed );
 		if( f < 0 )
 			f = 0;
-		wishspeed = max( curspeed, pml.maxPlayerSpeed ) + bunnyaccel * f * pml.maxPlayerSpeed * pml.frametime;
+		wishspeed = max( curspeed, pml->maxPlayerSpeed ) + bunnyaccel * f * pml->maxPlayerSpeed * pml->frametime;
 	}
 	VectorScale( wishdir, wishspeed, wishvel );
 	VectorSubtract( wishvel, curvel, acceldir );
 	addspeed = VectorNormalize( acceldir );
 
-	accelspeed = turnaccel * pml.maxPlayerSpeed * pml.frametime;
+	accelspeed = turnaccel * pml->maxPlayerSpeed * pml->frametime;
 	if( accelspeed > addspeed )
 		accelspeed = addspeed;
 
@@ -567,11 +564,11 @@ static void PM_AirAccelerate( vec3_t wishdir, float wishspeed )
 			VectorMA( acceldir, -( 1.0f - backtosideratio ) * dot, curdir, acceldir );
 	}
 
-	VectorMA( pml.velocity, accelspeed, acceldir, pml.velocity );
+	VectorMA( pml->velocity, accelspeed, acceldir, pml->velocity );
 }
 
 // when using +strafe convert the inertia to forward speed.
-static void PM_Aircontrol( pmove_t *pm, vec3_t wishdir, float wishspeed )
+static void PM_Aircontrol( pml_t *pml, vec3_t wishdir, float wishspeed )
 {
 	float zspeed, speed, dot, k;
 	int i;
@@ -581,53 +578,53 @@ static void PM_Aircontrol( pmove_t *pm, vec3_t wishdir, float wishspeed )
 		return;
 
 	// accelerate
-	fmove = pml.forwardPush;
-	smove = pml.sidePush;
+	fmove = pml->forwardPush;
+	smove = pml->sidePush;
 
 	if( ( smove > 0 || smove < 0 ) || ( wishspeed == 0.0 ) )
 		return; // can't control movement if not moving forward or backward
 
-	zspeed = pml.velocity[2];
-	pml.velocity[2] = 0;
-	speed = VectorNormalize( pml.velocity );
+	zspeed = pml->velocity[2];
+	pml->velocity[2] = 0;
+	speed = VectorNormalize( pml->velocity );
 
 
-	dot = DotProduct( pml.velocity, wishdir );
-	k = 32.0f * pm_aircontrol * dot * dot * pml.frametime;
+	dot = DotProduct( pml->velocity, wishdir );
+	k = 32.0f * pm_aircontrol * dot * dot * pml->frametime;
 
 	if( dot > 0 )
 	{
 		// we can't change direction while slowing down
 		for( i = 0; i < 2; i++ )
-			pml.velocity[i] = pml.velocity[i] * speed + wishdir[i] * k;
+			pml->velocity[i] = pml->velocity[i] * speed + wishdir[i] * k;
 
-		VectorNormalize( pml.velocity );
+		VectorNormalize( pml->velocity );
 	}
 
 	for( i = 0; i < 2; i++ )
-		pml.velocity[i] *= speed;
+		pml->velocity[i] *= speed;
 
-	pml.velocity[2] = zspeed;
+	pml->velocity[2] = zspeed;
 }
 
 #if 0 // never used
-static void PM_AirAccelerate( vec3_t wishdir, float wishspeed, float accel )
+static void PM_AirAccelerate( pml_t *pml, vec3_t wishdir, float wishspeed, float accel )
 {
 	int i;
 	float addspeed, accelspeed, currentspeed, wishspd = wishspeed;
 
 	if( wishspd > 30 )
 		wishspd = 30;
-	currentspeed = DotProduct( pml.velocity, wishdir );
+	currentspeed = DotProduct( pml->velocity, wishdir );
 	addspeed = wishspd - currentspeed;
 	if( addspeed <= 0 )
 		return;
-	accelspeed = accel * wishspeed * pml.frametime;
+	accelspeed = accel * wishspeed * pml->frametime;
 	if( accelspeed > addspeed )
 		accelspeed = addspeed;
 
 	for( i = 0; i < 3; i++ )
-		pml.velocity[i] += accelspeed*wishdir[i];
+		pml->velocity[i] += accelspeed*wishdir[i];
 }
 #endif
 
@@ -635,21 +632,21 @@ static void PM_AirAccelerate( vec3_t wishdir, float wishspeed, float accel )
 /*
 * PM_AddCurrents
 */
-static void PM_AddCurrents( vec3_t wishvel )
+static void PM_AddCurrents( pmove_t *pm, pml_t *pml, vec3_t wishvel )
 {
 	//
 	// account for ladders
 	//
 
-	if( pml.ladder && fabs( pml.velocity[2] ) <= DEFAULT_LADDERSPEED )
+	if( pml->ladder && fabs( pml->velocity[2] ) <= DEFAULT_LADDERSPEED )
 	{
-		if( ( pm->playerState->viewangles[PITCH] <= -15 ) && ( pml.forwardPush > 0 ) )
+		if( ( pm->playerState->viewangles[PITCH] <= -15 ) && ( pml->forwardPush > 0 ) )
 			wishvel[2] = DEFAULT_LADDERSPEED;
-		else if( ( pm->playerState->viewangles[PITCH] >= 15 ) && ( pml.forwardPush > 0 ) )
+		else if( ( pm->playerState->viewangles[PITCH] >= 15 ) && ( pml->forwardPush > 0 ) )
 			wishvel[2] = -DEFAULT_LADDERSPEED;
-		else if( pml.upPush > 0 )
+		else if( pml->upPush > 0 )
 			wishvel[2] = DEFAULT_LADDERSPEED;
-		else if( pml.upPush < 0 )
+		else if( pml->upPush < 0 )
 			wishvel[2] = -DEFAULT_LADDERSPEED;
 		else
 			wishvel[2] = 0;
@@ -664,7 +661,7 @@ static void PM_AddCurrents( vec3_t wishvel )
 * PM_WaterMove
 * 
 */
-static void PM_WaterMove( void )
+static void PM_WaterMove( pmove_t *pm, pml_t *pml )
 {
 	int i;
 	vec3_t wishvel;
@@ -673,35 +670,35 @@ static void PM_WaterMove( void )
 
 	// user intentions
 	for( i = 0; i < 3; i++ )
-		wishvel[i] = pml.forward[i]*pml.forwardPush + pml.right[i]*pml.sidePush;
+		wishvel[i] = pml->forward[i]*pml->forwardPush + pml->right[i]*pml->sidePush;
 
-	if( !pml.forwardPush && !pml.sidePush && !pml.upPush )
+	if( !pml->forwardPush && !pml->sidePush && !pml->upPush )
 		wishvel[2] -= 60; // drift towards bottom
 	else
-		wishvel[2] += pml.upPush;
+		wishvel[2] += pml->upPush;
 
-	PM_AddCurrents( wishvel );
+	PM_AddCurrents( pm, pml, wishvel );
 
 	VectorCopy( wishvel, wishdir );
 	wishspeed = VectorNormalize( wishdir );
 
-	if( wishspeed > pml.maxPlayerSpeed )
+	if( wishspeed > pml->maxPlayerSpeed )
 	{
-		wishspeed = pml.maxPlayerSpeed / wishspeed;
+		wishspeed = pml->maxPlayerSpeed / wishspeed;
 		VectorScale( wishvel, wishspeed, wishvel );
-		wishspeed = pml.maxPlayerSpeed;
+		wishspeed = pml->maxPlayerSpeed;
 	}
 	wishspeed *= 0.5;
 
-	PM_Accelerate( wishdir, wishspeed, pm_wateraccelerate );
-	PM_StepSlideMove();
+	PM_Accelerate( pml, wishdir, wishspeed, pm_wateraccelerate );
+	PM_StepSlideMove( pm, pml );
 }
 
 /*
 * PM_Move -- Kurim
 * 
 */
-static void PM_Move( void )
+static void PM_Move( pmove_t *pm, pml_t *pml )
 {
 	int i;
 	vec3_t wishvel;
@@ -711,15 +708,16 @@ static void PM_Move( void )
 	float maxspeed;
 	float accel;
 	float wishspeed2;
+	vec3_t hvel;
 
-	fmove = pml.forwardPush;
-	smove = pml.sidePush;
+	fmove = pml->forwardPush;
+	smove = pml->sidePush;
 
 	for( i = 0; i < 2; i++ )
-		wishvel[i] = pml.forward[i]*fmove + pml.right[i]*smove;
+		wishvel[i] = pml->forward[i]*fmove + pml->right[i]*smove;
 	wishvel[2] = 0;
 
-	PM_AddCurrents( wishvel );
+	PM_AddCurrents( pm, pml, wishvel );
 
 	VectorCopy( wishvel, wishdir );
 	wishspeed = VectorNormalize( wishdir );
@@ -728,14 +726,14 @@ static void PM_Move( void )
 
 	if( pm->playerState->pmove.stats[PM_STAT_CROUCHTIME] )
 	{
-		maxspeed = pml.maxCrouchedSpeed;
+		maxspeed = pml->maxCrouchedSpeed;
 	}
 	else if( ( pm->cmd.buttons & BUTTON_WALK ) && ( pm->playerState->pmove.stats[PM_STAT_FEATURES] & PMFEAT_WALK ) )
 	{
-		maxspeed = pml.maxWalkSpeed;
+		maxspeed = pml->maxWalkSpeed;
 	}
 	else
-		maxspeed = pml.maxPlayerSpeed;
+		maxspeed = pml->maxPlayerSpeed;
 
 	if( wishspeed > maxspeed )
 	{
@@ -744,53 +742,55 @@ static void PM_Move( void )
 		wishspeed = maxspeed;
 	}
 
-	if( pml.ladder )
+	if( pml->ladder )
 	{
-		PM_Accelerate( wishdir, wishspeed, pm_accelerate );
+		PM_Accelerate( pml, wishdir, wishspeed, pm_accelerate );
 
 		if( !wishvel[2] )
 		{
-			if( pml.velocity[2] > 0 )
+			if( pml->velocity[2] > 0 )
 			{
-				pml.velocity[2] -= pm->playerState->pmove.gravity * pml.frametime;
-				if( pml.velocity[2] < 0 )
-					pml.velocity[2]  = 0;
+				pml->velocity[2] -= pm->playerState->pmove.gravity * pml->frametime;
+				if( pml->velocity[2] < 0 )
+					pml->velocity[2]  = 0;
 			}
 			else
 			{
-				pml.velocity[2] += pm->playerState->pmove.gravity * pml.frametime;
-				if( pml.velocity[2] > 0 )
-					pml.velocity[2]  = 0;
+				pml->velocity[2] += pm->playerState->pmove.gravity * pml->frametime;
+				if( pml->velocity[2] > 0 )
+					pml->velocity[2]  = 0;
 			}
 		}
 
-		PM_StepSlideMove();
+		PM_StepSlideMove( pm, pml );
 	}
 	else if( pm->groundentity != -1 )
 	{ 
 		// walking on ground
-		if( pml.velocity[2] > 0 )
-			pml.velocity[2] = 0; //!!! this is before the accel
+		if( pml->velocity[2] > 0 )
+			pml->velocity[2] = 0; //!!! this is before the accel
 
-		PM_Accelerate( wishdir, wishspeed, pm_accelerate );
+		PM_Accelerate( pml, wishdir, wishspeed, pm_accelerate );
 
 		// fix for negative trigger_gravity fields
 		if( pm->playerState->pmove.gravity > 0 )
 		{
-			if( pml.velocity[2] > 0 )
-				pml.velocity[2] = 0;
+			if( pml->velocity[2] > 0 )
+				pml->velocity[2] = 0;
 		}
 		else
-			pml.velocity[2] -= pm->playerState->pmove.gravity * pml.frametime;
+			pml->velocity[2] -= pm->playerState->pmove.gravity * pml->frametime;
 
-		if( !pml.velocity[0] && !pml.velocity[1] )
+		if( !pml->velocity[0] && !pml->velocity[1] )
 			return;
 
-		PM_StepSlideMove();
+		PM_StepSlideMove( pm, pml );
 
         // racesow
 		// player is genuinely walking at walking speed: clear prejump counters
-		float hspeed = VectorLengthFast( tv( pml.velocity[0], pml.velocity[1], 0 ) );
+		float hspeed;
+		VectorSet( hvel, pml->velocity[0], pml->velocity[1], 0 );
+		hspeed = VectorLengthFast( hvel );
 		if (hspeed < DEFAULT_PLAYERSPEED_RACE+5.0f) // allow uncertainty of 5.0f
 		{
 		    RS_ResetPjState(pm->playerState->playerNum);
@@ -802,7 +802,7 @@ static void PM_Move( void )
 	{
 		// Air Control
 		wishspeed2 = wishspeed;
-		if( DotProduct( pml.velocity, wishdir ) < 0 
+		if( DotProduct( pml->velocity, wishdir ) < 0 
 			&& !( pm->playerState->pmove.pm_flags & PMF_WALLJUMPING ) 
 			&& ( pm->playerState->pmove.stats[PM_STAT_KNOCKBACK] <= 0 ) )
 			accel = pm_airdecelerate;
@@ -822,21 +822,21 @@ static void PM_Move( void )
 		}
 
 		// Air control
-		PM_Accelerate( wishdir, wishspeed, accel );
+		PM_Accelerate( pml, wishdir, wishspeed, accel );
 		if( pm_aircontrol && !( pm->playerState->pmove.pm_flags & PMF_WALLJUMPING ) && ( pm->playerState->pmove.stats[PM_STAT_KNOCKBACK] <= 0 ) )  // no air ctrl while wjing
-			PM_Aircontrol( pm, wishdir, wishspeed2 );
+			PM_Aircontrol( pml, wishdir, wishspeed2 );
 
 		// add gravity
-		pml.velocity[2] -= pm->playerState->pmove.gravity * pml.frametime;
-		PM_StepSlideMove();
+		pml->velocity[2] -= pm->playerState->pmove.gravity * pml->frametime;
+		PM_StepSlideMove( pm, pml );
 	}
 	else // air movement (old school)
 	{
 		qboolean inhibit = qfalse;
 		qboolean accelerating, decelerating;
 
-		accelerating = ( DotProduct( pml.velocity, wishdir ) > 0.0f );
-		decelerating = ( DotProduct( pml.velocity, wishdir ) < -0.0f );
+		accelerating = ( DotProduct( pml->velocity, wishdir ) > 0.0f );
+		decelerating = ( DotProduct( pml->velocity, wishdir ) < -0.0f );
 		
 		if( ( pm->playerState->pmove.pm_flags & PMF_WALLJUMPING ) &&
 			( pm->playerState->pmove.stats[PM_STAT_WJTIME] >= ( PM_WALLJUMP_TIMEDELAY - PM_AIRCONTROL_BOUNCE_DELAY ) ) )
@@ -859,7 +859,7 @@ static void PM_Move( void )
 		// (aka +fwdbunny) pressing forward or backward but not pressing strafe and not dashing
 		if( accelerating && !inhibit && !smove && fmove )
 		{
-			PM_AirAccelerate( wishdir, wishspeed );
+			PM_AirAccelerate( pml, wishdir, wishspeed );
 		}
 		else // strafe running
 		{
@@ -893,18 +893,18 @@ static void PM_Move( void )
 				if( wishspeed > pm_wishspeed )
 					wishspeed = pm_wishspeed;
 
-				PM_Accelerate( wishdir, wishspeed, pm_strafebunnyaccel );
-				PM_Aircontrol( pm, wishdir, wishspeed2 );
+				PM_Accelerate( pml, wishdir, wishspeed, pm_strafebunnyaccel );
+				PM_Aircontrol( pml, wishdir, wishspeed2 );
 			}
 			else // standard movement (includes strafejumping)
 			{
-				PM_Accelerate( wishdir, wishspeed, accel );
+				PM_Accelerate( pml, wishdir, wishspeed, accel );
 			}
 		}
 
 		// add gravity
-		pml.velocity[2] -= pm->playerState->pmove.gravity * pml.frametime;
-		PM_StepSlideMove();
+		pml->velocity[2] -= pm->playerState->pmove.gravity * pml->frametime;
+		PM_StepSlideMove( pm, pml );
 	}
 }
 
@@ -912,7 +912,7 @@ static void PM_Move( void )
 /*
 * PM_CategorizePosition
 */
-static void PM_CategorizePosition( void )
+static void PM_CategorizePosition( pmove_t *pm, pml_t *pml )
 {
 	vec3_t point;
 	int cont;
@@ -923,21 +923,21 @@ static void PM_CategorizePosition( void )
 	// if the player hull point one-quarter unit down is solid, the player is on ground
 
 	// see if standing on something solid
-	point[0] = pml.origin[0];
-	point[1] = pml.origin[1];
-	point[2] = pml.origin[2] - 0.25;
+	point[0] = pml->origin[0];
+	point[1] = pml->origin[1];
+	point[2] = pml->origin[2] - 0.25;
 
-	if( pml.velocity[2] > 180 ) // !!ZOID changed from 100 to 180 (ramp accel)
+	if( pml->velocity[2] > 180 ) // !!ZOID changed from 100 to 180 (ramp accel)
 	{
 		pm->playerState->pmove.pm_flags &= ~PMF_ON_GROUND;
 		pm->groundentity = -1;
 	}
 	else
 	{
-		module_Trace( &trace, pml.origin, pm->mins, pm->maxs, point, pm->playerState->POVnum, pm->contentmask, 0 );
-		pml.groundplane = trace.plane;
-		pml.groundsurfFlags = trace.surfFlags;
-		pml.groundcontents = trace.contents;
+		module_Trace( &trace, pml->origin, pm->mins, pm->maxs, point, pm->playerState->POVnum, pm->contentmask, 0 );
+		pml->groundplane = trace.plane;
+		pml->groundsurfFlags = trace.surfFlags;
+		pml->groundcontents = trace.contents;
 
 		if( ( trace.fraction == 1 ) || ( !ISWALKABLEPLANE( &trace.plane ) && !trace.startsolid ) )
 		{
@@ -977,19 +977,19 @@ static void PM_CategorizePosition( void )
 	sample2 = pm->playerState->viewheight - pm->mins[2];
 	sample1 = sample2 / 2;
 
-	point[2] = pml.origin[2] + pm->mins[2] + 1;
+	point[2] = pml->origin[2] + pm->mins[2] + 1;
 	cont = module_PointContents( point, 0 );
 
 	if( cont & MASK_WATER )
 	{
 		pm->watertype = cont;
 		pm->waterlevel = 1;
-		point[2] = pml.origin[2] + pm->mins[2] + sample1;
+		point[2] = pml->origin[2] + pm->mins[2] + sample1;
 		cont = module_PointContents( point, 0 );
 		if( cont & MASK_WATER )
 		{
 			pm->waterlevel = 2;
-			point[2] = pml.origin[2] + pm->mins[2] + sample2;
+			point[2] = pml->origin[2] + pm->mins[2] + sample2;
 			cont = module_PointContents( point, 0 );
 			if( cont & MASK_WATER )
 				pm->waterlevel = 3;
@@ -997,20 +997,20 @@ static void PM_CategorizePosition( void )
 	}
 }
 
-static void PM_ClearDash( void )
+static void PM_ClearDash( pmove_t *pm )
 {
 	pm->playerState->pmove.pm_flags &= ~PMF_DASHING;
 	pm->playerState->pmove.stats[PM_STAT_DASHTIME] = 0;
 }
 
-static void PM_ClearWallJump( void )
+static void PM_ClearWallJump( pmove_t *pm )
 {
 	pm->playerState->pmove.pm_flags &= ~PMF_WALLJUMPING;
 	pm->playerState->pmove.pm_flags &= ~PMF_WALLJUMPCOUNT;
 	pm->playerState->pmove.stats[PM_STAT_WJTIME] = 0;
 }
 
-static void PM_ClearStun( void )
+static void PM_ClearStun( pmove_t *pm )
 {
 	pm->playerState->pmove.stats[PM_STAT_STUN] = 0;
 }
@@ -1018,9 +1018,9 @@ static void PM_ClearStun( void )
 /*
 * PM_CheckJump
 */
-static void PM_CheckJump( void )
+static void PM_CheckJump( pmove_t *pm, pml_t *pml )
 {
-	if( pml.upPush < 10 )
+	if( pml->upPush < 10 )
 	{ 
 		// not holding jump
 		if( !( pm->playerState->pmove.stats[PM_STAT_FEATURES] & PMFEAT_CONTINOUSJUMP ) )
@@ -1056,16 +1056,16 @@ static void PM_CheckJump( void )
 
 	pm->groundentity = -1;
 
-	//if( gs.module == GS_MODULE_GAME ) GS_Printf( "upvel %f\n", pml.velocity[2] );
-	if( pml.velocity[2] > 100 )
+	//if( gs.module == GS_MODULE_GAME ) GS_Printf( "upvel %f\n", pml->velocity[2] );
+	if( pml->velocity[2] > 100 )
 	{
 		module_PredictedEvent( pm->playerState->POVnum, EV_DOUBLEJUMP, 0 );
-		pml.velocity[2] += pml.jumpPlayerSpeed;
+		pml->velocity[2] += pml->jumpPlayerSpeed;
 	}
-	else if( pml.velocity[2] > 0 )
+	else if( pml->velocity[2] > 0 )
 	{
 		module_PredictedEvent( pm->playerState->POVnum, EV_JUMP, 0 );
-		pml.velocity[2] += pml.jumpPlayerSpeed;
+		pml->velocity[2] += pml->jumpPlayerSpeed;
 
         // racesow
 		// increment count for prejump check (doublejumps dont count)
@@ -1075,7 +1075,7 @@ static void PM_CheckJump( void )
 	else
 	{
 		module_PredictedEvent( pm->playerState->POVnum, EV_JUMP, 0 );
-		pml.velocity[2] = pml.jumpPlayerSpeed;
+		pml->velocity[2] = pml->jumpPlayerSpeed;
 
         // racesow
 		// increment count for prejump check (doublejumps dont count)
@@ -1085,14 +1085,14 @@ static void PM_CheckJump( void )
 
 	// remove wj count
 	pm->playerState->pmove.pm_flags &= ~PMF_JUMPPAD_TIME;
-	PM_ClearDash();
-	PM_ClearWallJump();
+	PM_ClearDash( pm );
+	PM_ClearWallJump( pm );
 }
 
 /*
 * PM_CheckDash -- by Kurim
 */
-static void PM_CheckDash( void )
+static void PM_CheckDash( pmove_t *pm, pml_t *pml )
 {
 	float actual_velocity;
 	float upspeed;
@@ -1117,42 +1117,42 @@ static void PM_CheckDash( void )
 			return;
 
 		pm->playerState->pmove.pm_flags &= ~PMF_JUMPPAD_TIME;
-		PM_ClearWallJump();
+		PM_ClearWallJump( pm );
 
 		pm->playerState->pmove.pm_flags |= PMF_DASHING;
 		pm->playerState->pmove.pm_flags |= PMF_SPECIAL_HELD;
 		pm->groundentity = -1;
 
-		if( pml.velocity[2] <= 0.0f )
+		if( pml->velocity[2] <= 0.0f )
 			upspeed = pm_dashupspeed;
 		else
-			upspeed = pm_dashupspeed + pml.velocity[2];
+			upspeed = pm_dashupspeed + pml->velocity[2];
 
 		// ch : we should do explicit forwardPush here, and ignore sidePush ?
-		VectorMA( vec3_origin, pml.forwardPush, pml.flatforward, dashdir );
-		VectorMA( dashdir, pml.sidePush, pml.right, dashdir );
+		VectorMA( vec3_origin, pml->forwardPush, pml->flatforward, dashdir );
+		VectorMA( dashdir, pml->sidePush, pml->right, dashdir );
 		dashdir[2] = 0.0;
 
 		if( VectorLength( dashdir ) < 0.01f )  // if not moving, dash like a "forward dash"
-			VectorCopy( pml.flatforward, dashdir );
+			VectorCopy( pml->flatforward, dashdir );
 
 		VectorNormalizeFast( dashdir );
 
-		actual_velocity = VectorNormalize2D( pml.velocity );
-		if( actual_velocity <= pml.dashPlayerSpeed )
-			VectorScale( dashdir, pml.dashPlayerSpeed, dashdir );
+		actual_velocity = VectorNormalize2D( pml->velocity );
+		if( actual_velocity <= pml->dashPlayerSpeed )
+			VectorScale( dashdir, pml->dashPlayerSpeed, dashdir );
 		else
 			VectorScale( dashdir, actual_velocity, dashdir );
 
-		VectorCopy( dashdir, pml.velocity );
-		pml.velocity[2] = upspeed;
+		VectorCopy( dashdir, pml->velocity );
+		pml->velocity[2] = upspeed;
 
 		pm->playerState->pmove.stats[PM_STAT_DASHTIME] = PM_DASHJUMP_TIMEDELAY;
 
 		// return sound events
-		if( abs( pml.sidePush ) > 10 && abs( pml.sidePush ) >= abs( pml.forwardPush ) )
+		if( abs( pml->sidePush ) > 10 && abs( pml->sidePush ) >= abs( pml->forwardPush ) )
 		{
-			if( pml.sidePush > 0 )
+			if( pml->sidePush > 0 )
 			{
 				module_PredictedEvent( pm->playerState->POVnum, EV_DASH, 2 );
 			}
@@ -1161,7 +1161,7 @@ static void PM_CheckDash( void )
 				module_PredictedEvent( pm->playerState->POVnum, EV_DASH, 1 );
 			}
 		}
-		else if( pml.forwardPush < -10 )
+		else if( pml->forwardPush < -10 )
 		{
 			module_PredictedEvent( pm->playerState->POVnum, EV_DASH, 3 );
 		}
@@ -1182,9 +1182,9 @@ static void PM_CheckDash( void )
 /*
 * PM_CheckWallJump -- By Kurim
 */
-static void PM_CheckWallJump( void )
+static void PM_CheckWallJump( pmove_t *pm, pml_t *pml )
 {
-	vec3_t normal;
+	vec3_t normal, hvel;
 	float hspeed;
 
 	if( !( pm->cmd.buttons & BUTTON_SPECIAL ) )
@@ -1196,7 +1196,7 @@ static void PM_CheckWallJump( void )
 		pm->playerState->pmove.pm_flags &= ~PMF_WALLJUMPCOUNT;
 	}
 
-	if( pm->playerState->pmove.pm_flags & PMF_WALLJUMPING && pml.velocity[2] < 0.0 )
+	if( pm->playerState->pmove.pm_flags & PMF_WALLJUMPING && pml->velocity[2] < 0.0 )
 		pm->playerState->pmove.pm_flags &= ~PMF_WALLJUMPING;
 
 	if( pm->playerState->pmove.stats[PM_STAT_WJTIME] <= 0 )  // reset the wj count after wj delay
@@ -1222,58 +1222,60 @@ static void PM_CheckWallJump( void )
 		trace_t trace;
 		vec3_t point;
 
-		point[0] = pml.origin[0];
-		point[1] = pml.origin[1];
-		point[2] = pml.origin[2] - STEPSIZE;
+		point[0] = pml->origin[0];
+		point[1] = pml->origin[1];
+		point[2] = pml->origin[2] - STEPSIZE;
 
 		// don't walljump if our height is smaller than a step 
 		// unless the player is moving faster than dash speed and upwards
-		hspeed = VectorLengthFast( tv( pml.velocity[0], pml.velocity[1], 0 ) );
-		module_Trace( &trace, pml.origin, pm->mins, pm->maxs, point, pm->playerState->POVnum, pm->contentmask, 0 );
+		// not tv(), Pmove_Move runs on several threads
+		VectorSet( hvel, pml->velocity[0], pml->velocity[1], 0 );
+		hspeed = VectorLengthFast( hvel );
+		module_Trace( &trace, pml->origin, pm->mins, pm->maxs, point, pm->playerState->POVnum, pm->contentmask, 0 );
 		
-		if( ( hspeed > pm->playerState->pmove.stats[PM_STAT_DASHSPEED] && pml.velocity[2] > 8 ) 
+		if( ( hspeed > pm->playerState->pmove.stats[PM_STAT_DASHSPEED] && pml->velocity[2] > 8 ) 
 			|| ( trace.fraction == 1 ) || ( !ISWALKABLEPLANE( &trace.plane ) && !trace.startsolid ) )
 		{
 			VectorClear( normal );
-			PlayerTouchWall( 12, 0.3f, &normal );
+			PlayerTouchWall( pm, pml, 12, 0.3f, &normal );
 			if( !VectorLength( normal ) )
 				return;
 
 			if( !( pm->playerState->pmove.pm_flags & PMF_SPECIAL_HELD ) 
 				&& !( pm->playerState->pmove.pm_flags & PMF_WALLJUMPING ) )
 			{
-				float oldupvelocity = pml.velocity[2];
-				pml.velocity[2] = 0.0;
+				float oldupvelocity = pml->velocity[2];
+				pml->velocity[2] = 0.0;
 
-				hspeed = VectorNormalize2D( pml.velocity );
+				hspeed = VectorNormalize2D( pml->velocity );
 
 				// if stunned almost do nothing
 				if( pm->playerState->pmove.stats[PM_STAT_STUN] > 0 )
 				{
-					GS_ClipVelocity( pml.velocity, normal, pml.velocity, 1.0f );
-					VectorMA( pml.velocity, pm_failedwjbouncefactor, normal, pml.velocity );
+					GS_ClipVelocity( pml->velocity, normal, pml->velocity, 1.0f );
+					VectorMA( pml->velocity, pm_failedwjbouncefactor, normal, pml->velocity );
 
-					VectorNormalize( pml.velocity );
+					VectorNormalize( pml->velocity );
 
-					VectorScale( pml.velocity, hspeed, pml.velocity );
-					pml.velocity[2] = ( oldupvelocity + pm_failedwjupspeed > pm_failedwjupspeed ) ? oldupvelocity : oldupvelocity + pm_failedwjupspeed;
+					VectorScale( pml->velocity, hspeed, pml->velocity );
+					pml->velocity[2] = ( oldupvelocity + pm_failedwjupspeed > pm_failedwjupspeed ) ? oldupvelocity : oldupvelocity + pm_failedwjupspeed;
 				}
 				else
 				{
-					GS_ClipVelocity( pml.velocity, normal, pml.velocity, 1.0005f );
-					VectorMA( pml.velocity, pm_wjbouncefactor, normal, pml.velocity );
+					GS_ClipVelocity( pml->velocity, normal, pml->velocity, 1.0005f );
+					VectorMA( pml->velocity, pm_wjbouncefactor, normal, pml->velocity );
 
 					if( hspeed < pm_wjminspeed )
 						hspeed = pm_wjminspeed;
 
-					VectorNormalize( pml.velocity );
+					VectorNormalize( pml->velocity );
 
-					VectorScale( pml.velocity, hspeed, pml.velocity );
-					pml.velocity[2] = ( oldupvelocity > pm_wjupspeed ) ? oldupvelocity : pm_wjupspeed; // jal: if we had a faster upwards speed, keep it
+					VectorScale( pml->velocity, hspeed, pml->velocity );
+					pml->velocity[2] = ( oldupvelocity > pm_wjupspeed ) ? oldupvelocity : pm_wjupspeed; // jal: if we had a faster upwards speed, keep it
 				}
 
 				// set the walljumping state
-				PM_ClearDash();
+				PM_ClearDash( pm );
 				pm->playerState->pmove.pm_flags &= ~PMF_JUMPPAD_TIME;
 
 				pm->playerState->pmove.pm_flags |= PMF_WALLJUMPING;
@@ -1310,7 +1312,7 @@ static void PM_CheckWallJump( void )
 /*
 * PM_CheckSpecialMovement
 */
-static void PM_CheckSpecialMovement( void )
+static void PM_CheckSpecialMovement( pmove_t *pm, pml_t *pml )
 {
 	vec3_t spot;
 	int cont;
@@ -1319,19 +1321,19 @@ static void PM_CheckSpecialMovement( void )
 	if( pm->playerState->pmove.pm_time )
 		return;
 
-	pml.ladder = qfalse;
+	pml->ladder = qfalse;
 
 	// check for ladder
-	VectorMA( pml.origin, 1, pml.flatforward, spot );
-	module_Trace( &trace, pml.origin, pm->mins, pm->maxs, spot, pm->playerState->POVnum, pm->contentmask, 0 );
+	VectorMA( pml->origin, 1, pml->flatforward, spot );
+	module_Trace( &trace, pml->origin, pm->mins, pm->maxs, spot, pm->playerState->POVnum, pm->contentmask, 0 );
 	if( ( trace.fraction < 1 ) && ( trace.surfFlags & SURF_LADDER ) )
-		pml.ladder = qtrue;
+		pml->ladder = qtrue;
 
 	// check for water jump
 	if( pm->waterlevel != 2 )
 		return;
 
-	VectorMA( pml.origin, 30, pml.flatforward, spot );
+	VectorMA( pml->origin, 30, pml->flatforward, spot );
 	spot[2] += 4;
 	cont = module_PointContents( spot, 0 );
 	if( !( cont & CONTENTS_SOLID ) )
@@ -1342,8 +1344,8 @@ static void PM_CheckSpecialMovement( void )
 	if( cont )
 		return;
 	// jump out of water
-	VectorScale( pml.flatforward, 50, pml.velocity );
-	pml.velocity[2] = 350;
+	VectorScale( pml->flatforward, 50, pml->velocity );
+	pml->velocity[2] = 350;
 
 	pm->playerState->pmove.pm_flags |= PMF_TIME_WATERJUMP;
 	pm->playerState->pmove.pm_time = 255;
@@ -1352,7 +1354,7 @@ static void PM_CheckSpecialMovement( void )
 /*
 * PM_FlyMove
 */
-static void PM_FlyMove( qboolean doclip )
+static void PM_FlyMove( pmove_t *pm, pml_t *pml, qboolean doclip )
 {
 	float speed, drop, friction, control, newspeed;
 	float currentspeed, addspeed, accelspeed, maxspeed;
@@ -1364,16 +1366,16 @@ static void PM_FlyMove( qboolean doclip )
 	vec3_t end;
 	trace_t	trace;
 
-	maxspeed = pml.maxPlayerSpeed * 1.5;
+	maxspeed = pml->maxPlayerSpeed * 1.5;
 
 	if( pm->cmd.buttons & BUTTON_SPECIAL )
 		maxspeed *= 2;
 
 	// friction
-	speed = VectorLength( pml.velocity );
+	speed = VectorLength( pml->velocity );
 	if( speed < 1 )
 	{
-		VectorClear( pml.velocity );
+		VectorClear( pml->velocity );
 	}
 	else
 	{
@@ -1381,7 +1383,7 @@ static void PM_FlyMove( qboolean doclip )
 
 		friction = pm_friction * 1.5; // extra friction
 		control = speed < pm_decelerate ? pm_decelerate : speed;
-		drop += control * friction * pml.frametime;
+		drop += control * friction * pml->frametime;
 
 		// scale the velocity
 		newspeed = speed - drop;
@@ -1389,12 +1391,12 @@ static void PM_FlyMove( qboolean doclip )
 			newspeed = 0;
 		newspeed /= speed;
 
-		VectorScale( pml.velocity, newspeed, pml.velocity );
+		VectorScale( pml->velocity, newspeed, pml->velocity );
 	}
 
 	// accelerate
-	fmove = pml.forwardPush;
-	smove = pml.sidePush;
+	fmove = pml->forwardPush;
+	smove = pml->sidePush;
 
 	if( pm->cmd.buttons & BUTTON_SPECIAL )
 	{
@@ -1402,12 +1404,12 @@ static void PM_FlyMove( qboolean doclip )
 		smove *= 2;
 	}
 
-	VectorNormalize( pml.forward );
-	VectorNormalize( pml.right );
+	VectorNormalize( pml->forward );
+	VectorNormalize( pml->right );
 
 	for( i = 0; i < 3; i++ )
-		wishvel[i] = pml.forward[i]*fmove + pml.right[i]*smove;
-	wishvel[2] += pml.upPush;
+		wishvel[i] = pml->forward[i]*fmove + pml->right[i]*smove;
+	wishvel[2] += pml->upPush;
 
 	VectorCopy( wishvel, wishdir );
 	wishspeed = VectorNormalize( wishdir );
@@ -1422,35 +1424,35 @@ static void PM_FlyMove( qboolean doclip )
 		wishspeed = maxspeed;
 	}
 
-	currentspeed = DotProduct( pml.velocity, wishdir );
+	currentspeed = DotProduct( pml->velocity, wishdir );
 	addspeed = wishspeed - currentspeed;
 	if( addspeed > 0 )
 	{
-		accelspeed = pm_accelerate * pml.frametime * wishspeed;
+		accelspeed = pm_accelerate * pml->frametime * wishspeed;
 		if( accelspeed > addspeed )
 			accelspeed = addspeed;
 
 		for( i = 0; i < 3; i++ )
-			pml.velocity[i] += accelspeed*wishdir[i];
+			pml->velocity[i] += accelspeed*wishdir[i];
 	}
 
 	if( doclip )
 	{
 		for( i = 0; i < 3; i++ )
-			end[i] = pml.origin[i] + pml.frametime * pml.velocity[i];
+			end[i] = pml->origin[i] + pml->frametime * pml->velocity[i];
 
-		module_Trace( &trace, pml.origin, pm->mins, pm->maxs, end, pm->playerState->POVnum, pm->contentmask, 0 );
+		module_Trace( &trace, pml->origin, pm->mins, pm->maxs, end, pm->playerState->POVnum, pm->contentmask, 0 );
 
-		VectorCopy( trace.endpos, pml.origin );
+		VectorCopy( trace.endpos, pml->origin );
 	}
 	else
 	{
 		// move
-		VectorMA( pml.origin, pml.frametime, pml.velocity, pml.origin );
+		VectorMA( pml->origin, pml->frametime, pml->velocity, pml->origin );
 	}
 }
 
-static void PM_CheckZoom( void )
+static void PM_CheckZoom( pmove_t *pm )
 {
 	if( pm->playerState->pmove.pm_type != PM_NORMAL )
 	{
@@ -1475,7 +1477,7 @@ static void PM_CheckZoom( void )
 * 
 * Sets mins, maxs, and pm->viewheight
 */
-static void PM_AdjustBBox( void )
+static void PM_AdjustBBox( pmove_t *pm, pml_t *pml )
 {
 	float crouchFrac;
 	trace_t	trace;
@@ -1502,7 +1504,7 @@ static void PM_AdjustBBox( void )
 		pm->playerState->viewheight = playerbox_stand_viewheight;
 	}
 
-	if( pml.upPush < 0 && ( pm->playerState->pmove.stats[PM_STAT_FEATURES] & PMFEAT_CROUCH ) && 
+	if( pml->upPush < 0 && ( pm->playerState->pmove.stats[PM_STAT_FEATURES] & PMFEAT_CROUCH ) && 
 		pm->playerState->pmove.stats[PM_STAT_WJTIME] < ( PM_WALLJUMP_TIMEDELAY - PM_SPECIAL_CROUCH_INHIBIT ) &&
 		pm->playerState->pmove.stats[PM_STAT_DASHTIME] < ( PM_DASHJUMP_TIMEDELAY - PM_SPECIAL_CROUCH_INHIBIT ) )
 	{
@@ -1548,7 +1550,7 @@ static void PM_AdjustBBox( void )
 		wishviewheight = playerbox_stand_viewheight - ( crouchFrac * ( playerbox_stand_viewheight - playerbox_crouch_viewheight ) );
 
 		// check that the head is not blocked
-		module_Trace( &trace, pml.origin, wishmins, wishmaxs, pml.origin, pm->playerState->POVnum, pm->contentmask, 0 );
+		module_Trace( &trace, pml->origin, wishmins, wishmaxs, pml->origin, pm->playerState->POVnum, pm->contentmask, 0 );
 		if( trace.allsolid || trace.startsolid )
 		{
 			// can't do the uncrouching, let the time alone and use old position
@@ -1575,7 +1577,7 @@ static void PM_AdjustBBox( void )
 /*
 * PM_AdjustViewheight
 */
-void PM_AdjustViewheight( void )
+void PM_AdjustViewheight( pmove_t *pm )
 {
 	float height;
 	vec3_t pm_maxs, mins, maxs;
@@ -1599,7 +1601,7 @@ void PM_AdjustViewheight( void )
 		pm->playerState->viewheight -= height;
 }
 
-static qboolean PM_GoodPosition( int snaptorigin[3] )
+static qboolean PM_GoodPosition( pmove_t *pm, int snaptorigin[3] )
 {
 	trace_t	trace;
 	vec3_t origin, end;
@@ -1621,7 +1623,7 @@ static qboolean PM_GoodPosition( int snaptorigin[3] )
 * On exit, the origin will have a value that is pre-quantized to the (1.0/16.0)
 * precision of the network channel and in a valid position.
 */
-static void PM_SnapPosition( void )
+static void PM_SnapPosition( pmove_t *pm, pml_t *pml )
 {
 	int sign[3];
 	int i, j, bits;
@@ -1633,18 +1635,18 @@ static void PM_SnapPosition( void )
 	// snap velocity to sixteenths
 	for( i = 0; i < 3; i++ )
 	{
-		velint[i] = (int)( pml.velocity[i]*PM_VECTOR_SNAP );
+		velint[i] = (int)( pml->velocity[i]*PM_VECTOR_SNAP );
 		pm->playerState->pmove.velocity[i] = velint[i]*( 1.0/PM_VECTOR_SNAP );
 	}
 
 	for( i = 0; i < 3; i++ )
 	{
-		if( pml.origin[i] >= 0 )
+		if( pml->origin[i] >= 0 )
 			sign[i] = 1;
 		else
 			sign[i] = -1;
-		origint[i] = (int)( pml.origin[i]*PM_VECTOR_SNAP );
-		if( origint[i]*( 1.0/PM_VECTOR_SNAP ) == pml.origin[i] )
+		origint[i] = (int)( pml->origin[i]*PM_VECTOR_SNAP );
+		if( origint[i]*( 1.0/PM_VECTOR_SNAP ) == pml->origin[i] )
 			sign[i] = 0;
 	}
 	VectorCopy( origint, base );
@@ -1658,7 +1660,7 @@ static void PM_SnapPosition( void )
 			if( bits & ( 1<<i ) )
 				origint[i] += sign[i];
 
-		if( PM_GoodPosition( origint ) )
+		if( PM_GoodPosition( pm, origint ) )
 		{
 			VectorScale( origint, ( 1.0/PM_VECTOR_SNAP ), pm->playerState->pmove.origin );
 			return;
@@ -1666,7 +1668,7 @@ static void PM_SnapPosition( void )
 	}
 
 	// go back to the last position
-	VectorCopy( pml.previous_origin, pm->playerState->pmove.origin );
+	VectorCopy( pml->previous_origin, pm->playerState->pmove.origin );
 	VectorClear( pm->playerState->pmove.velocity );
 }
 
@@ -1675,7 +1677,7 @@ static void PM_SnapPosition( void )
 * PM_InitialSnapPosition
 * 
 */
-static void PM_InitialSnapPosition( void )
+static void PM_InitialSnapPosition( pmove_t *pm, pml_t *pml )
 {
 	int x, y, z;
 	int base[3];
@@ -1694,12 +1696,12 @@ static void PM_InitialSnapPosition( void )
 			for( x = 0; x < 3; x++ )
 			{
 				origint[0] = base[0] + offset[x];
-				if( PM_GoodPosition( origint ) )
+				if( PM_GoodPosition( pm, origint ) )
 				{
-					pml.origin[0] = pm->playerState->pmove.origin[0] = origint[0]*( 1.0/PM_VECTOR_SNAP );
-					pml.origin[1] = pm->playerState->pmove.origin[1] = origint[1]*( 1.0/PM_VECTOR_SNAP );
-					pml.origin[2] = pm->playerState->pmove.origin[2] = origint[2]*( 1.0/PM_VECTOR_SNAP );
-					VectorCopy( pm->playerState->pmove.origin, pml.previous_origin );
+					pml->origin[0] = pm->playerState->pmove.origin[0] = origint[0]*( 1.0/PM_VECTOR_SNAP );
+					pml->origin[1] = pm->playerState->pmove.origin[1] = origint[1]*( 1.0/PM_VECTOR_SNAP );
+					pml->origin[2] = pm->playerState->pmove.origin[2] = origint[2]*( 1.0/PM_VECTOR_SNAP );
+					VectorCopy( pm->playerState->pmove.origin, pml->previous_origin );
 					return;
 				}
 			}
@@ -1707,7 +1709,7 @@ static void PM_InitialSnapPosition( void )
 	}
 }
 
-static void PM_UpdateDeltaAngles( void )
+static void PM_UpdateDeltaAngles( pmove_t *pm )
 {
 	int i;
 
@@ -1726,7 +1728,7 @@ static void PM_UpdateDeltaAngles( void )
 #pragma warning( push )
 #pragma warning( disable : 4310 )   // cast truncates constant value
 #endif
-static void PM_ApplyMouseAnglesClamp( void )
+static void PM_ApplyMouseAnglesClamp( pmove_t *pm, pml_t *pml )
 {
 	int i;
 	short temp;
@@ -1752,70 +1754,71 @@ static void PM_ApplyMouseAnglesClamp( void )
 		pm->playerState->viewangles[i] = SHORT2ANGLE( temp );
 	}
 
-	AngleVectors( pm->playerState->viewangles, pml.forward, pml.right, pml.up );
+	AngleVectors( pm->playerState->viewangles, pml->forward, pml->right, pml->up );
 
-	VectorCopy( pml.forward, pml.flatforward );
-	pml.flatforward[2] = 0.0f;
-	VectorNormalize( pml.flatforward );
+	VectorCopy( pml->forward, pml->flatforward );
+	pml->flatforward[2] = 0.0f;
+	VectorNormalize( pml->flatforward );
 }
 #if defined ( _WIN32 ) && ( _MSC_VER >= 1400 )
 #pragma warning( pop )
 #endif
 
 /*
-* Pmove
+* Pmove_Move
 * 
-* Can be called by either the server or the client
+* Moves the player without touching triggers nor other entities. All the
+* working state is kept in the given pmove and on the stack, so the movement
+* of several players can run at once, as long as the collision world is not
+* changed meanwhile. Pmove_Finish has to be called afterwards.
 */
-void Pmove( pmove_t *pmove )
+void Pmove_Move( pmove_t *pm )
 {
-	float fallvelocity, falldelta, damage;
-	int oldGroundEntity;
+	pml_t pmlocals, *pml = &pmlocals;
 
-	if( !pmove->playerState )
+	if( !pm->playerState )
 		return;
 
-	pm = pmove;
-
 	// clear results
 	pm->numtouch = 0;
 	pm->groundentity = -1;
 	pm->watertype = 0;
 	pm->waterlevel = 0;
 	pm->step = qfalse;
+	pm->finish = qfalse;
 
 	// clear all pmove local vars
-	memset( &pml, 0, sizeof( pml ) );
+	memset( pml, 0, sizeof( *pml ) );
 
-	VectorCopy( pm->playerState->pmove.origin, pml.origin );
-	VectorCopy( pm->playerState->pmove.velocity, pml.velocity );
+	VectorCopy( pm->playerState->pmove.origin, pml->origin );
+	VectorCopy( pm->playerState->pmove.velocity, pml->velocity );
 
-	fallvelocity = ( ( pml.velocity[2] < 0.0f ) ? fabs( pml.velocity[2] ) : 0.0f );
+	pm->fallvelocity = ( ( pml->velocity[2] < 0.0f ) ? fabs( pml->velocity[2] ) : 0.0f );
 
 	// save old org in case we get stuck
-	VectorCopy( pm->playerState->pmove.origin, pml.previous_origin );
+	VectorCopy( pm->playerState->pmove.origin, pml->previous_origin );
 
-	pml.frametime = pm->cmd.msec * 0.001;
+	pml->frametime = pm->cmd.msec * 0.001;
 
-	pml.maxPlayerSpeed = pm->playerState->pmove.stats[PM_STAT_MAXSPEED];
-	if( pml.maxPlayerSpeed < 0 )
-		pml.maxPlayerSpeed = DEFAULT_PLAYERSPEED;
+	pml->maxPlayerSpeed = pm->playerState->pmove.stats[PM_STAT_MAXSPEED];
+	if( pml->maxPlayerSpeed < 0 )
+		pml->maxPlayerSpeed = DEFAULT_PLAYERSPEED;
 
-	pml.jumpPlayerSpeed = (float)pm->playerState->pmove.stats[PM_STAT_JUMPSPEED] * GRAVITY_COMPENSATE;
-	if( pml.jumpPlayerSpeed < 0 )
-		pml.jumpPlayerSpeed = DEFAULT_JUMPSPEED * GRAVITY_COMPENSATE;
+	pml->jumpPlayerSpeed = (float)pm->playerState->pmove.stats[PM_STAT_JUMPSPEED] * GRAVITY_COMPENSATE;
+	if( pml->jumpPlayerSpeed < 0 )
+		pml->jumpPlayerSpeed = DEFAULT_JUMPSPEED * GRAVITY_COMPENSATE;
 
-	pml.dashPlayerSpeed = pm->playerState->pmove.stats[PM_STAT_DASHSPEED];
-	if( pml.dashPlayerSpeed < 0 )
-		pml.dashPlayerSpeed = DEFAULT_DASHSPEED;
+	pml->dashPlayerSpeed = pm->playerState->pmove.stats[PM_STAT_DASHSPEED];
+	if( pml->dashPlayerSpeed < 0 )
+		pml->dashPlayerSpeed = DEFAULT_DASHSPEED;
 
-	pml.maxWalkSpeed = DEFAULT_WALKSPEED;
-	if( pml.maxWalkSpeed > pml.maxPlayerSpeed * 0.66f )
-		pml.maxWalkSpeed = pml.maxPlayerSpeed * 0.66f;
+	pml->maxWalkSpeed = DEFAULT_WALKSPEED;
+	if( pml->maxWalkSpeed > pml->maxPlayerSpeed * 0.66f )
+		pml->maxWalkSpeed = pml->maxPlayerSpeed * 0.66f;
 
-	pml.maxCrouchedSpeed = DEFAULT_CROUCHEDSPEED;
-	if( pml.maxCrouchedSpeed > pml.maxPlayerSpeed * 0.5f )
-		pml.maxCrouchedSpeed = pml.maxPlayerSpeed * 0.5f;
+	pml->maxCrouchedSpeed = DEFAULT_CROUCHEDSPEED;
+	if( pml->maxCrouchedSpeed > pml->maxPlayerSpeed * 0.5f )
+		pml->maxCrouchedSpeed = pml->maxPlayerSpeed * 0.5f;
 
 	// assign a contentmask for the movement type
 	switch( pm->playerState->pmove.pm_type )
@@ -1908,102 +1911,102 @@ void Pmove( pmove_t *pmove )
 			pm->playerState->pmove.stats[PM_STAT_FWDTIME] = 0;
 	}
 
-	pml.forwardPush = pm->cmd.forwardfrac * SPEEDKEY;
-	pml.sidePush = pm->cmd.sidefrac * SPEEDKEY;
-	pml.upPush = pm->cmd.upfrac * SPEEDKEY;
+	pml->forwardPush = pm->cmd.forwardfrac * SPEEDKEY;
+	pml->sidePush = pm->cmd.sidefrac * SPEEDKEY;
+	pml->upPush = pm->cmd.upfrac * SPEEDKEY;
 
 	if( pm->playerState->pmove.stats[PM_STAT_NOUSERCONTROL] > 0 )
 	{
-		pml.forwardPush = 0;
-		pml.sidePush = 0;
-		pml.upPush = 0;
+		pml->forwardPush = 0;
+		pml->sidePush = 0;
+		pml->upPush = 0;
 		pm->cmd.buttons = 0;
 	}
 
 	// in order the forward accelt to kick in, one has to keep +fwd pressed 
 	// for some time without strafing
-	if( pml.forwardPush <= 0 || pml.sidePush ) {
+	if( pml->forwardPush <= 0 || pml->sidePush ) {
 		pm->playerState->pmove.stats[PM_STAT_FWDTIME] = PM_FORWARD_ACCEL_TIMEDELAY;
 	}
 
 	if( pm->snapinitial )
-		PM_InitialSnapPosition();
+		PM_InitialSnapPosition( pm, pml );
 
 	if( pm->playerState->pmove.pm_type != PM_NORMAL ) // includes dead, freeze, chasecam...
 	{
 		if( !GS_MatchPaused() )
 		{
-			PM_ClearDash();
-			PM_ClearWallJump();
-			PM_ClearStun();
+			PM_ClearDash( pm );
+			PM_ClearWallJump( pm );
+			PM_ClearStun( pm );
 			pm->playerState->pmove.stats[PM_STAT_KNOCKBACK] = 0;
 			pm->playerState->pmove.stats[PM_STAT_CROUCHTIME] = 0;
 			pm->playerState->pmove.stats[PM_STAT_ZOOMTIME] = 0;
 			pm->playerState->pmove.pm_flags &= ~(PMF_JUMPPAD_TIME|PMF_DOUBLEJUMPED|PMF_TIME_WATERJUMP|PMF_TIME_LAND|PMF_TIME_TELEPORT|PMF_SPECIAL_HELD);
 
-			PM_AdjustBBox();
+			PM_AdjustBBox( pm, pml );
 		}
 
-		PM_AdjustViewheight();
+		PM_AdjustViewheight( pm );
 
 		if( pm->playerState->pmove.pm_type == PM_SPECTATOR )
 		{
-			PM_ApplyMouseAnglesClamp();
-			PM_FlyMove( qfalse );
+			PM_ApplyMouseAnglesClamp( pm, pml );
+			PM_FlyMove( pm, pml, qfalse );
 		}
 		else
 		{
-			pml.forwardPush = 0;
-			pml.sidePush = 0;
-			pml.upPush = 0;
+			pml->forwardPush = 0;
+			pml->sidePush = 0;
+			pml->upPush = 0;
 		}
 		
-		PM_SnapPosition();
+		PM_SnapPosition( pm, pml );
 		return;
 	}
 
-	PM_ApplyMouseAnglesClamp();
+	PM_ApplyMouseAnglesClamp( pm, pml );
 
 	// set mins, maxs, viewheight amd fov
-	PM_AdjustBBox();
-	PM_CheckZoom();
+	PM_AdjustBBox( pm, pml );
+	PM_CheckZoom( pm );
 
 	// round up mins/maxs to hull size and adjust the viewheight, if needed
-	PM_AdjustViewheight();
+	PM_AdjustViewheight( pm );
 
 	// set groundentity, watertype, and waterlevel
-	PM_CategorizePosition();
-	oldGroundEntity = pm->groundentity;
+	PM_CategorizePosition( pm, pml );
+	pm->oldgroundentity = pm->groundentity;
 
-	PM_CheckSpecialMovement();
+	PM_CheckSpecialMovement( pm, pml );
 
 	if( pm->playerState->pmove.pm_flags & PMF_TIME_TELEPORT )
 	{ // teleport pause stays exactly in place
 	}
 	else if( pm->playerState->pmove.pm_flags & PMF_TIME_WATERJUMP )
 	{ // waterjump has no control, but falls
-		pml.velocity[2] -= pm->playerState->pmove.gravity * pml.frametime;
-		if( pml.velocity[2] < 0 )
+		pml->velocity[2] -= pm->playerState->pmove.gravity * pml->frametime;
+		if( pml->velocity[2] < 0 )
 		{ // cancel as soon as we are falling down again
 			pm->playerState->pmove.pm_flags &= ~( PMF_TIME_WATERJUMP | PMF_TIME_LAND | PMF_TIME_TELEPORT );
 			pm->playerState->pmove.pm_time = 0;
 		}
 
-		PM_StepSlideMove();
+		PM_StepSlideMove( pm, pml );
 	}
 	else
 	{
 		// Kurim
 		// Keep this order !
-		PM_CheckJump();
-		PM_CheckDash();
-		PM_CheckWallJump();
+		PM_CheckJump( pm, pml );
+		PM_CheckDash( pm, pml );
+		PM_CheckWallJump( pm, pml );
 
-		PM_Friction();
+		PM_Friction( pm, pml );
 
 		if( pm->waterlevel >= 2 )
 		{
-			PM_WaterMove();
+			PM_WaterMove( pm, pml );
 		}
 		else
 		{
@@ -2014,32 +2017,51 @@ void Pmove( pmove_t *pmove )
 				angles[PITCH] = angles[PITCH] - 360;
 			angles[PITCH] /= 3;
 
-			AngleVectors( angles, pml.forward, pml.right, pml.up );
+			AngleVectors( angles, pml->forward, pml->right, pml->up );
 
 			// hack to work when looking straight up and straight down
-			if( pml.forward[2] == -1.0f )
+			if( pml->forward[2] == -1.0f )
 			{
-				VectorCopy( pml.up, pml.flatforward );
+				VectorCopy( pml->up, pml->flatforward );
 			}
-			else if( pml.forward[2] == 1.0f )
+			else if( pml->forward[2] == 1.0f )
 			{
-				VectorCopy( pml.up, pml.flatforward );
-				VectorNegate( pml.flatforward, pml.flatforward );
+				VectorCopy( pml->up, pml->flatforward );
+				VectorNegate( pml->flatforward, pml->flatforward );
 			}
 			else
 			{
-				VectorCopy( pml.forward, pml.flatforward );
+				VectorCopy( pml->forward, pml->flatforward );
 			}
-			pml.flatforward[2] = 0.0f;
-			VectorNormalize( pml.flatforward );
+			pml->flatforward[2] = 0.0f;
+			VectorNormalize( pml->flatforward );
 
-			PM_Move();
+			PM_Move( pm, pml );
 		}
 	}
 
 	// set groundentity, watertype, and waterlevel for final spot
-	PM_CategorizePosition();
-	PM_SnapPosition();
+	PM_CategorizePosition( pm, pml );
+	PM_SnapPosition( pm, pml );
+
+	// keep what the finishing stage needs
+	pm->finish = qtrue;
+	pm->groundsurfFlags = pml->groundsurfFlags;
+	pm->velocityz = pml->velocity[2];
+}
+
+/*
+* Pmove_Finish
+* 
+* Touches the triggers at the final position and generates the falling event.
+* Runs the callbacks of the module, so it must not run in parallel.
+*/
+void Pmove_Finish( pmove_t *pm )
+{
+	float falldelta, damage;
+
+	if( !pm->playerState || !pm->finish )
+		return;
 
 	// falling event
 
@@ -2051,13 +2073,13 @@ void Pmove( pmove_t *pmove )
 	// check for falling damage
 	module_PMoveTouchTriggers( pm );
 
-	PM_UpdateDeltaAngles(); // in case some trigger action has moved the view angles (like teleported).
+	PM_UpdateDeltaAngles( pm ); // in case some trigger action has moved the view angles (like teleported).
 
 	// touching triggers may force groundentity off
 	if( !( pm->playerState->pmove.pm_flags & PMF_ON_GROUND ) && pm->groundentity != -1 )
 	{
 		pm->groundentity = -1;
-		pml.velocity[2] = 0;
+		pm->velocityz = 0;
 	}
 
 	if( pm->groundentity != -1 ) // remove wall-jump and dash bits when touching ground
@@ -2067,12 +2089,12 @@ void Pmove( pmove_t *pmove )
 			pm->playerState->pmove.pm_flags &= ~PMF_DASHING;
 
 		if( pm->playerState->pmove.stats[PM_STAT_WJTIME] < ( PM_WALLJUMP_TIMEDELAY - 50 ) )
-			PM_ClearWallJump();
+			PM_ClearWallJump( pm );
 	}
 
-	if( oldGroundEntity == -1 )
+	if( pm->oldgroundentity == -1 )
 	{
-		falldelta = fallvelocity - ( ( pml.velocity[2] < 0.0f ) ? fabs( pml.velocity[2] ) : 0.0f );
+		falldelta = pm->fallvelocity - ( ( pm->velocityz < 0.0f ) ? fabs( pm->velocityz ) : 0.0f );
 
 		// scale delta if in water
 		if( pm->waterlevel == 3 )
@@ -2084,7 +2106,7 @@ void Pmove( pmove_t *pmove )
 
 		if( falldelta > FALL_STEP_MIN_DELTA )
 		{
-			if( !GS_FallDamage() || ( pml.groundsurfFlags & SURF_NODAMAGE ) || ( pm->playerState->pmove.pm_flags & PMF_JUMPPAD_TIME ) )
+			if( !GS_FallDamage() || ( pm->groundsurfFlags & SURF_NODAMAGE ) || ( pm->playerState->pmove.pm_flags & PMF_JUMPPAD_TIME ) )
 				damage = 0;
 			else
 			{
@@ -2098,3 +2120,14 @@ void Pmove( pmove_t *pmove )
 		pm->playerState->pmove.pm_flags &= ~PMF_JUMPPAD_TIME;
 	}
 }
+
+/*
+* Pmove
+* 
+* Can be called by either the server or the client
+*/
+void Pmove( pmove_t *pmove )
+{
+	Pmove_Move( pmove );
+	Pmove_Finish( pmove );
+}
@@ -262,6 +262,8 @@ enum {
 };
 
 void Pmove( pmove_t *pmove );
+void Pmove_Move( pmove_t *pm );
+void Pmove_Finish( pmove_t *pm );
 
 //===============================================================
 
@@ -98,6 +98,9 @@ extern "C" {
 #define	AREA_SOLID	1
 #define	AREA_TRIGGERS	2
 
+// 1/32 epsilon to keep floating point happy, traces stop this short of what they hit
+#define	DIST_EPSILON	( 1.0f / 32.0f )
+
 // a trace is returned when a box is swept through the world
 typedef struct
 {
@@ -471,6 +471,13 @@ typedef struct
 	int waterlevel;
 
 	int contentmask;
+
+	// carried from Pmove_Move to Pmove_Finish
+	qboolean finish;
+	int oldgroundentity;
+	int groundsurfFlags;
+	float fallvelocity;
+	float velocityz;            // full precision, not snapped
 } pmove_t;
 
 
@@ -133,6 +133,29 @@ time_t Sys_FS_FileMTime( const char *filename )
 	return -1;
 }
 
+void *Sys_FS_MMapFile( int fileno, size_t size, size_t offset, void **mapping, size_t *mapping_offset )
+{
+	return NULL;
+}
+
+void Sys_FS_UnMMapFile( void *mapping, void *data, size_t size, size_t mapping_offset )
+{
+}
+
+qboolean Sys_FS_WatchDirectory( const char *path )
+{
+	return qfalse;
+}
+
+const char *Sys_FS_NextChangedFile( qboolean *lost )
+{
+	return NULL;
+}
+
+void Sys_FS_StopWatching( void )
+{
+}
+
 //=============================================================================
 
 static void main( int argc, char **argv )
@@ -23,8 +23,18 @@
 #define CM_SUBDIV_LEVEL		( 16 )
 
 //#define TRACEVICFIX
+
+// SSE2 brush clipping, only where plain float math is done in SSE registers too,
+// so that both ways round the same
+#if !defined ( TRACEVICFIX ) && !defined ( C_ONLY ) && \
+	( ( defined ( __GNUC__ ) && defined ( __SSE2__ ) && defined ( __x86_64__ ) ) || ( defined ( _MSC_VER ) && defined ( _M_X64 ) ) )
+#define CM_SIMD_BRUSHES
+#endif
+
 #define TRACE_NOAXIAL_SAFETY_OFFSET 0.1
 
+#define CM_BRUSH_NOBOUNDS	999999  // brush extent on axes it has no axial sides for
+
 // keep 1/8 unit away to keep the position valid before network snapping
 // and to avoid various numeric issues
 #define	SURFACE_CLIP_EPSILON	(0.125)
@@ -51,16 +61,19 @@ typedef struct
 typedef struct
 {
 	int contents;
-	int checkcount;             // to avoid repeated testings
+	int checkcount;             // to avoid adding duplicates while loading
 
 	int numsides;
 	cbrushside_t *brushsides;
+
+	float *planes;              // CM_SIMD_BRUSHES: sides in groups of 4 as normal x's, y's, z's and dists
+
+	vec3_t mins, maxs;          // from the axial sides, padded, to skip brushes away from the trace
 } cbrush_t;
 
 typedef struct
 {
 	int contents;
-	int checkcount;             // to avoid repeated testings
 
 	vec3_t mins, maxs;
 
@@ -99,6 +112,16 @@ typedef struct cmodel_s
 	qboolean builtin;
 } cmodel_t;
 
+#define CM_MAX_TRACE_MARKERS	8	// traces that can run at once without testing brushes twice
+
+// brushes and patches tested by a trace, to avoid repeated testings
+typedef struct
+{
+	int checkcount;
+	int *brushchecks;           // [numbrushes]
+	int *facechecks;            // [numfaces]
+} cmtracemarkers_t;
+
 typedef struct
 {
 	int floodnum;               // if two areas have equal floodnums, they are connected
@@ -107,7 +130,6 @@ typedef struct
 
 struct cmodel_state_s
 {
-	int checkcount;
 	struct mempool_s *mempool;
 
 	const bspFormatDesc_t *cmap_bspFormat;
@@ -194,10 +216,11 @@ struct cmodel_state_s
 	cbrush_t *oct_markbrushes[1];
 	cmodel_t oct_cmodel[1];
 
-	int leaf_count, leaf_maxcount;
-	int *leaf_list;
-	float *leaf_mins, *leaf_maxs;
-	int leaf_topnode;
+	volatile int trace_freemarkers;     // a bit for each trace_markers not in use
+	cmtracemarkers_t trace_markers[CM_MAX_TRACE_MARKERS];
+	int *trace_markerchecks;
+
+	float *map_brushplanes;         // the cbrush_t planes of map brushes and patch facets
 
 	// optional special handling of line tracing and point contents
 	void ( *CM_TransformedBoxTrace )( struct cmodel_state_s *cms, trace_t *tr, vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, struct cmodel_s *cmodel, int brushmask, vec3_t origin, vec3_t angles );
@@ -211,5 +234,10 @@ qbyte	*CM_DecompressVis( const qbyte *in, int rowsize, qbyte *decompressed );
 
 void	CM_InitBoxHull( cmodel_state_t *cms );
 void	CM_InitOctagonHull( cmodel_state_t *cms );
+void	CM_InitTraceMarkers( cmodel_state_t *cms );
+void	CM_FreeTraceMarkers( cmodel_state_t *cms );
+void	CM_InitBrushBounds( cmodel_state_t *cms );
+void	CM_InitBrushPlanes( cmodel_state_t *cms );
+void	CM_FreeBrushPlanes( cmodel_state_t *cms );
 
 void	CM_FloodAreaConnections( cmodel_state_t *cms );
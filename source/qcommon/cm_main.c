@@ -63,6 +63,9 @@ static void CM_Clear( cmodel_state_t *cms )
 {
 	int i;
 
+	CM_FreeTraceMarkers( cms );
+	CM_FreeBrushPlanes( cms );
+
 	if( cms->map_shaderrefs )
 	{
 		Mem_Free( cms->map_shaderrefs[0].name );
@@ -274,6 +277,9 @@ cmodel_t *CM_LoadMap( cmodel_state_t *cms, const char *name, qboolean clientload
 
 	CM_InitBoxHull( cms );
 	CM_InitOctagonHull( cms );
+	CM_InitTraceMarkers( cms );
+	CM_InitBrushBounds( cms );
+	CM_InitBrushPlanes( cms );
 
 	if( cms->numareas )
 	{
@@ -929,6 +935,24 @@ void CM_Free( cmodel_state_t *cms )
 	Cvar_ForceSet( "cm_mapVersion", "0" );
 }
 
+/*
+* CM_TraceStats_f
+*/
+static void CM_TraceStats_f( void )
+{
+	int frames = max( c_trace_frames, 1 );
+
+	Com_Printf( "%i frames\n", c_trace_frames );
+	Com_Printf( "%8i traces        %8.1f per frame\n", c_traces, (float)c_traces / frames );
+	Com_Printf( "%8i nodes         %8.1f per frame\n", c_trace_nodes, (float)c_trace_nodes / frames );
+	Com_Printf( "%8i brush traces  %8.1f per frame\n", c_brush_traces, (float)c_brush_traces / frames );
+	Com_Printf( "%8i culled        %8.1f per frame\n", c_brush_culls, (float)c_brush_culls / frames );
+	Com_Printf( "%8i points        %8.1f per frame\n", c_pointcontents, (float)c_pointcontents / frames );
+
+	c_traces = c_trace_nodes = c_brush_traces = c_brush_culls = c_pointcontents = 0;
+	c_trace_frames = 0;
+}
+
 /*
 * CM_Init
 */
@@ -944,6 +968,8 @@ void CM_Init( void )
 	Cvar_Get( "cm_mapHeader", "", CVAR_READONLY );
 	Cvar_Get( "cm_mapVersion", "0", CVAR_READONLY );
 
+	Cmd_AddCommand( "cm_tracestats", CM_TraceStats_f );
+
 	cm_initialized = qtrue;
 }
 
@@ -955,6 +981,8 @@ void CM_Shutdown( void )
 	if( !cm_initialized )
 		return;
 
+	Cmd_RemoveCommand( "cm_tracestats" );
+
 	Mem_FreePool( &cmap_mempool );
 
 	cm_initialized = qfalse;
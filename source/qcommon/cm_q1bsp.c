@@ -188,22 +188,14 @@ LINE TESTING IN HULLS
 ===============================================================================
 */
 
-// 1/32 epsilon to keep floating point happy
-#define	DIST_EPSILON	(0.03125)
-
 #define HULLCHECKSTATE_EMPTY 0
 #define HULLCHECKSTATE_SOLID 1
 #define HULLCHECKSTATE_DONE 2
 
-static trace_t *trace_trace;
-
-static vec3_t trace_start, trace_end;
-static int trace_contents;
-
 /*
 * CM_RecursiveHullCheck
 */
-static int CM_RecursiveHullCheck( cmodel_state_t *cms, chull_t *hull, int nodenum, float p1f, float p2f, vec3_t p1, vec3_t p2 )
+static int CM_RecursiveHullCheck( cmodel_state_t *cms, chull_t *hull, trace_t *tr, int brushmask, int nodenum, float p1f, float p2f, vec3_t p1, vec3_t p2 )
 {
 	cnode_t		*node;
 	cplane_t	*plane;
@@ -221,19 +213,19 @@ start:
 		int contents;
 
 		contents = CMod_SurfaceContents( nodenum );
-		if( trace_contents & contents )
+		if( brushmask & contents )
 		{
 			c_brush_traces++;
 
-			trace_trace->contents = contents;
-			trace_trace->surfFlags = CMod_SurfaceFlags( nodenum );
-			if( trace_trace->allsolid )
-				trace_trace->startsolid = qtrue;
+			tr->contents = contents;
+			tr->surfFlags = CMod_SurfaceFlags( nodenum );
+			if( tr->allsolid )
+				tr->startsolid = qtrue;
 			return HULLCHECKSTATE_SOLID;
 		}
 		else
 		{
-			trace_trace->allsolid = qfalse;
+			tr->allsolid = qfalse;
 			return HULLCHECKSTATE_EMPTY;
 		}
 	}
@@ -268,12 +260,12 @@ start:
 
 	// recurse both sides, front side first
 
-	ret = CM_RecursiveHullCheck( cms, hull, node->children[side], p1f, midf, p1, mid );
+	ret = CM_RecursiveHullCheck( cms, hull, tr, brushmask, node->children[side], p1f, midf, p1, mid );
 	// if this side is not empty, return what it is (solid or done)
 	if (ret != HULLCHECKSTATE_EMPTY)
 		return ret;
 
-	ret = CM_RecursiveHullCheck( cms, hull, node->children[side^1], midf, p2f, mid, p2 );
+	ret = CM_RecursiveHullCheck( cms, hull, tr, brushmask, node->children[side^1], midf, p2f, mid, p2 );
 	// if other side is not solid, return what it is (empty or done)
 	if (ret != HULLCHECKSTATE_SOLID)
 		return ret;
@@ -281,13 +273,13 @@ start:
 	// the other side of the node is solid, this is the impact point
 	if( !side )
 	{
-		trace_trace->plane = *plane;
+		tr->plane = *plane;
 	}
 	else
 	{
-		VectorNegate( plane->normal, trace_trace->plane.normal );
-		trace_trace->plane.dist = -plane->dist;
-		CategorizePlane( &trace_trace->plane );
+		VectorNegate( plane->normal, tr->plane.normal );
+		tr->plane.dist = -plane->dist;
+		CategorizePlane( &tr->plane );
 	}
 
 	// put the crosspoint DIST_EPSILON pixels on the near side
@@ -297,8 +289,8 @@ start:
 		frac = (t1 - DIST_EPSILON) / (t1 - t2);
 	midf = p1f + (p2f - p1f) * bound( 0, frac, 1 );
 
-	trace_trace->fraction = bound( 0, midf, 1 );
-	VectorLerp( p1, frac, p2, trace_trace->endpos );
+	tr->fraction = bound( 0, midf, 1 );
+	VectorLerp( p1, frac, p2, tr->endpos );
 
 	return HULLCHECKSTATE_DONE;
 }
@@ -322,7 +314,6 @@ static void CM_TransformedHullTrace( cmodel_state_t *cms, trace_t *tr, vec3_t st
 	if( !tr )
 		return;
 
-	cms->checkcount++;  // for multi-check avoidance
 	c_traces++;     // for statistics, may be zeroed
 
 	// fill in a default trace
@@ -340,10 +331,6 @@ static void CM_TransformedHullTrace( cmodel_state_t *cms, trace_t *tr, vec3_t st
 	VectorSubtract( end, offset, end_l );
 
 	tr->allsolid = qtrue;
-	trace_trace = tr;
-	trace_contents = brushmask;
-	VectorCopy( start_l, trace_start );
-	VectorCopy( end_l, trace_end );
 
 	// rotate start and end into the models frame of reference
 	if( ( angles[0] || angles[1] || angles[2] ) 
@@ -367,12 +354,12 @@ static void CM_TransformedHullTrace( cmodel_state_t *cms, trace_t *tr, vec3_t st
 	}
 
 	// sweep the box through the model
-	CM_RecursiveHullCheck( cms, hull, hull->firstclipnode, 0, 1, start_l, end_l );
+	CM_RecursiveHullCheck( cms, hull, tr, brushmask, hull->firstclipnode, 0, 1, start_l, end_l );
 
 	// check for position test special case
 	if( VectorCompare( start, end ) )
 	{
-		VectorCopy( start, trace_trace->endpos );
+		VectorCopy( start, tr->endpos );
 		return;
 	}
 
@@ -39,6 +39,8 @@ void CM_InitBoxHull( cmodel_state_t *cms )
 	cms->box_brush->contents = CONTENTS_BODY;
 
 	cms->box_markbrushes[0] = cms->box_brush;
+	VectorSet( cms->box_brush->mins, -CM_BRUSH_NOBOUNDS, -CM_BRUSH_NOBOUNDS, -CM_BRUSH_NOBOUNDS );
+	VectorSet( cms->box_brush->maxs, CM_BRUSH_NOBOUNDS, CM_BRUSH_NOBOUNDS, CM_BRUSH_NOBOUNDS );
 
 	cms->box_cmodel->builtin = qtrue;
 	cms->box_cmodel->nummarkfaces = 0;
@@ -95,6 +97,8 @@ void CM_InitOctagonHull( cmodel_state_t *cms )
 	cms->oct_brush->contents = CONTENTS_BODY;
 
 	cms->oct_markbrushes[0] = cms->oct_brush;
+	VectorSet( cms->oct_brush->mins, -CM_BRUSH_NOBOUNDS, -CM_BRUSH_NOBOUNDS, -CM_BRUSH_NOBOUNDS );
+	VectorSet( cms->oct_brush->maxs, CM_BRUSH_NOBOUNDS, CM_BRUSH_NOBOUNDS, CM_BRUSH_NOBOUNDS );
 
 	cms->oct_cmodel->builtin = qtrue;
 	cms->oct_cmodel->nummarkfaces = 0;
@@ -147,7 +151,8 @@ void CM_InitOctagonHull( cmodel_state_t *cms )
 /*
 * CM_ModelForBBox
 * 
-* To keep everything totally uniform, bounding boxes are turned into inline models
+* To keep everything totally uniform, bounding boxes are turned into inline models.
+* There's only one box model, so unlike tracing this must not be called from several threads.
 */
 cmodel_t *CM_ModelForBBox( cmodel_state_t *cms, vec3_t mins, vec3_t maxs )
 {
@@ -253,7 +258,15 @@ int CM_PointLeafnum( cmodel_state_t *cms, const vec3_t p )
 *
 * Fills in a list of all the leafs touched
 */
-static void CM_BoxLeafnums_r( cmodel_state_t *cms, int nodenum )
+typedef struct
+{
+	int count, maxcount;
+	int *list;
+	float *mins, *maxs;
+	int topnode;
+} cboxleafnums_t;
+
+static void CM_BoxLeafnums_r( cmodel_state_t *cms, cboxleafnums_t *bl, int nodenum )
 {
 	int s;
 	cnode_t	*node;
@@ -261,7 +274,7 @@ static void CM_BoxLeafnums_r( cmodel_state_t *cms, int nodenum )
 	while( nodenum >= 0 )
 	{
 		node = &cms->map_nodes[nodenum];
-		s = BOX_ON_PLANE_SIDE( cms->leaf_mins, cms->leaf_maxs, node->plane ) - 1;
+		s = BOX_ON_PLANE_SIDE( bl->mins, bl->maxs, node->plane ) - 1;
 
 		if( s < 2 )
 		{
@@ -270,35 +283,39 @@ static void CM_BoxLeafnums_r( cmodel_state_t *cms, int nodenum )
 		}
 
 		// go down both sides
-		if( cms->leaf_topnode == -1 )
-			cms->leaf_topnode = nodenum;
-		CM_BoxLeafnums_r( cms, node->children[0] );
+		if( bl->topnode == -1 )
+			bl->topnode = nodenum;
+		CM_BoxLeafnums_r( cms, bl, node->children[0] );
 		nodenum = node->children[1];
 	}
 
-	if( cms->leaf_count < cms->leaf_maxcount )
-		cms->leaf_list[cms->leaf_count++] = -1 - nodenum;
+	if( bl->count < bl->maxcount )
+		bl->list[bl->count++] = -1 - nodenum;
 }
 
 /*
 * CM_BoxLeafnums
+*
+* The walk state lives on the stack, so this can be called from several threads at once.
 */
 int CM_BoxLeafnums( cmodel_state_t *cms, vec3_t mins, vec3_t maxs, int *list, int listsize, int *topnode )
 {
-	cms->leaf_list = list;
-	cms->leaf_count = 0;
-	cms->leaf_maxcount = listsize;
-	cms->leaf_mins = mins;
-	cms->leaf_maxs = maxs;
+	cboxleafnums_t bl;
+
+	bl.list = list;
+	bl.count = 0;
+	bl.maxcount = listsize;
+	bl.mins = mins;
+	bl.maxs = maxs;
 
-	cms->leaf_topnode = -1;
+	bl.topnode = -1;
 
-	CM_BoxLeafnums_r( cms, 0 );
+	CM_BoxLeafnums_r( cms, &bl, 0 );
 
 	if( topnode )
-		*topnode = cms->leaf_topnode;
+		*topnode = bl.topnode;
 
-	return cms->leaf_count;
+	return bl.count;
 }
 
 /*
@@ -481,31 +498,439 @@ BOX TRACING
 
 //#define TRACEVICFIX
 
-// 1/32 epsilon to keep floating point happy
-#define	DIST_EPSILON	( 1.0f / 32.0f )
+#ifdef TRACEVICFIX
+#undef CM_SIMD_BRUSHES
+#endif
+
+#ifdef CM_SIMD_BRUSHES
+#include <emmintrin.h>
+#endif
+
 #ifdef TRACEVICFIX
 #define FRAC_EPSILON    ( 1.0f / 1024.0f )
 #endif
 #define RADIUS_EPSILON		1.0f
 
-static vec3_t trace_start, trace_end;
-static vec3_t trace_mins, trace_maxs;
-static vec3_t trace_startmins, trace_endmins;
-static vec3_t trace_startmaxs, trace_endmaxs;
-static vec3_t trace_absmins, trace_absmaxs;
-static vec3_t trace_extents;
+// the working state of a single trace, so traces can run in several threads at once
+typedef struct
+{
+	cmodel_state_t *cms;
+	cmtracemarkers_t *markers;      // NULL if all are taken, brushes may be tested twice then
+
+	vec3_t start, end;
+	vec3_t mins, maxs;
+	vec3_t startmins, endmins;
+	vec3_t startmaxs, endmaxs;
+	vec3_t absmins, absmaxs;
+	vec3_t extents;
 
-static trace_t	*trace_trace;
+	trace_t	*trace;
 #ifdef TRACEVICFIX
-static float trace_realfraction;
+	float realfraction;
+#endif
+	int contents;
+	qboolean ispoint;      // optimized case
+
+	int numnodes, numculls;     // counted here and added to the totals once, traces run on several threads
+} cmtrace_t;
+
+/*
+* CM_InitTraceMarkers
+*
+* Allocates the per-thread multi-check markers once the map is loaded
+*/
+void CM_InitTraceMarkers( cmodel_state_t *cms )
+{
+	int i, size;
+	int *checks;
+
+	size = cms->numbrushes + cms->numfaces;
+	if( !size )
+		return;
+
+	checks = Mem_Alloc( cms->mempool, CM_MAX_TRACE_MARKERS * size * sizeof( *checks ) );
+	for( i = 0; i < CM_MAX_TRACE_MARKERS; i++ )
+	{
+		cms->trace_markers[i].checkcount = 0;
+		cms->trace_markers[i].brushchecks = checks + i * size;
+		cms->trace_markers[i].facechecks = checks + i * size + cms->numbrushes;
+	}
+
+	cms->trace_markerchecks = checks;
+	cms->trace_freemarkers = ( 1 << CM_MAX_TRACE_MARKERS ) - 1;
+}
+
+/*
+* CM_FreeTraceMarkers
+*/
+void CM_FreeTraceMarkers( cmodel_state_t *cms )
+{
+	cms->trace_freemarkers = 0;
+	if( cms->trace_markerchecks )
+	{
+		Mem_Free( cms->trace_markerchecks );
+		cms->trace_markerchecks = NULL;
+	}
+	memset( cms->trace_markers, 0, sizeof( cms->trace_markers ) );
+}
+
+/*
+* CM_AcquireTraceMarkers
+*/
+static cmtracemarkers_t *CM_AcquireTraceMarkers( cmodel_state_t *cms )
+{
+	int freemarkers, slot;
+	cmtracemarkers_t *markers;
+
+	do
+	{
+		freemarkers = cms->trace_freemarkers;
+		if( !freemarkers )
+			return NULL;
+
+		for( slot = 0; !( freemarkers & ( 1 << slot ) ); slot++ )
+			;
+	} while( !QAtomic_CAS( &cms->trace_freemarkers, freemarkers, freemarkers & ~( 1 << slot ), NULL ) );
+
+	markers = &cms->trace_markers[slot];
+	markers->checkcount++;  // for multi-check avoidance
+	return markers;
+}
+
+/*
+* CM_ReleaseTraceMarkers
+*/
+static void CM_ReleaseTraceMarkers( cmodel_state_t *cms, cmtracemarkers_t *markers )
+{
+	int freemarkers, bit;
+
+	if( !markers )
+		return;
+
+	bit = 1 << ( markers - cms->trace_markers );
+	do
+	{
+		freemarkers = cms->trace_freemarkers;
+	} while( !QAtomic_CAS( &cms->trace_freemarkers, freemarkers, freemarkers | bit, NULL ) );
+}
+
+/*
+* CM_BoundBrush
+*
+* A brush lies behind all of its sides, so the axial ones bound it. The
+* bounds are padded well past DIST_EPSILON, because a trace that stops
+* that close to a brush still clips against it.
+*/
+static void CM_BoundBrush( cbrush_t *brush )
+{
+	int i, j;
+	cplane_t *p;
+
+	VectorSet( brush->mins, -CM_BRUSH_NOBOUNDS, -CM_BRUSH_NOBOUNDS, -CM_BRUSH_NOBOUNDS );
+	VectorSet( brush->maxs, CM_BRUSH_NOBOUNDS, CM_BRUSH_NOBOUNDS, CM_BRUSH_NOBOUNDS );
+
+	for( i = 0; i < brush->numsides; i++ )
+	{
+		p = brush->brushsides[i].plane;
+		for( j = 0; j < 3; j++ )
+		{
+			if( p->normal[j] == 1 )
+				brush->maxs[j] = min( brush->maxs[j], p->dist + 1 );
+			else if( p->normal[j] == -1 )
+				brush->mins[j] = max( brush->mins[j], -p->dist - 1 );
+		}
+	}
+}
+
+/*
+* CM_InitBrushBounds
+*/
+void CM_InitBrushBounds( cmodel_state_t *cms )
+{
+	int i, j;
+	cface_t *patch;
+
+	for( i = 0; i < cms->numbrushes; i++ )
+		CM_BoundBrush( &cms->map_brushes[i] );
+
+	for( i = 0, patch = cms->map_faces; i < cms->numfaces; i++, patch++ )
+	{
+		for( j = 0; j < patch->numfacets; j++ )
+			CM_BoundBrush( &patch->facets[j] );
+	}
+}
+
+/*
+* CM_SetBrushPlanes
+*
+* Returns qfalse if the brush has to be clipped the scalar way
+*/
+static qboolean CM_SetBrushPlanes( cbrush_t *brush, float *planes )
+{
+	int i, j;
+	float *group;
+	cplane_t *p;
+
+	for( i = 0; i < ( ( brush->numsides + 3 ) & ~3 ); i++ )
+	{
+		group = planes + ( i >> 2 ) * 16 + ( i & 3 );
+
+		if( i >= brush->numsides )
+		{
+			// padding, always behind the box
+			group[0] = group[4] = group[8] = 0;
+			group[12] = 1;
+			continue;
+		}
+
+		p = brush->brushsides[i].plane;
+		if( p->type < 3 )
+		{
+			group[0] = group[4] = group[8] = 0;
+			group[p->type * 4] = 1;
+		}
+		else
+		{
+			// the corner of the box is picked by the sign of the normal
+			for( j = 0; j < 3; j++ )
+			{
+				if( ( p->normal[j] < 0 ) != ( ( p->signbits >> j ) & 1 ) )
+					return qfalse;
+				group[j * 4] = p->normal[j];
+			}
+		}
+		group[12] = p->dist;
+	}
+
+	return qtrue;
+}
+
+/*
+* CM_InitBrushPlanes
+*
+* Copies the planes of the map brushes and patch facets for the SIMD clipping
+*/
+void CM_InitBrushPlanes( cmodel_state_t *cms )
+{
+#ifdef CM_SIMD_BRUSHES
+	int i, j, numgroups;
+	float *planes;
+	cface_t *patch;
+
+	numgroups = 0;
+	for( i = 0; i < cms->numbrushes; i++ )
+		numgroups += ( cms->map_brushes[i].numsides + 3 ) >> 2;
+	for( i = 0, patch = cms->map_faces; i < cms->numfaces; i++, patch++ )
+	{
+		for( j = 0; j < patch->numfacets; j++ )
+			numgroups += ( patch->facets[j].numsides + 3 ) >> 2;
+	}
+	if( !numgroups )
+		return;
+
+	// Mem_Alloc aligns to 16 bytes
+	planes = cms->map_brushplanes = Mem_Alloc( cms->mempool, numgroups * 16 * sizeof( float ) );
+
+	for( i = 0; i < cms->numbrushes; i++ )
+	{
+		cbrush_t *brush = &cms->map_brushes[i];
+
+		brush->planes = CM_SetBrushPlanes( brush, planes ) ? planes : NULL;
+		planes += ( ( brush->numsides + 3 ) >> 2 ) * 16;
+	}
+
+	for( i = 0, patch = cms->map_faces; i < cms->numfaces; i++, patch++ )
+	{
+		for( j = 0; j < patch->numfacets; j++ )
+		{
+			cbrush_t *facet = &patch->facets[j];
+
+			facet->planes = CM_SetBrushPlanes( facet, planes ) ? planes : NULL;
+			planes += ( ( facet->numsides + 3 ) >> 2 ) * 16;
+		}
+	}
 #endif
-static int trace_contents;
-static qboolean trace_ispoint;      // optimized case
+}
+
+/*
+* CM_FreeBrushPlanes
+*/
+void CM_FreeBrushPlanes( cmodel_state_t *cms )
+{
+	if( cms->map_brushplanes )
+	{
+		Mem_Free( cms->map_brushplanes );
+		cms->map_brushplanes = NULL;
+	}
+}
+
+#ifdef CM_SIMD_BRUSHES
+
+/*
+* CM_ClipBoxToBrush_SSE2
+*
+* CM_ClipBoxToBrush for 4 sides at a time. The distances are computed in the
+* same order as in the scalar version, so the results are the same.
+*/
+static void CM_ClipBoxToBrush_SSE2( cmtrace_t *tlc, cbrush_t *brush )
+{
+	int i, j, frontmask, startoutmask, getoutmask, entermask, leavemask;
+	const float *group;
+	float enterfrac, leavefrac;
+	float fenter[4], fleave[4];
+	cbrushside_t *leadside;
+	__m128 zero, epsilon, nx, ny, nz, dist, negx, negy, negz, d1, d2, f, out1, out2;
+	__m128 startmins[3], startmaxs[3], endmins[3], endmaxs[3];
+
+	enterfrac = -1;
+	leavefrac = 1;
+	leadside = NULL;
+
+	c_brush_traces++;
+
+	for( j = 0; j < 3; j++ )
+	{
+		startmins[j] = _mm_set1_ps( tlc->startmins[j] );
+		startmaxs[j] = _mm_set1_ps( tlc->startmaxs[j] );
+		endmins[j] = _mm_set1_ps( tlc->endmins[j] );
+		endmaxs[j] = _mm_set1_ps( tlc->endmaxs[j] );
+	}
+	zero = _mm_setzero_ps();
+	epsilon = _mm_set1_ps( DIST_EPSILON );
+
+	startoutmask = getoutmask = 0;
+	for( i = 0, group = brush->planes; i < brush->numsides; i += 4, group += 16 )
+	{
+		nx = _mm_load_ps( group );
+		ny = _mm_load_ps( group + 4 );
+		nz = _mm_load_ps( group + 8 );
+		dist = _mm_load_ps( group + 12 );
+
+		// push the plane out apropriately for mins/maxs
+		negx = _mm_cmplt_ps( nx, zero );
+		negy = _mm_cmplt_ps( ny, zero );
+		negz = _mm_cmplt_ps( nz, zero );
+
+		d1 = _mm_mul_ps( nx, _mm_or_ps( _mm_and_ps( negx, startmaxs[0] ), _mm_andnot_ps( negx, startmins[0] ) ) );
+		d1 = _mm_add_ps( d1, _mm_mul_ps( ny, _mm_or_ps( _mm_and_ps( negy, startmaxs[1] ), _mm_andnot_ps( negy, startmins[1] ) ) ) );
+		d1 = _mm_add_ps( d1, _mm_mul_ps( nz, _mm_or_ps( _mm_and_ps( negz, startmaxs[2] ), _mm_andnot_ps( negz, startmins[2] ) ) ) );
+		d1 = _mm_sub_ps( d1, dist );
+
+		d2 = _mm_mul_ps( nx, _mm_or_ps( _mm_and_ps( negx, endmaxs[0] ), _mm_andnot_ps( negx, endmins[0] ) ) );
+		d2 = _mm_add_ps( d2, _mm_mul_ps( ny, _mm_or_ps( _mm_and_ps( negy, endmaxs[1] ), _mm_andnot_ps( negy, endmins[1] ) ) ) );
+		d2 = _mm_add_ps( d2, _mm_mul_ps( nz, _mm_or_ps( _mm_and_ps( negz, endmaxs[2] ), _mm_andnot_ps( negz, endmins[2] ) ) ) );
+		d2 = _mm_sub_ps( d2, dist );
+
+		out1 = _mm_cmpgt_ps( d1, zero );
+		out2 = _mm_cmpgt_ps( d2, zero );
+
+		// if completely in front of any face, no intersection
+		frontmask = _mm_movemask_ps( _mm_and_ps( out1, _mm_cmpge_ps( d2, d1 ) ) );
+		if( frontmask )
+			return;
+
+		startoutmask |= _mm_movemask_ps( out1 );
+		getoutmask |= _mm_movemask_ps( out2 );
+
+		// crosses face
+		f = _mm_sub_ps( d1, d2 );
+		entermask = _mm_movemask_ps( _mm_and_ps( out1, _mm_cmpgt_ps( f, zero ) ) );
+		leavemask = _mm_movemask_ps( _mm_and_ps( _mm_or_ps( out1, out2 ), _mm_cmplt_ps( f, zero ) ) );
+		if( !( entermask | leavemask ) )
+			continue;
+
+		_mm_storeu_ps( fenter, _mm_div_ps( _mm_sub_ps( d1, epsilon ), f ) );
+		_mm_storeu_ps( fleave, _mm_div_ps( _mm_add_ps( d1, epsilon ), f ) );
+
+		for( j = 0; j < 4; j++ )
+		{
+			if( ( entermask & ( 1 << j ) ) && fenter[j] > enterfrac )
+			{
+				enterfrac = fenter[j];
+				leadside = brush->brushsides + i + j;
+			}
+			else if( ( leavemask & ( 1 << j ) ) && fleave[j] < leavefrac )
+			{
+				leavefrac = fleave[j];
+			}
+		}
+	}
+
+	if( !startoutmask )
+	{
+		// original point was inside brush
+		tlc->trace->startsolid = qtrue;
+		tlc->trace->contents = brush->contents;
+		if( !getoutmask )
+		{
+			tlc->trace->allsolid = qtrue;
+			tlc->trace->fraction = 0;
+		}
+		return;
+	}
+
+	if( enterfrac - ( 1.0f / 1024.0f ) <= leavefrac )
+	{
+		if( enterfrac > -1 && enterfrac < tlc->trace->fraction )
+		{
+			if( enterfrac < 0 )
+				enterfrac = 0;
+			tlc->trace->fraction = enterfrac;
+			tlc->trace->plane = *leadside->plane;
+			tlc->trace->surfFlags = leadside->surfFlags;
+			tlc->trace->contents = brush->contents;
+		}
+	}
+}
+
+/*
+* CM_TestBoxInBrush_SSE2
+*/
+static void CM_TestBoxInBrush_SSE2( cmtrace_t *tlc, cbrush_t *brush )
+{
+	int i, j;
+	const float *group;
+	__m128 zero, nx, ny, nz, negx, negy, negz, d;
+	__m128 startmins[3], startmaxs[3];
+
+	for( j = 0; j < 3; j++ )
+	{
+		startmins[j] = _mm_set1_ps( tlc->startmins[j] );
+		startmaxs[j] = _mm_set1_ps( tlc->startmaxs[j] );
+	}
+	zero = _mm_setzero_ps();
+
+	for( i = 0, group = brush->planes; i < brush->numsides; i += 4, group += 16 )
+	{
+		nx = _mm_load_ps( group );
+		ny = _mm_load_ps( group + 4 );
+		nz = _mm_load_ps( group + 8 );
+
+		negx = _mm_cmplt_ps( nx, zero );
+		negy = _mm_cmplt_ps( ny, zero );
+		negz = _mm_cmplt_ps( nz, zero );
+
+		d = _mm_mul_ps( nx, _mm_or_ps( _mm_and_ps( negx, startmaxs[0] ), _mm_andnot_ps( negx, startmins[0] ) ) );
+		d = _mm_add_ps( d, _mm_mul_ps( ny, _mm_or_ps( _mm_and_ps( negy, startmaxs[1] ), _mm_andnot_ps( negy, startmins[1] ) ) ) );
+		d = _mm_add_ps( d, _mm_mul_ps( nz, _mm_or_ps( _mm_and_ps( negz, startmaxs[2] ), _mm_andnot_ps( negz, startmins[2] ) ) ) );
+
+		// if completely in front of face, no intersection
+		if( _mm_movemask_ps( _mm_cmpgt_ps( d, _mm_load_ps( group + 12 ) ) ) )
+			return;
+	}
+
+	// inside this brush
+	tlc->trace->startsolid = tlc->trace->allsolid = qtrue;
+	tlc->trace->fraction = 0;
+	tlc->trace->contents = brush->contents;
+}
+
+#endif // CM_SIMD_BRUSHES
 
 /*
 * CM_ClipBoxToBrush
 */
-static void CM_ClipBoxToBrush( cmodel_state_t *cms, cbrush_t *brush )
+static void CM_ClipBoxToBrush( cmtrace_t *tlc, cbrush_t *brush )
 {
 	int i;
 	cplane_t *p, *clipplane;
@@ -520,6 +945,14 @@ static void CM_ClipBoxToBrush( cmodel_state_t *cms, cbrush_t *brush )
 	if( !brush->numsides )
 		return;
 
+#ifdef CM_SIMD_BRUSHES
+	if( brush->planes )
+	{
+		CM_ClipBoxToBrush_SSE2( tlc, brush );
+		return;
+	}
+#endif
+
 	enterfrac = -1;
 	leavefrac = 1;
 	clipplane = NULL;
@@ -538,44 +971,44 @@ static void CM_ClipBoxToBrush( cmodel_state_t *cms, cbrush_t *brush )
 		// push the plane out apropriately for mins/maxs
 		if( p->type < 3 )
 		{
-			d1 = trace_startmins[p->type] - p->dist;
-			d2 = trace_endmins[p->type] - p->dist;
+			d1 = tlc->startmins[p->type] - p->dist;
+			d2 = tlc->endmins[p->type] - p->dist;
 		}
 		else
 		{
 			switch( p->signbits )
 			{
 			case 0:
-				d1 = p->normal[0]*trace_startmins[0] + p->normal[1]*trace_startmins[1] + p->normal[2]*trace_startmins[2] - p->dist;
-				d2 = p->normal[0]*trace_endmins[0] + p->normal[1]*trace_endmins[1] + p->normal[2]*trace_endmins[2] - p->dist;
+				d1 = p->normal[0]*tlc->startmins[0] + p->normal[1]*tlc->startmins[1] + p->normal[2]*tlc->startmins[2] - p->dist;
+				d2 = p->normal[0]*tlc->endmins[0] + p->normal[1]*tlc->endmins[1] + p->normal[2]*tlc->endmins[2] - p->dist;
 				break;
 			case 1:
-				d1 = p->normal[0]*trace_startmaxs[0] + p->normal[1]*trace_startmins[1] + p->normal[2]*trace_startmins[2] - p->dist;
-				d2 = p->normal[0]*trace_endmaxs[0] + p->normal[1]*trace_endmins[1] + p->normal[2]*trace_endmins[2] - p->dist;
+				d1 = p->normal[0]*tlc->startmaxs[0] + p->normal[1]*tlc->startmins[1] + p->normal[2]*tlc->startmins[2] - p->dist;
+				d2 = p->normal[0]*tlc->endmaxs[0] + p->normal[1]*tlc->endmins[1] + p->normal[2]*tlc->endmins[2] - p->dist;
 				break;
 			case 2:
-				d1 = p->normal[0]*trace_startmins[0] + p->normal[1]*trace_startmaxs[1] + p->normal[2]*trace_startmins[2] - p->dist;
-				d2 = p->normal[0]*trace_endmins[0] + p->normal[1]*trace_endmaxs[1] + p->normal[2]*trace_endmins[2] - p->dist;
+				d1 = p->normal[0]*tlc->startmins[0] + p->normal[1]*tlc->startmaxs[1] + p->normal[2]*tlc->startmins[2] - p->dist;
+				d2 = p->normal[0]*tlc->endmins[0] + p->normal[1]*tlc->endmaxs[1] + p->normal[2]*tlc->endmins[2] - p->dist;
 				break;
 			case 3:
-				d1 = p->normal[0]*trace_startmaxs[0] + p->normal[1]*trace_startmaxs[1] + p->normal[2]*trace_startmins[2] - p->dist;
-				d2 = p->normal[0]*trace_endmaxs[0] + p->normal[1]*trace_endmaxs[1] + p->normal[2]*trace_endmins[2] - p->dist;
+				d1 = p->normal[0]*tlc->startmaxs[0] + p->normal[1]*tlc->startmaxs[1] + p->normal[2]*tlc->startmins[2] - p->dist;
+				d2 = p->normal[0]*tlc->endmaxs[0] + p->normal[1]*tlc->endmaxs[1] + p->normal[2]*tlc->endmins[2] - p->dist;
 				break;
 			case 4:
-				d1 = p->normal[0]*trace_startmins[0] + p->normal[1]*trace_startmins[1] + p->normal[2]*trace_startmaxs[2] - p->dist;
-				d2 = p->normal[0]*trace_endmins[0] + p->normal[1]*trace_endmins[1] + p->normal[2]*trace_endmaxs[2] - p->dist;
+				d1 = p->normal[0]*tlc->startmins[0] + p->normal[1]*tlc->startmins[1] + p->normal[2]*tlc->startmaxs[2] - p->dist;
+				d2 = p->normal[0]*tlc->endmins[0] + p->normal[1]*tlc->endmins[1] + p->normal[2]*tlc->endmaxs[2] - p->dist;
 				break;
 			case 5:
-				d1 = p->normal[0]*trace_startmaxs[0] + p->normal[1]*trace_startmins[1] + p->normal[2]*trace_startmaxs[2] - p->dist;
-				d2 = p->normal[0]*trace_endmaxs[0] + p->normal[1]*trace_endmins[1] + p->normal[2]*trace_endmaxs[2] - p->dist;
+				d1 = p->normal[0]*tlc->startmaxs[0] + p->normal[1]*tlc->startmins[1] + p->normal[2]*tlc->startmaxs[2] - p->dist;
+				d2 = p->normal[0]*tlc->endmaxs[0] + p->normal[1]*tlc->endmins[1] + p->normal[2]*tlc->endmaxs[2] - p->dist;
 				break;
 			case 6:
-				d1 = p->normal[0]*trace_startmins[0] + p->normal[1]*trace_startmaxs[1] + p->normal[2]*trace_startmaxs[2] - p->dist;
-				d2 = p->normal[0]*trace_endmins[0] + p->normal[1]*trace_endmaxs[1] + p->normal[2]*trace_endmaxs[2] - p->dist;
+				d1 = p->normal[0]*tlc->startmins[0] + p->normal[1]*tlc->startmaxs[1] + p->normal[2]*tlc->startmaxs[2] - p->dist;
+				d2 = p->normal[0]*tlc->endmins[0] + p->normal[1]*tlc->endmaxs[1] + p->normal[2]*tlc->endmaxs[2] - p->dist;
 				break;
 			case 7:
-				d1 = p->normal[0]*trace_startmaxs[0] + p->normal[1]*trace_startmaxs[1] + p->normal[2]*trace_startmaxs[2] - p->dist;
-				d2 = p->normal[0]*trace_endmaxs[0] + p->normal[1]*trace_endmaxs[1] + p->normal[2]*trace_endmaxs[2] - p->dist;
+				d1 = p->normal[0]*tlc->startmaxs[0] + p->normal[1]*tlc->startmaxs[1] + p->normal[2]*tlc->startmaxs[2] - p->dist;
+				d2 = p->normal[0]*tlc->endmaxs[0] + p->normal[1]*tlc->endmaxs[1] + p->normal[2]*tlc->endmaxs[2] - p->dist;
 				break;
 			default:
 				d1 = d2 = 0; // shut up compiler
@@ -640,42 +1073,42 @@ static void CM_ClipBoxToBrush( cmodel_state_t *cms, cbrush_t *brush )
 	if( !startout )
 	{
 		// original point was inside brush
-		trace_trace->startsolid = qtrue;
-		trace_trace->contents = brush->contents;
+		tlc->trace->startsolid = qtrue;
+		tlc->trace->contents = brush->contents;
 		if( !getout )
 		{
-			trace_trace->allsolid = qtrue;
-			trace_trace->fraction = 0;
+			tlc->trace->allsolid = qtrue;
+			tlc->trace->fraction = 0;
 		}
 		return;
 	}
 #ifdef TRACEVICFIX
 	if( enterfrac - FRAC_EPSILON <= leavefrac )
 	{
-		if( enterfrac > -1 && enterfrac < trace_realfraction )
+		if( enterfrac > -1 && enterfrac < tlc->realfraction )
 		{
 			if( enterfrac < 0 )
 				enterfrac = 0;
-			trace_realfraction = enterfrac;
-			trace_trace->plane = *clipplane;
-			trace_trace->surfFlags = leadside->surfFlags;
-			trace_trace->contents = brush->contents;
-			trace_trace->fraction = ( enterdist - DIST_EPSILON ) / move;
-			if( trace_trace->fraction < 0 )
-				trace_trace->fraction = 0;
+			tlc->realfraction = enterfrac;
+			tlc->trace->plane = *clipplane;
+			tlc->trace->surfFlags = leadside->surfFlags;
+			tlc->trace->contents = brush->contents;
+			tlc->trace->fraction = ( enterdist - DIST_EPSILON ) / move;
+			if( tlc->trace->fraction < 0 )
+				tlc->trace->fraction = 0;
 		}
 	}
 #else
 	if( enterfrac - ( 1.0f / 1024.0f ) <= leavefrac )
 	{
-		if( enterfrac > -1 && enterfrac < trace_trace->fraction )
+		if( enterfrac > -1 && enterfrac < tlc->trace->fraction )
 		{
 			if( enterfrac < 0 )
 				enterfrac = 0;
-			trace_trace->fraction = enterfrac;
-			trace_trace->plane = *clipplane;
-			trace_trace->surfFlags = leadside->surfFlags;
-			trace_trace->contents = brush->contents;
+			tlc->trace->fraction = enterfrac;
+			tlc->trace->plane = *clipplane;
+			tlc->trace->surfFlags = leadside->surfFlags;
+			tlc->trace->contents = brush->contents;
 		}
 	}
 #endif
@@ -684,7 +1117,7 @@ static void CM_ClipBoxToBrush( cmodel_state_t *cms, cbrush_t *brush )
 /*
 * CM_TestBoxInBrush
 */
-static void CM_TestBoxInBrush( cmodel_state_t *cms, cbrush_t *brush )
+static void CM_TestBoxInBrush( cmtrace_t *tlc, cbrush_t *brush )
 {
 	int i;
 	cplane_t *p;
@@ -693,6 +1126,14 @@ static void CM_TestBoxInBrush( cmodel_state_t *cms, cbrush_t *brush )
 	if( !brush->numsides )
 		return;
 
+#ifdef CM_SIMD_BRUSHES
+	if( brush->planes )
+	{
+		CM_TestBoxInBrush_SSE2( tlc, brush );
+		return;
+	}
+#endif
+
 	side = brush->brushsides;
 	for( i = 0; i < brush->numsides; i++, side++ )
 	{
@@ -702,7 +1143,7 @@ static void CM_TestBoxInBrush( cmodel_state_t *cms, cbrush_t *brush )
 		// if completely in front of face, no intersection
 		if( p->type < 3 )
 		{
-			if( trace_startmins[p->type] > p->dist )
+			if( tlc->startmins[p->type] > p->dist )
 				return;
 		}
 		else
@@ -710,35 +1151,35 @@ static void CM_TestBoxInBrush( cmodel_state_t *cms, cbrush_t *brush )
 			switch( p->signbits )
 			{
 			case 0:
-				if( p->normal[0]*trace_startmins[0] + p->normal[1]*trace_startmins[1] + p->normal[2]*trace_startmins[2] > p->dist )
+				if( p->normal[0]*tlc->startmins[0] + p->normal[1]*tlc->startmins[1] + p->normal[2]*tlc->startmins[2] > p->dist )
 					return;
 				break;
 			case 1:
-				if( p->normal[0]*trace_startmaxs[0] + p->normal[1]*trace_startmins[1] + p->normal[2]*trace_startmins[2] > p->dist )
+				if( p->normal[0]*tlc->startmaxs[0] + p->normal[1]*tlc->startmins[1] + p->normal[2]*tlc->startmins[2] > p->dist )
 					return;
 				break;
 			case 2:
-				if( p->normal[0]*trace_startmins[0] + p->normal[1]*trace_startmaxs[1] + p->normal[2]*trace_startmins[2] > p->dist )
+				if( p->normal[0]*tlc->startmins[0] + p->normal[1]*tlc->startmaxs[1] + p->normal[2]*tlc->startmins[2] > p->dist )
 					return;
 				break;
 			case 3:
-				if( p->normal[0]*trace_startmaxs[0] + p->normal[1]*trace_startmaxs[1] + p->normal[2]*trace_startmins[2] > p->dist )
+				if( p->normal[0]*tlc->startmaxs[0] + p->normal[1]*tlc->startmaxs[1] + p->normal[2]*tlc->startmins[2] > p->dist )
 					return;
 				break;
 			case 4:
-				if( p->normal[0]*trace_startmins[0] + p->normal[1]*trace_startmins[1] + p->normal[2]*trace_startmaxs[2] > p->dist )
+				if( p->normal[0]*tlc->startmins[0] + p->normal[1]*tlc->startmins[1] + p->normal[2]*tlc->startmaxs[2] > p->dist )
 					return;
 				break;
 			case 5:
-				if( p->normal[0]*trace_startmaxs[0] + p->normal[1]*trace_startmins[1] + p->normal[2]*trace_startmaxs[2] > p->dist )
+				if( p->normal[0]*tlc->startmaxs[0] + p->normal[1]*tlc->startmins[1] + p->normal[2]*tlc->startmaxs[2] > p->dist )
 					return;
 				break;
 			case 6:
-				if( p->normal[0]*trace_startmins[0] + p->normal[1]*trace_startmaxs[1] + p->normal[2]*trace_startmaxs[2] > p->dist )
+				if( p->normal[0]*tlc->startmins[0] + p->normal[1]*tlc->startmaxs[1] + p->normal[2]*tlc->startmaxs[2] > p->dist )
 					return;
 				break;
 			case 7:
-				if( p->normal[0]*trace_startmaxs[0] + p->normal[1]*trace_startmaxs[1] + p->normal[2]*trace_startmaxs[2] > p->dist )
+				if( p->normal[0]*tlc->startmaxs[0] + p->normal[1]*tlc->startmaxs[1] + p->normal[2]*tlc->startmaxs[2] > p->dist )
 					return;
 				break;
 			default:
@@ -749,33 +1190,43 @@ static void CM_TestBoxInBrush( cmodel_state_t *cms, cbrush_t *brush )
 	}
 
 	// inside this brush
-	trace_trace->startsolid = trace_trace->allsolid = qtrue;
-	trace_trace->fraction = 0;
-	trace_trace->contents = brush->contents;
+	tlc->trace->startsolid = tlc->trace->allsolid = qtrue;
+	tlc->trace->fraction = 0;
+	tlc->trace->contents = brush->contents;
 }
 
 /*
 * CM_CollideBox
 */
-static void CM_CollideBox( cmodel_state_t *cms, cbrush_t **markbrushes, int nummarkbrushes, cface_t **markfaces,
-						  int nummarkfaces, void ( *func )( cmodel_state_t *cms, cbrush_t *b ) )
+static void CM_CollideBox( cmtrace_t *tlc, cbrush_t **markbrushes, int nummarkbrushes, cface_t **markfaces,
+						  int nummarkfaces, void ( *func )( cmtrace_t *tlc, cbrush_t *b ) )
 {
-	int i, j;
+	int i, j, checknum;
 	cbrush_t *b;
 	cface_t	*patch;
 	cbrush_t *facet;
+	cmtracemarkers_t *markers = tlc->markers;
 
 	// trace line against all brushes
 	for( i = 0; i < nummarkbrushes; i++ )
 	{
 		b = markbrushes[i];
-		if( b->checkcount == cms->checkcount )
-			continue; // already checked this brush
-		b->checkcount = cms->checkcount;
-		if( !( b->contents & trace_contents ) )
+		if( markers )
+		{
+			checknum = b - tlc->cms->map_brushes;
+			if( markers->brushchecks[checknum] == markers->checkcount )
+				continue; // already checked this brush
+			markers->brushchecks[checknum] = markers->checkcount;
+		}
+		if( !( b->contents & tlc->contents ) )
 			continue;
-		func( cms, b );
-		if( !trace_trace->fraction )
+		if( !BoundsIntersect( b->mins, b->maxs, tlc->absmins, tlc->absmaxs ) )
+		{
+			tlc->numculls++;
+			continue;
+		}
+		func( tlc, b );
+		if( !tlc->trace->fraction )
 			return;
 	}
 
@@ -786,18 +1237,27 @@ static void CM_CollideBox( cmodel_state_t *cms, cbrush_t **markbrushes, int numm
 	for( i = 0; i < nummarkfaces; i++ )
 	{
 		patch = markfaces[i];
-		if( patch->checkcount == cms->checkcount )
-			continue; // already checked this patch
-		patch->checkcount = cms->checkcount;
-		if( !( patch->contents & trace_contents ) )
+		if( markers )
+		{
+			checknum = patch - tlc->cms->map_faces;
+			if( markers->facechecks[checknum] == markers->checkcount )
+				continue; // already checked this patch
+			markers->facechecks[checknum] = markers->checkcount;
+		}
+		if( !( patch->contents & tlc->contents ) )
 			continue;
-		if( !BoundsIntersect( patch->mins, patch->maxs, trace_absmins, trace_absmaxs ) )
+		if( !BoundsIntersect( patch->mins, patch->maxs, tlc->absmins, tlc->absmaxs ) )
 			continue;
 		facet = patch->facets;
 		for( j = 0; j < patch->numfacets; j++, facet++ )
 		{
-			func( cms, facet );
-			if( !trace_trace->fraction )
+			if( !BoundsIntersect( facet->mins, facet->maxs, tlc->absmins, tlc->absmaxs ) )
+			{
+				tlc->numculls++;
+				continue;
+			}
+			func( tlc, facet );
+			if( !tlc->trace->fraction )
 				return;
 		}
 	}
@@ -806,26 +1266,27 @@ static void CM_CollideBox( cmodel_state_t *cms, cbrush_t **markbrushes, int numm
 /*
 * CM_ClipBox
 */
-static inline void CM_ClipBox( cmodel_state_t *cms, cbrush_t **markbrushes, int nummarkbrushes, cface_t **markfaces,
+static inline void CM_ClipBox( cmtrace_t *tlc, cbrush_t **markbrushes, int nummarkbrushes, cface_t **markfaces,
 							  int nummarkfaces )
 {
-	CM_CollideBox( cms, markbrushes, nummarkbrushes, markfaces, nummarkfaces, CM_ClipBoxToBrush );
+	CM_CollideBox( tlc, markbrushes, nummarkbrushes, markfaces, nummarkfaces, CM_ClipBoxToBrush );
 }
 
 /*
 * CM_TestBox
 */
-static inline void CM_TestBox( cmodel_state_t *cms, cbrush_t **markbrushes, int nummarkbrushes, cface_t **markfaces,
+static inline void CM_TestBox( cmtrace_t *tlc, cbrush_t **markbrushes, int nummarkbrushes, cface_t **markfaces,
 							  int nummarkfaces )
 {
-	CM_CollideBox( cms, markbrushes, nummarkbrushes, markfaces, nummarkfaces, CM_TestBoxInBrush );
+	CM_CollideBox( tlc, markbrushes, nummarkbrushes, markfaces, nummarkfaces, CM_TestBoxInBrush );
 }
 
 /*
 * CM_RecursiveHullCheck
 */
-static void CM_RecursiveHullCheck( cmodel_state_t *cms, int num, float p1f, float p2f, vec3_t p1, vec3_t p2 )
+static void CM_RecursiveHullCheck( cmtrace_t *tlc, int num, float p1f, float p2f, vec3_t p1, vec3_t p2 )
 {
+	cmodel_state_t *cms = tlc->cms;
 	cnode_t	*node;
 	cplane_t *plane;
 	int side;
@@ -836,20 +1297,22 @@ static void CM_RecursiveHullCheck( cmodel_state_t *cms, int num, float p1f, floa
 
 loc0:
 #ifdef TRACEVICFIX
-	if( trace_realfraction <= p1f )
+	if( tlc->realfraction <= p1f )
 		return; // already hit something nearer
 #else
-	if( trace_trace->fraction <= p1f )
+	if( tlc->trace->fraction <= p1f )
 		return; // already hit something nearer
 #endif
+	tlc->numnodes++;
+
 	// if < 0, we are in a leaf node
 	if( num < 0 )
 	{
 		cleaf_t	*leaf;
 
 		leaf = &cms->map_leafs[-1 - num];
-		if( leaf->contents & trace_contents )
-			CM_ClipBox( cms, leaf->markbrushes, leaf->nummarkbrushes, leaf->markfaces, leaf->nummarkfaces );
+		if( leaf->contents & tlc->contents )
+			CM_ClipBox( tlc, leaf->markbrushes, leaf->nummarkbrushes, leaf->markfaces, leaf->nummarkfaces );
 		return;
 	}
 
@@ -864,18 +1327,18 @@ loc0:
 	{
 		t1 = p1[plane->type] - plane->dist;
 		t2 = p2[plane->type] - plane->dist;
-		offset = trace_extents[plane->type];
+		offset = tlc->extents[plane->type];
 	}
 	else
 	{
 		t1 = DotProduct( plane->normal, p1 ) - plane->dist;
 		t2 = DotProduct( plane->normal, p2 ) - plane->dist;
-		if( trace_ispoint )
+		if( tlc->ispoint )
 			offset = 0;
 		else
-			offset = fabs( trace_extents[0] * plane->normal[0] ) +
-			fabs( trace_extents[1] * plane->normal[1] ) +
-			fabs( trace_extents[2] * plane->normal[2] );
+			offset = fabs( tlc->extents[0] * plane->normal[0] ) +
+			fabs( tlc->extents[1] * plane->normal[1] ) +
+			fabs( tlc->extents[2] * plane->normal[2] );
 	}
 
 	// see which sides we need to consider
@@ -927,18 +1390,29 @@ loc0:
 	midf = p1f + ( p2f - p1f ) * frac;
 	VectorLerp( p1, frac, p2, mid );
 
-	CM_RecursiveHullCheck( cms, node->children[side], p1f, midf, p1, mid );
+	CM_RecursiveHullCheck( tlc, node->children[side], p1f, midf, p1, mid );
 
 	// go past the node
 	clamp( frac2, 0, 1 );
 	midf = p1f + ( p2f - p1f ) * frac2;
 	VectorLerp( p1, frac2, p2, mid );
 
-	CM_RecursiveHullCheck( cms, node->children[side^1], midf, p2f, mid, p2 );
+	CM_RecursiveHullCheck( tlc, node->children[side^1], midf, p2f, mid, p2 );
 }
 
 //======================================================================
 
+/*
+* CM_AddTraceStats
+*/
+static void CM_AddTraceStats( cmtrace_t *tlc )
+{
+	if( tlc->numnodes )
+		QAtomic_Add( &c_trace_nodes, tlc->numnodes, NULL );
+	if( tlc->numculls )
+		QAtomic_Add( &c_brush_culls, tlc->numculls, NULL );
+}
+
 /*
 * CM_BoxTrace
 */
@@ -946,43 +1420,46 @@ static void CM_BoxTrace( cmodel_state_t *cms, trace_t *tr, vec3_t start, vec3_t
 						cmodel_t *cmodel, vec3_t origin, int brushmask )
 {
 	qboolean notworld;
+	cmtrace_t tlc_s, *tlc = &tlc_s;
 
 	notworld = ( cmodel != cms->map_cmodels ? qtrue : qfalse );
 
-	cms->checkcount++;  // for multi-check avoidance
 	c_traces++;     // for statistics, may be zeroed
 
 	// fill in a default trace
 	memset( tr, 0, sizeof( *tr ) );
 #ifdef TRACEVICFIX
-	tr->fraction = trace_realfraction = 1;
+	tr->fraction = tlc->realfraction = 1;
 #else
 	tr->fraction = 1;
 #endif
 	if( !cms->numnodes )  // map not loaded
 		return;
 
-	trace_trace = tr;
-	trace_contents = brushmask;
-	VectorCopy( start, trace_start );
-	VectorCopy( end, trace_end );
-	VectorCopy( mins, trace_mins );
-	VectorCopy( maxs, trace_maxs );
+	tlc->cms = cms;
+	tlc->markers = NULL;
+	tlc->trace = tr;
+	tlc->contents = brushmask;
+	tlc->numnodes = tlc->numculls = 0;
+	VectorCopy( start, tlc->start );
+	VectorCopy( end, tlc->end );
+	VectorCopy( mins, tlc->mins );
+	VectorCopy( maxs, tlc->maxs );
 
 	// build a bounding box of the entire move
-	ClearBounds( trace_absmins, trace_absmaxs );
+	ClearBounds( tlc->absmins, tlc->absmaxs );
 
-	VectorAdd( start, trace_mins, trace_startmins );
-	AddPointToBounds( trace_startmins, trace_absmins, trace_absmaxs );
+	VectorAdd( start, tlc->mins, tlc->startmins );
+	AddPointToBounds( tlc->startmins, tlc->absmins, tlc->absmaxs );
 
-	VectorAdd( start, trace_maxs, trace_startmaxs );
-	AddPointToBounds( trace_startmaxs, trace_absmins, trace_absmaxs );
+	VectorAdd( start, tlc->maxs, tlc->startmaxs );
+	AddPointToBounds( tlc->startmaxs, tlc->absmins, tlc->absmaxs );
 
-	VectorAdd( end, trace_mins, trace_endmins );
-	AddPointToBounds( trace_endmins, trace_absmins, trace_absmaxs );
+	VectorAdd( end, tlc->mins, tlc->endmins );
+	AddPointToBounds( tlc->endmins, tlc->absmins, tlc->absmaxs );
 
-	VectorAdd( end, trace_maxs, trace_endmaxs );
-	AddPointToBounds( trace_endmaxs, trace_absmins, trace_absmaxs );
+	VectorAdd( end, tlc->maxs, tlc->endmaxs );
+	AddPointToBounds( tlc->endmaxs, tlc->absmins, tlc->absmaxs );
 
 	//
 	// check for position test special case
@@ -997,9 +1474,9 @@ static void CM_BoxTrace( cmodel_state_t *cms, trace_t *tr, vec3_t start, vec3_t
 
 		if( notworld )
 		{
-			if( BoundsIntersect( cmodel->mins, cmodel->maxs, trace_absmins, trace_absmaxs ) )
+			if( BoundsIntersect( cmodel->mins, cmodel->maxs, tlc->absmins, tlc->absmaxs ) )
 			{
-				CM_TestBox( cms, cmodel->markbrushes, cmodel->nummarkbrushes, cmodel->markfaces, cmodel->nummarkfaces );
+				CM_TestBox( tlc, cmodel->markbrushes, cmodel->nummarkbrushes, cmodel->markfaces, cmodel->nummarkfaces );
 			}
 		}
 		else
@@ -1011,19 +1488,23 @@ static void CM_BoxTrace( cmodel_state_t *cms, trace_t *tr, vec3_t start, vec3_t
 			}
 
 			numleafs = CM_BoxLeafnums( cms, c1, c2, leafs, 1024, &topnode );
+
+			tlc->markers = CM_AcquireTraceMarkers( cms );
 			for( i = 0; i < numleafs; i++ )
 			{
 				leaf = &cms->map_leafs[leafs[i]];
 
-				if( leaf->contents & trace_contents )
+				if( leaf->contents & tlc->contents )
 				{
-					CM_TestBox( cms, leaf->markbrushes, leaf->nummarkbrushes, leaf->markfaces, leaf->nummarkfaces );
+					CM_TestBox( tlc, leaf->markbrushes, leaf->nummarkbrushes, leaf->markfaces, leaf->nummarkfaces );
 					if( tr->allsolid )
 						break;
 				}
 			}
+			CM_ReleaseTraceMarkers( cms, tlc->markers );
 		}
 
+		CM_AddTraceStats( tlc );
 		VectorCopy( start, tr->endpos );
 		return;
 	}
@@ -1033,13 +1514,13 @@ static void CM_BoxTrace( cmodel_state_t *cms, trace_t *tr, vec3_t start, vec3_t
 	//
 	if( VectorCompare( mins, vec3_origin ) && VectorCompare( maxs, vec3_origin ) )
 	{
-		trace_ispoint = qtrue;
-		VectorClear( trace_extents );
+		tlc->ispoint = qtrue;
+		VectorClear( tlc->extents );
 	}
 	else
 	{
-		trace_ispoint = qfalse;
-		VectorSet( trace_extents,
+		tlc->ispoint = qfalse;
+		VectorSet( tlc->extents,
 			-mins[0] > maxs[0] ? -mins[0] : maxs[0],
 			-mins[1] > maxs[1] ? -mins[1] : maxs[1],
 			-mins[2] > maxs[2] ? -mins[2] : maxs[2] );
@@ -1049,9 +1530,15 @@ static void CM_BoxTrace( cmodel_state_t *cms, trace_t *tr, vec3_t start, vec3_t
 	// general sweeping through world
 	//
 	if( !notworld )
-		CM_RecursiveHullCheck( cms, 0, 0, 1, start, end );
-	else if( BoundsIntersect( cmodel->mins, cmodel->maxs, trace_absmins, trace_absmaxs ) )
-		CM_ClipBox( cms, cmodel->markbrushes, cmodel->nummarkbrushes, cmodel->markfaces, cmodel->nummarkfaces );
+	{
+		tlc->markers = CM_AcquireTraceMarkers( cms );
+		CM_RecursiveHullCheck( tlc, 0, 0, 1, start, end );
+		CM_ReleaseTraceMarkers( cms, tlc->markers );
+	}
+	else if( BoundsIntersect( cmodel->mins, cmodel->maxs, tlc->absmins, tlc->absmaxs ) )
+		CM_ClipBox( tlc, cmodel->markbrushes, cmodel->nummarkbrushes, cmodel->markfaces, cmodel->nummarkfaces );
+
+	CM_AddTraceStats( tlc );
 
 #ifdef TRACEVICFIX
 	clamp( tr->fraction, 0, 1 );
@@ -23,7 +23,7 @@ typedef struct cmodel_state_s cmodel_state_t;
 extern cvar_t *cm_noCurves;
 
 // debug/performance counter vars
-int c_pointcontents, c_traces, c_brush_traces;
+int c_pointcontents, c_traces, c_brush_traces, c_brush_culls, c_trace_nodes, c_trace_frames;
 
 struct cmodel_s *CM_LoadMap( cmodel_state_t *cms, const char *name, qboolean clientload, unsigned *checksum );
 struct cmodel_s *CM_InlineModel( cmodel_state_t *cms, int num ); // 1, 2, etc
@@ -45,6 +45,8 @@ struct cmodel_s *CM_ModelForBBox( cmodel_state_t *cms, vec3_t mins, vec3_t maxs
 struct cmodel_s *CM_OctagonModelForBBox( cmodel_state_t *cms, vec3_t mins, vec3_t maxs );
 void CM_InlineModelBounds( cmodel_state_t *cms, struct cmodel_s *cmodel, vec3_t mins, vec3_t maxs );
 
+// point contents and traces may run in several threads at once, as long as the map stays loaded
+
 // returns an ORed contents mask
 int CM_TransformedPointContents( cmodel_state_t *cms, vec3_t p, struct cmodel_s *cmodel, vec3_t origin, vec3_t angles );
 
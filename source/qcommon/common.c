@@ -1313,6 +1313,7 @@ void Qcommon_Frame( unsigned int realmsec )
 	static quint64 fc = 0;
 	char *s;
 	int time_before = 0, time_between = 0, time_after = 0;
+	int zmessages, zbytesin, zbytesout, zusec;
 	static unsigned int gamemsec;
 
 	if( setjmp( abortframe ) )
@@ -1355,13 +1356,17 @@ void Qcommon_Frame( unsigned int realmsec )
 		gamemsec = realmsec;
 	}
 
+	c_trace_frames++;
 	if( com_showtrace->integer )
 	{
-		Com_Printf( "%4i traces %4i brush traces %4i points\n",
-			c_traces, c_brush_traces, c_pointcontents );
+		Com_Printf( "%4i traces %4i nodes %4i brush traces %4i culled %4i points\n",
+			c_traces, c_trace_nodes, c_brush_traces, c_brush_culls, c_pointcontents );
 		c_traces = 0;
+		c_trace_nodes = 0;
 		c_brush_traces = 0;
+		c_brush_culls = 0;
 		c_pointcontents = 0;
+		c_trace_frames = 0;
 	}
 
 	wswcurl_perform();
@@ -1412,6 +1417,13 @@ void Qcommon_Frame( unsigned int realmsec )
 			all, sv, gm, cl, rf );
 	}
 
+	Netchan_GetCompressStats( &zmessages, &zbytesin, &zbytesout, &zusec );
+	if( host_speeds->integer && zmessages )
+	{
+		Com_Printf( "zlib:%3i msgs %6i -> %6i bytes (%3i%%) %5ius\n",
+			zmessages, zbytesin, zbytesout, zbytesin ? zbytesout * 100 / zbytesin : 0, zusec );
+	}
+
 	MM_Frame( realmsec );
 
 	// wsw : aiwa : generic observer pattern to plug in arbitrary functionality
@@ -46,6 +46,14 @@ QUAKE FILESYSTEM
 
 #define FS_PAK_MANIFEST_FILE		"manifest.txt"
 
+#define FS_PAK_CACHE_FILE			"pakcache.dat"
+#define FS_PAK_CACHE_MAGIC			0x43504b57 // "WKPC"
+#define FS_PAK_CACHE_VERSION		1
+#define FS_PAK_CACHE_HEADER			( 4 * 4 )
+#define FS_PAK_CACHE_PAKHEADER		( 6 * 4 )
+#define FS_PAK_CACHE_FILEINFO		( 5 * 4 )
+#define FS_PAK_CACHE_HASH_SIZE		1024
+
 const char *pak_extensions[] = { "pk3", "pak", "pk2", NULL };
 
 static const char *forbidden_gamedirs[] = {
@@ -88,6 +96,9 @@ typedef struct
 	char *manifest;
 	unsigned checksum;
 	qboolean pure;
+	qboolean indexed;   // files added to the path index
+	unsigned diskSize;  // pk3 file size and modification time, for the central directory cache
+	unsigned diskMTime;
 	void *sysHandle;
 	int numFiles;
 	int hashSize;
@@ -103,6 +114,7 @@ typedef struct filehandle_s
 	unsigned uncompressedSize;      // uncompressed size
 	unsigned restReadUncompressed;  // number of bytes to be obtained after decompession
 	zipEntry_t *zipEntry;
+	qboolean pakStored;             // uncompressed file in a pak, can be mapped instead of read
 
 	wswcurl_req *streamHandle;
 	qboolean streamDone;
@@ -118,9 +130,55 @@ typedef struct searchpath_s
 {
 	char *path;                     // set on both, packs and directories, won't include the pack name, just path
 	pack_t *pack;
+	int order;                      // position in fs_searchpaths, for the path index
+	qboolean watched;               // directory is watched for new paks, so rescans don't list it
 	struct searchpath_s *next;
 } searchpath_t;
 
+// central directory of a pk3 file read from the cache,
+// stored as little endian values in fs_pakcache
+typedef struct cachedpak_s
+{
+	const char *filename;
+	unsigned diskSize, diskMTime;
+	unsigned checksum;
+	int numFiles;
+	unsigned namesLen;
+	const qbyte *fileInfos;         // numFiles times flags, sizes, offset and mtime
+	const char *fileNames;
+	struct cachedpak_s *hashNext;
+} cachedpak_t;
+
+// pak written into a watched directory, to be added on the next rescan
+typedef struct changedpak_s
+{
+	char *filename;
+	struct changedpak_s *next;
+} changedpak_t;
+
+// the pak files first found for every file name in the paks of fs_searchpaths,
+// so that looking a file up doesn't need to go through thousands of paks
+typedef struct
+{
+	const char *name;
+	unsigned hashValue;
+	searchpath_t *search;           // first pak that's not pure
+	packfile_t *file;
+	searchpath_t *pureSearch;       // first pure pak
+	packfile_t *pureFile;
+	int hashNext;                   // index + 1 of the next entry with the same hash key
+} pathindex_t;
+
+// file loaded with FS_LoadFile and mapped from its pak instead of read
+typedef struct mappedfile_s
+{
+	void *data;
+	size_t size;
+	void *mapping;
+	size_t mappingOffset;
+	struct mappedfile_s *next;
+} mappedfile_t;
+
 typedef struct
 {
 	char *name;
@@ -136,6 +194,7 @@ static cvar_t *fs_cdpath;
 static cvar_t *fs_usehomedir;
 static cvar_t *fs_basegame;
 static cvar_t *fs_game;
+static cvar_t *fs_loadthreads;
 
 // these are used in couple of functions to temporary store a full path to filenames
 // so that it doesn't need to be constantly reallocated
@@ -146,6 +205,42 @@ static searchpath_t *fs_basepaths = NULL;       // directories without gamedirs
 static searchpath_t *fs_searchpaths = NULL;     // game search directories, plus paks
 static searchpath_t *fs_base_searchpaths;       // same as above, but without extra gamedirs
 
+static int fs_numsearchpaths;
+static searchpath_t **fs_searchdirs;            // the directories in fs_searchpaths, in order
+static int fs_numsearchdirs;
+
+static pathindex_t *fs_pathindex;
+static int fs_numpathindex, fs_maxpathindex;
+static int *fs_pathindexhash;                   // index + 1 of the first entry for every hash key
+static qboolean fs_pathindexdirty = qtrue;      // rebuild the whole index on next lookup
+
+static mappedfile_t *fs_mappedfiles;
+
+static qbyte *fs_pakcache;
+static cachedpak_t *fs_cachedpaks;
+static cachedpak_t *fs_cachedpakshash[FS_PAK_CACHE_HASH_SIZE];
+static qboolean fs_pakcachedirty;               // paks were loaded without the cache
+
+static changedpak_t *fs_changedpaks;
+static qboolean fs_rescanall;                   // list all directories on next rescan, changes were lost
+
+// pk3 headers parsed in parallel by FS_LoadPackFiles, allocations and printing
+// of the loaders are serialized with fs_loadmutex while it's set
+static qthreadpool_t *fs_loadpool;
+static qmutex_t *fs_loadmutex;
+static int fs_numloadthreads;
+
+typedef struct
+{
+	const char *filename;
+	int index;                      // in the list of pak names
+	pack_t *pack;
+} packload_t;
+
+// startup timings, in microseconds
+static quint64 fs_listtime, fs_parsetime, fs_inserttime;
+static int fs_numparsedpaks;
+
 static mempool_t *fs_mempool;
 
 #define FS_Malloc( size ) Mem_Alloc( fs_mempool, size )
@@ -156,6 +251,8 @@ static mempool_t *fs_mempool;
 #define FS_MAX_HASH_SIZE    512
 #define FS_EXT_HASH_SIZE	64
 #define FS_MAX_HANDLES	    1024
+#define FS_MIN_PATHINDEX	0x1000
+#define FS_MIN_MMAP_SIZE	0x10000         // smaller files are read, mapping them isn't worth it
 
 static filehandle_t fs_filehandles[FS_MAX_HANDLES];
 static filehandle_t fs_filehandles_headnode, *fs_free_filehandles;
@@ -208,6 +305,27 @@ static unsigned FS_PackHashValue( const char *str )
 	return hashval;
 }
 
+/*
+* FS_PathHashValue
+* 
+* FNV-1a, spreads the whole path index much better than FS_PackHashValue
+*/
+static unsigned FS_PathHashValue( const char *str )
+{
+	int c;
+	unsigned hashval = 2166136261u;
+
+	for( ; *str; str++ )
+	{
+		c = tolower( *str );
+		if( c == '\\' )
+			c = '/';
+		hashval = ( hashval ^ c ) * 16777619u;
+	}
+
+	return hashval;
+}
+
 /*
 * FS_PackHashKey
 */
@@ -270,6 +388,24 @@ static char *FS_CopyString( const char *in )
 	return out;
 }
 
+/*
+* FS_LockLoad
+*/
+static inline void FS_LockLoad( void )
+{
+	if( fs_loadmutex )
+		QMutex_Lock( fs_loadmutex );
+}
+
+/*
+* FS_UnlockLoad
+*/
+static inline void FS_UnlockLoad( void )
+{
+	if( fs_loadmutex )
+		QMutex_Unlock( fs_loadmutex );
+}
+
 /*
 * FS_CheckTempnameSize
 */
@@ -415,55 +551,254 @@ static int FS_FileLength( FILE *f, qboolean close )
 }
 
 /*
-* FS_SearchPathForFile
-* 
-* Gives the searchpath element where this file exists, or NULL if it doesn't
+* FS_UpdateSearchOrder
 */
-static searchpath_t *FS_SearchPathForFile( const char *filename )
+static void FS_UpdateSearchOrder( void )
 {
+	int numdirs;
 	searchpath_t *search;
-	qboolean purepass;
 
-	if( !COM_ValidateRelativeFilename( filename ) )
+	fs_numsearchpaths = 0;
+	numdirs = 0;
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		search->order = fs_numsearchpaths++;
+		if( !search->pack )
+			numdirs++;
+	}
+
+	if( fs_searchdirs )
+		FS_Free( fs_searchdirs );
+	fs_searchdirs = ( searchpath_t ** )FS_Malloc( sizeof( *fs_searchdirs ) * ( numdirs + 1 ) );
+
+	fs_numsearchdirs = 0;
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		if( !search->pack )
+			fs_searchdirs[fs_numsearchdirs++] = search;
+	}
+}
+
+/*
+* FS_PathIndexFind
+*/
+static pathindex_t *FS_PathIndexFind( const char *filename, unsigned hashValue )
+{
+	int i;
+	pathindex_t *entry;
+
+	if( !fs_pathindexhash )
 		return NULL;
 
-	// search through the path, one element at a time
-	search = fs_searchpaths;
-	purepass = qtrue;
-	while( search )
+	for( i = fs_pathindexhash[FS_PackHashKey( hashValue, fs_maxpathindex )]; i; i = entry->hashNext )
 	{
-		// is the element a pak file?
-		if( search->pack )
+		entry = &fs_pathindex[i - 1];
+		if( entry->hashValue == hashValue && !Q_stricmp( entry->name, filename ) )
+			return entry;
+	}
+
+	return NULL;
+}
+
+/*
+* FS_PathIndexAdd
+*/
+static pathindex_t *FS_PathIndexAdd( const char *filename, unsigned hashValue )
+{
+	int i;
+	unsigned hashKey;
+	pathindex_t *entry;
+
+	if( fs_numpathindex == fs_maxpathindex )
+	{
+		// grow and rehash, keeping the hash size equal to the number of entries
+		if( fs_pathindex )
+		{
+			fs_maxpathindex *= 2;
+			fs_pathindex = ( pathindex_t * )FS_Realloc( fs_pathindex, sizeof( *fs_pathindex ) * fs_maxpathindex );
+			FS_Free( fs_pathindexhash );
+		}
+		else
+		{
+			fs_maxpathindex = FS_MIN_PATHINDEX;
+			fs_pathindex = ( pathindex_t * )FS_Malloc( sizeof( *fs_pathindex ) * fs_maxpathindex );
+		}
+
+		fs_pathindexhash = ( int * )FS_Malloc( sizeof( *fs_pathindexhash ) * fs_maxpathindex );
+		for( i = 0; i < fs_numpathindex; i++ )
+		{
+			hashKey = FS_PackHashKey( fs_pathindex[i].hashValue, fs_maxpathindex );
+			fs_pathindex[i].hashNext = fs_pathindexhash[hashKey];
+			fs_pathindexhash[hashKey] = i + 1;
+		}
+	}
+
+	entry = &fs_pathindex[fs_numpathindex++];
+	memset( entry, 0, sizeof( *entry ) );
+	entry->name = filename;
+	entry->hashValue = hashValue;
+
+	hashKey = FS_PackHashKey( hashValue, fs_maxpathindex );
+	entry->hashNext = fs_pathindexhash[hashKey];
+	fs_pathindexhash[hashKey] = fs_numpathindex;
+
+	return entry;
+}
+
+/*
+* FS_IndexPak
+* 
+* Adds the files of the pak to the path index, where the pak comes before the paks already there
+*/
+static void FS_IndexPak( searchpath_t *search )
+{
+	int i;
+	unsigned hashValue;
+	pack_t *pack = search->pack;
+	packfile_t *file;
+	pathindex_t *entry;
+
+	for( i = 0, file = pack->files; i < pack->numFiles; i++, file++ )
+	{
+		hashValue = FS_PathHashValue( file->name );
+		entry = FS_PathIndexFind( file->name, hashValue );
+		if( !entry )
+			entry = FS_PathIndexAdd( file->name, hashValue );
+
+		// the later of the files with the same name in a pak wins, as with FS_SearchPakForFile
+		if( pack->pure )
 		{
-			if( search->pack->pure == purepass )
+			if( !entry->pureSearch || entry->pureSearch == search || search->order < entry->pureSearch->order )
 			{
-				if( FS_SearchPakForFile( search->pack, filename, -1, NULL ) )
-					return search;
+				entry->pureSearch = search;
+				entry->pureFile = file;
 			}
 		}
 		else
 		{
-			if( !purepass )
+			if( !entry->search || entry->search == search || search->order < entry->search->order )
 			{
-				if( FS_SearchDirectoryForFile( search, filename, NULL ) )
-					return search;
+				entry->search = search;
+				entry->file = file;
 			}
 		}
+	}
 
-		if( !search->next && purepass )
-		{
-			search = fs_searchpaths;
-			purepass = qfalse;
-		}
-		else
+	pack->indexed = qtrue;
+}
+
+/*
+* FS_RebuildPathIndex
+*/
+static void FS_RebuildPathIndex( void )
+{
+	searchpath_t *search;
+
+	fs_numpathindex = 0;
+	if( fs_pathindexhash )
+		memset( fs_pathindexhash, 0, sizeof( *fs_pathindexhash ) * fs_maxpathindex );
+
+	FS_UpdateSearchOrder();
+
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		if( search->pack )
+			FS_IndexPak( search );
+	}
+
+	fs_pathindexdirty = qfalse;
+}
+
+/*
+* FS_UpdatePathIndex
+* 
+* Adds the paks added to the search paths since the last update
+*/
+static void FS_UpdatePathIndex( void )
+{
+	searchpath_t *search;
+
+	// paks were removed or changed purity, the whole index is rebuilt on next lookup anyway
+	if( fs_pathindexdirty )
+		return;
+
+	FS_UpdateSearchOrder();
+
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		if( search->pack && !search->pack->indexed )
+			FS_IndexPak( search );
+	}
+}
+
+/*
+* FS_SearchPathForFileExt
+* 
+* Pure paks come first, then directories and the other paks in search order.
+* The rank tells which of two files comes first.
+*/
+static searchpath_t *FS_SearchPathForFileExt( const char *filename, unsigned hashValue, packfile_t **pakFile, int *rank )
+{
+	int i;
+	pathindex_t *entry;
+	searchpath_t *search;
+
+	if( fs_pathindexdirty )
+		FS_RebuildPathIndex();
+
+	entry = FS_PathIndexFind( filename, hashValue );
+	if( entry && entry->pureSearch )
+	{
+		if( pakFile )
+			*pakFile = entry->pureFile;
+		if( rank )
+			*rank = entry->pureSearch->order;
+		return entry->pureSearch;
+	}
+
+	// directories before the first pak having the file override it
+	for( i = 0; i < fs_numsearchdirs; i++ )
+	{
+		search = fs_searchdirs[i];
+		if( entry && entry->search && search->order > entry->search->order )
+			break;
+
+		if( FS_SearchDirectoryForFile( search, filename, NULL ) )
 		{
-			search = search->next;
+			if( pakFile )
+				*pakFile = NULL;
+			if( rank )
+				*rank = fs_numsearchpaths + search->order;
+			return search;
 		}
 	}
 
+	if( entry && entry->search )
+	{
+		if( pakFile )
+			*pakFile = entry->file;
+		if( rank )
+			*rank = fs_numsearchpaths + entry->search->order;
+		return entry->search;
+	}
+
 	return NULL;
 }
 
+/*
+* FS_SearchPathForFile
+* 
+* Gives the searchpath element where this file exists, or NULL if it doesn't,
+* and the file in the pak if the element is a pak
+*/
+static searchpath_t *FS_SearchPathForFile( const char *filename, packfile_t **pakFile )
+{
+	if( !COM_ValidateRelativeFilename( filename ) )
+		return NULL;
+
+	return FS_SearchPathForFileExt( filename, FS_PathHashValue( filename ), pakFile, NULL );
+}
+
 /*
 * FS_SearchPathForBaseFile
 * 
@@ -517,7 +852,7 @@ static const char *FS_PakNameForPath( pack_t *pack )
 */
 const char *FS_PakNameForFile( const char *filename )
 {
-	searchpath_t *search = FS_SearchPathForFile( filename );
+	searchpath_t *search = FS_SearchPathForFile( filename, NULL );
 
 	if( !search || !search->pack )
 		return NULL;
@@ -668,13 +1003,11 @@ static void FS_CloseFileHandle( filehandle_t *fh )
 */
 const char *FS_FirstExtension( const char *filename, const char *extensions[], int num_extensions )
 {
-	char **filenames;           // slots for testable filenames
-	int *filekeys;
-	size_t filename_size;       // size of one slot
-	int i;
+	char *testname;
+	size_t testname_size;
+	int i, rank, bestrank;
 	size_t max_extension_length;
-	searchpath_t *search;
-	qboolean purepass;
+	const char *best;
 
 	assert( filename && extensions );
 
@@ -696,76 +1029,31 @@ const char *FS_FirstExtension( const char *filename, const char *extensions[], i
 			max_extension_length = strlen( extensions[i] );
 	}
 
-	// set the filenames to be tested
-	filenames = ( char** )Mem_TempMalloc( sizeof( char * ) * num_extensions );
-	filename_size = sizeof( char ) * ( strlen( filename ) + max_extension_length + 1 );
-	filekeys = ( int* )Mem_TempMalloc( sizeof( int ) * num_extensions );
+	testname_size = sizeof( char ) * ( strlen( filename ) + max_extension_length + 1 );
+	testname = ( char* )Mem_TempMalloc( testname_size );
 
+	// the extension of the file coming first in the search path wins,
+	// the earlier extension on ties
+	best = NULL;
+	bestrank = 0;
 	for( i = 0; i < num_extensions; i++ )
 	{
-		if( i )
-			filenames[i] = ( char * )( ( qbyte * )filenames[0] + filename_size * i );
-		else
-			filenames[i] = ( char* )Mem_TempMalloc( filename_size * num_extensions );
-		Q_strncpyz( filenames[i], filename, filename_size );
-		COM_ReplaceExtension( filenames[i], extensions[i], filename_size );
+		Q_strncpyz( testname, filename, testname_size );
+		COM_ReplaceExtension( testname, extensions[i], testname_size );
 
-		filekeys[i] = FS_PackHashValue( filenames[i] );
-	}
+		if( !FS_SearchPathForFileExt( testname, FS_PathHashValue( testname ), NULL, &rank ) )
+			continue;
 
-	// search through the path, one element at a time
-	search = fs_searchpaths;
-	purepass = qtrue;
-	while( search )
-	{
-		if( search->pack ) // is the element a pak file?
-		{
-			if( search->pack->pure == purepass )
-			{
-				for( i = 0; i < num_extensions; i++ )
-				{
-					if( FS_SearchPakForFile( search->pack, filenames[i], filekeys[i], NULL ) )
-					{
-						Mem_TempFree( filekeys );
-						Mem_TempFree( filenames[0] );
-						Mem_TempFree( filenames );
-						return extensions[i];
-					}
-				}
-			}
-		}
-		else
-		{
-			if( !purepass )
-			{
-				for( i = 0; i < num_extensions; i++ )
-				{
-					if( FS_SearchDirectoryForFile( search, filenames[i], NULL ) )
-					{
-						Mem_TempFree( filekeys );
-						Mem_TempFree( filenames[0] );
-						Mem_TempFree( filenames );
-						return extensions[i];
-					}
-				}
-			}
-		}
-		if( !search->next && purepass )
-		{
-			search = fs_searchpaths;
-			purepass = qfalse;
-		}
-		else
+		if( !best || rank < bestrank )
 		{
-			search = search->next;
+			best = extensions[i];
+			bestrank = rank;
 		}
 	}
 
-	Mem_TempFree( filekeys );
-	Mem_TempFree( filenames[0] );
-	Mem_TempFree( filenames );
+	Mem_TempFree( testname );
 
-	return NULL;
+	return best;
 }
 
 /*
@@ -774,6 +1062,7 @@ const char *FS_FirstExtension( const char *filename, const char *extensions[], i
 static int FS_FileExists( const char *filename, qboolean base )
 {
 	searchpath_t *search;
+	packfile_t *pakFile = NULL;
 
 	if ( FS_IsUrl( filename ) )
 	{
@@ -789,19 +1078,16 @@ static int FS_FileExists( const char *filename, qboolean base )
 	if( base )
 		search = FS_SearchPathForBaseFile( filename );
 	else
-		search = FS_SearchPathForFile( filename );
+		search = FS_SearchPathForFile( filename, &pakFile );
 
 	if( !search )
 		return -1;
 
 	if( search->pack )
 	{
-		packfile_t *pakFile;
-
 		assert( !base );
 
-		if( FS_SearchPakForFile( search->pack, filename, -1, &pakFile ) )
-			return pakFile->uncompressedSize;
+		return pakFile->uncompressedSize;
 	}
 	else
 	{
@@ -907,15 +1193,17 @@ static void FS_StreamDoneSimpleCb( wswcurl_req *req, int status, void *customp )
 
 /*
 * _FS_FOpenPakFile
+* 
+* pakFile can be given if it's already known, otherwise it's looked up in the pak
 */
-static int _FS_FOpenPakFile( const char *filename, pack_t *pak, int *filenum )
+static int _FS_FOpenPakFile( const char *filename, pack_t *pak, packfile_t *pakFile, int *filenum )
 {
-	packfile_t *pakFile = NULL;
 	filehandle_t *file;
 
 	*filenum = 0;
 
-	FS_SearchPakForFile( pak, filename, -1, &pakFile );
+	if( !pakFile )
+		FS_SearchPakForFile( pak, filename, -1, &pakFile );
 	if( !pakFile )
 		return -1;
 
@@ -930,6 +1218,7 @@ static int _FS_FOpenPakFile( const char *filename, pack_t *pak, int *filenum )
 	file->uncompressedSize = pakFile->uncompressedSize;
 	file->restReadUncompressed = pakFile->uncompressedSize;
 	file->zipEntry = NULL;
+	file->pakStored = !( pakFile->flags & FS_PACKFILE_DEFLATED );
 
 	if( !( pakFile->flags & FS_PACKFILE_COHERENT ) )
 	{
@@ -990,6 +1279,7 @@ static int _FS_FOpenPakFile( const char *filename, pack_t *pak, int *filenum )
 static int _FS_FOpenFile( const char *filename, int *filenum, int mode, qboolean base )
 {
 	searchpath_t *search;
+	packfile_t *pakFile = NULL;
 	filehandle_t *file;
 	qboolean noSize;
 
@@ -1094,7 +1384,7 @@ static int _FS_FOpenFile( const char *filename, int *filenum, int mode, qboolean
 	if( base )
 		search = FS_SearchPathForBaseFile( filename );
 	else
-		search = FS_SearchPathForFile( filename );
+		search = FS_SearchPathForFile( filename, &pakFile );
 	if( !search )
 		goto notfound_dprint;
 
@@ -1104,7 +1394,7 @@ static int _FS_FOpenFile( const char *filename, int *filenum, int mode, qboolean
 
 		assert( !base );
 
-		uncompressedSize = _FS_FOpenPakFile( filename, search->pack, filenum );
+		uncompressedSize = _FS_FOpenPakFile( filename, search->pack, pakFile, filenum );
 		if( uncompressedSize < 0 )
 		{
 			if( *filenum > 0 )
@@ -1177,6 +1467,7 @@ void FS_FCloseFile( int file )
 
 	fh = FS_FileHandleForNum( file );
 	fh->restReadUncompressed = 0;
+	fh->pakStored = qfalse;
 
 	if( fh->zipEntry )
 	{
@@ -1535,6 +1826,64 @@ int FS_Flush( int file )
 	return fflush( fh->fstream );
 }
 
+/*
+* FS_MapFile
+* 
+* Maps an uncompressed file in a pak instead of reading it, the copy is private and
+* writable, and the terminating zero goes over the next byte in the pak
+*/
+static void *FS_MapFile( int file, size_t len )
+{
+	filehandle_t *fh;
+	mappedfile_t *mapped;
+	void *data, *mapping;
+	size_t mappingOffset;
+
+	fh = FS_FileHandleForNum( file );
+	if( !fh->pakStored || len < FS_MIN_MMAP_SIZE )
+		return NULL;
+	if( fh->offset + len >= (size_t)FS_FileLength( fh->fstream, qfalse ) )
+		return NULL;
+
+	data = Sys_FS_MMapFile( fileno( fh->fstream ), len + 1, fh->offset, &mapping, &mappingOffset );
+	if( !data )
+		return NULL;
+
+	mapped = ( mappedfile_t * )FS_Malloc( sizeof( *mapped ) );
+	mapped->data = data;
+	mapped->size = len + 1;
+	mapped->mapping = mapping;
+	mapped->mappingOffset = mappingOffset;
+	mapped->next = fs_mappedfiles;
+	fs_mappedfiles = mapped;
+
+	( ( qbyte * )data )[len] = 0;
+	return data;
+}
+
+/*
+* FS_UnMapFile
+* 
+* Returns qfalse if the buffer wasn't mapped
+*/
+static qboolean FS_UnMapFile( void *buffer )
+{
+	mappedfile_t *mapped, **prev;
+
+	for( prev = &fs_mappedfiles, mapped = *prev; mapped; prev = &mapped->next, mapped = *prev )
+	{
+		if( mapped->data != buffer )
+			continue;
+
+		*prev = mapped->next;
+		Sys_FS_UnMMapFile( mapped->mapping, mapped->data, mapped->size, mapped->mappingOffset );
+		FS_Free( mapped );
+		return qtrue;
+	}
+
+	return qfalse;
+}
+
 /*
 * FS_LoadFileExt
 * 
@@ -1565,9 +1914,21 @@ int FS_LoadFileExt( const char *path, void **buffer, void *stack, size_t stackSi
 	}
 
 	if( stack && ( stackSize > len ) )
+	{
 		buf = ( qbyte* )stack;
+	}
 	else
+	{
+		buf = ( qbyte* )FS_MapFile( fhandle, len );
+		if( buf )
+		{
+			*buffer = buf;
+			FS_FCloseFile( fhandle );
+			return len;
+		}
+
 		buf = ( qbyte* )_Mem_AllocExt( tempMemPool, len + 1, 0, 0, 0, 0, filename, fileline );
+	}
 	buf[len] = 0;
 	*buffer = buf;
 
@@ -1623,6 +1984,9 @@ int FS_LoadBaseFileExt( const char *path, void **buffer, void *stack, size_t sta
 */
 void FS_FreeFile( void *buffer )
 {
+	if( fs_mappedfiles && FS_UnMapFile( buffer ) )
+		return;
+
 	Mem_TempFree( buffer );
 }
 
@@ -1676,7 +2040,9 @@ static unsigned FS_ChecksumPK3File( const char *filename, int numPakFiles, int *
 	md5_state_t state;
 	int pakFileInd;
 
+	FS_LockLoad();
 	Com_DPrintf( "Calculating checksum for file: %s\n", filename );
+	FS_UnlockLoad();
 
 	md5_init( &state );
 
@@ -1744,6 +2110,8 @@ qboolean FS_AddPurePak( unsigned checksum )
 	{
 		if( search->pack && search->pack->checksum == checksum )
 		{
+			if( !search->pack->pure )
+				fs_pathindexdirty = qtrue;
 			search->pack->pure = qtrue;
 			return qtrue;
 		}
@@ -1761,8 +2129,11 @@ void FS_RemovePurePaks( void )
 
 	for( search = fs_searchpaths; search; search = search->next )
 	{
-		if( search->pack )
+		if( search->pack && search->pack->pure )
+		{
 			search->pack->pure = qfalse;
+			fs_pathindexdirty = qtrue;
+		}
 	}
 }
 
@@ -1771,7 +2142,7 @@ void FS_RemovePurePaks( void )
 */
 qboolean FS_IsPureFile( const char *filename )
 {
-	searchpath_t *search = FS_SearchPathForFile( filename );
+	searchpath_t *search = FS_SearchPathForFile( filename, NULL );
 
 	if( !search || !search->pack )
 		return qfalse;
@@ -1784,7 +2155,7 @@ qboolean FS_IsPureFile( const char *filename )
 */
 const char *FS_FileManifest( const char *filename )
 {
-	searchpath_t *search = FS_SearchPathForFile( filename );
+	searchpath_t *search = FS_SearchPathForFile( filename, NULL );
 
 	if( !search || !search->pack )
 		return NULL;
@@ -1945,11 +2316,12 @@ qboolean FS_MoveBaseFile( const char *src, const char *dst )
 static time_t _FS_FileMTime( const char *filename, qboolean base )
 {
 	searchpath_t *search;
+	packfile_t *pakFile = NULL;
 
 	if( base ) {
 		search = FS_SearchPathForBaseFile( filename );
 	} else {
-		search = FS_SearchPathForFile( filename );
+		search = FS_SearchPathForFile( filename, &pakFile );
 	}
 
 	if( !search ) {
@@ -1957,13 +2329,9 @@ static time_t _FS_FileMTime( const char *filename, qboolean base )
 	}
 
 	if( search->pack ) {
-		packfile_t *pakFile;
-
 		assert( !base );
 
-		if( FS_SearchPakForFile( search->pack, filename, -1, &pakFile ) ) {
-			return pakFile->mtime;
-		}
+		return pakFile->mtime;
 	} else {
 		if( FS_SearchDirectoryForFile( search, filename, NULL ) ) {
 			return Sys_FS_FileMTime( tempname );
@@ -2024,16 +2392,28 @@ qboolean FS_RemoveDirectory( const char *dirname )
 
 /*
 * FS_ReadPackManifest
+* 
+* Reads the manifest file if it's a module pack
 */
 static void FS_ReadPackManifest( pack_t *pack )
 {
 	int size;
 	int file = 0;
 
-	size = _FS_FOpenPakFile( FS_PAK_MANIFEST_FILE, pack, &file );
-	if( (size > -1) && file )
+	if( Q_strnicmp( COM_FileBase( pack->filename ), "modules", strlen( "modules" ) ) )
+		return;
+
+	size = _FS_FOpenPakFile( FS_PAK_MANIFEST_FILE, pack, NULL, &file );
+	if( size <= 0 )
 	{
-		pack->manifest = ( char* )FS_Malloc( size + 1 );
+		if( file )
+			FS_FCloseFile( file );
+		return;
+	}
+
+	if( file )
+	{
+		pack->manifest = ( char* )FS_Malloc( size + 1 );
 
 		// read the file into memory
 		FS_Read( ( qbyte * )pack->manifest, size, file );
@@ -2178,6 +2558,334 @@ static unsigned FS_PK3GetFileInfo( FILE *f, unsigned pos, unsigned byteBeforeThe
 		( unsigned )LittleShortRaw( &infoHeader[30] ) + ( unsigned )LittleShortRaw( &infoHeader[32] );
 }
 
+/*
+* FS_AllocPK3
+* 
+* Allocates the pack with room for the files, their names and the hash tables
+*/
+static pack_t *FS_AllocPK3( const char *packfilename, int numFiles, size_t namesLen, void *handle )
+{
+	int hashSize;
+	pack_t *pack;
+
+	for( hashSize = 1; ( hashSize <= numFiles ) && ( hashSize < FS_MAX_HASH_SIZE ); hashSize <<= 1 ) ;
+
+	namesLen += 1; // add space for a guard
+
+	FS_LockLoad();
+	pack = ( pack_t* )FS_Malloc( (int)( sizeof( pack_t ) + numFiles * sizeof( packfile_t ) + namesLen + hashSize * sizeof( packfile_t * ) + (FS_EXT_HASH_SIZE+1) * sizeof( packfile_t * ) ) );
+	pack->filename = FS_CopyString( packfilename );
+	FS_UnlockLoad();
+
+	pack->files = ( packfile_t * )( ( qbyte * )pack + sizeof( pack_t ) );
+	pack->fileNames = ( char * )( ( qbyte * )pack->files + numFiles * sizeof( packfile_t ) );
+	pack->filesHash = ( packfile_t ** )( ( qbyte * )pack->fileNames + namesLen );
+	pack->filesExtHash = ( packfile_t ** )( ( qbyte * )pack->filesHash + hashSize * sizeof( packfile_t * ) );
+	pack->numFiles = numFiles;
+	pack->hashSize = hashSize;
+	pack->sysHandle = handle;
+
+	return pack;
+}
+
+/*
+* FS_HashPackFile
+*/
+static void FS_HashPackFile( pack_t *pack, packfile_t *file )
+{
+	unsigned hashKey;
+	const char *ext;
+
+	// add to filenames hash table
+	hashKey = FS_PackHashKey( FS_PackHashValue( file->name ), pack->hashSize );
+	file->hashNext = pack->filesHash[hashKey];
+	pack->filesHash[hashKey] = file;
+
+	// add to extensions hash table
+	ext = COM_FileExtension( file->name );
+	hashKey = ext ? FS_PackHashKey( FS_PackHashValue( ext ), FS_EXT_HASH_SIZE ) : FS_EXT_HASH_SIZE;
+	file->hashExtNext = pack->filesExtHash[hashKey];
+	pack->filesExtHash[hashKey] = file;
+}
+
+/*
+* FS_PakCacheFileName
+*/
+static const char *FS_PakCacheFileName( const char *suffix )
+{
+	FS_CheckTempnameSize( sizeof( char ) * ( strlen( FS_WriteDirectory() ) + 1 + strlen( FS_PAK_CACHE_FILE ) + strlen( suffix ) + 1 ) );
+	Q_snprintfz( tempname, tempname_size, "%s/%s%s", FS_WriteDirectory(), FS_PAK_CACHE_FILE, suffix );
+	return tempname;
+}
+
+/*
+* FS_FreePakCache
+*/
+static void FS_FreePakCache( void )
+{
+	if( fs_pakcache )
+	{
+		FS_Free( fs_pakcache );
+		fs_pakcache = NULL;
+	}
+	if( fs_cachedpaks )
+	{
+		FS_Free( fs_cachedpaks );
+		fs_cachedpaks = NULL;
+	}
+	memset( fs_cachedpakshash, 0, sizeof( fs_cachedpakshash ) );
+}
+
+/*
+* FS_ReadPakCache
+* 
+* Reads the central directories of the pk3 files saved by FS_WritePakCache
+*/
+static void FS_ReadPakCache( void )
+{
+	FILE *f;
+	int i, numPaks, len;
+	size_t size, pos;
+	unsigned hashKey;
+	const qbyte *data;
+	cachedpak_t *cached;
+
+	f = fopen( FS_PakCacheFileName( "" ), "rb" );
+	if( !f )
+		return;
+
+	size = FS_FileLength( f, qfalse );
+	if( size < FS_PAK_CACHE_HEADER )
+	{
+		fclose( f );
+		return;
+	}
+
+	fs_pakcache = ( qbyte * )FS_Malloc( size );
+	if( fread( fs_pakcache, 1, size, f ) != size )
+		goto error;
+	fclose( f );
+	f = NULL;
+
+	data = fs_pakcache;
+	if( LittleLongRaw( data ) != FS_PAK_CACHE_MAGIC || LittleLongRaw( data + 4 ) != FS_PAK_CACHE_VERSION )
+		goto error;
+	numPaks = LittleLongRaw( data + 8 );
+	if( numPaks < 0 || (size_t)numPaks > size / FS_PAK_CACHE_PAKHEADER )
+		goto error;
+
+	fs_cachedpaks = ( cachedpak_t * )FS_Malloc( sizeof( *fs_cachedpaks ) * ( numPaks + 1 ) );
+
+	for( i = 0, pos = FS_PAK_CACHE_HEADER, cached = fs_cachedpaks; i < numPaks; i++, cached++ )
+	{
+		if( pos + FS_PAK_CACHE_PAKHEADER > size )
+			goto error;
+
+		len = LittleLongRaw( data + pos );
+		cached->diskSize = LittleLongRaw( data + pos + 4 );
+		cached->diskMTime = LittleLongRaw( data + pos + 8 );
+		cached->checksum = LittleLongRaw( data + pos + 12 );
+		cached->numFiles = LittleLongRaw( data + pos + 16 );
+		cached->namesLen = LittleLongRaw( data + pos + 20 );
+		pos += FS_PAK_CACHE_PAKHEADER;
+
+		if( len <= 0 || (size_t)len > size - pos || data[pos + len - 1] != 0 )
+			goto error;
+		cached->filename = ( const char * )( data + pos );
+		pos += len;
+
+		if( cached->numFiles <= 0 || (size_t)cached->numFiles > ( size - pos ) / FS_PAK_CACHE_FILEINFO )
+			goto error;
+		cached->fileInfos = data + pos;
+		pos += cached->numFiles * FS_PAK_CACHE_FILEINFO;
+
+		if( !cached->namesLen || cached->namesLen > size - pos || data[pos + cached->namesLen - 1] != 0 )
+			goto error;
+		cached->fileNames = ( const char * )( data + pos );
+		pos += cached->namesLen;
+
+		hashKey = FS_PackHashKey( FS_PathHashValue( cached->filename ), FS_PAK_CACHE_HASH_SIZE );
+		cached->hashNext = fs_cachedpakshash[hashKey];
+		fs_cachedpakshash[hashKey] = cached;
+	}
+
+	Com_DPrintf( "Read the central directories of %i pk3 files from cache\n", numPaks );
+	return;
+
+error:
+	if( f )
+		fclose( f );
+	Com_Printf( "Ignoring invalid pk3 cache file\n" );
+	FS_FreePakCache();
+}
+
+/*
+* FS_WriteLittleLong
+*/
+static void FS_WriteLittleLong( FILE *f, unsigned value )
+{
+	qbyte raw[4];
+
+	raw[0] = value & 0xFF;
+	raw[1] = ( value >> 8 ) & 0xFF;
+	raw[2] = ( value >> 16 ) & 0xFF;
+	raw[3] = ( value >> 24 ) & 0xFF;
+	fwrite( raw, 1, sizeof( raw ), f );
+}
+
+/*
+* FS_WritePakCache
+* 
+* Saves the central directories of the loaded pk3 files, so that they don't need
+* to be parsed again until they change
+*/
+static void FS_WritePakCache( void )
+{
+	FILE *f;
+	int i, numPaks;
+	unsigned namesLen;
+	char *cachename;
+	searchpath_t *search;
+	pack_t *pack;
+	packfile_t *file;
+	qboolean error;
+
+	if( !fs_pakcachedirty )
+		return;
+	fs_pakcachedirty = qfalse;
+
+	numPaks = 0;
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		if( search->pack && search->pack->diskSize )
+			numPaks++;
+	}
+
+	cachename = FS_CopyString( FS_PakCacheFileName( "" ) );
+	FS_PakCacheFileName( ".tmp" );
+
+	FS_CreateAbsolutePath( tempname );
+	f = fopen( tempname, "wb" );
+	if( !f )
+	{
+		FS_Free( cachename );
+		return;
+	}
+
+	FS_WriteLittleLong( f, FS_PAK_CACHE_MAGIC );
+	FS_WriteLittleLong( f, FS_PAK_CACHE_VERSION );
+	FS_WriteLittleLong( f, numPaks );
+	FS_WriteLittleLong( f, 0 );
+
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		pack = search->pack;
+		if( !pack || !pack->diskSize )
+			continue;
+
+		for( i = 0, namesLen = 0, file = pack->files; i < pack->numFiles; i++, file++ )
+			namesLen += strlen( file->name ) + 1;
+
+		FS_WriteLittleLong( f, strlen( pack->filename ) + 1 );
+		FS_WriteLittleLong( f, pack->diskSize );
+		FS_WriteLittleLong( f, pack->diskMTime );
+		FS_WriteLittleLong( f, pack->checksum );
+		FS_WriteLittleLong( f, pack->numFiles );
+		FS_WriteLittleLong( f, namesLen );
+		fwrite( pack->filename, 1, strlen( pack->filename ) + 1, f );
+
+		for( i = 0, file = pack->files; i < pack->numFiles; i++, file++ )
+		{
+			FS_WriteLittleLong( f, file->flags );
+			FS_WriteLittleLong( f, file->compressedSize );
+			FS_WriteLittleLong( f, file->uncompressedSize );
+			FS_WriteLittleLong( f, file->offset );
+			FS_WriteLittleLong( f, (unsigned)file->mtime );
+		}
+
+		for( i = 0, file = pack->files; i < pack->numFiles; i++, file++ )
+			fwrite( file->name, 1, strlen( file->name ) + 1, f );
+	}
+
+	error = ferror( f ) ? qtrue : qfalse;
+	if( fclose( f ) )
+		error = qtrue;
+
+	FS_PakCacheFileName( ".tmp" );
+	if( error )
+	{
+		Com_Printf( "Error writing pk3 cache file\n" );
+		remove( tempname );
+	}
+	else
+	{
+		remove( cachename );
+		rename( tempname, cachename );
+	}
+
+	FS_Free( cachename );
+}
+
+/*
+* FS_LoadCachedPK3File
+* 
+* Gives the pack from the cached central directory, if the file hasn't changed since
+*/
+static pack_t *FS_LoadCachedPK3File( const char *packfilename, unsigned diskSize, unsigned diskMTime, void *handle )
+{
+	int i;
+	const qbyte *info;
+	char *names, *namesEnd;
+	pack_t *pack;
+	packfile_t *file;
+	cachedpak_t *cached;
+
+	for( cached = fs_cachedpakshash[FS_PackHashKey( FS_PathHashValue( packfilename ), FS_PAK_CACHE_HASH_SIZE )];
+		cached; cached = cached->hashNext )
+	{
+		if( !strcmp( cached->filename, packfilename ) )
+			break;
+	}
+
+	if( !cached || cached->diskSize != diskSize || cached->diskMTime != diskMTime )
+		return NULL;
+
+	pack = FS_AllocPK3( packfilename, cached->numFiles, cached->namesLen, handle );
+	memcpy( pack->fileNames, cached->fileNames, cached->namesLen );
+
+	names = pack->fileNames;
+	namesEnd = pack->fileNames + cached->namesLen;
+	for( i = 0, file = pack->files, info = cached->fileInfos; i < pack->numFiles; i++, file++, info += FS_PAK_CACHE_FILEINFO )
+	{
+		if( names >= namesEnd )
+		{
+			// fewer names than files, the cache is broken
+			FS_LockLoad();
+			FS_Free( pack->filename );
+			FS_Free( pack );
+			FS_UnlockLoad();
+			return NULL;
+		}
+
+		file->name = names;
+		names += strlen( names ) + 1;
+
+		file->flags = LittleLongRaw( info );
+		file->compressedSize = LittleLongRaw( info + 4 );
+		file->uncompressedSize = LittleLongRaw( info + 8 );
+		file->offset = LittleLongRaw( info + 12 );
+		file->mtime = LittleLongRaw( info + 16 );
+
+		FS_HashPackFile( pack, file );
+	}
+
+	pack->checksum = cached->checksum;
+	pack->diskSize = diskSize;
+	pack->diskMTime = diskMTime;
+
+	return pack;
+}
+
 /*
 * FS_LoadPK3File
 * 
@@ -2188,7 +2896,7 @@ static unsigned FS_PK3GetFileInfo( FILE *f, unsigned pos, unsigned byteBeforeThe
 */
 static pack_t *FS_LoadPK3File( const char *packfilename, qboolean silent )
 {
-	int i, hashSize;
+	int i;
 	int *checksums = NULL;
 	int numFiles;
 	size_t namesLen, len;
@@ -2196,11 +2904,10 @@ static pack_t *FS_LoadPK3File( const char *packfilename, qboolean silent )
 	packfile_t *file;
 	FILE *fin = NULL;
 	char *names;
-	unsigned hashKey;
 	unsigned char zipHeader[20]; // we can't use a struct here because of packing
 	unsigned offset, centralPos, sizeCentralDir, offsetCentralDir, byteBeforeTheZipFile;
+	unsigned diskSize, diskMTime;
 	qboolean modulepack;
-	int manifestFilesize;
 	void *handle = NULL;
 
 	// lock the file for reading, but don't throw fatal error
@@ -2217,6 +2924,20 @@ static pack_t *FS_LoadPK3File( const char *packfilename, qboolean silent )
 		if( !silent ) Com_Printf( "Error opening PK3 file: %s\n", packfilename );
 		goto error;
 	}
+
+	diskSize = FS_FileLength( fin, qfalse );
+	diskMTime = (unsigned)Sys_FS_FileMTime( packfilename );
+
+	pack = FS_LoadCachedPK3File( packfilename, diskSize, diskMTime, handle );
+	if( pack )
+	{
+		fclose( fin );
+
+		if( !silent ) Com_Printf( "Added pk3 file %s (%i files, cached)\n", pack->filename, pack->numFiles );
+
+		return pack;
+	}
+
 	centralPos = FS_PK3SearchCentralDir( fin );
 	if( centralPos == 0 )
 	{
@@ -2260,8 +2981,6 @@ static pack_t *FS_LoadPK3File( const char *packfilename, qboolean silent )
 	}
 	byteBeforeTheZipFile = centralPos - offsetCentralDir - sizeCentralDir;
 
-	for( hashSize = 1; ( hashSize <= numFiles ) && ( hashSize < FS_MAX_HASH_SIZE ); hashSize <<= 1 ) ;
-
 	for( i = 0, namesLen = 0, centralPos = offsetCentralDir + byteBeforeTheZipFile; i < numFiles; i++, centralPos += offset )
 	{
 		offset = FS_PK3GetFileInfo( fin, centralPos, byteBeforeTheZipFile, NULL, &len, NULL );
@@ -2273,28 +2992,19 @@ static pack_t *FS_LoadPK3File( const char *packfilename, qboolean silent )
 		namesLen += len + 1;
 	}
 
-	namesLen += 1; // add space for a guard
-
-	pack = ( pack_t* )FS_Malloc( (int)( sizeof( pack_t ) + numFiles * sizeof( packfile_t ) + namesLen + hashSize * sizeof( packfile_t * ) + (FS_EXT_HASH_SIZE+1) * sizeof( packfile_t * ) ) );
-	pack->filename = FS_CopyString( packfilename );
-	pack->files = ( packfile_t * )( ( qbyte * )pack + sizeof( pack_t ) );
-	pack->fileNames = names = ( char * )( ( qbyte * )pack->files + numFiles * sizeof( packfile_t ) );
-	pack->filesHash = ( packfile_t ** )( ( qbyte * )names + namesLen );
-	pack->filesExtHash = ( packfile_t ** )( ( qbyte * )pack->filesHash + hashSize * sizeof( packfile_t * ) );
-	pack->numFiles = numFiles;
-	pack->hashSize = hashSize;
-	pack->sysHandle = handle;
+	pack = FS_AllocPK3( packfilename, numFiles, namesLen, handle );
+	names = pack->fileNames;
 
 	// allocate temp memory for files' checksums
+	FS_LockLoad();
 	checksums = ( int* )Mem_TempMallocExt( ( numFiles + 1 ) * sizeof( *checksums ), 0 );
+	FS_UnlockLoad();
 
 	if( !Q_strnicmp( COM_FileBase( packfilename ), "modules", strlen( "modules" ) ) )
 		modulepack = qtrue;
 	else
 		modulepack = qfalse;
 
-	manifestFilesize = -1;
-
 	// add all files to hash table
 	for( i = 0, file = pack->files, centralPos = offsetCentralDir + byteBeforeTheZipFile; i < numFiles; i++, file++, centralPos += offset, names += len + 1 )
 	{
@@ -2321,21 +3031,8 @@ static pack_t *FS_LoadPK3File( const char *packfilename, qboolean silent )
 				goto error;
 			}
 		}
-		else
-		{
-			if( !Q_stricmp( file->name, FS_PAK_MANIFEST_FILE ) && !(file->flags & FS_PACKFILE_DIRECTORY) )
-				manifestFilesize = file->uncompressedSize;
-		}
 
-		// add to filenames hash table
-		hashKey = FS_PackHashKey( FS_PackHashValue( file->name ), hashSize );
-		file->hashNext = pack->filesHash[hashKey];
-		pack->filesHash[hashKey] = file;
-
-		// add to extensions hash table
-		hashKey = ext ? FS_PackHashKey( FS_PackHashValue( ext ), FS_EXT_HASH_SIZE ) : FS_EXT_HASH_SIZE;
-		file->hashExtNext = pack->filesExtHash[hashKey];
-		pack->filesExtHash[hashKey] = file;
+		FS_HashPackFile( pack, file );
 	}
 
 	fclose( fin );
@@ -2350,11 +3047,13 @@ static pack_t *FS_LoadPK3File( const char *packfilename, qboolean silent )
 		goto error;
 	}
 
+	FS_LockLoad();
 	Mem_TempFree( checksums );
+	FS_UnlockLoad();
 
-	// read manifest file if it's a module pk3
-	if( modulepack && manifestFilesize > 0 )
-		FS_ReadPackManifest( pack );
+	pack->diskSize = diskSize;
+	pack->diskMTime = diskMTime;
+	fs_pakcachedirty = qtrue;
 
 	if( !silent ) Com_Printf( "Added pk3 file %s (%i files)\n", pack->filename, pack->numFiles, pack->checksum );
 
@@ -2363,6 +3062,7 @@ static pack_t *FS_LoadPK3File( const char *packfilename, qboolean silent )
 error:
 	if( fin )
 		fclose( fin );
+	FS_LockLoad();
 	if( pack )
 	{
 		if( pack->filename )
@@ -2371,6 +3071,7 @@ error:
 	}
 	if( checksums )
 		Mem_TempFree( checksums );
+	FS_UnlockLoad();
 	if( handle != NULL )
 		Sys_FS_UnlockFile( handle );
 
@@ -2402,7 +3103,6 @@ pack_t *FS_LoadPakFile( const char *packfilename, qboolean silent )
 	unsigned		numFiles, numDirs, maxDirs, hashSize, hashKey, len, namesLen;
 	void			*handle = NULL;
 	qboolean		modulepack;
-	int				manifestFilesize;
 
 	// lock the file for shared reading, don't throw a fatal error if failed for some reason
 	handle = Sys_FS_LockFile( packfilename );
@@ -2505,8 +3205,6 @@ pack_t *FS_LoadPakFile( const char *packfilename, qboolean silent )
 	else
 		modulepack = qfalse;
 
-	manifestFilesize = -1;
-
 	// add all files and dirs
 	for( i = 0, file = pack->files; i < numFiles + numDirs; i++, file++ )
 	{
@@ -2540,11 +3238,6 @@ pack_t *FS_LoadPakFile( const char *packfilename, qboolean silent )
 					goto error;
 				}
 			}
-			else
-			{
-				if( !Q_stricmp( file->name, FS_PAK_MANIFEST_FILE ) && !(file->flags & FS_PACKFILE_DIRECTORY) )
-					manifestFilesize = file->uncompressedSize;
-			}
 
 			checksums[i] = file->offset + file->compressedSize; // FIXME
 		}
@@ -2583,10 +3276,6 @@ pack_t *FS_LoadPakFile( const char *packfilename, qboolean silent )
 	Mem_TempFree( info );
 	Mem_TempFree( dirs );
 
-	// read manifest file if it's a module pk3
-	if( modulepack && manifestFilesize > 0 )
-		FS_ReadPackManifest( pack );
-
 	if( !silent )
 		Com_Printf( "Added pak file %s (%i files)\n", pack->filename, pack->numFiles );
 
@@ -2619,6 +3308,7 @@ error:
 static pack_t *FS_LoadPackFile( const char *packfilename, qboolean silent )
 {
 	const char *ext;
+	pack_t *pack;
 
 	FS_CheckTempnameSize( sizeof( char ) * ( strlen( packfilename ) + 1 ) );
 	strcpy( tempname, packfilename );
@@ -2636,10 +3326,15 @@ static pack_t *FS_LoadPackFile( const char *packfilename, qboolean silent )
 	}
 
 	if( !Q_stricmp( ext, ".pk3" ) || !Q_stricmp( ext, ".pk2" ) )
-		return FS_LoadPK3File( packfilename, silent );
-	if( !Q_stricmp( ext, ".pak" ) )
-		return FS_LoadPakFile( packfilename, silent );
-	return NULL;
+		pack = FS_LoadPK3File( packfilename, silent );
+	else if( !Q_stricmp( ext, ".pak" ) )
+		pack = FS_LoadPakFile( packfilename, silent );
+	else
+		return NULL;
+
+	if( pack )
+		FS_ReadPackManifest( pack );
+	return pack;
 }
 
 
@@ -3186,7 +3881,7 @@ void FS_CreateAbsolutePath( const char *path )
 const char *FS_AbsoluteNameForFile( const char *filename )
 {
 	static char absolutename[1024]; // fixme
-	searchpath_t *search = FS_SearchPathForFile( filename );
+	searchpath_t *search = FS_SearchPathForFile( filename, NULL );
 
 	if( !search || search->pack )
 		return NULL;
@@ -3219,7 +3914,7 @@ const char *FS_AbsoluteNameForBaseFile( const char *filename )
 const char *FS_BaseNameForFile( const char *filename )
 {
 	const char *p;
-	searchpath_t *search = FS_SearchPathForFile( filename );
+	searchpath_t *search = FS_SearchPathForFile( filename, NULL );
 
 	if( !search || search->pack )
 		return NULL;
@@ -3299,6 +3994,31 @@ int FS_GetGameDirectoryList( char *buf, size_t bufsize )
 	return nummods_total;
 }
 
+/*
+* FS_SkipPakFile
+* 
+* Pure data and modules pk3 files from other versions are ignored
+*/
+static qboolean FS_SkipPakFile( const char *pakname )
+{
+	const char *pakbasename, *extension;
+	size_t pakname_len, extension_len;
+
+	pakbasename = COM_FileBase( pakname );
+	pakname_len = strlen( pakbasename );
+	extension = COM_FileExtension( pakbasename );
+	extension_len = extension ? strlen( extension ) : 0;
+
+	if( !Q_strnicmp( pakbasename + pakname_len - strlen( "pure" ) - extension_len - 1, "pure", strlen ( "pure" ) ) &&
+		Q_strnicmp( pakbasename + pakname_len - strlen( APP_VERSION_STR_MAJORMINOR "pure" ) - extension_len - 1, APP_VERSION_STR_MAJORMINOR, strlen( APP_VERSION_STR_MAJORMINOR ) ) )
+	{
+		if( !Q_strnicmp( pakbasename, "data", strlen( "data" ) ) || !Q_strnicmp( pakbasename, "modules", strlen( "modules" ) ) )
+			return qtrue;
+	}
+
+	return qfalse;
+}
+
 /*
 * FS_GamePathPaks
 */
@@ -3306,8 +4026,6 @@ static char **FS_GamePathPaks( const char *basepath, const char *gamedir, int *n
 {
 	int i, e, numpakfiles;
 	char **paknames = NULL;
-	const char *pakbasename, *extension;
-	size_t pakname_len, extension_len;
 
 	numpakfiles = 0;
 	for( e = 0; pak_extensions[e]; e++ )
@@ -3344,22 +4062,13 @@ static char **FS_GamePathPaks( const char *basepath, const char *gamedir, int *n
 
 		for( i = 0; i < numpakfiles; )
 		{
-			pakbasename = COM_FileBase( paknames[i] );
-			pakname_len = strlen( pakbasename );
-			extension = COM_FileExtension( pakbasename );
-			extension_len = strlen( extension );
-
 			// ignore pure data and modules pk3 files from other versions
-			if( !Q_strnicmp( pakbasename + pakname_len - strlen( "pure" ) - extension_len - 1, "pure", strlen ( "pure" ) ) &&
-				Q_strnicmp( pakbasename + pakname_len - strlen( APP_VERSION_STR_MAJORMINOR "pure" ) - extension_len - 1, APP_VERSION_STR_MAJORMINOR, strlen( APP_VERSION_STR_MAJORMINOR ) ) )
+			if( FS_SkipPakFile( paknames[i] ) )
 			{
-				if( !Q_strnicmp( pakbasename, "data", strlen( "data" ) ) || !Q_strnicmp( pakbasename, "modules", strlen( "modules" ) ) )
-				{
-					//Com_Printf( "Skipping %s\n", pakbasename );
-					Mem_Free( paknames[i] );
-					memmove( &paknames[i], &paknames[i+1], (numpakfiles-- - i) * sizeof( *paknames ) );
-					continue;
-				}
+				//Com_Printf( "Skipping %s\n", COM_FileBase( paknames[i] ) );
+				Mem_Free( paknames[i] );
+				memmove( &paknames[i], &paknames[i+1], (numpakfiles-- - i) * sizeof( *paknames ) );
+				continue;
 			}
 
 			i++;
@@ -3370,6 +4079,163 @@ static char **FS_GamePathPaks( const char *basepath, const char *gamedir, int *n
 	return paknames;
 }
 
+/*
+* FS_PakFileWanted
+* 
+* Returns true unless the pak file is already loaded or overriden by a similarly
+* named file elsewhere
+*/
+static qboolean FS_PakFileWanted( const char *pakname )
+{
+	searchpath_t *search;
+
+	// ignore already loaded pk3 files if updating
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		if( search->pack && !Q_stricmp( search->pack->filename, pakname ) )
+			return qfalse;
+	}
+
+	// well, we couldn't find a suitable position for this pak file, probably because
+	// it's going to be overriden by a similarly named file elsewhere
+	return FS_FindPackFilePos( pakname, NULL, NULL, NULL );
+}
+
+/*
+* FS_LoadPackFileJob
+*/
+static void FS_LoadPackFileJob( void *param, int index, int thread )
+{
+	packload_t *load = ( packload_t * )param + index;
+
+	load->pack = FS_LoadPK3File( load->filename, qtrue );
+}
+
+/*
+* FS_LoadPackFiles
+* 
+* Parses the headers of the wanted pk3 files on fs_loadthreads threads. Gives the
+* packs in the order of the names, to be added by FS_TouchPakFile, or NULL if there
+* was nothing worth doing in parallel. Failed and other paks are left to FS_TouchPakFile.
+*/
+static pack_t **FS_LoadPackFiles( char **paknames, int numpaks )
+{
+	int i, numloads, numThreads;
+	const char *ext;
+	packload_t *loads;
+	pack_t **paks;
+	quint64 time;
+
+	numThreads = fs_loadthreads->integer;
+	if( numThreads < 0 )
+		numThreads = QThreads_NumProcessors();
+	numThreads = min( numThreads, 64 );
+	if( numThreads <= 1 || numpaks < 2 )
+		return NULL;
+
+	loads = ( packload_t * )Mem_TempMalloc( sizeof( *loads ) * numpaks );
+	for( i = 0, numloads = 0; i < numpaks; i++ )
+	{
+		ext = COM_FileExtension( paknames[i] );
+		if( !ext || ( Q_stricmp( ext, ".pk3" ) && Q_stricmp( ext, ".pk2" ) ) )
+			continue;
+		if( !FS_PakFileWanted( paknames[i] ) )
+			continue;
+
+		loads[numloads].filename = paknames[i];
+		loads[numloads].index = i;
+		numloads++;
+	}
+
+	if( numloads < 2 )
+	{
+		Mem_TempFree( loads );
+		return NULL;
+	}
+
+	time = Sys_Microseconds();
+
+	// the calling thread takes part in the loop
+	if( !fs_loadpool )
+	{
+		fs_loadpool = QThreadPool_Create( numThreads - 1 );
+		fs_loadmutex = QMutex_Create();
+		fs_numloadthreads = numThreads;
+	}
+
+	QThreadPool_ParallelFor( fs_loadpool, numloads, FS_LoadPackFileJob, loads );
+
+	paks = ( pack_t ** )Mem_TempMalloc( sizeof( *paks ) * numpaks );
+	for( i = 0; i < numloads; i++ )
+		paks[loads[i].index] = loads[i].pack;
+	Mem_TempFree( loads );
+
+	fs_parsetime += Sys_Microseconds() - time;
+	fs_numparsedpaks += numloads;
+
+	return paks;
+}
+
+/*
+* FS_FreeLoadThreads
+*/
+static void FS_FreeLoadThreads( void )
+{
+	QThreadPool_Destroy( &fs_loadpool );
+	QMutex_Destroy( &fs_loadmutex );
+}
+
+/*
+* FS_TouchPakFile
+* 
+* Loads the pak file, unless it was given already parsed, and inserts it to the
+* search paths, unless it's already there or overriden by a similarly named file elsewhere
+*/
+static qboolean FS_TouchPakFile( const char *pakname, pack_t *pak )
+{
+	searchpath_t *search, *prev, *next;
+
+	if( !FS_PakFileWanted( pakname ) )
+	{
+		if( pak )
+			FS_FreePakFile( pak );
+		return qfalse;
+	}
+
+	if( pak )
+	{
+		Com_Printf( "Added pk3 file %s (%i files)\n", pak->filename, pak->numFiles );
+		FS_ReadPackManifest( pak );
+	}
+	else
+	{
+		pak = FS_LoadPackFile( pakname, qfalse );
+		if( !pak )
+			return qfalse;
+	}
+
+	// now insert it for real
+	if( !FS_FindPackFilePos( pakname, &search, &prev, &next ) )
+	{
+		FS_FreePakFile( pak );
+		return qfalse;
+	}
+
+	search->pack = pak;
+	if( !prev )
+	{
+		search->next = fs_searchpaths;
+		fs_searchpaths = search;
+	}
+	else
+	{
+		prev->next = search;
+		search->next = next;
+	}
+
+	return qtrue;
+}
+
 /*
 * FS_TouchGamePath
 */
@@ -3377,9 +4243,10 @@ static int FS_TouchGamePath( const char *basepath, const char *gamedir, qboolean
 {
 	int i, totalpaks, newpaks;
 	size_t path_size;
-	searchpath_t *search, *prev, *next;
-	pack_t *pak;
+	searchpath_t *search;
 	char **paknames;
+	pack_t **paks;
+	quint64 time;
 
 	// add directory to the list of search paths so pak files can stack properly
 	if( initial )
@@ -3393,60 +4260,41 @@ static int FS_TouchGamePath( const char *basepath, const char *gamedir, qboolean
 		search->next = fs_searchpaths;
 		fs_searchpaths = search;
 	}
+	else if( !fs_rescanall )
+	{
+		// new paks in watched directories are added from the change notifications
+		FS_CheckTempnameSize( sizeof( char ) * ( strlen( basepath ) + 1 + strlen( gamedir ) + 1 ) );
+		Q_snprintfz( tempname, tempname_size, "%s/%s", basepath, gamedir );
+
+		for( search = fs_searchpaths; search; search = search->next )
+		{
+			if( !search->pack && search->watched && !strcmp( search->path, tempname ) )
+				return 0;
+		}
+	}
 
 	newpaks = 0;
 	totalpaks = 0;
-	if( ( paknames = FS_GamePathPaks( basepath, gamedir, &totalpaks ) ) != 0 )
+	time = Sys_Microseconds();
+	paknames = FS_GamePathPaks( basepath, gamedir, &totalpaks );
+	fs_listtime += Sys_Microseconds() - time;
+
+	if( paknames )
 	{
+		paks = FS_LoadPackFiles( paknames, totalpaks );
+
+		time = Sys_Microseconds();
 		for( i = 0; i < totalpaks; i++ )
 		{
-			// ignore already loaded pk3 files if updating
-			searchpath_t *compare = fs_searchpaths;
-			while( compare )
-			{
-				if( compare->pack )
-				{
-					int cmp = Q_stricmp( COM_FileBase( compare->pack->filename ), COM_FileBase( paknames[i] ) );
-					if( !cmp )
-					{
-						if( !Q_stricmp( compare->pack->filename, paknames[i] ) )
-							goto freename;
-					}
-				}
-				compare = compare->next;
-			}
-
-			if( !FS_FindPackFilePos( paknames[i], NULL, NULL, NULL ) )
-			{
-				// well, we couldn't find a suitable position for this pak file, probably because
-				// it's going to be overriden by a similarly named file elsewhere
-				continue;
-			}
-
-			pak = FS_LoadPackFile( paknames[i], qfalse );
-			if( !pak )
-				goto freename;
-
-			// now insert it for real
-			if( FS_FindPackFilePos( paknames[i], &search, &prev, &next ) )
-			{
-				search->pack = pak;
-				if( !prev )
-				{
-					search->next = fs_searchpaths;
-					fs_searchpaths = search;
-				}
-				else
-				{
-					prev->next = search;
-					search->next = next;
-				}
+			if( FS_TouchPakFile( paknames[i], paks ? paks[i] : NULL ) )
 				newpaks++;
-			}
-freename:
 			Mem_ZoneFree( paknames[i] );
 		}
 		Mem_ZoneFree( paknames );
+		fs_inserttime += Sys_Microseconds() - time;
+
+		if( paks )
+			Mem_TempFree( paks );
 	}
 
 	return newpaks;
@@ -3490,6 +4338,7 @@ static void FS_RemoveExtraPaks( searchpath_t *old )
 				{
 					Com_Printf( "Removed duplicate pk3 file %s\n", search->pack->filename );
 					prev->next = search->next;
+					fs_pathindexdirty = qtrue;
 					FS_FreePakFile( search->pack );
 					FS_Free( search );
 					search = prev;
@@ -3532,6 +4381,10 @@ static int FS_TouchGameDirectory( const char *gamedir, qboolean initial )
 	if( initial && newpaks )
 		FS_RemoveExtraPaks( old );
 
+	FS_FreeLoadThreads();
+
+	FS_UpdatePathIndex();
+
 	return newpaks;
 }
 
@@ -3551,6 +4404,99 @@ static int FS_UpdateGameDirectory( const char *gamedir )
 	return FS_TouchGameDirectory( gamedir, qfalse );
 }
 
+/*
+* FS_FreeChangedPaks
+*/
+static void FS_FreeChangedPaks( void )
+{
+	changedpak_t *next;
+
+	while( fs_changedpaks )
+	{
+		next = fs_changedpaks->next;
+		FS_Free( fs_changedpaks );
+		fs_changedpaks = next;
+	}
+}
+
+/*
+* FS_WatchGameDirectories
+* 
+* Watches the directories of the search paths for new pak files, so that rescanning
+* doesn't need to list them
+*/
+static void FS_WatchGameDirectories( void )
+{
+	searchpath_t *search;
+
+	Sys_FS_StopWatching();
+	FS_FreeChangedPaks();
+
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		if( !search->pack )
+			search->watched = Sys_FS_WatchDirectory( search->path );
+	}
+
+	// paks written before the watches were set up would be missed otherwise
+	fs_rescanall = qtrue;
+}
+
+/*
+* FS_ReadChangedPaks
+* 
+* Collects the pak files written into the watched directories for the next rescan
+*/
+static void FS_ReadChangedPaks( void )
+{
+	const char *filename;
+	qboolean lost = qfalse;
+	changedpak_t *changed;
+
+	while( ( filename = Sys_FS_NextChangedFile( &lost ) ) != NULL )
+	{
+		if( !FS_CheckPakExtension( filename ) )
+			continue;
+
+		for( changed = fs_changedpaks; changed; changed = changed->next )
+		{
+			if( !strcmp( changed->filename, filename ) )
+				break;
+		}
+		if( changed )
+			continue;
+
+		changed = ( changedpak_t * )FS_Malloc( sizeof( *changed ) + strlen( filename ) + 1 );
+		changed->filename = ( char * )( ( qbyte * )changed + sizeof( *changed ) );
+		strcpy( changed->filename, filename );
+		changed->next = fs_changedpaks;
+		fs_changedpaks = changed;
+	}
+
+	if( lost )
+		fs_rescanall = qtrue;
+}
+
+/*
+* FS_WatchedPakPath
+* 
+* Returns true if the pak file is in a watched directory of the search paths
+*/
+static qboolean FS_WatchedPakPath( const char *pakname )
+{
+	size_t path_len;
+	searchpath_t *search;
+
+	path_len = COM_FilePathLength( pakname );
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		if( !search->pack && search->watched && !strncmp( search->path, pakname, path_len ) && !search->path[path_len] )
+			return qtrue;
+	}
+
+	return qfalse;
+}
+
 /*
 * FS_SetGameDirectory
 * 
@@ -3591,6 +4537,8 @@ qboolean FS_SetGameDirectory( const char *dir, qboolean force )
 	}
 
 	// free up any current game dir info
+	if( fs_searchpaths != fs_base_searchpaths )
+		fs_pathindexdirty = qtrue;
 	while( fs_searchpaths != fs_base_searchpaths )
 	{
 		if( fs_searchpaths->pack )
@@ -3611,6 +4559,9 @@ qboolean FS_SetGameDirectory( const char *dir, qboolean force )
 		FS_AddGameDirectory( dir );
 	}
 
+	FS_WatchGameDirectories();
+	FS_WritePakCache();
+
 	// if game directory is present but we haven't initialized filesystem yet,
 	// that means fs_game was set via early commands and autoexec.cfg (and confi.cfg in the 
 	// case of client) will be executed in Qcommon_Init, so prevent double execution
@@ -3858,6 +4809,7 @@ static void Cmd_FileMTime_f( void )
 void FS_Init( void )
 {
 	int i;
+	quint64 time;
 
 	assert( !fs_initialized );
 
@@ -3922,16 +4874,32 @@ void FS_Init( void )
 	if( !fs_game->string[0] )
 		Cvar_ForceSet( "fs_game", fs_basegame->string );
 
+	// threads parsing pk3 headers at startup, all processors if negative
+	fs_loadthreads = Cvar_Get( "fs_loadthreads", "-1", CVAR_NOSET );
+
+	time = Sys_Microseconds();
+	fs_listtime = fs_parsetime = fs_inserttime = 0;
+	fs_numparsedpaks = fs_numloadthreads = 0;
+
+	FS_ReadPakCache();
+
 	FS_AddGameDirectory( fs_basegame->string );
 
 	fs_base_searchpaths = fs_searchpaths;
 
 	if( strcmp( fs_game->string, fs_basegame->string ) )
 		FS_SetGameDirectory( fs_game->string, qfalse );
+	else
+		FS_WatchGameDirectories();
+
+	FS_WritePakCache();
 
 	// no notifications after startup
 	FS_RemoveNotifications( ~0 );
 
+	Com_DPrintf( "Filesystem initialized in %.1f ms: listing %.1f ms, parsing %i pk3 headers on %i threads %.1f ms, adding paks %.1f ms\n",
+		( Sys_Microseconds() - time ) * 0.001, fs_listtime * 0.001, fs_numparsedpaks, max( fs_numloadthreads, 1 ), fs_parsetime * 0.001, fs_inserttime * 0.001 );
+
 	// done
 	Com_Printf( "Using %s for writing\n", FS_WriteDirectory() );
 
@@ -3946,13 +4914,36 @@ void FS_Init( void )
 int FS_Rescan( void )
 {
 	int newpaks = 0;
+	changedpak_t *changed;
 
+	FS_ReadChangedPaks();
+
+	// watched directories are only listed when changes were lost
 	newpaks += FS_UpdateGameDirectory( fs_basegame->string );
 	if( strcmp( fs_game->string, fs_basegame->string ) )
 		newpaks += FS_UpdateGameDirectory( fs_game->string );
 
+	if( !fs_rescanall )
+	{
+		for( changed = fs_changedpaks; changed; changed = changed->next )
+		{
+			if( !FS_WatchedPakPath( changed->filename ) || FS_SkipPakFile( changed->filename ) )
+				continue;
+			if( FS_TouchPakFile( changed->filename, NULL ) )
+				newpaks++;
+		}
+	}
+
+	FS_FreeChangedPaks();
+	fs_rescanall = qfalse;
+
 	if( newpaks )
+	{
+		FS_UpdatePathIndex();
 		FS_AddNotifications( FS_NOTIFT_NEWPAKS );
+	}
+
+	FS_WritePakCache();
 
 	return newpaks;
 }
@@ -3963,6 +4954,9 @@ int FS_Rescan( void )
 void FS_Frame( void )
 {
 	FS_FreeSearchFiles();
+
+	// keep the system queue of changes from overflowing
+	FS_ReadChangedPaks();
 }
 
 /*
@@ -3985,6 +4979,12 @@ void FS_Shutdown( void )
 	FS_Free( fs_searchfiles );
 	fs_numsearchfiles = 0;
 
+	Sys_FS_StopWatching();
+	FS_FreeChangedPaks();
+	FS_FreePakCache();
+	fs_pakcachedirty = qfalse;
+	fs_rescanall = qfalse;
+
 	while( fs_searchpaths )
 	{
 		search = fs_searchpaths;
@@ -4012,6 +5012,16 @@ void FS_Shutdown( void )
 		tempname_size = 0;
 	}
 
+	while( fs_mappedfiles )
+		FS_UnMapFile( fs_mappedfiles->data );
+
+	fs_searchdirs = NULL;
+	fs_numsearchdirs = fs_numsearchpaths = 0;
+	fs_pathindex = NULL;
+	fs_pathindexhash = NULL;
+	fs_numpathindex = fs_maxpathindex = 0;
+	fs_pathindexdirty = qtrue;
+
 	Mem_FreePool( &fs_mempool );
 
 	fs_initialized = qfalse;
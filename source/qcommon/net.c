@@ -18,6 +18,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
+#if defined ( __linux__ ) && !defined ( _GNU_SOURCE )
+#	define _GNU_SOURCE		// recvmmsg and sendmmsg
+#endif
+
 #include "qcommon.h"
 
 #include "sys_net.h"
@@ -33,6 +37,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <sys/socket.h>
 #endif
 
+#if defined ( __linux__ )
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
 #define	MAX_LOOPBACK	4
 
 #if !defined SHUT_RDWR && defined SD_BOTH
@@ -47,6 +57,15 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #	define MSG_NOSIGNAL 0
 #endif
 
+#if defined ( __linux__ )
+#	define USE_MMSG
+#	define USE_EPOLL
+#endif
+
+#define NET_MAX_RECV_BATCH	32
+#define NET_MAX_SEND_BATCH	64
+#define NET_MAX_POLL_SOCKETS	64
+
 
 typedef struct
 {
@@ -332,6 +351,335 @@ static qboolean NET_SocketMakeNonBlocking( socket_handle_t handle )
 	return qtrue;
 }
 
+#ifdef USE_EPOLL
+
+// sockets stay registered between waits, only the changes are passed to the kernel
+typedef struct
+{
+	int epfd;
+	int timerfd;
+	int numhandles;
+	socket_handle_t handles[NET_MAX_POLL_SOCKETS];
+} net_poller_t;
+
+static net_poller_t net_sleeppoller = { -1, -1, 0 };
+static net_poller_t net_monitorpoller = { -1, -1, 0 };
+
+/*
+* NET_Poller_Init
+*/
+static qboolean NET_Poller_Init( net_poller_t *poller )
+{
+	struct epoll_event ev;
+
+	if( poller->epfd >= 0 )
+		return qtrue;
+
+	poller->epfd = epoll_create1( EPOLL_CLOEXEC );
+	if( poller->epfd < 0 )
+		return qfalse;
+
+	// the timeout is a timer in the set, so the wakeup is not rounded to milliseconds
+	poller->timerfd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+	if( poller->timerfd < 0 )
+	{
+		close( poller->epfd );
+		poller->epfd = -1;
+		return qfalse;
+	}
+
+	memset( &ev, 0, sizeof( ev ) );
+	ev.events = EPOLLIN;
+	ev.data.fd = poller->timerfd;
+	if( epoll_ctl( poller->epfd, EPOLL_CTL_ADD, poller->timerfd, &ev ) < 0 )
+	{
+		close( poller->timerfd );
+		close( poller->epfd );
+		poller->timerfd = poller->epfd = -1;
+		return qfalse;
+	}
+
+	poller->numhandles = 0;
+	return qtrue;
+}
+
+/*
+* NET_Poller_Shutdown
+*/
+static void NET_Poller_Shutdown( net_poller_t *poller )
+{
+	if( poller->epfd < 0 )
+		return;
+
+	close( poller->timerfd );
+	close( poller->epfd );
+	poller->timerfd = poller->epfd = -1;
+	poller->numhandles = 0;
+}
+
+/*
+* NET_Poller_Forget
+*
+* Closing a socket takes it out of the epoll set, so just drop it from the list
+*/
+static void NET_Poller_Forget( net_poller_t *poller, socket_handle_t handle )
+{
+	int i;
+
+	for( i = 0; i < poller->numhandles; i++ )
+	{
+		if( poller->handles[i] == handle )
+		{
+			poller->handles[i] = poller->handles[--poller->numhandles];
+			return;
+		}
+	}
+}
+
+/*
+* NET_Poller_Update
+*
+* Makes the epoll set match the given sockets. Returns qfalse if it can't be used.
+*/
+static qboolean NET_Poller_Update( net_poller_t *poller, socket_t *sockets[] )
+{
+	int i, j;
+	socket_handle_t handle;
+	struct epoll_event ev;
+
+	// remove the sockets that are no longer waited on
+	for( i = 0; i < poller->numhandles; )
+	{
+		handle = poller->handles[i];
+		for( j = 0; sockets[j]; j++ )
+		{
+			if( sockets[j]->open && sockets[j]->type != SOCKET_LOOPBACK && sockets[j]->handle == handle )
+				break;
+		}
+
+		if( !sockets[j] )
+		{
+			epoll_ctl( poller->epfd, EPOLL_CTL_DEL, handle, &ev );
+			poller->handles[i] = poller->handles[--poller->numhandles];
+			continue;
+		}
+		i++;
+	}
+
+	// and add the new ones
+	for( j = 0; sockets[j]; j++ )
+	{
+		if( !sockets[j]->open || sockets[j]->type == SOCKET_LOOPBACK )
+			continue;
+
+		handle = sockets[j]->handle;
+		for( i = 0; i < poller->numhandles; i++ )
+		{
+			if( poller->handles[i] == handle )
+				break;
+		}
+		if( i < poller->numhandles )
+			continue;
+
+		if( poller->numhandles == NET_MAX_POLL_SOCKETS )
+			return qfalse;
+
+		memset( &ev, 0, sizeof( ev ) );
+		ev.events = EPOLLIN | EPOLLPRI;
+		ev.data.fd = handle;
+		if( epoll_ctl( poller->epfd, EPOLL_CTL_ADD, handle, &ev ) < 0 )
+			return qfalse;
+
+		poller->handles[poller->numhandles++] = handle;
+	}
+
+	return qtrue;
+}
+
+/*
+* NET_Poller_Wait
+*
+* Returns the number of ready sockets, with their events in events
+*/
+static int NET_Poller_Wait( net_poller_t *poller, int msec, struct epoll_event *events, int maxevents )
+{
+	int i, ret, numevents;
+	struct itimerspec its;
+
+	if( msec > 0 )
+	{
+		memset( &its, 0, sizeof( its ) );
+		its.it_value.tv_sec = msec / 1000;
+		its.it_value.tv_nsec = ( msec % 1000 ) * 1000000;
+		timerfd_settime( poller->timerfd, 0, &its, NULL );
+	}
+
+	ret = epoll_wait( poller->epfd, events, maxevents, msec > 0 ? -1 : 0 );
+	if( ret < 0 )
+		return ( errno == EINTR ? 0 : -1 );
+
+	// the timer isn't one of the sockets
+	for( i = 0, numevents = 0; i < ret; i++ )
+	{
+		if( events[i].data.fd != poller->timerfd )
+			events[numevents++] = events[i];
+	}
+
+	return numevents;
+}
+
+#endif // USE_EPOLL
+
+#ifdef USE_MMSG
+
+typedef struct
+{
+	qbyte data[MAX_PACKETLEN];
+	struct sockaddr_storage addr;
+	struct iovec iov;
+} net_batchpacket_t;
+
+static qboolean net_sendbatch = qfalse;
+static socket_handle_t net_batchhandle;
+static int net_numbatchpackets = 0;
+static net_batchpacket_t net_batchpackets[NET_MAX_SEND_BATCH];
+static struct mmsghdr net_batchmsgs[NET_MAX_SEND_BATCH];
+
+/*
+* NET_UDP_FlushSendBatch
+*
+* Sends the queued packets with as few sendmmsg calls as possible
+*/
+static void NET_UDP_FlushSendBatch( void )
+{
+	int i, ret;
+
+	for( i = 0; i < net_numbatchpackets; i += ret )
+	{
+		ret = sendmmsg( net_batchhandle, net_batchmsgs + i, net_numbatchpackets - i, 0 );
+		if( ret <= 0 )
+		{
+			// the first one failed, skip it and go on with the rest
+			NET_SetErrorStringFromLastError( "sendmmsg" );
+			Com_Printf( "NET_SendPacket: Error: %s\n", NET_ErrorString() );
+			ret = 1;
+		}
+	}
+
+	net_numbatchpackets = 0;
+}
+
+/*
+* NET_UDP_QueuePacket
+*/
+static qboolean NET_UDP_QueuePacket( const socket_t *socket, const void *data, size_t length, const netadr_t *address )
+{
+	net_batchpacket_t *packet;
+	struct mmsghdr *msg;
+
+	if( net_numbatchpackets && ( net_batchhandle != socket->handle || net_numbatchpackets == NET_MAX_SEND_BATCH ) )
+		NET_UDP_FlushSendBatch();
+
+	packet = &net_batchpackets[net_numbatchpackets];
+	if( !AddressToSockaddress( address, &packet->addr ) )
+		return qfalse;
+
+	memcpy( packet->data, data, length );
+	packet->iov.iov_base = packet->data;
+	packet->iov.iov_len = length;
+
+	msg = &net_batchmsgs[net_numbatchpackets];
+	memset( msg, 0, sizeof( *msg ) );
+	msg->msg_hdr.msg_name = &packet->addr;
+	msg->msg_hdr.msg_namelen = ( packet->addr.ss_family == AF_INET6 ? sizeof( struct sockaddr_in6 ) : sizeof( struct sockaddr_in ) );
+	msg->msg_hdr.msg_iov = &packet->iov;
+	msg->msg_hdr.msg_iovlen = 1;
+
+	net_batchhandle = socket->handle;
+	net_numbatchpackets++;
+
+	return qtrue;
+}
+
+/*
+* NET_UDP_GetPackets
+*
+* Reads all the waiting packets, up to maxpackets, with one recvmmsg call.
+* Packets that can't be used are dropped and the rest moved to the front.
+*/
+static int NET_UDP_GetPackets( const socket_t *socket, netadr_t *addresses, msg_t *messages, int maxpackets )
+{
+	int i, ret, numpackets;
+	msg_t tmp;
+	struct mmsghdr msgs[NET_MAX_RECV_BATCH];
+	struct iovec iovs[NET_MAX_RECV_BATCH];
+	struct sockaddr_storage from[NET_MAX_RECV_BATCH];
+
+	assert( socket && socket->open && socket->type == SOCKET_UDP );
+	assert( addresses );
+	assert( messages );
+
+	if( maxpackets > NET_MAX_RECV_BATCH )
+		maxpackets = NET_MAX_RECV_BATCH;
+
+	memset( msgs, 0, maxpackets * sizeof( msgs[0] ) );
+	for( i = 0; i < maxpackets; i++ )
+	{
+		assert( messages[i].data );
+		assert( messages[i].maxsize > 0 );
+
+		iovs[i].iov_base = messages[i].data;
+		iovs[i].iov_len = messages[i].maxsize;
+		msgs[i].msg_hdr.msg_name = &from[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof( from[i] );
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	ret = recvmmsg( socket->handle, msgs, maxpackets, 0, NULL );
+	if( ret == SOCKET_ERROR )
+	{
+		net_error_t err;
+
+		NET_SetErrorStringFromLastError( "recvmmsg" );
+
+		err = Sys_NET_GetLastError();
+		if( err == NET_ERR_WOULDBLOCK || err == NET_ERR_CONNRESET )  // would block
+			return 0;
+
+		return -1;
+	}
+
+	for( i = 0, numpackets = 0; i < ret; i++ )
+	{
+		if( !SockaddressToAddress( (struct sockaddr*)&from[i], &addresses[numpackets] ) )
+			continue;
+
+		if( msgs[i].msg_len == messages[i].maxsize )
+		{
+			NET_SetErrorString( "Oversized packet" );
+			continue;
+		}
+
+		if( i != numpackets )
+		{
+			tmp = messages[numpackets];
+			messages[numpackets] = messages[i];
+			messages[i] = tmp;
+		}
+
+		messages[numpackets].readcount = 0;
+		messages[numpackets].cursize = msgs[i].msg_len;
+		numpackets++;
+	}
+
+	if( !numpackets && ret > 0 )
+		return -1;
+	return numpackets;
+}
+
+#endif // USE_MMSG
+
 /*
 * NET_UDP_GetPacket
 */
@@ -390,6 +738,15 @@ static qboolean NET_UDP_SendPacket( const socket_t *socket, const void *data, si
 	assert( address );
 	assert( length > 0 );
 
+#ifdef USE_MMSG
+	if( net_sendbatch && length <= MAX_PACKETLEN )
+		return NET_UDP_QueuePacket( socket, data, length, address );
+
+	// keep the order of the packets
+	if( net_numbatchpackets )
+		NET_UDP_FlushSendBatch();
+#endif
+
 	if( !AddressToSockaddress( address, &addr ) )
 		return qfalse;
 
@@ -496,6 +853,15 @@ static void NET_UDP_CloseSocket( socket_t *socket )
 	if( !socket->open )
 		return;
 
+#ifdef USE_MMSG
+	if( net_numbatchpackets && net_batchhandle == socket->handle )
+		NET_UDP_FlushSendBatch();
+#endif
+#ifdef USE_EPOLL
+	NET_Poller_Forget( &net_sleeppoller, socket->handle );
+	NET_Poller_Forget( &net_monitorpoller, socket->handle );
+#endif
+
 	Sys_NET_SocketClose( socket->handle );
 	socket->handle = 0;
 	socket->open = qfalse;
@@ -804,6 +1170,11 @@ static void NET_TCP_CloseSocket( socket_t *socket )
 
 	shutdown( socket->handle, SHUT_RDWR );
 
+#ifdef USE_EPOLL
+	NET_Poller_Forget( &net_sleeppoller, socket->handle );
+	NET_Poller_Forget( &net_monitorpoller, socket->handle );
+#endif
+
 	Sys_NET_SocketClose( socket->handle );
 	socket->handle = 0;
 	socket->open = qfalse;
@@ -993,6 +1364,42 @@ int NET_GetPacket( const socket_t *socket, netadr_t *address, msg_t *message )
 	}
 }
 
+/*
+* NET_GetPackets
+*
+* Like NET_GetPacket, but reads up to maxpackets packets at once
+* 
+* n	number of packets read
+* 0	not ready
+* -1	error
+*/
+int NET_GetPackets( const socket_t *socket, netadr_t *addresses, msg_t *messages, int maxpackets )
+{
+	int ret, numpackets;
+
+	assert( socket->open );
+	assert( maxpackets > 0 );
+
+	if( !socket->open )
+		return -1;
+
+#ifdef USE_MMSG
+	if( socket->type == SOCKET_UDP )
+		return NET_UDP_GetPackets( socket, addresses, messages, maxpackets );
+#endif
+
+	for( numpackets = 0; numpackets < maxpackets; numpackets++ )
+	{
+		ret = NET_GetPacket( socket, &addresses[numpackets], &messages[numpackets] );
+		if( ret == 0 )
+			break;
+		if( ret == -1 )
+			return ( numpackets ? numpackets : -1 );
+	}
+
+	return numpackets;
+}
+
 /*
 * NET_Get
 * 
@@ -1059,6 +1466,31 @@ qboolean NET_SendPacket( const socket_t *socket, const void *data, size_t length
 	}
 }
 
+/*
+* NET_BeginSendBatch
+*
+* UDP packets sent until NET_EndSendBatch may be queued and sent together.
+* Errors for queued packets are only printed when they are sent.
+*/
+void NET_BeginSendBatch( void )
+{
+#ifdef USE_MMSG
+	net_sendbatch = qtrue;
+#endif
+}
+
+/*
+* NET_EndSendBatch
+*/
+void NET_EndSendBatch( void )
+{
+#ifdef USE_MMSG
+	if( net_numbatchpackets )
+		NET_UDP_FlushSendBatch();
+	net_sendbatch = qfalse;
+#endif
+}
+
 /*
 * NET_Send
 */
@@ -1167,6 +1599,27 @@ qboolean NET_CompareBaseAddress( const netadr_t *a, const netadr_t *b )
 	}
 }
 
+/*
+* NET_BaseAddressHash
+*
+* Hashes the address without the port, equal for addresses NET_CompareBaseAddress matches
+*/
+unsigned int NET_BaseAddressHash( const netadr_t *address )
+{
+	switch( address->type )
+	{
+	case NA_IP:
+		return Com_SuperFastHash( address->address.ipv4.ip, sizeof( address->address.ipv4.ip ), NA_IP );
+
+	case NA_IP6:
+		return Com_SuperFastHash( address->address.ipv6.ip, sizeof( address->address.ipv6.ip ),
+			NA_IP6 + (unsigned int)address->address.ipv6.scope_id );
+
+	default:
+		return address->type;
+	}
+}
+
 /*
 * NET_GetAddressPort
 * 
@@ -1768,8 +2221,6 @@ void NET_Sleep( int msec, socket_t *sockets[] )
 	if( !sockets || !sockets[0] )
 		return;
 
-	FD_ZERO( &fdset );
-
 	for( i = 0; sockets[i]; i++ )
 	{
 		assert( sockets[i]->open );
@@ -1781,7 +2232,6 @@ void NET_Sleep( int msec, socket_t *sockets[] )
 		case SOCKET_TCP:
 #endif
 			assert( sockets[i]->handle > 0 );
-			FD_SET( (unsigned)sockets[i]->handle, &fdset ); // network socket
 			break;
 
 		default:
@@ -1790,6 +2240,21 @@ void NET_Sleep( int msec, socket_t *sockets[] )
 		}
 	}
 
+#ifdef USE_EPOLL
+	if( NET_Poller_Init( &net_sleeppoller ) && NET_Poller_Update( &net_sleeppoller, sockets ) )
+	{
+		struct epoll_event events[NET_MAX_POLL_SOCKETS + 1];
+
+		NET_Poller_Wait( &net_sleeppoller, msec, events, NET_MAX_POLL_SOCKETS + 1 );
+		return;
+	}
+#endif
+
+	FD_ZERO( &fdset );
+
+	for( i = 0; sockets[i]; i++ )
+		FD_SET( (unsigned)sockets[i]->handle, &fdset ); // network socket
+
 	timeout.tv_sec = msec / 1000;
 	timeout.tv_usec = ( msec % 1000 ) * 1000;
 	select( FD_SETSIZE, &fdset, NULL, NULL, &timeout );
@@ -1814,6 +2279,38 @@ int NET_Monitor( int msec, socket_t *sockets[], void (*read_cb)(socket_t *socket
 	if( !sockets || !sockets[0] )
 		return 0;
 
+#ifdef USE_EPOLL
+	if( NET_Poller_Init( &net_monitorpoller ) && NET_Poller_Update( &net_monitorpoller, sockets ) )
+	{
+		struct epoll_event events[NET_MAX_POLL_SOCKETS + 1];
+		int j;
+
+		ret = NET_Poller_Wait( &net_monitorpoller, msec, events, NET_MAX_POLL_SOCKETS + 1 );
+		if( ret > 0 && ( read_cb || exception_cb ) )
+		{
+			// Launch callbacks, in the order of the sockets
+			for( i = 0; sockets[i]; i++ )
+			{
+				if( !sockets[i]->open || sockets[i]->type == SOCKET_LOOPBACK )
+					continue;
+
+				for( j = 0; j < ret; j++ )
+				{
+					if( events[j].data.fd != sockets[i]->handle )
+						continue;
+
+					if( exception_cb && ( events[j].events & ( EPOLLPRI|EPOLLERR ) ) )
+						exception_cb( sockets[i] );
+					if( read_cb && ( events[j].events & EPOLLIN ) )
+						read_cb( sockets[i] );
+					break;
+				}
+			}
+		}
+		return ret;
+	}
+#endif
+
 	FD_ZERO( &fdsetr );
 	if (exception_cb) {
 		FD_ZERO( &fdsete );
@@ -1900,6 +2397,11 @@ void NET_Shutdown( void )
 		errorstring_size = 0;
 	}
 
+#ifdef USE_EPOLL
+	NET_Poller_Shutdown( &net_sleeppoller );
+	NET_Poller_Shutdown( &net_monitorpoller );
+#endif
+
 	Sys_NET_Shutdown();
 
 	net_initialized = qfalse;
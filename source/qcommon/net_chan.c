@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include "qcommon.h"
+#include "qthreads.h"
 
 #if defined ( __MACOSX__ )
 #include <arpa/inet.h>
@@ -85,6 +86,7 @@ static int game_port;
 static cvar_t *showpackets;
 static cvar_t *showdrop;
 static cvar_t *net_showfragments;
+static cvar_t *net_compresslevel;
 
 /*
 * Netchan_OutOfBand
@@ -149,6 +151,9 @@ static qbyte msg_process_data[MAX_MSGLEN];
 
 #include "zlib.h"
 
+// compression stats for host_speeds, added to from the snapshot threads too
+static volatile int netchan_zmessages, netchan_zbytesin, netchan_zbytesout, netchan_zusec;
+
 #ifdef ALT_ZLIB_COMPRESSION
 /*
 http://www.zlib.net/manual.html#compress2
@@ -238,6 +243,15 @@ static int Netchan_ZLibDecompressChunk( const qbyte *source, unsigned long sourc
 
 	return result;
 }
+
+struct netchan_zstream_s *Netchan_CreateZStream( void )
+{
+	return NULL;
+}
+
+void Netchan_FreeZStream( struct netchan_zstream_s *stream )
+{
+}
 #else // ALT_ZLIB_COMPRESSION
 
 int Netchan_ZLibDecompressChunk( qbyte *in, int inlen, qbyte *out, int outlen, int wbits )
@@ -318,27 +332,154 @@ int Netchan_ZLibCompressChunk( qbyte *in, int len_in, qbyte *out, int max_len_ou
 	return zs.total_out;
 }
 
+typedef struct netchan_zstream_s
+{
+	z_stream zs;
+	int level;
+} netchan_zstream_t;
+
+static netchan_zstream_t *netchan_zstream;
+static z_stream netchan_inflate;
+static qboolean netchan_inflateInit;
+
+/*
+* Netchan_CreateZStream
+*
+* A deflate stream that is reset for each message instead of set up
+* and freed, saving the allocation of the deflate state every time
+*/
+netchan_zstream_t *Netchan_CreateZStream( void )
+{
+	netchan_zstream_t *stream;
+
+	stream = Mem_ZoneMalloc( sizeof( *stream ) );
+	stream->level = Z_DEFAULT_COMPRESSION;
+
+	if( deflateInit2( &stream->zs, stream->level, Z_DEFLATED, -MAX_WBITS, 9, Z_DEFAULT_STRATEGY ) != Z_OK )
+	{
+		Com_DPrintf( "ZLib data error! Error on deflateInit.\n" );
+		Mem_ZoneFree( stream );
+		return NULL;
+	}
+
+	return stream;
+}
+
+/*
+* Netchan_FreeZStream
+*/
+void Netchan_FreeZStream( netchan_zstream_t *stream )
+{
+	if( !stream )
+		return;
+
+	deflateEnd( &stream->zs );
+	Mem_ZoneFree( stream );
+}
+
+/*
+* Netchan_ZLibCompressStream
+*/
+static int Netchan_ZLibCompressStream( netchan_zstream_t *stream, qbyte *in, int len_in, qbyte *out, int max_len_out, int level )
+{
+	z_stream *zs = &stream->zs;
+
+	if( deflateReset( zs ) != Z_OK )
+		return -1;
+
+	if( level != stream->level )
+	{
+		if( deflateParams( zs, level, Z_DEFAULT_STRATEGY ) != Z_OK )
+			return -1;
+		stream->level = level;
+	}
+
+	zs->next_in = in;
+	zs->avail_in = len_in;
+	zs->next_out = out;
+	zs->avail_out = max_len_out;
+	zs->data_type = Z_BINARY;
+
+	if( deflate( zs, Z_FINISH ) != Z_STREAM_END )
+		return -1;
+
+	return zs->total_out;
+}
+
+/*
+* Netchan_ZLibDecompressStream
+*/
+static int Netchan_ZLibDecompressStream( qbyte *in, int inlen, qbyte *out, int outlen )
+{
+	int result;
+
+	if( !netchan_inflateInit )
+	{
+		memset( &netchan_inflate, 0, sizeof( netchan_inflate ) );
+		result = inflateInit2( &netchan_inflate, -MAX_WBITS );
+		if( result != Z_OK )
+		{
+			Com_DPrintf( "ZLib data error! Error %d on inflateInit.\n", result );
+			return result;
+		}
+		netchan_inflateInit = qtrue;
+	}
+	else if( inflateReset( &netchan_inflate ) != Z_OK )
+	{
+		return -1;
+	}
+
+	netchan_inflate.next_in = in;
+	netchan_inflate.avail_in = inlen;
+	netchan_inflate.next_out = out;
+	netchan_inflate.avail_out = outlen;
+
+	result = inflate( &netchan_inflate, Z_FINISH );
+	if( result != Z_STREAM_END )
+	{
+		Com_DPrintf( "ZLib data error! Error %d on inflate.\nMessage: %s", result, netchan_inflate.msg );
+		return -1;
+	}
+
+	return netchan_inflate.total_out;
+}
+
 #endif // ALT_ZLIB_COMPRESSION
 
 /*
-* Netchan_CompressMessage
+* Netchan_CompressMessageExt
+*
+* Compresses through the given work buffer and stream instead of the shared
+* ones, so messages can be compressed from several threads at once.
 */
-int Netchan_CompressMessage( msg_t *msg )
+int Netchan_CompressMessageExt( msg_t *msg, qbyte *buffer, size_t buffer_size, struct netchan_zstream_s *stream )
 {
-	int length;
+	int length, level;
+	quint64 usec;
 
 	if( msg == NULL || !msg->data )
 		return 0;
 
-	// zero-fill our buffer
-	length = 0;
-	memset( msg_process_data, 0, sizeof( msg_process_data ) );
+	level = net_compresslevel->integer;
+	clamp( level, Z_DEFAULT_COMPRESSION, Z_BEST_COMPRESSION );
+
+	usec = Sys_Microseconds();
 
 	//compress the message
-	length = Netchan_ZLibCompressChunk( msg->data, msg->cursize, msg_process_data, sizeof( msg_process_data ), Z_DEFAULT_COMPRESSION, -MAX_WBITS );
+#ifndef ALT_ZLIB_COMPRESSION
+	if( stream )
+		length = Netchan_ZLibCompressStream( stream, msg->data, msg->cursize, buffer, buffer_size, level );
+	else
+#endif
+		length = Netchan_ZLibCompressChunk( msg->data, msg->cursize, buffer, buffer_size, level, -MAX_WBITS );
 	if( length < 0 )  // failed to compress, return the error
 		return length;
 
+	QAtomic_Add( &netchan_zmessages, 1, NULL );
+	QAtomic_Add( &netchan_zbytesin, msg->cursize, NULL );
+	QAtomic_Add( &netchan_zbytesout, min( length, (int)msg->cursize ), NULL );
+	QAtomic_Add( &netchan_zusec, (int)( Sys_Microseconds() - usec ), NULL );
+
 	if( (size_t)length >= msg->cursize || length >= MAX_MSGLEN )
 	{
 		return 0; // compressed was bigger. Send uncompressed
@@ -346,12 +487,41 @@ int Netchan_CompressMessage( msg_t *msg )
 
 	//write it back into the original container
 	MSG_Clear( msg );
-	MSG_CopyData( msg, msg_process_data, length );
+	MSG_CopyData( msg, buffer, length );
 	msg->compressed = qtrue;
 
 	return length; // return the new size
 }
 
+/*
+* Netchan_CompressMessage
+*/
+int Netchan_CompressMessage( msg_t *msg )
+{
+#ifndef ALT_ZLIB_COMPRESSION
+	if( !netchan_zstream )
+		netchan_zstream = Netchan_CreateZStream();
+	return Netchan_CompressMessageExt( msg, msg_process_data, sizeof( msg_process_data ), netchan_zstream );
+#else
+	return Netchan_CompressMessageExt( msg, msg_process_data, sizeof( msg_process_data ), NULL );
+#endif
+}
+
+/*
+* Netchan_GetCompressStats
+*
+* Returns what was compressed since the last call
+*/
+void Netchan_GetCompressStats( int *messages, int *bytesIn, int *bytesOut, int *usec )
+{
+	*messages = netchan_zmessages;
+	*bytesIn = netchan_zbytesin;
+	*bytesOut = netchan_zbytesout;
+	*usec = netchan_zusec;
+
+	netchan_zmessages = netchan_zbytesin = netchan_zbytesout = netchan_zusec = 0;
+}
+
 /*
 * Netchan_DecompressMessage
 */
@@ -365,7 +535,11 @@ int Netchan_DecompressMessage( msg_t *msg )
 	if( msg->compressed == qfalse )
 		return 0;
 
+#ifndef ALT_ZLIB_COMPRESSION
+	length = Netchan_ZLibDecompressStream( msg->data + msg->readcount, msg->cursize - msg->readcount, msg_process_data, ( sizeof( msg_process_data ) - msg->readcount ) );
+#else
 	length = Netchan_ZLibDecompressChunk( msg->data + msg->readcount, msg->cursize - msg->readcount, msg_process_data, ( sizeof( msg_process_data ) - msg->readcount ), -MAX_WBITS );
+#endif
 	if( length < 0 )
 		return length;
 
@@ -547,8 +721,8 @@ qboolean Netchan_Transmit( netchan_t *chan, msg_t *msg )
 
 	if( showpackets->integer )
 	{
-		Com_Printf( "%s send %4i : s=%i ack=%i\n", NET_SocketToString( chan->socket ), send.cursize,
-			chan->outgoingSequence - 1, chan->incomingSequence );
+		Com_Printf( "%s send %4i : s=%i ack=%i%s\n", NET_SocketToString( chan->socket ), send.cursize,
+			chan->outgoingSequence - 1, chan->incomingSequence, msg->compressed ? " compressed" : "" );
 	}
 
 	return qtrue;
@@ -766,6 +940,7 @@ void Netchan_Init( void )
 	showpackets = Cvar_Get( "showpackets", "0", 0 );
 	showdrop = Cvar_Get( "showdrop", "0", 0 );
 	net_showfragments = Cvar_Get( "net_showfragments", "0", 0 );
+	net_compresslevel = Cvar_Get( "net_compresslevel", "-1", CVAR_ARCHIVE );
 }
 
 /*
@@ -773,4 +948,14 @@ void Netchan_Init( void )
 */
 void Netchan_Shutdown( void )
 {
+#ifndef ALT_ZLIB_COMPRESSION
+	Netchan_FreeZStream( netchan_zstream );
+	netchan_zstream = NULL;
+
+	if( netchan_inflateInit )
+	{
+		inflateEnd( &netchan_inflate );
+		netchan_inflateInit = qfalse;
+	}
+#endif
 }
@@ -34,6 +34,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "qfiles.h"
 #include "cmodel.h"
 #include "version.h"
+#include "qthreads.h"
 
 //#define	PARANOID			// speed sapping error checking
 
@@ -50,6 +51,7 @@ struct client_s;
 struct cmodel_state_s;
 struct client_entities_s;
 struct fatvis_s;
+struct snapshotEntityVis_s;
 
 //============================================================================
 
@@ -148,6 +150,24 @@ void SNAP_BuildClientFrameSnap( struct cmodel_state_s *cms, struct ginfo_s *gi,
 							   game_state_t *gameState, struct client_entities_s *client_entities,
 							   qboolean relay, struct mempool_s *mempool );
 
+// the stages of SNAP_BuildClientFrameSnap, for building several clients at once
+#define	MAX_SNAPSHOT_ENTITIES	1024
+typedef struct
+{
+	int numSnapshotEntities;
+	int snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	int entityAddedToSnapList[MAX_EDICTS];
+} snapshotEntityNumbers_t;
+
+void SNAP_IndexFrameEntities( struct ginfo_s *gi, struct snapshotEntityVis_s *entvis );
+qboolean SNAP_BeginClientFrameSnap( struct cmodel_state_s *cms, struct ginfo_s *gi, unsigned int frameNum, unsigned int timeStamp,
+								   struct client_s *client, game_state_t *gameState, qboolean relay, struct mempool_s *mempool );
+void SNAP_BuildClientFrameEntities( struct cmodel_state_s *cms, struct ginfo_s *gi, unsigned int frameNum, vec_t *skyorg, qbyte *fatpvs,
+								   struct snapshotEntityVis_s *entvis, struct client_s *client, snapshotEntityNumbers_t *entsList );
+void SNAP_ReserveClientFrameEntities( unsigned int frameNum, struct client_s *client, int numEntities, struct client_entities_s *client_entities );
+void SNAP_EmitClientFrameEntities( struct ginfo_s *gi, unsigned int frameNum, struct client_s *client,
+								  snapshotEntityNumbers_t *entsList, struct client_entities_s *client_entities );
+
 void SNAP_FreeClientFrames( struct client_s *client );
 
 void SNAP_RecordDemoMessage( int demofile, msg_t *msg, int offset );
@@ -651,7 +671,10 @@ int						NET_Accept( const socket_t *socket, socket_t *newsocket, netadr_t *addr
 #endif
 
 int			NET_GetPacket( const socket_t *socket, netadr_t *address, msg_t *message );
+int			NET_GetPackets( const socket_t *socket, netadr_t *addresses, msg_t *messages, int maxpackets );
 qboolean    NET_SendPacket( const socket_t *socket, const void *data, size_t length, const netadr_t *address );
+void		NET_BeginSendBatch( void );
+void		NET_EndSendBatch( void );
 
 int			NET_Get( const socket_t *socket, netadr_t *address, void *data, size_t length );
 qboolean    NET_Send( const socket_t *socket, const void *data, size_t length, const netadr_t *address );
@@ -675,6 +698,7 @@ void			NET_SetAddressPort( netadr_t *address, unsigned short port );
 
 qboolean    NET_CompareAddress( const netadr_t *a, const netadr_t *b );
 qboolean    NET_CompareBaseAddress( const netadr_t *a, const netadr_t *b );
+unsigned int	NET_BaseAddressHash( const netadr_t *address );
 qboolean    NET_IsLANAddress( const netadr_t *address );
 qboolean    NET_IsLocalAddress( const netadr_t *address );
 qboolean    NET_IsAnyAddress( const netadr_t *address );
@@ -716,6 +740,8 @@ typedef struct
 extern netadr_t	net_from;
 
 
+struct netchan_zstream_s;
+
 void Netchan_Init( void );
 void Netchan_Shutdown( void );
 void Netchan_Setup( netchan_t *chan, const socket_t *socket, const netadr_t *address, int qport );
@@ -724,7 +750,11 @@ qboolean Netchan_Transmit( netchan_t *chan, msg_t *msg );
 qboolean Netchan_PushAllFragments( netchan_t *chan );
 qboolean Netchan_TransmitNextFragment( netchan_t *chan );
 int Netchan_CompressMessage( msg_t *msg );
+int Netchan_CompressMessageExt( msg_t *msg, qbyte *buffer, size_t buffer_size, struct netchan_zstream_s *stream );
 int Netchan_DecompressMessage( msg_t *msg );
+struct netchan_zstream_s *Netchan_CreateZStream( void );
+void Netchan_FreeZStream( struct netchan_zstream_s *stream );
+void Netchan_GetCompressStats( int *messages, int *bytesIn, int *bytesOut, int *usec );
 void Netchan_OutOfBand( const socket_t *socket, const netadr_t *address, size_t length, const qbyte *data );
 void Netchan_OutOfBandPrint( const socket_t *socket, const netadr_t *address, const char *format, ... );
 int Netchan_GamePort( void );
@@ -0,0 +1,63 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef __QTHREADS_H
+#define __QTHREADS_H
+
+#define Q_THREADS_WAIT_INFINITE 0xFFFFFFFF
+
+struct qthread_s;
+struct qmutex_s;
+struct qcondvar_s;
+struct qthreadpool_s;
+
+typedef struct qthread_s qthread_t;
+typedef struct qmutex_s qmutex_t;
+typedef struct qcondvar_s qcondvar_t;
+typedef struct qthreadpool_s qthreadpool_t;
+
+qmutex_t *QMutex_Create( void );
+void QMutex_Destroy( qmutex_t **pmutex );
+void QMutex_Lock( qmutex_t *mutex );
+void QMutex_Unlock( qmutex_t *mutex );
+
+qcondvar_t *QCondVar_Create( void );
+void QCondVar_Destroy( qcondvar_t **pcond );
+qboolean QCondVar_Wait( qcondvar_t *cond, qmutex_t *mutex, unsigned int timeout_msec );
+void QCondVar_Wake( qcondvar_t *cond );
+
+qthread_t *QThread_Create( void *(*routine) (void*), void *param );
+void QThread_Join( qthread_t *thread );
+
+int QAtomic_Add( volatile int *value, int add, qmutex_t *mutex );
+qboolean QAtomic_CAS( volatile int *value, int oldval, int newval, qmutex_t *mutex );
+
+int QThreads_NumProcessors( void );
+
+// a pool of worker threads running one parallel loop at a time,
+// the calling thread takes part in the loop as thread number 0
+typedef void ( *qparallelfunc_t )( void *param, int index, int thread );
+
+qthreadpool_t *QThreadPool_Create( int numThreads );
+void QThreadPool_Destroy( qthreadpool_t **ppool );
+int QThreadPool_NumThreads( const qthreadpool_t *pool );
+void QThreadPool_ParallelFor( qthreadpool_t *pool, int count, qparallelfunc_t func, void *param );
+
+#endif // __QTHREADS_H
@@ -799,14 +799,6 @@ static qboolean SNAP_BitsCullEntity( cmodel_state_t *cms, edict_t *ent, qbyte *b
 
 //=====================================================================
 
-#define	MAX_SNAPSHOT_ENTITIES	1024
-typedef struct
-{
-	int numSnapshotEntities;
-	int snapshotEntities[MAX_SNAPSHOT_ENTITIES];
-	int entityAddedToSnapList[MAX_EDICTS];
-} snapshotEntityNumbers_t;
-
 /*
 * SNAP_AddEntNumToSnapList
 */
@@ -943,14 +935,34 @@ static qboolean SNAP_SnapCullEntity( cmodel_state_t *cms, edict_t *ent, edict_t
 	return SNAP_PVSCullEntity( cms, fatpvs, ent );			// cull by PVS
 }
 
+/*
+* SNAP_AddEntityToSnapList
+*/
+static void SNAP_AddEntityToSnapList( cmodel_state_t *cms, ginfo_t *gi, int entNum, edict_t *clent, client_snapshot_t *frame, vec3_t vieworg, qbyte *fatpvs, snapshotEntityNumbers_t *entsList )
+{
+	edict_t *ent = EDICT_NUM( entNum );
+
+	// always add the client entity, even if SVF_NOCLIENT
+	if( ( ent != clent ) && SNAP_SnapCullEntity( cms, ent, clent, frame, vieworg, fatpvs ) )
+		return;
+
+	// add it
+	SNAP_AddEntNumToSnapList( entNum, entsList );
+
+	// owner numbers were validated by SNAP_FixEntityNumbers
+	if( ( ent->r.svflags & SVF_FORCEOWNER ) && ent->s.ownerNum > 0 )
+		SNAP_AddEntNumToSnapList( ent->s.ownerNum, entsList );
+}
+
 /*
 * SNAP_BuildSnapEntitiesList
 */
-static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, edict_t *clent, vec3_t vieworg, vec3_t skyorg, qbyte *fatpvs, client_snapshot_t *frame, snapshotEntityNumbers_t *entsList )
+static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, edict_t *clent, vec3_t vieworg, vec3_t skyorg, qbyte *fatpvs, snapshotEntityVis_t *entvis, client_snapshot_t *frame, snapshotEntityNumbers_t *entsList )
 {
 	int leafnum = -1, clusternum = -1, clientarea = -1;
-	int entNum;
+	int i, j, entNum;
 	edict_t	*ent;
+	unsigned int candidates[MAX_EDICTS/32];
 
 	// find the client's PVS
 	if( frame->allentities )
@@ -975,11 +987,6 @@ static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, edict_
 		if( !frame->allentities && clusternum == -1 )
 		{
 			entNum = NUM_FOR_EDICT( clent );
-			if( clent->s.number != entNum )
-			{
-				Com_Printf( "FIXING CLENT->S.NUMBER: %i %i!!!\n", clent->s.number, entNum );
-				clent->s.number = entNum;
-			}
 
 			// FIXME we should send all the entities who's POV we are sending if frame->multipov
 			SNAP_AddEntNumToSnapList( entNum, entsList );
@@ -994,22 +1001,84 @@ static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, edict_
 		if( skyorg )
 			CM_MergeVisSets( cms, skyorg, fatpvs, frame->areabits + clientarea * CM_AreaRowSize( cms ) );
 
+		for( i = 0; i < entvis->numPortalEntities; i++ )
+		{
+			ent = EDICT_NUM( entvis->portalEntities[i] );
+
+			// merge visibility sets if portal
+			if( SNAP_SnapCullEntity( cms, ent, clent, frame, vieworg, fatpvs ) )
+				continue;
+
+			if( !VectorCompare( ent->s.origin, ent->s.origin2 ) )
+				CM_MergeVisSets( cms, ent->s.origin2, fatpvs, frame->areabits + clientarea * CM_AreaRowSize( cms ) );
+		}
+	}
+
+	// add the entities to the list
+	if( frame->allentities )
+	{
 		for( entNum = 1; entNum < gi->num_edicts; entNum++ )
+			SNAP_AddEntityToSnapList( cms, gi, entNum, clent, frame, vieworg, fatpvs, entsList );
+	}
+	else
+	{
+		// only the entities touching a cluster in the PVS can pass the PVS check,
+		// everything else goes through the full cull anyway
+		memset( candidates, 0, sizeof( candidates ) );
+
+		for( i = 0; i < entvis->numOccupiedClusters; i++ )
 		{
-			ent = EDICT_NUM( entNum );
-			if( ent->r.svflags & SVF_PORTAL )
+			int cluster = entvis->occupiedClusters[i];
+
+			if( !( fatpvs[cluster >> 3] & ( 1 << ( cluster&7 ) ) ) )
+				continue;
+
+			for( j = entvis->occupiedFirst[i]; j < entvis->occupiedFirst[i+1]; j++ )
 			{
-				// merge visibility sets if portal
-				if( SNAP_SnapCullEntity( cms, ent, clent, frame, vieworg, fatpvs ) )
-					continue;
+				entNum = entvis->clusterEntities[j] % MAX_EDICTS;
+				candidates[entNum >> 5] |= 1 << ( entNum&31 );
+			}
+		}
 
-				if( !VectorCompare( ent->s.origin, ent->s.origin2 ) )
-					CM_MergeVisSets( cms, ent->s.origin2, fatpvs, frame->areabits + clientarea * CM_AreaRowSize( cms ) );
+		for( i = 0; i < entvis->numSpecialEntities; i++ )
+		{
+			entNum = entvis->specialEntities[i];
+			candidates[entNum >> 5] |= 1 << ( entNum&31 );
+		}
+
+		if( clent )
+		{
+			entNum = NUM_FOR_EDICT( clent );
+			candidates[entNum >> 5] |= 1 << ( entNum&31 );
+		}
+
+		for( i = 0; i < MAX_EDICTS/32; i++ )
+		{
+			if( !candidates[i] )
+				continue;
+
+			for( j = 0; j < 32; j++ )
+			{
+				if( candidates[i] & ( 1 << j ) )
+					SNAP_AddEntityToSnapList( cms, gi, ( i << 5 ) + j, clent, frame, vieworg, fatpvs, entsList );
 			}
 		}
 	}
 
-	// add the entities to the list
+	SNAP_SortSnapList( entsList );
+}
+
+/*
+* SNAP_FixEntityNumbers
+*
+* Repairs broken entity numbers before the snapshots are built, so that
+* building them only reads the edicts.
+*/
+static void SNAP_FixEntityNumbers( ginfo_t *gi )
+{
+	int entNum;
+	edict_t	*ent;
+
 	for( entNum = 1; entNum < gi->num_edicts; entNum++ )
 	{
 		ent = EDICT_NUM( entNum );
@@ -1021,66 +1090,117 @@ static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, edict_
 			ent->s.number = entNum;
 		}
 
-		// always add the client entity, even if SVF_NOCLIENT
-		if( ( ent != clent ) && SNAP_SnapCullEntity( cms, ent, clent, frame, vieworg, fatpvs ) )
+		// make sure owner number is valid too
+		if( ( ent->r.svflags & SVF_FORCEOWNER ) && ( ent->s.ownerNum <= 0 || ent->s.ownerNum >= gi->num_edicts ) )
+		{
+			Com_Printf( "FIXING ENT->S.OWNERNUM: %i %i!!!\n", ent->s.type, ent->s.ownerNum );
+			ent->s.ownerNum = 0;
+		}
+	}
+}
+
+/*
+* SNAP_CompareClusterEntities
+*/
+static int SNAP_CompareClusterEntities( const int *a, const int *b )
+{
+	return *a - *b;
+}
+
+/*
+* SNAP_IndexFrameEntities
+*
+* Fixes the entity numbers and sorts the entities by what decides their
+* visibility: portals, entities that every client must check on its own, and
+* entities that can only be seen through the clusters they touch.
+* Must be called once per frame before building the client snapshots.
+*/
+void SNAP_IndexFrameEntities( ginfo_t *gi, snapshotEntityVis_t *entvis )
+{
+	int i, entNum, cluster;
+	edict_t	*ent;
+
+	SNAP_FixEntityNumbers( gi );
+
+	entvis->numEntities = gi->num_edicts;
+	entvis->numPortalEntities = 0;
+	entvis->numSpecialEntities = 0;
+	entvis->numClusterEntities = 0;
+	entvis->numOccupiedClusters = 0;
+
+	for( entNum = 1; entNum < gi->num_edicts; entNum++ )
+	{
+		ent = EDICT_NUM( entNum );
+
+		// client entities skip the cull for themselves, anyone else can't see them
+		if( ent->r.svflags & SVF_NOCLIENT )
 			continue;
 
-		// add it
-		SNAP_AddEntNumToSnapList( entNum, entsList );
+		if( ent->r.svflags & SVF_PORTAL )
+			entvis->portalEntities[entvis->numPortalEntities++] = entNum;
 
-		if( ent->r.svflags & SVF_FORCEOWNER )
+		// these follow the order of the tests in SNAP_SnapCullEntity
+		if( ent->r.svflags & SVF_BROADCAST )
 		{
-			// make sure owner number is valid too
-			if( ent->s.ownerNum > 0 && ent->s.ownerNum < gi->num_edicts )
-			{
-				SNAP_AddEntNumToSnapList( ent->s.ownerNum, entsList );
-			}
-			else
-			{
-				Com_Printf( "FIXING ENT->S.OWNERNUM: %i %i!!!\n", ent->s.type, ent->s.ownerNum );
-				ent->s.ownerNum = 0;
-			}
+			entvis->specialEntities[entvis->numSpecialEntities++] = entNum;
+			continue;
 		}
+
+		if( ent->r.areanum < 0 )
+			continue;
+
+		if( ( ent->r.svflags & SVF_SOUNDCULL ) || 
+			( !ent->s.modelindex && !ent->s.events[0] && !ent->s.light && !ent->s.effects && ent->s.sound ) ||
+			ent->r.num_clusters == -1 )
+		{
+			entvis->specialEntities[entvis->numSpecialEntities++] = entNum;
+			continue;
+		}
+
+		for( i = 0; i < ent->r.num_clusters; i++ )
+			entvis->clusterEntities[entvis->numClusterEntities++] = ent->r.clusternums[i] * MAX_EDICTS + entNum;
 	}
 
-	SNAP_SortSnapList( entsList );
+	qsort( entvis->clusterEntities, entvis->numClusterEntities, sizeof( int ),
+		( int ( * )( const void *, const void * ) )SNAP_CompareClusterEntities );
+
+	// group them by cluster
+	cluster = -1;
+	for( i = 0; i < entvis->numClusterEntities; i++ )
+	{
+		if( entvis->clusterEntities[i] / MAX_EDICTS == cluster )
+			continue;
+
+		cluster = entvis->clusterEntities[i] / MAX_EDICTS;
+		entvis->occupiedClusters[entvis->numOccupiedClusters] = cluster;
+		entvis->occupiedFirst[entvis->numOccupiedClusters] = i;
+		entvis->numOccupiedClusters++;
+	}
+	entvis->occupiedFirst[entvis->numOccupiedClusters] = entvis->numClusterEntities;
 }
 
 /*
-* SNAP_BuildClientFrameSnap
+* SNAP_BeginClientFrameSnap
 *
-* Decides which entities are going to be visible to the client, and
-* copies off the playerstat and areabits.
+* Sets up the client frame and copies off the playerstate and match state.
+* Returns qfalse if the client is not in game yet.
 */
-void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int frameNum, unsigned int timeStamp,
-							   fatvis_t *fatvis, client_t *client,
-							   game_state_t *gameState, client_entities_t *client_entities,
-							   qboolean relay, mempool_t *mempool )
+qboolean SNAP_BeginClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int frameNum, unsigned int timeStamp,
+								   client_t *client, game_state_t *gameState, qboolean relay, mempool_t *mempool )
 {
-	int e, i, ne;
-	vec3_t org;
+	int i;
 	edict_t	*ent, *clent;
 	client_snapshot_t *frame;
-	entity_state_t *state;
 	int numplayers, numareas;
-	snapshotEntityNumbers_t entsList;
 
 	assert( gameState );
 
 	clent = client->edict;
 	if( clent && !clent->r.client )		// allow NULL ent for server record
-		return;		// not in game yet
+		return qfalse;		// not in game yet
 
-	if( clent )
-	{
-		VectorCopy( clent->s.origin, org );
-		org[2] += clent->r.client->ps.viewheight;
-	}
-	else
-	{
+	if( !clent )
 		assert( client->mv );
-		VectorClear( org );
-	}
 
 	// this is the frame we are creating
 	frame = &client->snapShots[frameNum & UPDATE_MASK];
@@ -1162,39 +1282,97 @@ void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int f
 		frame->ps[0].playerNum = NUM_FOR_EDICT( clent ) - 1;
 	}
 
+	// store current match state information
+	frame->gameState = *gameState;
+
+	return qtrue;
+}
+
+/*
+* SNAP_BuildClientFrameEntities
+*
+* Decides which entities are going to be visible to the client and writes the
+* areabits. Only reads shared state, so clients can be culled in parallel as
+* long as each one has its own fatpvs and entsList.
+*/
+void SNAP_BuildClientFrameEntities( cmodel_state_t *cms, ginfo_t *gi, unsigned int frameNum, vec_t *skyorg, qbyte *fatpvs,
+								   snapshotEntityVis_t *entvis, client_t *client, snapshotEntityNumbers_t *entsList )
+{
+	int e;
+	vec3_t org;
+	edict_t	*clent;
+	client_snapshot_t *frame;
+
+	clent = client->edict;
+	if( clent )
+	{
+		VectorCopy( clent->s.origin, org );
+		org[2] += clent->r.client->ps.viewheight;
+	}
+	else
+	{
+		VectorClear( org );
+	}
+
+	frame = &client->snapShots[frameNum & UPDATE_MASK];
+
 	// build up the list of visible entities
 	//=============================
-	entsList.numSnapshotEntities = 0;
-	memset( entsList.entityAddedToSnapList, 0, sizeof( entsList.entityAddedToSnapList ) );
-	SNAP_BuildSnapEntitiesList( cms, gi, clent, org, fatvis->skyorg, fatvis->pvs, frame, &entsList );
+	entsList->numSnapshotEntities = 0;
+	memset( entsList->entityAddedToSnapList, 0, sizeof( entsList->entityAddedToSnapList ) );
+	SNAP_BuildSnapEntitiesList( cms, gi, clent, org, skyorg, fatpvs, entvis, frame, entsList );
 
-	//Com_Printf( "Snap NumEntities:%i\n", entsList.numSnapshotEntities );
+	//Com_Printf( "Snap NumEntities:%i\n", entsList->numSnapshotEntities );
 
 	if( developer->integer )
 	{
 		int olde = -1;
-		for( e = 0; e < entsList.numSnapshotEntities; e++ )
+		for( e = 0; e < entsList->numSnapshotEntities; e++ )
 		{
-			if( olde >= entsList.snapshotEntities[e] )
+			if( olde >= entsList->snapshotEntities[e] )
 				Com_Printf( "WARNING 'SV_BuildClientFrameSnap': Unsorted entities list\n" );
-			olde = entsList.snapshotEntities[e];
+			olde = entsList->snapshotEntities[e];
 		}
 	}
+}
 
-	// store current match state information
-	frame->gameState = *gameState;
+/*
+* SNAP_ReserveClientFrameEntities
+*
+* Takes the next numEntities slots of the circular client_entities array for the frame.
+*/
+void SNAP_ReserveClientFrameEntities( unsigned int frameNum, client_t *client, int numEntities, client_entities_t *client_entities )
+{
+	client_snapshot_t *frame;
 
-	//=============================
+	frame = &client->snapShots[frameNum & UPDATE_MASK];
+	frame->first_entity = client_entities->next_entities;
+	frame->num_entities = numEntities;
 
-	// dump the entities list
-	ne = client_entities->next_entities;
-	frame->num_entities = 0;
-	frame->first_entity = ne;
+	client_entities->next_entities += numEntities;
+}
+
+/*
+* SNAP_EmitClientFrameEntities
+*
+* Copies the states of the listed entities into the slots reserved for the frame.
+*/
+void SNAP_EmitClientFrameEntities( ginfo_t *gi, unsigned int frameNum, client_t *client,
+								  snapshotEntityNumbers_t *entsList, client_entities_t *client_entities )
+{
+	int e, ne;
+	edict_t	*ent;
+	client_snapshot_t *frame;
+	entity_state_t *state;
+
+	frame = &client->snapShots[frameNum & UPDATE_MASK];
+	assert( frame->num_entities == entsList->numSnapshotEntities );
 
-	for( e = 0; e < entsList.numSnapshotEntities; e++ )
+	ne = frame->first_entity;
+	for( e = 0; e < entsList->numSnapshotEntities; e++ )
 	{
 		// add it to the circular client_entities array
-		ent = EDICT_NUM( entsList.snapshotEntities[e] );
+		ent = EDICT_NUM( entsList->snapshotEntities[e] );
 		state = &client_entities->entities[ne%client_entities->num_entities];
 
 		*state = ent->s;
@@ -1204,11 +1382,34 @@ void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int f
 		if( ent->r.svflags & SVF_PROJECTILE )
 			state->solid = 0;
 
-		frame->num_entities++;
 		ne++;
 	}
+}
 
-	client_entities->next_entities = ne;
+/*
+* SNAP_BuildClientFrameSnap
+*
+* Decides which entities are going to be visible to the client, and
+* copies off the playerstat and areabits. fatvis->entvis must have been
+* built by SNAP_IndexFrameEntities in this frame.
+*/
+void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int frameNum, unsigned int timeStamp,
+							   fatvis_t *fatvis, client_t *client,
+							   game_state_t *gameState, client_entities_t *client_entities,
+							   qboolean relay, mempool_t *mempool )
+{
+	snapshotEntityNumbers_t entsList;
+
+	if( !SNAP_BeginClientFrameSnap( cms, gi, frameNum, timeStamp, client, gameState, relay, mempool ) )
+		return;
+
+	SNAP_BuildClientFrameEntities( cms, gi, frameNum, fatvis->skyorg, fatvis->pvs, &fatvis->entvis, client, &entsList );
+
+	//=============================
+
+	// dump the entities list
+	SNAP_ReserveClientFrameEntities( frameNum, client, entsList.numSnapshotEntities, client_entities );
+	SNAP_EmitClientFrameEntities( gi, frameNum, client, &entsList, client_entities );
 }
 
 /*
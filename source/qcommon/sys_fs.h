@@ -35,4 +35,11 @@ void	    Sys_FS_UnlockFile( void *handle );
 
 time_t		Sys_FS_FileMTime( const char *filename );
 
+void		*Sys_FS_MMapFile( int fileno, size_t size, size_t offset, void **mapping, size_t *mapping_offset );
+void		Sys_FS_UnMMapFile( void *mapping, void *data, size_t size, size_t mapping_offset );
+
+qboolean	Sys_FS_WatchDirectory( const char *path );
+const char	*Sys_FS_NextChangedFile( qboolean *lost );
+void		Sys_FS_StopWatching( void );
+
 #endif // __SYS_FS_H
@@ -0,0 +1,354 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "qcommon.h"
+#include "sys_threads.h"
+
+/*
+* QMutex_Create
+*/
+qmutex_t *QMutex_Create( void )
+{
+	int ret;
+	qmutex_t *mutex;
+
+	ret = Sys_Mutex_Create( &mutex );
+	if( ret != 0 )
+		Com_Error( ERR_FATAL, "QMutex_Create: failed with code %i", ret );
+	return mutex;
+}
+
+/*
+* QMutex_Destroy
+*/
+void QMutex_Destroy( qmutex_t **pmutex )
+{
+	assert( pmutex != NULL );
+	if( pmutex && *pmutex )
+	{
+		Sys_Mutex_Destroy( *pmutex );
+		*pmutex = NULL;
+	}
+}
+
+/*
+* QMutex_Lock
+*/
+void QMutex_Lock( qmutex_t *mutex )
+{
+	assert( mutex != NULL );
+	Sys_Mutex_Lock( mutex );
+}
+
+/*
+* QMutex_Unlock
+*/
+void QMutex_Unlock( qmutex_t *mutex )
+{
+	assert( mutex != NULL );
+	Sys_Mutex_Unlock( mutex );
+}
+
+/*
+* QCondVar_Create
+*/
+qcondvar_t *QCondVar_Create( void )
+{
+	int ret;
+	qcondvar_t *cond;
+
+	ret = Sys_CondVar_Create( &cond );
+	if( ret != 0 )
+		Com_Error( ERR_FATAL, "QCondVar_Create: failed with code %i", ret );
+	return cond;
+}
+
+/*
+* QCondVar_Destroy
+*/
+void QCondVar_Destroy( qcondvar_t **pcond )
+{
+	assert( pcond != NULL );
+	if( pcond && *pcond )
+	{
+		Sys_CondVar_Destroy( *pcond );
+		*pcond = NULL;
+	}
+}
+
+/*
+* QCondVar_Wait
+*
+* Returns qfalse if the timeout expired before the condition was signaled.
+*/
+qboolean QCondVar_Wait( qcondvar_t *cond, qmutex_t *mutex, unsigned int timeout_msec )
+{
+	return Sys_CondVar_Wait( cond, mutex, timeout_msec );
+}
+
+/*
+* QCondVar_Wake
+*
+* Wakes all threads waiting on the condition variable.
+*/
+void QCondVar_Wake( qcondvar_t *cond )
+{
+	Sys_CondVar_Wake( cond );
+}
+
+/*
+* QThread_Create
+*/
+qthread_t *QThread_Create( void *(*routine) (void*), void *param )
+{
+	int ret;
+	qthread_t *thread;
+
+	ret = Sys_Thread_Create( &thread, routine, param );
+	if( ret != 0 )
+		Com_Error( ERR_FATAL, "QThread_Create: failed with code %i", ret );
+	return thread;
+}
+
+/*
+* QThread_Join
+*/
+void QThread_Join( qthread_t *thread )
+{
+	if( thread )
+		Sys_Thread_Join( thread );
+}
+
+/*
+* QAtomic_Add
+*
+* Returns the value before the addition. The mutex is only used
+* where the platform has no atomic instructions.
+*/
+int QAtomic_Add( volatile int *value, int add, qmutex_t *mutex )
+{
+	return Sys_Atomic_Add( value, add, mutex );
+}
+
+/*
+* QAtomic_CAS
+*/
+qboolean QAtomic_CAS( volatile int *value, int oldval, int newval, qmutex_t *mutex )
+{
+	return Sys_Atomic_CAS( value, oldval, newval, mutex );
+}
+
+/*
+* QThreads_NumProcessors
+*/
+int QThreads_NumProcessors( void )
+{
+	return max( Sys_NumProcessors(), 1 );
+}
+
+/*
+=============================================================================
+
+Thread pool
+
+=============================================================================
+*/
+
+struct qthreadpool_s
+{
+	qmutex_t *mutex;
+	qcondvar_t *wakeCond;		// signaled when a loop starts or on shutdown
+	qcondvar_t *doneCond;		// signaled when the last worker leaves a loop
+
+	qthread_t **threads;
+	struct qthreadpoolworker_s *workers;
+	int numThreads;
+	qboolean shutdown;
+
+	// the loop being run
+	unsigned int generation;
+	qparallelfunc_t func;
+	void *param;
+	int count;
+	volatile int nextIndex;
+	int numBusy;
+};
+
+typedef struct qthreadpoolworker_s
+{
+	qthreadpool_t *pool;
+	int thread;
+} qthreadpoolworker_t;
+
+/*
+* QThreadPool_RunLoop
+*
+* Takes indices of the current loop until they run out.
+*/
+static void QThreadPool_RunLoop( qthreadpool_t *pool, int thread )
+{
+	int index;
+
+	while( ( index = QAtomic_Add( &pool->nextIndex, 1, pool->mutex ) ) < pool->count )
+		pool->func( pool->param, index, thread );
+}
+
+/*
+* QThreadPool_Worker
+*/
+static void *QThreadPool_Worker( void *param )
+{
+	qthreadpoolworker_t *worker = ( qthreadpoolworker_t * )param;
+	qthreadpool_t *pool = worker->pool;
+	unsigned int generation = 0;
+
+	QMutex_Lock( pool->mutex );
+	while( 1 )
+	{
+		while( !pool->shutdown && pool->generation == generation )
+			QCondVar_Wait( pool->wakeCond, pool->mutex, Q_THREADS_WAIT_INFINITE );
+		if( pool->shutdown )
+			break;
+		generation = pool->generation;
+		QMutex_Unlock( pool->mutex );
+
+		QThreadPool_RunLoop( pool, worker->thread );
+
+		QMutex_Lock( pool->mutex );
+		if( --pool->numBusy == 0 )
+			QCondVar_Wake( pool->doneCond );
+	}
+	QMutex_Unlock( pool->mutex );
+
+	return NULL;
+}
+
+/*
+* QThreadPool_Create
+*
+* Spawns numThreads workers next to the calling thread.
+*/
+qthreadpool_t *QThreadPool_Create( int numThreads )
+{
+	int i;
+	qthreadpool_t *pool;
+
+	pool = Mem_ZoneMallocExt( sizeof( *pool ), 1 );
+	pool->mutex = QMutex_Create();
+	pool->wakeCond = QCondVar_Create();
+	pool->doneCond = QCondVar_Create();
+
+	pool->numThreads = max( numThreads, 0 );
+	if( pool->numThreads )
+	{
+		pool->threads = Mem_ZoneMallocExt( sizeof( *pool->threads ) * pool->numThreads, 1 );
+		pool->workers = Mem_ZoneMallocExt( sizeof( *pool->workers ) * pool->numThreads, 1 );
+	}
+
+	for( i = 0; i < pool->numThreads; i++ )
+	{
+		pool->workers[i].pool = pool;
+		pool->workers[i].thread = i + 1;
+		pool->threads[i] = QThread_Create( QThreadPool_Worker, &pool->workers[i] );
+	}
+
+	return pool;
+}
+
+/*
+* QThreadPool_Destroy
+*/
+void QThreadPool_Destroy( qthreadpool_t **ppool )
+{
+	int i;
+	qthreadpool_t *pool;
+
+	assert( ppool != NULL );
+	if( !ppool || !*ppool )
+		return;
+	pool = *ppool;
+
+	QMutex_Lock( pool->mutex );
+	pool->shutdown = qtrue;
+	QCondVar_Wake( pool->wakeCond );
+	QMutex_Unlock( pool->mutex );
+
+	for( i = 0; i < pool->numThreads; i++ )
+		QThread_Join( pool->threads[i] );
+
+	if( pool->threads )
+		Mem_ZoneFree( pool->threads );
+	if( pool->workers )
+		Mem_ZoneFree( pool->workers );
+	QCondVar_Destroy( &pool->doneCond );
+	QCondVar_Destroy( &pool->wakeCond );
+	QMutex_Destroy( &pool->mutex );
+	Mem_ZoneFree( pool );
+
+	*ppool = NULL;
+}
+
+/*
+* QThreadPool_NumThreads
+*
+* Number of threads taking part in a loop, the caller included.
+*/
+int QThreadPool_NumThreads( const qthreadpool_t *pool )
+{
+	return pool ? pool->numThreads + 1 : 1;
+}
+
+/*
+* QThreadPool_ParallelFor
+*
+* Calls func for every index in [0, count) and returns when all calls are done.
+* The order of the calls and the thread running each of them are unspecified.
+*/
+void QThreadPool_ParallelFor( qthreadpool_t *pool, int count, qparallelfunc_t func, void *param )
+{
+	int i;
+
+	if( count <= 0 )
+		return;
+
+	if( !pool || !pool->numThreads || count == 1 )
+	{
+		for( i = 0; i < count; i++ )
+			func( param, i, 0 );
+		return;
+	}
+
+	QMutex_Lock( pool->mutex );
+	pool->func = func;
+	pool->param = param;
+	pool->count = count;
+	pool->nextIndex = 0;
+	pool->numBusy = pool->numThreads;
+	pool->generation++;
+	QCondVar_Wake( pool->wakeCond );
+	QMutex_Unlock( pool->mutex );
+
+	QThreadPool_RunLoop( pool, 0 );
+
+	QMutex_Lock( pool->mutex );
+	while( pool->numBusy > 0 )
+		QCondVar_Wait( pool->doneCond, pool->mutex, Q_THREADS_WAIT_INFINITE );
+	QMutex_Unlock( pool->mutex );
+}
@@ -105,10 +105,18 @@ typedef struct
 typedef struct
 {
 	char *name;
-	qbyte *data;            // file being downloaded
+	qbyte *data;            // file being downloaded, shared by all clients downloading it
 	int size;               // total bytes (can't use EOF because of paks)
 	unsigned int timeout;   // so we can free the file being downloaded
 	                        // if client omits sending success or failure message
+
+	qboolean windowed;      // client acknowledges every block, so several can be in flight
+	int ackOffset;          // client has received everything before this
+	int sentOffset;         // blocks before this have been sent
+	unsigned int ackTime;   // last time ackOffset advanced
+	unsigned int resendTime;    // last time the window was resent
+	unsigned int sendTime;  // last time the allowance was refilled
+	int allowance;          // bytes that can be sent now without going over the client rate
 } client_download_t;
 
 typedef struct
@@ -239,11 +247,32 @@ typedef struct client_entities_s
 	entity_state_t *entities;			// [num_entities]
 } client_entities_t;
 
+// entities grouped by the clusters they touch, built once per frame so that
+// culling each client only looks at the clusters in its PVS
+typedef struct snapshotEntityVis_s
+{
+	int numEntities;						// gi->num_edicts when indexed
+
+	int numPortalEntities;
+	int portalEntities[MAX_EDICTS];
+
+	int numSpecialEntities;					// broadcast, sound and headnode culled entities
+	int specialEntities[MAX_EDICTS];
+
+	int numClusterEntities;					// cluster * MAX_EDICTS + entity number, sorted
+	int clusterEntities[MAX_EDICTS*MAX_ENT_CLUSTERS];
+
+	int numOccupiedClusters;
+	int occupiedClusters[MAX_EDICTS*MAX_ENT_CLUSTERS];
+	int occupiedFirst[MAX_EDICTS*MAX_ENT_CLUSTERS+1];	// into clusterEntities
+} snapshotEntityVis_t;
+
 typedef struct fatvis_s
 {
 	vec_t *skyorg;
 	qbyte pvs[MAX_MAP_LEAFS/8];
 	qbyte phs[MAX_MAP_LEAFS/8];
+	snapshotEntityVis_t entvis;
 } fatvis_t;
 
 typedef struct
@@ -324,6 +353,7 @@ extern cvar_t *sv_highchars;
 //wsw : jal
 extern cvar_t *sv_maxrate;
 extern cvar_t *sv_compresspackets;
+extern cvar_t *sv_snapthreads;     // threads building client snapshots, -1 for one per processor
 extern cvar_t *sv_public;         // should heartbeats be sent
 
 // wsw : debug netcode
@@ -449,6 +479,8 @@ qboolean SV_ClientConnect( const socket_t *socket, const netadr_t *address, clie
 void SV_DropClient( client_t *drop, int type, const char *format, ... );
 void SV_ExecuteClientThinks( int clientNum );
 void SV_ClientResetCommandBuffers( client_t *client );
+void SV_ClientCloseDownload( client_t *client );
+void SV_SendClientDownloads( void );
 
 //
 // sv_mv.c
@@ -466,6 +498,7 @@ void SV_Status_f( void );
 //
 void SV_WriteFrameSnapToClient( client_t *client, msg_t *msg );
 void SV_BuildClientFrameSnap( client_t *client );
+void SV_ShutdownSnapThreads( void );
 
 
 void SV_Error( char *error, ... );
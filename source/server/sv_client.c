@@ -220,20 +220,7 @@ void SV_DropClient( client_t *drop, int type, const char *format, ... )
 
 	SNAP_FreeClientFrames( drop );
 
-	if( drop->download.name )
-	{
-		if( drop->download.data )
-		{
-			FS_FreeBaseFile( drop->download.data );
-			drop->download.data = NULL;
-		}
-
-		Mem_ZoneFree( drop->download.name );
-		drop->download.name = NULL;
-
-		drop->download.size = 0;
-		drop->download.timeout = 0;
-	}
+	SV_ClientCloseDownload( drop );
 
 	if( drop->individual_socket )
 		NET_CloseSocket( &drop->socket );
@@ -486,24 +473,219 @@ static void SV_Begin_f( client_t *client )
 //=============================================================================
 
 
+// blocks not acknowledged yet, every one of them costs the client a reliable command
+// until the server acknowledges the commands, so keep well under MAX_RELIABLE_COMMANDS
+#define DOWNLOAD_MIN_WINDOW		4
+#define DOWNLOAD_MAX_WINDOW		32
+
+typedef struct sv_uploadfile_s
+{
+	char *name;
+	qbyte *data;
+	int size;
+	int refcount;
+	struct sv_uploadfile_s *next;
+} sv_uploadfile_t;
+
+static sv_uploadfile_t *sv_uploadfiles;
+
+/*
+* SV_LoadUploadFile
+* 
+* Files being uploaded are loaded once and shared by all the clients downloading them.
+* The size is the one the client was told, a file which changed since then isn't shared
+*/
+static qbyte *SV_LoadUploadFile( const char *name, int size )
+{
+	sv_uploadfile_t *file;
+	qbyte *data;
+	size_t alloc_size;
+
+	for( file = sv_uploadfiles; file; file = file->next )
+	{
+		if( !strcmp( file->name, name ) && file->size == size )
+		{
+			file->refcount++;
+			return file->data;
+		}
+	}
+
+	if( FS_LoadBaseFile( name, (void **)&data, NULL, 0 ) != size )
+	{
+		if( data )
+			FS_FreeBaseFile( data );
+		return NULL;
+	}
+
+	alloc_size = sizeof( char ) * ( strlen( name ) + 1 );
+	file = Mem_ZoneMalloc( sizeof( *file ) + alloc_size );
+	file->name = ( char * )( file + 1 );
+	Q_strncpyz( file->name, name, alloc_size );
+	file->data = data;
+	file->size = size;
+	file->refcount = 1;
+	file->next = sv_uploadfiles;
+	sv_uploadfiles = file;
+
+	return data;
+}
+
+/*
+* SV_FreeUploadFile
+*/
+static void SV_FreeUploadFile( qbyte *data )
+{
+	sv_uploadfile_t *file, **prev;
+
+	for( prev = &sv_uploadfiles, file = *prev; file; prev = &file->next, file = *prev )
+	{
+		if( file->data != data )
+			continue;
+
+		if( --file->refcount > 0 )
+			return;
+
+		*prev = file->next;
+		FS_FreeBaseFile( file->data );
+		Mem_ZoneFree( file );
+		return;
+	}
+
+	assert( 0 );
+}
+
+/*
+* SV_ClientCloseDownload
+*/
+void SV_ClientCloseDownload( client_t *client )
+{
+	if( !client->download.name )
+		return;
+
+	if( client->download.data )
+		SV_FreeUploadFile( client->download.data );
+
+	Mem_ZoneFree( client->download.name );
+
+	memset( &client->download, 0, sizeof( client->download ) );
+}
+
+/*
+* SV_SendDownloadBlock
+* 
+* Sends the block of the download starting at offset in a message of its own,
+* returns the size of the message or 0 if it couldn't be sent
+* A blocksize of 0 makes the block fit in a single fragment when possible,
+* so losing a packet doesn't lose a whole fragmented message
+*/
+static int SV_SendDownloadBlock( client_t *client, int offset, int blocksize )
+{
+	SV_InitClientMessage( client, &tmpMessage, NULL, 0 );
+	SV_AddReliableCommandsToMessage( client, &tmpMessage );
+
+	if( !blocksize )
+	{
+		blocksize = FRAGMENT_SIZE - tmpMessage.cursize - strlen( client->download.name ) - 16;
+		clamp_low( blocksize, FRAGMENT_SIZE / 2 );
+	}
+	if( offset + blocksize > client->download.size )
+		blocksize = client->download.size - offset;
+
+	MSG_WriteByte( &tmpMessage, svc_download );
+	MSG_WriteString( &tmpMessage, client->download.name );
+	MSG_WriteLong( &tmpMessage, offset );
+	MSG_WriteLong( &tmpMessage, blocksize );
+	MSG_CopyData( &tmpMessage, client->download.data + offset, blocksize );
+
+	if( !SV_SendMessageToClient( client, &tmpMessage ) )
+		return 0;
+
+	client->download.sentOffset = offset + blocksize;
+	return tmpMessage.cursize;
+}
+
+/*
+* SV_SendClientDownload
+* 
+* Keeps the window of blocks not acknowledged yet full, paced to the client rate
+*/
+static void SV_SendClientDownload( client_t *client )
+{
+	client_download_t *dl = &client->download;
+	int window, maxallowance, sent;
+	unsigned int resendtime;
+
+	if( !dl->data || !dl->windowed )
+		return;
+
+	// resend everything not acknowledged if the client went quiet
+	resendtime = 2 * client->ping + 500;
+	if( dl->sentOffset > dl->ackOffset && max( dl->ackTime, dl->resendTime ) + resendtime < svs.realtime )
+	{
+		dl->sentOffset = dl->ackOffset;
+		dl->resendTime = svs.realtime;
+	}
+
+	// half a second worth of data at the client rate can be waiting for acknowledgement,
+	// and a tenth of a second of it can be sent at once
+	window = client->rate / 2;
+	clamp( window, DOWNLOAD_MIN_WINDOW * FRAGMENT_SIZE / 2, DOWNLOAD_MAX_WINDOW * FRAGMENT_SIZE / 2 );
+	maxallowance = max( client->rate / 10, MAX_PACKETLEN );
+
+	dl->allowance += (int)( (double)client->rate * ( svs.realtime - dl->sendTime ) / 1000 );
+	if( dl->allowance > maxallowance )
+		dl->allowance = maxallowance;
+	dl->sendTime = svs.realtime;
+
+	while( dl->allowance > 0 && dl->sentOffset < dl->size && dl->sentOffset - dl->ackOffset < window )
+	{
+		sent = SV_SendDownloadBlock( client, dl->sentOffset, 0 );
+		if( !sent )
+			break;
+		dl->allowance -= sent;
+	}
+}
+
+/*
+* SV_SendClientDownloads
+*/
+void SV_SendClientDownloads( void )
+{
+	int i;
+	client_t *client;
+
+	for( i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++ )
+	{
+		if( client->state == CS_FREE || client->state == CS_ZOMBIE )
+			continue;
+		if( client->edict && ( client->edict->r.svflags & SVF_FAKECLIENT ) )
+			continue;
+
+		SV_SendClientDownload( client );
+	}
+}
+
 /*
 * SV_NextDownload_f
 * 
 * Responds to reliable nextdl packet with unreliable download packet
 * If nextdl packet's offet information is negative, download will be stopped
+* 
+* Clients sending a third argument of 1 acknowledge every block they receive, and
+* get their blocks from SV_SendClientDownloads, a window of them at the client rate
 */
 static void SV_NextDownload_f( client_t *client )
 {
-	int blocksize;
+	client_download_t *dl = &client->download;
 	int offset;
 
-	if( !client->download.name )
+	if( !dl->name )
 	{
 		Com_Printf( "nextdl message for client with no download active, from: %s\n", client->name );
 		return;
 	}
 
-	if( Q_stricmp( client->download.name, Cmd_Argv( 1 ) ) )
+	if( Q_stricmp( dl->name, Cmd_Argv( 1 ) ) )
 	{
 		Com_Printf( "nextdl message for wrong filename, from: %s\n", client->name );
 		return;
@@ -511,7 +693,7 @@ static void SV_NextDownload_f( client_t *client )
 
 	offset = atoi( Cmd_Argv( 2 ) );
 
-	if( offset > client->download.size )
+	if( offset > dl->size )
 	{
 		Com_Printf( "nextdl message with too big offset, from: %s\n", client->name );
 		return;
@@ -519,68 +701,65 @@ static void SV_NextDownload_f( client_t *client )
 
 	if( offset == -1 )
 	{
-		Com_Printf( "Upload of %s to %s%s completed\n", client->download.name, client->name, S_COLOR_WHITE );
-		if( client->download.data )
-		{
-			FS_FreeBaseFile( client->download.data );
-			client->download.data = NULL;
-		}
-		Mem_ZoneFree( client->download.name );
-		client->download.name = NULL;
-		client->download.size = 0;
-		client->download.timeout = 0;
+		Com_Printf( "Upload of %s to %s%s completed\n", dl->name, client->name, S_COLOR_WHITE );
+		SV_ClientCloseDownload( client );
 		return;
 	}
 
 	if( offset < 0 )
 	{
-		Com_Printf( "Upload of %s to %s%s failed\n", client->download.name, client->name, S_COLOR_WHITE );
-		if( client->download.data )
-		{
-			FS_FreeBaseFile( client->download.data );
-			client->download.data = NULL;
-		}
-		Mem_ZoneFree( client->download.name );
-		client->download.name = NULL;
-		client->download.size = 0;
-		client->download.timeout = 0;
+		Com_Printf( "Upload of %s to %s%s failed\n", dl->name, client->name, S_COLOR_WHITE );
+		SV_ClientCloseDownload( client );
 		return;
 	}
 
-	if( !client->download.data )
+	if( !dl->data )
 	{
-		Com_Printf( "Starting server upload of %s to %s\n", client->download.name, client->name );
+		Com_Printf( "Starting server upload of %s to %s\n", dl->name, client->name );
 
-		FS_LoadBaseFile( client->download.name, (void **)&client->download.data, NULL, 0 );
-		if( !client->download.data )
+		dl->data = SV_LoadUploadFile( dl->name, dl->size );
+		if( !dl->data )
 		{
-			Com_Printf( "Error loading %s for uploading\n", client->download.name );
-			Mem_ZoneFree( client->download.name );
-			client->download.name = NULL;
-			client->download.size = 0;
-			client->download.timeout = 0;
+			Com_Printf( "Error loading %s for uploading\n", dl->name );
+			SV_ClientCloseDownload( client );
 			return;
 		}
+
+		dl->windowed = ( atoi( Cmd_Argv( 3 ) ) == 1 );
+		dl->ackOffset = dl->sentOffset = offset;
+		dl->ackTime = dl->sendTime = svs.realtime;
+		dl->resendTime = 0;
+		dl->allowance = MAX_PACKETLEN;
 	}
 
-	SV_InitClientMessage( client, &tmpMessage, NULL, 0 );
-	SV_AddReliableCommandsToMessage( client, &tmpMessage );
+	dl->timeout = svs.realtime + 10000;
 
-	blocksize = client->download.size - offset;
-	// jalfixme: adapt download to user rate setting and sv_maxrate setting.
-	if( blocksize > FRAGMENT_SIZE * 2 )
-		blocksize = FRAGMENT_SIZE * 2;
-	if( offset + blocksize > client->download.size )
-		blocksize = client->download.size - offset;
-
-	MSG_WriteByte( &tmpMessage, svc_download );
-	MSG_WriteString( &tmpMessage, client->download.name );
-	MSG_WriteLong( &tmpMessage, offset );
-	MSG_WriteLong( &tmpMessage, blocksize );
-	MSG_CopyData( &tmpMessage, client->download.data + offset, blocksize );
-	SV_SendMessageToClient( client, &tmpMessage );
+	if( !dl->windowed )
+	{
+		SV_SendDownloadBlock( client, offset, FRAGMENT_SIZE * 2 );
+		return;
+	}
 
-	client->download.timeout = svs.realtime + 10000;
+	if( offset > dl->ackOffset )
+	{
+		dl->ackOffset = offset;
+		dl->ackTime = svs.realtime;
+		if( dl->sentOffset < offset )
+			dl->sentOffset = offset;
+	}
+	else if( offset < dl->ackOffset )
+	{
+		// the client went back, follow it
+		dl->ackOffset = dl->sentOffset = offset;
+		dl->ackTime = dl->resendTime = svs.realtime;
+	}
+	else if( dl->sentOffset > offset && dl->resendTime + client->ping + 100 < svs.realtime )
+	{
+		// repeated acknowledgement, a block was lost, so send all from there again
+		// unless that was just done and the resent blocks can't have arrived yet
+		dl->sentOffset = offset;
+		dl->resendTime = svs.realtime;
+	}
 }
 
 /*
@@ -720,20 +899,7 @@ static void SV_BeginDownload_f( client_t *client )
 	}
 
 	// we will just overwrite old download, if any
-	if( client->download.name )
-	{
-		if( client->download.data )
-		{
-			FS_FreeBaseFile( client->download.data );
-			client->download.data = NULL;
-		}
-
-		Mem_ZoneFree( client->download.name );
-		client->download.name = NULL;
-
-		client->download.size = 0;
-		client->download.timeout = 0;
-	}
+	SV_ClientCloseDownload( client );
 
 	client->download.size = FS_LoadBaseFile( uploadname, NULL, NULL, 0 );
 	if( client->download.size == -1 )
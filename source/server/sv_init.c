@@ -492,6 +492,8 @@ void SV_ShutdownGame( const char *finalmsg, qboolean reconnect )
 	// get any latched variable changes (sv_maxclients, etc)
 	Cvar_GetLatchedVars( CVAR_LATCH );
 
+	SV_ShutdownSnapThreads();
+
 	if( svs.clients )
 	{
 		Mem_Free( svs.clients );
@@ -70,6 +70,7 @@ cvar_t *sv_reconnectlimit; // minimum seconds between connect messages
 
 cvar_t *sv_maxrate;
 cvar_t *sv_compresspackets;
+cvar_t *sv_snapthreads;
 cvar_t *sv_masterservers;
 cvar_t *sv_skilllevel;
 
@@ -164,6 +165,125 @@ static qboolean SV_ProcessPacket( netchan_t *netchan, msg_t *msg )
 	return qtrue;
 }
 
+#define SV_MAX_PACKET_BATCH	32
+#define SV_CLIENT_HASH_SIZE	512
+
+static qboolean sv_clientHashValid;
+static short sv_clientHash[SV_CLIENT_HASH_SIZE];
+static short sv_clientHashNext[MAX_CLIENTS];
+
+/*
+* SV_ClientHashKey
+*/
+static inline unsigned int SV_ClientHashKey( const netadr_t *address, int game_port )
+{
+	return ( NET_BaseAddressHash( address ) ^ ( game_port * 0x9E3779B1 ) ) & ( SV_CLIENT_HASH_SIZE - 1 );
+}
+
+/*
+* SV_BuildClientHash
+*
+* Hashes the clients that receive packets on the shared sockets by their
+* address and game port. Each chain is in client order.
+*/
+static void SV_BuildClientHash( void )
+{
+	int i;
+	unsigned int key;
+	client_t *cl;
+
+	memset( sv_clientHash, -1, sizeof( sv_clientHash ) );
+
+	for( i = sv_maxclients->integer - 1, cl = svs.clients + i; i >= 0; i--, cl-- )
+	{
+		if( cl->state == CS_FREE || cl->state == CS_ZOMBIE )
+			continue;
+		if( cl->edict && ( cl->edict->r.svflags & SVF_FAKECLIENT ) )
+			continue;
+
+		key = SV_ClientHashKey( &cl->netchan.remoteAddress, cl->netchan.game_port );
+		sv_clientHashNext[i] = sv_clientHash[key];
+		sv_clientHash[key] = i;
+	}
+
+	sv_clientHashValid = qtrue;
+}
+
+/*
+* SV_FindPacketClient
+*/
+static client_t *SV_FindPacketClient( const netadr_t *address, int game_port )
+{
+	int i;
+	client_t *cl;
+
+	if( !sv_clientHashValid )
+		SV_BuildClientHash();
+
+	for( i = sv_clientHash[SV_ClientHashKey( address, game_port )]; i >= 0; i = sv_clientHashNext[i] )
+	{
+		cl = svs.clients + i;
+
+		// clients may have been dropped since the hash was built
+		if( cl->state == CS_FREE || cl->state == CS_ZOMBIE )
+			continue;
+		if( cl->edict && ( cl->edict->r.svflags & SVF_FAKECLIENT ) )
+			continue;
+		if( !NET_CompareBaseAddress( address, &cl->netchan.remoteAddress ) )
+			continue;
+		if( cl->netchan.game_port != game_port )
+			continue;
+
+		return cl;
+	}
+
+	return NULL;
+}
+
+/*
+* SV_ReadPacket
+*/
+static void SV_ReadPacket( socket_t *socket, netadr_t *address, msg_t *msg )
+{
+	int game_port;
+	unsigned short addr_port;
+	client_t *cl;
+
+	// check for connectionless packet (0xffffffff) first
+	if( *(int *)msg->data == -1 )
+	{
+		SV_ConnectionlessPacket( socket, address, msg );
+		sv_clientHashValid = qfalse;
+		return;
+	}
+
+	// read the game port out of the message so we can fix up
+	// stupid address translating routers
+	MSG_BeginReading( msg );
+	MSG_ReadLong( msg ); // sequence number
+	MSG_ReadLong( msg ); // sequence number
+	game_port = MSG_ReadShort( msg ) & 0xffff;
+	// data follows
+
+	// check for packets from connected clients
+	cl = SV_FindPacketClient( address, game_port );
+	if( !cl )
+		return;
+
+	addr_port = NET_GetAddressPort( address );
+	if( NET_GetAddressPort( &cl->netchan.remoteAddress ) != addr_port )
+	{
+		Com_Printf( "SV_ReadPackets: fixing up a translated port\n" );
+		NET_SetAddressPort( &cl->netchan.remoteAddress, addr_port );
+	}
+
+	if( SV_ProcessPacket( &cl->netchan, msg ) ) // this is a valid, sequenced packet, so process it
+	{
+		cl->lastPacketReceivedTime = svs.realtime;
+		SV_ParseClientMessage( cl, msg );
+	}
+}
+
 /*
 * SV_ReadPackets
 */
@@ -175,12 +295,14 @@ static void SV_ReadPackets( void )
 	socket_t newsocket;
 	netadr_t mmserver;
 #endif
-	int game_port;
 	socket_t *socket;
 	netadr_t address;
 
 	static msg_t msg;
 	static qbyte msgData[MAX_MSGLEN];
+	static netadr_t batchAddresses[SV_MAX_PACKET_BATCH];
+	static msg_t batchMsgs[SV_MAX_PACKET_BATCH];
+	static qbyte batchMsgData[SV_MAX_PACKET_BATCH][MAX_MSGLEN];
 
 	socket_t* sockets [] =
 	{
@@ -262,6 +384,11 @@ static void SV_ReadPackets( void )
 #endif
 
 	MSG_Init( &msg, msgData, sizeof( msgData ) );
+	for( i = 0; i < SV_MAX_PACKET_BATCH; i++ )
+		MSG_Init( &batchMsgs[i], batchMsgData[i], sizeof( batchMsgData[i] ) );
+
+	// new clients can only come from connectionless packets
+	sv_clientHashValid = qfalse;
 
 	for( socketind = 0; socketind < sizeof( sockets ) / sizeof( sockets[0] ); socketind++ )
 	{
@@ -270,7 +397,7 @@ static void SV_ReadPackets( void )
 		if( !socket->open )
 			continue;
 
-		while( ( ret = NET_GetPacket( socket, &address, &msg ) ) != 0 )
+		while( ( ret = NET_GetPackets( socket, batchAddresses, batchMsgs, SV_MAX_PACKET_BATCH ) ) != 0 )
 		{
 			if( ret == -1 )
 			{
@@ -278,49 +405,8 @@ static void SV_ReadPackets( void )
 				continue;
 			}
 
-			// check for connectionless packet (0xffffffff) first
-			if( *(int *)msg.data == -1 )
-			{
-				SV_ConnectionlessPacket( socket, &address, &msg );
-				continue;
-			}
-
-			// read the game port out of the message so we can fix up
-			// stupid address translating routers
-			MSG_BeginReading( &msg );
-			MSG_ReadLong( &msg ); // sequence number
-			MSG_ReadLong( &msg ); // sequence number
-			game_port = MSG_ReadShort( &msg ) & 0xffff;
-			// data follows
-
-			// check for packets from connected clients
-			for( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ )
-			{
-				unsigned short addr_port;
-
-				if( cl->state == CS_FREE || cl->state == CS_ZOMBIE )
-					continue;
-				if( cl->edict && ( cl->edict->r.svflags & SVF_FAKECLIENT ) )
-					continue;
-				if( !NET_CompareBaseAddress( &address, &cl->netchan.remoteAddress ) )
-					continue;
-				if( cl->netchan.game_port != game_port )
-					continue;
-
-				addr_port = NET_GetAddressPort( &address );
-				if( NET_GetAddressPort( &cl->netchan.remoteAddress ) != addr_port )
-				{
-					Com_Printf( "SV_ReadPackets: fixing up a translated port\n" );
-					NET_SetAddressPort( &cl->netchan.remoteAddress, addr_port );
-				}
-
-				if( SV_ProcessPacket( &cl->netchan, &msg ) ) // this is a valid, sequenced packet, so process it
-				{
-					cl->lastPacketReceivedTime = svs.realtime;
-					SV_ParseClientMessage( cl, &msg );
-				}
-				break;
-			}
+			for( i = 0; i < ret; i++ )
+				SV_ReadPacket( socket, &batchAddresses[i], &batchMsgs[i] );
 		}
 	}
 
@@ -421,17 +507,7 @@ static void SV_CheckTimeouts( void )
 		{
 			Com_Printf( "Download of %s to %s%s timed out\n", cl->download.name, cl->name, S_COLOR_WHITE );
 
-			if( cl->download.data )
-			{
-				FS_FreeBaseFile( cl->download.data );
-				cl->download.data = NULL;
-			}
-
-			Mem_ZoneFree( cl->download.name );
-			cl->download.name = NULL;
-
-			cl->download.size = 0;
-			cl->download.timeout = 0;
+			SV_ClientCloseDownload( cl );
 		}
 	}
 }
@@ -723,6 +799,9 @@ void SV_Frame( int realmsec, int gamemsec )
 	// get packets from clients
 	SV_ReadPackets();
 
+	// keep the downloads flowing at the client rates
+	SV_SendClientDownloads();
+
 	// let everything in the world think and move
 	if( SV_RunGameFrame( gamemsec ) )
 	{
@@ -934,6 +1013,7 @@ void SV_Init( void )
 	// wsw : jal : cap client's exceding server rules
 	sv_maxrate =		    Cvar_Get( "sv_maxrate", "0", CVAR_DEVELOPER );
 	sv_compresspackets =	    Cvar_Get( "sv_compresspackets", "1", CVAR_DEVELOPER );
+	sv_snapthreads =	    Cvar_Get( "sv_snapthreads", "0", CVAR_ARCHIVE );
 	sv_skilllevel =		    Cvar_Get( "sv_skilllevel", "1", CVAR_SERVERINFO|CVAR_ARCHIVE|CVAR_LATCH );
 
 	if( sv_skilllevel->integer > 2 )
@@ -374,11 +374,13 @@ void SV_WriteFrameSnapToClient( client_t *client, msg_t *msg )
 }
 
 /*
-* SV_BuildClientFrameSnap
+* SV_SkyPortalOrigin
+*
+* Returns the sky portal origin if the sky portal shows entities, NULL otherwise.
 */
-void SV_BuildClientFrameSnap( client_t *client )
+static vec_t *SV_SkyPortalOrigin( vec3_t origin )
 {
-	vec_t *skyorg = NULL, origin[3];
+	vec_t *skyorg = NULL;
 
 	if( sv.configstrings[CS_SKYBOX][0] != '\0' )
 	{
@@ -392,7 +394,17 @@ void SV_BuildClientFrameSnap( client_t *client )
 		}
 	}
 
-	svs.fatvis.skyorg = skyorg;		// HACK HACK HACK
+	return skyorg;
+}
+
+/*
+* SV_BuildClientFrameSnap
+*/
+void SV_BuildClientFrameSnap( client_t *client )
+{
+	vec3_t origin;
+
+	svs.fatvis.skyorg = SV_SkyPortalOrigin( origin );		// HACK HACK HACK
 	SNAP_BuildClientFrameSnap( svs.cms, &sv.gi, sv.framenum, svs.gametime,
 		&svs.fatvis, client, ge->GetGameState(), 
 		&svs.client_entities,
@@ -421,6 +433,271 @@ static qboolean SV_SendClientDatagram( client_t *client )
 	return SV_SendMessageToClient( client, &tmpMessage );
 }
 
+/*
+* SV_SendClientReliableCommands
+*
+* Sends pending reliable commands to a client that is not in game yet,
+* or a heartbeat so it doesn't time out
+*/
+static void SV_SendClientReliableCommands( client_t *client )
+{
+	if( client->reliableSequence > client->reliableAcknowledge ||
+		svs.realtime - client->lastPacketSentTime > 1000 )
+	{
+		SV_InitClientMessage( client, &tmpMessage, NULL, 0 );
+		SV_AddReliableCommandsToMessage( client, &tmpMessage );
+		if( !SV_SendMessageToClient( client, &tmpMessage ) )
+		{
+			Com_Printf( "Error sending message to %s: %s\n", client->name, NET_ErrorString() );
+			if( client->reliable )
+			{
+				SV_DropClient( client, DROP_TYPE_GENERAL, "Error sending message: %s\n", NET_ErrorString() );
+			}
+		}
+	}
+}
+
+//=============================================================================
+//
+//PARALLEL SNAPSHOTS
+//
+//=============================================================================
+
+/*
+* With sv_snapthreads set, the culling, delta encoding and compression of the
+* client snapshots run on a thread pool. Everything that touches shared state
+* stays on the main thread and runs in client order: setting up the frames,
+* reserving client_entities slots and sending, so the messages come out the
+* same as from the serial path.
+*/
+
+typedef struct
+{
+	client_t *client;
+	qboolean inGame;			// SNAP_BeginClientFrameSnap accepted the client
+	int compressError;
+	msg_t msg;
+	qbyte msgData[MAX_MSGLEN];
+	snapshotEntityNumbers_t entsList;
+} sv_snapjob_t;
+
+typedef struct
+{
+	qbyte fatpvs[MAX_MAP_LEAFS/8];
+	qbyte compressData[MAX_MSGLEN];
+	struct netchan_zstream_s *zstream;
+} sv_snapthread_t;
+
+static qthreadpool_t *sv_snapPool;
+static sv_snapthread_t *sv_snapThreads;
+static int sv_numSnapThreads;
+static sv_snapjob_t *sv_snapJobs;
+static int sv_maxSnapJobs;
+static vec_t *sv_snapSkyorg;
+
+/*
+* SV_ShutdownSnapThreads
+*/
+void SV_ShutdownSnapThreads( void )
+{
+	int i;
+
+	QThreadPool_Destroy( &sv_snapPool );
+
+	if( sv_snapThreads )
+	{
+		for( i = 0; i < sv_numSnapThreads; i++ )
+			Netchan_FreeZStream( sv_snapThreads[i].zstream );
+		sv_numSnapThreads = 0;
+
+		Mem_Free( sv_snapThreads );
+		sv_snapThreads = NULL;
+	}
+
+	if( sv_snapJobs )
+	{
+		Mem_Free( sv_snapJobs );
+		sv_snapJobs = NULL;
+	}
+	sv_maxSnapJobs = 0;
+}
+
+/*
+* SV_UpdateSnapThreads
+*
+* Matches the thread pool to sv_snapthreads. Returns qfalse for the serial path.
+*/
+static qboolean SV_UpdateSnapThreads( void )
+{
+	int i, numThreads;
+
+	numThreads = sv_snapthreads->integer;
+	if( numThreads < 0 )
+		numThreads = QThreads_NumProcessors();
+	numThreads = min( numThreads, 64 );
+
+	if( numThreads <= 1 )
+	{
+		if( sv_snapPool )
+			SV_ShutdownSnapThreads();
+		return qfalse;
+	}
+
+	if( sv_snapPool && QThreadPool_NumThreads( sv_snapPool ) == numThreads && sv_maxSnapJobs == sv_maxclients->integer )
+		return qtrue;
+
+	SV_ShutdownSnapThreads();
+
+	// the calling thread takes part in the loops
+	sv_snapPool = QThreadPool_Create( numThreads - 1 );
+	sv_snapThreads = Mem_Alloc( sv_mempool, sizeof( *sv_snapThreads ) * numThreads );
+	sv_numSnapThreads = numThreads;
+	for( i = 0; i < numThreads; i++ )
+		sv_snapThreads[i].zstream = Netchan_CreateZStream();
+	sv_maxSnapJobs = sv_maxclients->integer;
+	sv_snapJobs = Mem_Alloc( sv_mempool, sizeof( *sv_snapJobs ) * sv_maxSnapJobs );
+
+	Com_Printf( "Building snapshots on %i threads\n", numThreads );
+	return qtrue;
+}
+
+/*
+* SV_BuildSnapJob
+*
+* Culls the entities of one client.
+*/
+static void SV_BuildSnapJob( void *param, int index, int thread )
+{
+	sv_snapjob_t *job = &sv_snapJobs[index];
+
+	if( !job->inGame )
+		return;
+
+	SNAP_BuildClientFrameEntities( svs.cms, &sv.gi, sv.framenum, sv_snapSkyorg, sv_snapThreads[thread].fatpvs,
+		&svs.fatvis.entvis, job->client, &job->entsList );
+}
+
+/*
+* SV_WriteSnapJob
+*
+* Fills the reserved entity slots, then delta encodes and compresses the message of one client.
+*/
+static void SV_WriteSnapJob( void *param, int index, int thread )
+{
+	sv_snapjob_t *job = &sv_snapJobs[index];
+
+	if( job->inGame )
+		SNAP_EmitClientFrameEntities( &sv.gi, sv.framenum, job->client, &job->entsList, &svs.client_entities );
+
+	SV_WriteFrameSnapToClient( job->client, &job->msg );
+
+	job->compressError = 0;
+	if( sv_compresspackets->integer )
+		job->compressError = Netchan_CompressMessageExt( &job->msg, sv_snapThreads[thread].compressData,
+			sizeof( sv_snapThreads[thread].compressData ), sv_snapThreads[thread].zstream );
+}
+
+/*
+* SV_SendSnapJob
+*/
+static qboolean SV_SendSnapJob( sv_snapjob_t *job )
+{
+	client_t *client = job->client;
+
+	if( job->compressError < 0 )
+	{          // it's compression error, just send uncompressed
+		Com_DPrintf( "SV_Netchan_Transmit (ignoring compression): Compression error %i\n", job->compressError );
+	}
+
+	// transmit the message data
+	client->lastPacketSentTime = svs.realtime;
+	if( !Netchan_PushAllFragments( &client->netchan ) )
+		return qfalse;
+	return Netchan_Transmit( &client->netchan, &job->msg );
+}
+
+/*
+* SV_SendClientMessagesParallel
+*/
+static void SV_SendClientMessagesParallel( void )
+{
+	int i, j, numJobs;
+	vec3_t skyorigin;
+	client_t *client;
+	sv_snapjob_t *job;
+	game_state_t *gameState;
+
+	gameState = ge->GetGameState();
+	sv_snapSkyorg = SV_SkyPortalOrigin( skyorigin );
+
+	// the workers only read the edicts
+	SNAP_IndexFrameEntities( &sv.gi, &svs.fatvis.entvis );
+
+	// set up the frames and write the reliable commands
+	numJobs = 0;
+	for( i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++ )
+	{
+		if( client->state != CS_SPAWNED )
+			continue;
+		if( client->edict && ( client->edict->r.svflags & SVF_FAKECLIENT ) )
+			continue;
+
+		job = &sv_snapJobs[numJobs++];
+		job->client = client;
+
+		SV_InitClientMessage( client, &job->msg, job->msgData, sizeof( job->msgData ) );
+		SV_AddReliableCommandsToMessage( client, &job->msg );
+
+		job->inGame = SNAP_BeginClientFrameSnap( svs.cms, &sv.gi, sv.framenum, svs.gametime,
+			client, gameState, qfalse, sv_mempool );
+	}
+
+	QThreadPool_ParallelFor( sv_snapPool, numJobs, SV_BuildSnapJob, NULL );
+
+	// reserve the entity slots in the same order as the serial path
+	for( j = 0; j < numJobs; j++ )
+	{
+		job = &sv_snapJobs[j];
+		if( job->inGame )
+			SNAP_ReserveClientFrameEntities( sv.framenum, job->client, job->entsList.numSnapshotEntities, &svs.client_entities );
+	}
+
+	QThreadPool_ParallelFor( sv_snapPool, numJobs, SV_WriteSnapJob, NULL );
+
+	sv_snapSkyorg = NULL;
+
+	// send a message to each connected client
+	for( i = 0, j = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++ )
+	{
+		if( client->state == CS_FREE || client->state == CS_ZOMBIE )
+			continue;
+
+		if( client->edict && ( client->edict->r.svflags & SVF_FAKECLIENT ) )
+		{
+			client->lastSentFrameNum = sv.framenum;
+			continue;
+		}
+
+		SV_UpdateActivity();
+
+		if( j < numJobs && sv_snapJobs[j].client == client )
+		{
+			if( !SV_SendSnapJob( &sv_snapJobs[j++] ) )
+			{
+				Com_Printf( "Error sending message to %s: %s\n", client->name, NET_ErrorString() );
+				if( client->reliable )
+				{
+					SV_DropClient( client, DROP_TYPE_GENERAL, "Error sending message: %s\n", NET_ErrorString() );
+				}
+			}
+		}
+		else if( client->state != CS_SPAWNED )
+		{
+			SV_SendClientReliableCommands( client );
+		}
+	}
+}
+
 /*
 * SV_SendClientMessages
 */
@@ -429,6 +706,18 @@ void SV_SendClientMessages( void )
 	int i;
 	client_t *client;
 
+	// the datagrams go out together at the end
+	NET_BeginSendBatch();
+
+	if( SV_UpdateSnapThreads() )
+	{
+		SV_SendClientMessagesParallel();
+		NET_EndSendBatch();
+		return;
+	}
+
+	SNAP_IndexFrameEntities( &sv.gi, &svs.fatvis.entvis );
+
 	// send a message to each connected client
 	for( i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++ )
 	{
@@ -457,20 +746,9 @@ void SV_SendClientMessages( void )
 		else
 		{
 			// send pending reliable commands, or send heartbeats for not timing out
-			if( client->reliableSequence > client->reliableAcknowledge ||
-				svs.realtime - client->lastPacketSentTime > 1000 )
-			{
-				SV_InitClientMessage( client, &tmpMessage, NULL, 0 );
-				SV_AddReliableCommandsToMessage( client, &tmpMessage );
-				if( !SV_SendMessageToClient( client, &tmpMessage ) )
-				{
-					Com_Printf( "Error sending message to %s: %s\n", client->name, NET_ErrorString() );
-					if( client->reliable )
-					{
-						SV_DropClient( client, DROP_TYPE_GENERAL, "Error sending message: %s\n", NET_ErrorString() );
-					}
-				}
-			}
+			SV_SendClientReliableCommands( client );
 		}
 	}
+
+	NET_EndSendBatch();
 }
@@ -24,6 +24,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <dirent.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#define USE_INOTIFY
+#endif
 
 // Mac OS X and FreeBSD don't know the readdir64 and dirent64
 #if ( defined (__FreeBSD__) || !defined(_LARGEFILE64_SOURCE) )
@@ -40,6 +46,19 @@ static DIR *fdir = NULL;
 static int fdfd = -1;
 static int fdots = 0;
 
+#ifdef USE_INOTIFY
+#define MAX_WATCHED_DIRS	32
+
+static int watchfd = -1;
+static int numwatches = 0;
+static int watchwds[MAX_WATCHED_DIRS];
+static char *watchpaths[MAX_WATCHED_DIRS];
+static qbyte watchbuf[4096] __attribute__ ( ( aligned( __alignof__( struct inotify_event ) ) ) );
+static int watchbufpos = 0, watchbufsize = 0;
+static char *watchfile = NULL;
+static size_t watchfile_size = 0;
+#endif
+
 /*
 * CompareAttributes
 */
@@ -239,3 +258,161 @@ time_t Sys_FS_FileMTime( const char *filename )
 	}
 	return buffer.st_mtime;
 }
+
+/*
+* Sys_FS_MMapFile
+* 
+* Maps a private, writable copy of size bytes of the open file starting at offset
+*/
+void *Sys_FS_MMapFile( int fileno, size_t size, size_t offset, void **mapping, size_t *mapping_offset )
+{
+	qbyte *data;
+	size_t dataoffset;
+
+	assert( mapping );
+	assert( mapping_offset );
+
+	dataoffset = offset % sysconf( _SC_PAGESIZE );
+
+	data = mmap( NULL, size + dataoffset, PROT_READ|PROT_WRITE, MAP_PRIVATE, fileno, offset - dataoffset );
+	if( data == MAP_FAILED )
+		return NULL;
+
+	*mapping = data;
+	*mapping_offset = dataoffset;
+	return data + dataoffset;
+}
+
+/*
+* Sys_FS_UnMMapFile
+*/
+void Sys_FS_UnMMapFile( void *mapping, void *data, size_t size, size_t mapping_offset )
+{
+	munmap( mapping, size + mapping_offset );
+}
+
+/*
+* Sys_FS_WatchDirectory
+* 
+* Starts reporting the files written or moved into the directory
+*/
+qboolean Sys_FS_WatchDirectory( const char *path )
+{
+#ifdef USE_INOTIFY
+	int wd;
+
+	if( watchfd == -1 )
+	{
+		watchfd = inotify_init1( IN_NONBLOCK|IN_CLOEXEC );
+		if( watchfd == -1 )
+			return qfalse;
+	}
+
+	if( numwatches == MAX_WATCHED_DIRS )
+		return qfalse;
+
+	wd = inotify_add_watch( watchfd, path, IN_CLOSE_WRITE|IN_MOVED_TO );
+	if( wd == -1 )
+		return qfalse;
+
+	watchwds[numwatches] = wd;
+	watchpaths[numwatches] = ZoneCopyString( path );
+	numwatches++;
+	return qtrue;
+#else
+	return qfalse;
+#endif
+}
+
+/*
+* Sys_FS_NextChangedFile
+* 
+* Gives the path of the next file written in one of the watched directories, NULL if there
+* are none. lost is set when there were more changes than could be kept track of.
+*/
+const char *Sys_FS_NextChangedFile( qboolean *lost )
+{
+#ifdef USE_INOTIFY
+	int i;
+	ssize_t len;
+	size_t size;
+	const struct inotify_event *event;
+
+	if( watchfd == -1 )
+		return NULL;
+
+	while( 1 )
+	{
+		if( watchbufpos >= watchbufsize )
+		{
+			watchbufpos = watchbufsize = 0;
+			len = read( watchfd, watchbuf, sizeof( watchbuf ) );
+			if( len <= 0 )
+				return NULL;
+			watchbufsize = len;
+		}
+
+		event = ( const struct inotify_event * )( watchbuf + watchbufpos );
+		watchbufpos += sizeof( *event ) + event->len;
+
+		if( event->mask & IN_Q_OVERFLOW )
+		{
+			if( lost )
+				*lost = qtrue;
+			continue;
+		}
+		if( ( event->mask & IN_ISDIR ) || !event->len )
+			continue;
+
+		for( i = 0; i < numwatches; i++ )
+		{
+			if( watchwds[i] == event->wd )
+				break;
+		}
+		if( i == numwatches )
+			continue;
+
+		size = sizeof( char ) * ( strlen( watchpaths[i] ) + 1 + strlen( event->name ) + 1 );
+		if( watchfile_size < size )
+		{
+			if( watchfile )
+				Mem_ZoneFree( watchfile );
+			watchfile_size = size * 2;
+			watchfile = Mem_ZoneMalloc( watchfile_size );
+		}
+
+		Q_snprintfz( watchfile, watchfile_size, "%s/%s", watchpaths[i], event->name );
+		return watchfile;
+	}
+#else
+	return NULL;
+#endif
+}
+
+/*
+* Sys_FS_StopWatching
+*/
+void Sys_FS_StopWatching( void )
+{
+#ifdef USE_INOTIFY
+	int i;
+
+	for( i = 0; i < numwatches; i++ )
+		Mem_ZoneFree( watchpaths[i] );
+	numwatches = 0;
+
+	if( watchfd != -1 )
+	{
+		close( watchfd );
+		watchfd = -1;
+	}
+	watchbufpos = watchbufsize = 0;
+
+	if( watchfile )
+	{
+		Mem_ZoneFree( watchfile );
+		watchfile = NULL;
+		watchfile_size = 0;
+	}
+#endif
+}
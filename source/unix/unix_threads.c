@@ -0,0 +1,211 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../qcommon/qcommon.h"
+#include "../qcommon/sys_threads.h"
+
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+struct qthread_s {
+	pthread_t t;
+};
+
+struct qmutex_s {
+	pthread_mutex_t m;
+};
+
+struct qcondvar_s {
+	pthread_cond_t c;
+};
+
+/*
+* Sys_Mutex_Create
+*/
+int Sys_Mutex_Create( qmutex_t **pmutex )
+{
+	int res;
+	qmutex_t *mutex;
+
+	mutex = ( qmutex_t * )malloc( sizeof( *mutex ) );
+	if( !mutex )
+		return -1;
+	res = pthread_mutex_init( &mutex->m, NULL );
+	if( res != 0 )
+	{
+		free( mutex );
+		return res;
+	}
+
+	*pmutex = mutex;
+	return 0;
+}
+
+/*
+* Sys_Mutex_Destroy
+*/
+void Sys_Mutex_Destroy( qmutex_t *mutex )
+{
+	if( !mutex )
+		return;
+	pthread_mutex_destroy( &mutex->m );
+	free( mutex );
+}
+
+/*
+* Sys_Mutex_Lock
+*/
+void Sys_Mutex_Lock( qmutex_t *mutex )
+{
+	pthread_mutex_lock( &mutex->m );
+}
+
+/*
+* Sys_Mutex_Unlock
+*/
+void Sys_Mutex_Unlock( qmutex_t *mutex )
+{
+	pthread_mutex_unlock( &mutex->m );
+}
+
+/*
+* Sys_CondVar_Create
+*/
+int Sys_CondVar_Create( qcondvar_t **pcond )
+{
+	int res;
+	qcondvar_t *cond;
+
+	cond = ( qcondvar_t * )malloc( sizeof( *cond ) );
+	if( !cond )
+		return -1;
+	res = pthread_cond_init( &cond->c, NULL );
+	if( res != 0 )
+	{
+		free( cond );
+		return res;
+	}
+
+	*pcond = cond;
+	return 0;
+}
+
+/*
+* Sys_CondVar_Destroy
+*/
+void Sys_CondVar_Destroy( qcondvar_t *cond )
+{
+	if( !cond )
+		return;
+	pthread_cond_destroy( &cond->c );
+	free( cond );
+}
+
+/*
+* Sys_CondVar_Wait
+*/
+qboolean Sys_CondVar_Wait( qcondvar_t *cond, qmutex_t *mutex, unsigned int timeout_msec )
+{
+	struct timeval now;
+	struct timespec ts;
+
+	if( timeout_msec == Q_THREADS_WAIT_INFINITE )
+		return pthread_cond_wait( &cond->c, &mutex->m ) == 0;
+
+	gettimeofday( &now, NULL );
+	ts.tv_sec = now.tv_sec + timeout_msec / 1000;
+	ts.tv_nsec = ( now.tv_usec + ( timeout_msec % 1000 ) * 1000 ) * 1000;
+	if( ts.tv_nsec >= 1000000000 )
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	return pthread_cond_timedwait( &cond->c, &mutex->m, &ts ) == 0;
+}
+
+/*
+* Sys_CondVar_Wake
+*/
+void Sys_CondVar_Wake( qcondvar_t *cond )
+{
+	pthread_cond_broadcast( &cond->c );
+}
+
+/*
+* Sys_Thread_Create
+*/
+int Sys_Thread_Create( qthread_t **pthread, void *(*routine) (void*), void *param )
+{
+	int res;
+	qthread_t *thread;
+
+	thread = ( qthread_t * )malloc( sizeof( *thread ) );
+	if( !thread )
+		return -1;
+	res = pthread_create( &thread->t, NULL, routine, param );
+	if( res != 0 )
+	{
+		free( thread );
+		return res;
+	}
+
+	*pthread = thread;
+	return 0;
+}
+
+/*
+* Sys_Thread_Join
+*/
+void Sys_Thread_Join( qthread_t *thread )
+{
+	pthread_join( thread->t, NULL );
+	free( thread );
+}
+
+/*
+* Sys_Atomic_Add
+*/
+int Sys_Atomic_Add( volatile int *value, int add, qmutex_t *mutex )
+{
+	return __sync_fetch_and_add( value, add );
+}
+
+/*
+* Sys_Atomic_CAS
+*/
+qboolean Sys_Atomic_CAS( volatile int *value, int oldval, int newval, qmutex_t *mutex )
+{
+	return __sync_bool_compare_and_swap( value, oldval, newval ) ? qtrue : qfalse;
+}
+
+/*
+* Sys_NumProcessors
+*/
+int Sys_NumProcessors( void )
+{
+#ifdef _SC_NPROCESSORS_ONLN
+	return (int)sysconf( _SC_NPROCESSORS_ONLN );
+#else
+	return 1;
+#endif
+}
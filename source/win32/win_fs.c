@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "winquake.h"
 #include <direct.h>
+#include <io.h>
 #include <shlobj.h>
 
 #ifndef CSIDL_APPDATA
@@ -258,3 +259,73 @@ time_t Sys_FS_FileMTime( const char *filename )
 
 	return time;
 }
+
+/*
+* Sys_FS_MMapFile
+* 
+* Maps a private, writable copy of size bytes of the open file starting at offset
+*/
+void *Sys_FS_MMapFile( int fileno, size_t size, size_t offset, void **mapping, size_t *mapping_offset )
+{
+	HANDLE handle, fmapping;
+	SYSTEM_INFO sysInfo;
+	size_t dataoffset;
+	qbyte *data;
+
+	assert( mapping );
+	assert( mapping_offset );
+
+	handle = (HANDLE)_get_osfhandle( fileno );
+	if( handle == INVALID_HANDLE_VALUE )
+		return NULL;
+
+	fmapping = CreateFileMapping( handle, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+	if( !fmapping )
+		return NULL;
+
+	GetSystemInfo( &sysInfo );
+	dataoffset = offset % sysInfo.dwAllocationGranularity;
+
+	data = MapViewOfFile( fmapping, FILE_MAP_COPY, 0, (DWORD)( offset - dataoffset ), size + dataoffset );
+	if( !data )
+	{
+		CloseHandle( fmapping );
+		return NULL;
+	}
+
+	*mapping = (void *)fmapping;
+	*mapping_offset = dataoffset;
+	return data + dataoffset;
+}
+
+/*
+* Sys_FS_UnMMapFile
+*/
+void Sys_FS_UnMMapFile( void *mapping, void *data, size_t size, size_t mapping_offset )
+{
+	UnmapViewOfFile( (qbyte *)data - mapping_offset );
+	CloseHandle( (HANDLE)mapping );
+}
+
+/*
+* Sys_FS_WatchDirectory
+*/
+qboolean Sys_FS_WatchDirectory( const char *path )
+{
+	return qfalse;
+}
+
+/*
+* Sys_FS_NextChangedFile
+*/
+const char *Sys_FS_NextChangedFile( qboolean *lost )
+{
+	return NULL;
+}
+
+/*
+* Sys_FS_StopWatching
+*/
+void Sys_FS_StopWatching( void )
+{
+}
@@ -0,0 +1,197 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../qcommon/qcommon.h"
+#include "../qcommon/sys_threads.h"
+
+#include <windows.h>
+#include <process.h>
+
+// condition variables need Windows Vista or newer
+struct qthread_s {
+	HANDLE h;
+	void *(*routine) (void*);
+	void *param;
+};
+
+struct qmutex_s {
+	CRITICAL_SECTION h;
+};
+
+struct qcondvar_s {
+	CONDITION_VARIABLE c;
+};
+
+/*
+* Sys_Mutex_Create
+*/
+int Sys_Mutex_Create( qmutex_t **pmutex )
+{
+	qmutex_t *mutex;
+
+	mutex = ( qmutex_t * )malloc( sizeof( *mutex ) );
+	if( !mutex )
+		return -1;
+	InitializeCriticalSection( &mutex->h );
+
+	*pmutex = mutex;
+	return 0;
+}
+
+/*
+* Sys_Mutex_Destroy
+*/
+void Sys_Mutex_Destroy( qmutex_t *mutex )
+{
+	if( !mutex )
+		return;
+	DeleteCriticalSection( &mutex->h );
+	free( mutex );
+}
+
+/*
+* Sys_Mutex_Lock
+*/
+void Sys_Mutex_Lock( qmutex_t *mutex )
+{
+	EnterCriticalSection( &mutex->h );
+}
+
+/*
+* Sys_Mutex_Unlock
+*/
+void Sys_Mutex_Unlock( qmutex_t *mutex )
+{
+	LeaveCriticalSection( &mutex->h );
+}
+
+/*
+* Sys_CondVar_Create
+*/
+int Sys_CondVar_Create( qcondvar_t **pcond )
+{
+	qcondvar_t *cond;
+
+	cond = ( qcondvar_t * )malloc( sizeof( *cond ) );
+	if( !cond )
+		return -1;
+	InitializeConditionVariable( &cond->c );
+
+	*pcond = cond;
+	return 0;
+}
+
+/*
+* Sys_CondVar_Destroy
+*/
+void Sys_CondVar_Destroy( qcondvar_t *cond )
+{
+	if( !cond )
+		return;
+	free( cond );
+}
+
+/*
+* Sys_CondVar_Wait
+*/
+qboolean Sys_CondVar_Wait( qcondvar_t *cond, qmutex_t *mutex, unsigned int timeout_msec )
+{
+	return SleepConditionVariableCS( &cond->c, &mutex->h, timeout_msec == Q_THREADS_WAIT_INFINITE ? INFINITE : timeout_msec ) != 0;
+}
+
+/*
+* Sys_CondVar_Wake
+*/
+void Sys_CondVar_Wake( qcondvar_t *cond )
+{
+	WakeAllConditionVariable( &cond->c );
+}
+
+/*
+* Sys_Thread_Entry
+*/
+static unsigned __stdcall Sys_Thread_Entry( void *param )
+{
+	qthread_t *thread = ( qthread_t * )param;
+
+	thread->routine( thread->param );
+	return 0;
+}
+
+/*
+* Sys_Thread_Create
+*/
+int Sys_Thread_Create( qthread_t **pthread, void *(*routine) (void*), void *param )
+{
+	qthread_t *thread;
+
+	thread = ( qthread_t * )malloc( sizeof( *thread ) );
+	if( !thread )
+		return -1;
+	thread->routine = routine;
+	thread->param = param;
+
+	thread->h = (HANDLE)_beginthreadex( NULL, 0, Sys_Thread_Entry, thread, 0, NULL );
+	if( !thread->h )
+	{
+		free( thread );
+		return GetLastError();
+	}
+
+	*pthread = thread;
+	return 0;
+}
+
+/*
+* Sys_Thread_Join
+*/
+void Sys_Thread_Join( qthread_t *thread )
+{
+	WaitForSingleObject( thread->h, INFINITE );
+	CloseHandle( thread->h );
+	free( thread );
+}
+
+/*
+* Sys_Atomic_Add
+*/
+int Sys_Atomic_Add( volatile int *value, int add, qmutex_t *mutex )
+{
+	return InterlockedExchangeAdd( (volatile LONG*)value, add );
+}
+
+/*
+* Sys_Atomic_CAS
+*/
+qboolean Sys_Atomic_CAS( volatile int *value, int oldval, int newval, qmutex_t *mutex )
+{
+	return InterlockedCompareExchange( (volatile LONG*)value, newval, oldval ) == oldval ? qtrue : qfalse;
+}
+
+/*
+* Sys_NumProcessors
+*/
+int Sys_NumProcessors( void )
+{
+	SYSTEM_INFO sysInfo;
+
+	GetSystemInfo( &sysInfo );
+	return sysInfo.dwNumberOfProcessors;
+}